@@ -78,6 +78,16 @@ public class Main
                 LogConfig.getLogger().info("Keys generated successfully.");
                 return;
             }
+            ArgOption<MapArgOptions> workerJobs = argParser.getOptionParams(
+                    MapArgOptions.WORKER_JOBS);
+            if (workerJobs != null)
+            {
+                LogConfig.getLogger().info("Skipping normal map creation and"
+                        + " running as a worker process.");
+                new MapCreator().runWorkerJobs(
+                        new File(workerJobs.getParameter(0)));
+                return;
+            }
         }
         catch (IllegalArgumentException e)
         {
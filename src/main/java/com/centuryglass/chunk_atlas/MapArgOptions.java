@@ -65,6 +65,11 @@ public enum MapArgOptions
      * maps.
      */
     BOUNDS,
+    /**
+     * Sets whether single-image map bounds are reduced to the area covered by
+     * region files.
+     */
+    AUTO_CROP,
     
     // Tile map options:
     /**
@@ -81,6 +86,61 @@ public enum MapArgOptions
      * of map tiles.
      */
     TILE_ALT_SIZES,
+    /**
+     * Sets the order in which region files are scanned when creating tile
+     * maps.
+     */
+    RENDER_ORDER,
+    /**
+     * Sets whether low-detail preview tiles should be created before the
+     * full map is drawn.
+     */
+    PREVIEW,
+    /**
+     * Sets whether zoomed out tiles should be built from each set of map
+     * tiles.
+     */
+    ZOOM_LEVELS,
+    /**
+     * Sets whether tiles saved by an earlier run should be reused, redrawing
+     * only regions that changed.
+     */
+    INCREMENTAL,
+    /**
+     * Sets whether tiles identical to their saved images, and empty tiles,
+     * should be left out when saving tile maps.
+     */
+    SKIP_UNCHANGED,
+    /**
+     * Sets the bounds (in Minecraft chunks) of the only area redrawn within
+     * saved tile maps.
+     */
+    TILE_BOUNDS,
+    /**
+     * Sets whether compact data tiles holding the chunk values used by every
+     * map type should be saved with tile maps.
+     */
+    DATA_TILES,
+    /**
+     * Sets the compression level and row filter used when saving map images
+     * as PNG files.
+     */
+    PNG_ENCODING,
+    /**
+     * Sets whether map generation checkpoints should be saved and resumed,
+     * and the directory where they will be saved.
+     */
+    CHECKPOINTS,
+    /**
+     * Sets whether tile maps should be created by worker processes, and how
+     * many worker processes to launch.
+     */
+    WORKERS,
+    /**
+     * Runs as a worker process, mapping jobs from a shared job directory
+     * instead of performing any normal operations.
+     */
+    WORKER_JOBS,
     
     // Map type options:
     /**
@@ -161,6 +221,9 @@ public enum MapArgOptions
         parserFactory.setOptionProperties(BOUNDS, "b", "--bounds", 4, 4,
                 "<xMin> <zMin> <width> <height>",
                 "Set the area in chunks that should be mapped.");
+        parserFactory.setOptionProperties(AUTO_CROP, "-C", "--auto-crop", 0,
+                1, optionalBool,
+                "Crop single-image maps to the area covered by region files.");
         
         parserFactory.setOptionProperties(TILE_MAP, "-t", "--tile-map", 1, 1,
                 "(<false>|<outputPath>)",
@@ -173,6 +236,53 @@ public enum MapArgOptions
         parserFactory.setOptionProperties(TILE_ALT_SIZES, "-a",
                 "--alt-tile-sizes", 1, Integer.MAX_VALUE / 10, "<size>...",
                 "Sets one or more alternate sizes of tile image to create.");
+        parserFactory.setOptionProperties(RENDER_ORDER, "-o",
+                "--render-order", 1, 1, "(POSITION|RECENT|CHUNK_COUNT|ZORDER)",
+                "Sets whether tiles are rendered by position, most recently"
+                + " updated first, most chunks first, or in Z-order blocks of"
+                + " nearby tiles.");
+        parserFactory.setOptionProperties(PREVIEW, "-v", "--preview", 0, 1,
+                optionalBool,
+                "Quickly create rough preview tiles before drawing full"
+                + " detail tile maps.");
+        parserFactory.setOptionProperties(ZOOM_LEVELS, "-y",
+                "--zoom-levels", 0, 1, optionalBool,
+                "Build a pyramid of zoomed out tiles from each tile map.");
+        parserFactory.setOptionProperties(INCREMENTAL, "-e",
+                "--incremental", 0, 1, optionalBool,
+                "Only redraw tiles covering region files that changed since"
+                + " the last run.");
+        parserFactory.setOptionProperties(SKIP_UNCHANGED, "-x",
+                "--skip-unchanged", 0, 1, optionalBool,
+                "Don't rewrite tiles with unchanged content or save empty"
+                + " tiles.");
+        parserFactory.setOptionProperties(TILE_BOUNDS, "-q",
+                "--tile-bounds", 1, 4,
+                "(<false>|<xMin> <zMin> <width> <height>)",
+                "Only redraw chunks within an area in chunks, updating that"
+                + " area of saved tiles.");
+        parserFactory.setOptionProperties(DATA_TILES, "-f",
+                "--data-tiles", 0, 1, optionalBool,
+                "Save compact chunk data tiles, so map types can be drawn by"
+                + " the map viewer.");
+        parserFactory.setOptionProperties(PNG_ENCODING, "-z",
+                "--png-encoding", 1, 2,
+                "<level> [(NONE|SUB|UP|AVERAGE|PAETH|ADAPTIVE)]",
+                "Sets the PNG compression level (0-9) and row filter used"
+                + " when saving map images.");
+        parserFactory.setOptionProperties(CHECKPOINTS, "-k",
+                "--checkpoints", 1, 1, "(<false>|<checkpointPath>)",
+                "Set if and where to save checkpoints, allowing interrupted"
+                + " tile map generation to resume.");
+        parserFactory.setOptionProperties(WORKERS, "-n", "--workers", 1, 2,
+                "(<false>|<processCount> [<jobPath>])",
+                "Set if tile maps should be divided between worker processes,"
+                + " the number of workers to launch, and where jobs are"
+                + " shared.");
+        parserFactory.setOptionProperties(WORKER_JOBS, "-j",
+                "--worker-jobs", 1, 1, "<jobPath>",
+                "Skips all normal operations, and instead maps jobs shared"
+                + " by another ChunkAtlas process until none remain.");
         parserFactory.setOptionProperties(GENERATE_RSA_KEYPAIR, "-g",
                 "--generate-rsa", 2, 2,
                 "</path/to/publicKeyFile> </path/to/privateKeyFile>",
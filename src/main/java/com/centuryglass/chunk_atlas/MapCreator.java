@@ -8,35 +8,60 @@ package com.centuryglass.chunk_atlas;
 
 import com.centuryglass.chunk_atlas.config.LogConfig;
 import com.centuryglass.chunk_atlas.config.MapGenConfig;
+import com.centuryglass.chunk_atlas.mapping.GenerationManifest;
+import com.centuryglass.chunk_atlas.mapping.MapCheckpoint;
 import com.centuryglass.chunk_atlas.mapping.MapCollector;
+import com.centuryglass.chunk_atlas.mapping.MapOptions;
+import com.centuryglass.chunk_atlas.mapping.MapPreview;
+import com.centuryglass.chunk_atlas.mapping.TileManifest;
 import com.centuryglass.chunk_atlas.mapping.maptype.MapType;
-import com.centuryglass.chunk_atlas.mapping.TileMap;
-import com.centuryglass.chunk_atlas.mapping.images.ImageStitcher;
+import com.centuryglass.chunk_atlas.mapping.images.PngEncoder;
+import com.centuryglass.chunk_atlas.mapping.images.TileWriter;
 import com.centuryglass.chunk_atlas.savedata.MCAFile;
 import com.centuryglass.chunk_atlas.serverplugin.Plugin;
+import com.centuryglass.chunk_atlas.threads.JobDirectory;
 import com.centuryglass.chunk_atlas.threads.MapperThread;
 import com.centuryglass.chunk_atlas.threads.ProgressThread;
 import com.centuryglass.chunk_atlas.threads.ReaderFileQueue;
 import com.centuryglass.chunk_atlas.threads.ReaderThread;
+import com.centuryglass.chunk_atlas.threads.RegionOrder;
+import com.centuryglass.chunk_atlas.threads.TileTracker;
+import com.centuryglass.chunk_atlas.threads.WorkerJob;
 import com.centuryglass.chunk_atlas.util.ExtendedValidate;
 import com.centuryglass.chunk_atlas.util.MapUnit;
 import com.centuryglass.chunk_atlas.util.args.ArgOption;
 import com.centuryglass.chunk_atlas.util.args.ArgParser;
+import com.centuryglass.chunk_atlas.webserver.Connection;
 import java.awt.Point;
+import java.awt.Rectangle;
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
 import java.io.File;
+import java.io.FileInputStream;
 import java.io.FileNotFoundException;
+import java.io.FileOutputStream;
 import java.io.IOException;
 import java.util.ArrayDeque;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.Collections;
-import java.util.Comparator;
 import java.util.Deque;
+import java.util.EnumMap;
+import java.util.HashMap;
+import java.util.HashSet;
 import java.util.List;
+import java.util.Map;
 import java.util.Set;
+import java.util.Timer;
+import java.util.TimerTask;
 import java.util.TreeSet;
+import java.util.concurrent.TimeUnit;
 import java.util.function.Function;
 import java.util.logging.Level;
+import java.util.zip.GZIPInputStream;
+import java.util.zip.GZIPOutputStream;
 import javax.json.Json;
 import javax.json.JsonArray;
 import javax.json.JsonArrayBuilder;
@@ -57,6 +82,27 @@ public final class MapCreator
     // Debug: Set whether to use multiple threads to scan region files:
     private static final boolean MULTI_REGION_THREADS = true;
     
+    // Relative web server path used when uploading finished tiles:
+    private static final String TILE_UPLOAD_PATH = "imageUpload";
+    // HTTP status code returned when an image upload succeeds:
+    private static final int HTTP_OK = 200;
+    // Number of threads used to save preview tiles:
+    private static final int PREVIEW_WRITER_THREADS = 2;
+    // Bytes in a megabyte, used when reading the tile memory budget:
+    private static final long BYTES_PER_MB = 1024 * 1024;
+    
+    // Number of jobs to create for each worker process, so faster workers
+    // can take on more of the work:
+    private static final int JOBS_PER_WORKER = 4;
+    // Time between checks for finished worker jobs:
+    private static final long WORKER_POLL_INTERVAL = 1000; // milliseconds
+    // Time between updates showing a worker is still processing a job:
+    private static final long CLAIM_HEARTBEAT = 10000; // milliseconds
+    // Time after the last update before a claimed job is released:
+    private static final long CLAIM_TIMEOUT = 60000; // milliseconds
+    // Time workers wait for new jobs before exiting:
+    private static final long WORKER_IDLE_TIMEOUT = 30000; // milliseconds
+    
     /**
      * Initialize the MapCreator with all options unset.
      */
@@ -66,6 +112,8 @@ public final class MapCreator
         enabledMapTypes = new TreeSet<>();
         keyBuilder = Json.createArrayBuilder();
         tileListBuilder = Json.createObjectBuilder();
+        dataTileListBuilder = Json.createObjectBuilder();
+        uploadedTiles = Collections.synchronizedSet(new HashSet<>());
     }
     
     /**
@@ -79,6 +127,8 @@ public final class MapCreator
         enabledMapTypes = new TreeSet<>();
         keyBuilder = Json.createArrayBuilder();
         tileListBuilder = Json.createObjectBuilder();
+        dataTileListBuilder = Json.createObjectBuilder();
+        uploadedTiles = Collections.synchronizedSet(new HashSet<>());
         if (mapConfig != null)
         {
             applyConfigOptions(mapConfig);
@@ -97,6 +147,7 @@ public final class MapCreator
         if (mapConfig != null)
         {
             setPixelsPerChunk(mapConfig.getPixelsPerChunk());
+            setOffHeapRastersEnabled(mapConfig.getOffHeapRasters());
             MapGenConfig.SingleImage imageMapOptions
                     = mapConfig.getSingleImageOptions();
             setSingleImageMapsEnabled(imageMapOptions.enabled);
@@ -106,6 +157,7 @@ public final class MapCreator
                     imageMapOptions.zMin,
                     imageMapOptions.width,
                     imageMapOptions.height);
+            setImageAutoCropEnabled(imageMapOptions.autoCrop);
             
             MapGenConfig.MapTiles tileOptions
                     = mapConfig.getMapTileOptions();
@@ -113,6 +165,47 @@ public final class MapCreator
             setTileOutputDir(new File(tileOptions.outPath));
             setTileSize(tileOptions.tileSize);
             setAltTileSizes(tileOptions.getAlternateSizes());
+            setRenderOrder(tileOptions.renderOrder);
+            setPreviewEnabled(tileOptions.preview);
+            setTileMemoryBudget(tileOptions.memoryBudgetMB);
+            setZoomLevelsEnabled(tileOptions.zoomLevels);
+            setIncrementalUpdatesEnabled(tileOptions.incremental);
+            setSkipUnchangedTilesEnabled(tileOptions.skipUnchanged);
+            setSharedTileCacheEnabled(tileOptions.sharedCache);
+            setTileArchivesEnabled(tileOptions.archive);
+            setDataTilesEnabled(tileOptions.dataTiles);
+            setTileRenderBounds(tileOptions.getRenderBounds());
+            
+            MapGenConfig.Checkpoints checkpointOptions
+                    = mapConfig.getCheckpointOptions();
+            if (checkpointOptions != null)
+            {
+                setCheckpointsEnabled(checkpointOptions.enabled);
+                setCheckpointDir(new File(checkpointOptions.outPath));
+                setCheckpointInterval(checkpointOptions.interval);
+            }
+            
+            MapGenConfig.Workers workerOptions
+                    = mapConfig.getWorkerOptions();
+            if (workerOptions != null)
+            {
+                setWorkersEnabled(workerOptions.enabled);
+                setWorkerJobDir(new File(workerOptions.jobPath));
+                setWorkerProcesses(workerOptions.processes);
+                setWorkerJvmOptions(workerOptions.getJvmOptions());
+            }
+            
+            MapGenConfig.PngEncoding encodingOptions
+                    = mapConfig.getPngEncodingOptions();
+            if (encodingOptions != null)
+            {
+                setDefaultPngEncoder(encodingOptions.defaultEncoder);
+                encodingOptions.getTypeEncoders().forEach((type, encoder) ->
+                {
+                    setPngEncoder(type, encoder);
+                });
+                setEncoderThreads(encodingOptions.encoderThreads);
+            }
             
             mapConfig.forEachRegionPath((regionDir, name)->
             {
@@ -209,7 +302,11 @@ public final class MapCreator
                             option.parseIntParam(1, null),
                             option.parseIntParam(2, (w) -> w > 0),
                             option.parseIntParam(3, (h) -> h > 0));
+                    break;
                 }
+                case AUTO_CROP:
+                    setImageAutoCropEnabled(option.boolOptionStatus());
+                    break;
                 case TILE_MAP:
                 {
                     String param = option.getParameter(0);
@@ -239,6 +336,91 @@ public final class MapCreator
                     setAltTileSizes(altSizes);
                     break;
                 }
+                case RENDER_ORDER:
+                {
+                    RegionOrder order = RegionOrder.fromString(
+                            option.getParameter(0));
+                    if (order == null)
+                    {
+                        LogConfig.getLogger().logp(Level.WARNING, CLASSNAME,
+                                FN_NAME, "Invalid render order \"{0}\"",
+                                option.getParameter(0));
+                    }
+                    else
+                    {
+                        setRenderOrder(order);
+                    }
+                    break;
+                }
+                case PREVIEW:
+                    setPreviewEnabled(option.boolOptionStatus());
+                    break;
+                case ZOOM_LEVELS:
+                    setZoomLevelsEnabled(option.boolOptionStatus());
+                    break;
+                case INCREMENTAL:
+                    setIncrementalUpdatesEnabled(option.boolOptionStatus());
+                    break;
+                case SKIP_UNCHANGED:
+                    setSkipUnchangedTilesEnabled(option.boolOptionStatus());
+                    break;
+                case DATA_TILES:
+                    setDataTilesEnabled(option.boolOptionStatus());
+                    break;
+                case TILE_BOUNDS:
+                {
+                    String param = option.getParameter(0);
+                    if (option.getParamCount() == 1 && (param.equals("0")
+                            || param.equalsIgnoreCase("false")))
+                    {
+                        setTileRenderBounds(null);
+                    }
+                    else
+                    {
+                        setTileRenderBounds(new Rectangle(
+                                option.parseIntParam(0, null),
+                                option.parseIntParam(1, null),
+                                option.parseIntParam(2, (w) -> w > 0),
+                                option.parseIntParam(3, (h) -> h > 0)));
+                    }
+                    break;
+                }
+                case PNG_ENCODING:
+                {
+                    final int level = option.parseIntParam(0,
+                            (l) -> l >= 0 && l <= 9);
+                    PngEncoder.Filter filter = defaultPngEncoder.getFilter();
+                    if (option.getParamCount() > 1)
+                    {
+                        filter = PngEncoder.Filter.fromString(
+                                option.getParameter(1));
+                        if (filter == null)
+                        {
+                            LogConfig.getLogger().logp(Level.WARNING,
+                                    CLASSNAME, FN_NAME,
+                                    "Invalid PNG filter \"{0}\"",
+                                    option.getParameter(1));
+                            filter = defaultPngEncoder.getFilter();
+                        }
+                    }
+                    setDefaultPngEncoder(new PngEncoder(level, filter,
+                            defaultPngEncoder.usesIndexedColor()));
+                    break;
+                }
+                case CHECKPOINTS:
+                {
+                    String param = option.getParameter(0);
+                    if (param.equals("0") || param.equalsIgnoreCase("false"))
+                    {
+                        setCheckpointsEnabled(false);
+                    }
+                    else
+                    {
+                        setCheckpointsEnabled(true);
+                        setCheckpointDir(new File(param));
+                    }
+                    break;
+                }
                 case ACTIVITY_MAPS_ENABLED:
                     setMapTypeEnabled(MapType.TOTAL_ACTIVITY,
                             option.boolOptionStatus());
@@ -263,6 +445,29 @@ public final class MapCreator
                     setMapTypeEnabled(MapType.STRUCTURE,
                             option.boolOptionStatus());
                     break;
+                case WORKERS:
+                {
+                    String param = option.getParameter(0);
+                    if (param.equalsIgnoreCase("false"))
+                    {
+                        setWorkersEnabled(false);
+                    }
+                    else
+                    {
+                        setWorkersEnabled(true);
+                        setWorkerProcesses(option.parseIntParam(0,
+                                (count) -> count >= 0));
+                        if (option.getParamCount() > 1)
+                        {
+                            setWorkerJobDir(new File(option.getParameter(1)));
+                        }
+                    }
+                    break;
+                }
+                case WORKER_JOBS:
+                    // No action needed, Main runs worker processes before
+                    // creating a MapCreator for normal map generation.
+                    break;
                 case USE_CACHED_UPDATE:
                 case MAP_CONFIG_PATH:
                 case WEB_SERVER_CONFIG_PATH:
@@ -313,12 +518,80 @@ public final class MapCreator
             };
             File regionTileOutDir = getRegionOutDir.apply(tileOutDir);
             File regionImageOutDir = getRegionOutDir.apply(imageOutDir);
-            // Remove old map images:
+            // Check for an interrupted map generation run to resume:
+            MapCheckpoint savedCheckpoint = null;
+            if (tilesEnabled && checkpointsEnabled && checkpointDir != null
+                    && tileRenderBounds == null)
+            {
+                savedCheckpoint = MapCheckpoint.load(checkpointDir,
+                        region.name, tileSize, altTileSizes, pixelsPerChunk,
+                        enabledMapTypes, dataTiles);
+            }
+            // Check for tiles from an earlier run that can be updated:
+            TileManifest savedManifest = null;
+            if (tilesEnabled && incrementalUpdates && savedCheckpoint == null
+                    && tileRenderBounds == null)
+            {
+                savedManifest = TileManifest.load(regionTileOutDir, tileSize,
+                        altTileSizes, pixelsPerChunk, enabledMapTypes,
+                        zoomLevelsEnabled, dataTiles);
+            }
+            // Find all tiles saved by the last completed run:
+            GenerationManifest savedFiles = null;
+            if (tilesEnabled)
+            {
+                savedFiles = GenerationManifest.load(regionTileOutDir,
+                        region.name);
+            }
+            // Remove old map images, keeping tiles if resuming or updating:
             Deque<File> toDelete = new ArrayDeque<>();
             int filesDeleted = 0;
-            if (tilesEnabled) 
+            final boolean keepTiles = savedCheckpoint != null
+                    || savedManifest != null || tileRenderBounds != null;
+            if (tilesEnabled && ! keepTiles && savedFiles != null)
+            {
+                // Only files listed in the manifest need to be removed,
+                // keeping tiles of enabled map types if using hashes:
+                Set<String> keptTypes = new HashSet<>();
+                if (tileHashesUsed())
+                {
+                    enabledMapTypes.forEach((type) ->
+                    {
+                        keptTypes.add(type.toString());
+                    });
+                }
+                for (GenerationManifest.Entry entry : savedFiles.getEntries())
+                {
+                    if (! keptTypes.contains(entry.mapType)
+                            && entry.file.delete())
+                    {
+                        filesDeleted++;
+                    }
+                }
+            }
+            else if (tilesEnabled && ! keepTiles)
             { 
-                toDelete.add(regionTileOutDir);
+                if (tileHashesUsed() && regionTileOutDir.isDirectory())
+                {
+                    // Keep tiles of enabled map types until they are
+                    // replaced, so unchanged tiles aren't written again:
+                    Set<String> typeDirNames = new HashSet<>();
+                    enabledMapTypes.forEach((type) ->
+                    {
+                        typeDirNames.add(type.toString());
+                    });
+                    for (File child : regionTileOutDir.listFiles())
+                    {
+                        if (! typeDirNames.contains(child.getName()))
+                        {
+                            toDelete.add(child);
+                        }
+                    }
+                }
+                else
+                {
+                    toDelete.add(regionTileOutDir);
+                }
             }
             if (imageMapsEnabled)
             {
@@ -341,72 +614,11 @@ public final class MapCreator
                     "Deleted {0} old map images.", filesDeleted);
             if (tilesEnabled)
             {
-                createTileMaps(region, regionTileOutDir);
+                createTileMaps(region, regionTileOutDir, savedCheckpoint,
+                        savedManifest, savedFiles,
+                        imageMapsEnabled ? regionImageOutDir : null);
                 LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
                         "Region tile maps created.");
-                // Find and store all tile map directories:
-                ArrayList<File> tileDirs = new ArrayList<>();
-                Deque<File> toSearch = new ArrayDeque<>();
-                toSearch.add(regionTileOutDir);
-                while (! toSearch.isEmpty())
-                {
-                    File searchDir = toSearch.pop();
-                    boolean tilesFound = false;
-                    assert (searchDir != null);
-                    assert (searchDir.isDirectory());
-                    for (File child : searchDir.listFiles())
-                    {
-                        if (child.isDirectory())
-                        {
-                            String name = child.getName();
-                            // Detect and skip resized tile directories:
-                            if (name.matches("^\\d+$"))
-                            {
-                                int nameValue = Integer.parseInt(name);
-                                if (nameValue != tileSize)
-                                {
-                                    continue;
-                                }
-                            }
-                            toSearch.push(child);
-                        }
-                        else if (! tilesFound)
-                        {
-                            tilesFound = (child.getPath().endsWith(".png"));
-                        }
-                    }
-                    if (tilesFound)
-                    {
-                        tileDirs.add(searchDir);
-                    }
-                }
-                // If single-image maps are also enabled, create them by
-                // stitching together tile images:
-                if (imageMapsEnabled)
-                {
-                    LogConfig.getLogger().logp(Level.CONFIG, CLASSNAME, FN_NAME,
-                            "Creating full region maps from map tiles.");
-                    tileDirs.forEach((tileDir) ->
-                    {
-                        File outFile = new File(regionImageOutDir,
-                                tileDir.getParentFile().getName() + ".png");
-                        LogConfig.getLogger().logp(Level.FINE, CLASSNAME,
-                                FN_NAME, "Creating '{0}' from tiles at '{1}'.",
-                                new Object[] { outFile, tileDir });
-                        try
-                        {
-                            ImageStitcher.stitch(tileDir, outFile, xMin, zMin,
-                                    width, height, pixelsPerChunk, tileSize,
-                                    drawBackgrounds);
-                        }
-                        catch (IOException e)
-                        {
-                            LogConfig.getLogger().logp(Level.WARNING,
-                                    CLASSNAME, FN_NAME,
-                                    "Failed to create map:", e);
-                        }
-                    });
-                }
             }
             else if (imageMapsEnabled)
             {
@@ -468,6 +680,279 @@ public final class MapCreator
         altTileSizes = altSizes;
     }
     
+    /**
+     * Sets the order in which region files are scanned when creating tile
+     * maps.
+     * 
+     * @param order  The region ordering policy. Tiles holding the highest
+     *               priority regions are finished and saved first.
+     */
+    public void setRenderOrder(RegionOrder order)
+    {
+        Validate.notNull(order, "Render order cannot be null.");
+        renderOrder = order;
+    }
+    
+    /**
+     * Sets whether low-detail preview tiles should be created from region file
+     * headers before the full map is drawn.
+     * 
+     * @param enabled  Whether preview tiles will be created. Preview tiles are
+     *                 replaced as detailed tiles are finished, and are never
+     *                 created when resuming from a checkpoint.
+     */
+    public void setPreviewEnabled(boolean enabled)
+    {
+        previewEnabled = enabled;
+    }
+    
+    /**
+     * Sets the maximum amount of memory used to hold tile images while tile
+     * maps are created. This budget is divided evenly between all map types.
+     * 
+     * @param megabytes  The tile memory budget in megabytes, or zero to use
+     *                   the default MapOptions budget for each map type.
+     */
+    public void setTileMemoryBudget(int megabytes)
+    {
+        ExtendedValidate.isNotNegative(megabytes, "Tile memory budget");
+        tileMemoryBudgetMB = megabytes;
+    }
+    
+    /**
+     * Sets whether zoomed out tiles will be created from each set of map
+     * tiles.
+     * 
+     * @param enabled  Whether a quadtree of zoom level tiles should be built
+     *                 from finished map tiles.
+     */
+    public void setZoomLevelsEnabled(boolean enabled)
+    {
+        zoomLevelsEnabled = enabled;
+    }
+    
+    /**
+     * Sets whether tile maps saved by an earlier run will be updated instead
+     * of recreated. When enabled, a manifest of the region files used to
+     * create each set of tiles is saved, and the next run only redraws areas
+     * covered by region files that changed. This only applies if every
+     * enabled map type can draw chunks without data from other chunks.
+     * 
+     * @param enabled  Whether only changed areas of saved tiles should be
+     *                 redrawn.
+     */
+    public void setIncrementalUpdatesEnabled(boolean enabled)
+    {
+        incrementalUpdates = enabled;
+    }
+    
+    /**
+     * Sets whether map tiles identical to the tiles saved by an earlier run
+     * will be left in place instead of written again. When enabled, a
+     * manifest of the hash of each saved tile's pixels is kept, old tiles are
+     * kept until mapping finishes, and fully transparent tiles are not saved.
+     * This has no effect when checkpoints are enabled.
+     * 
+     * @param enabled  Whether unchanged and empty tiles should be skipped
+     *                 when saving tile maps.
+     */
+    public void setSkipUnchangedTilesEnabled(boolean enabled)
+    {
+        skipUnchangedTiles = enabled;
+    }
+    
+    /**
+     * Sets whether all map types will hold their tiles in memory within one
+     * shared tile cache. Each cached tile then holds the images of every map
+     * type, so drawing a chunk finds all of its tile images with one lookup,
+     * and tiles are compressed or evicted for all map types at once.
+     * 
+     * @param enabled  Whether map types should share a multi-layer tile
+     *                 cache.
+     */
+    public void setSharedTileCacheEnabled(boolean enabled)
+    {
+        sharedTileCache = enabled;
+    }
+    
+    /**
+     * Sets whether each map type's tiles will be copied into a single indexed
+     * archive file once a region's maps are finished. Archived tile image
+     * files are removed, unless incremental updates or unchanged tile
+     * skipping are enabled, since those reload saved tile images.
+     * 
+     * @param enabled  Whether tile archives should be created.
+     */
+    public void setTileArchivesEnabled(boolean enabled)
+    {
+        tileArchives = enabled;
+    }
+    
+    /**
+     * Sets whether compact data tiles will be saved alongside map tiles. Each
+     * data tile holds the values every map type draws from each chunk within
+     * the tile's area, so a map viewer can draw and restyle any map type
+     * without downloading another set of tile images.
+     * 
+     * @param enabled  Whether data tiles should be saved.
+     */
+    public void setDataTilesEnabled(boolean enabled)
+    {
+        dataTiles = enabled;
+    }
+    
+    /**
+     * Sets an area that will be redrawn within tile maps saved by an earlier
+     * run, leaving the rest of each saved tile unchanged. When set, only
+     * region files overlapping the area are read, only chunks within the area
+     * are drawn, and saved tiles, zoom level tiles, and generation records
+     * are updated instead of replaced. Checkpoints and worker processes
+     * aren't used, and tile manifests used for incremental updates are left
+     * unchanged.
+     * 
+     *  Map types that need data from every chunk leave their saved tiles
+     * unchanged. Tiles can't be redrawn if archiving removed their saved
+     * tile images.
+     * 
+     * @param bounds  The chunk coordinate bounds of the redrawn area, or null
+     *                to draw all chunks.
+     */
+    public void setTileRenderBounds(Rectangle bounds)
+    {
+        if (bounds != null)
+        {
+            ExtendedValidate.isPositive(bounds.width, "Render bounds width");
+            ExtendedValidate.isPositive(bounds.height,
+                    "Render bounds height");
+            bounds = new Rectangle(bounds);
+        }
+        tileRenderBounds = bounds;
+    }
+    
+    /**
+     * Sets whether map generation checkpoints will be saved and resumed.
+     * Checkpoints are only used when creating tile maps.
+     * 
+     * @param enabled  Whether tile map generation progress should be saved
+     *                 periodically, so interrupted runs can resume later.
+     */
+    public void setCheckpointsEnabled(boolean enabled)
+    {
+        checkpointsEnabled = enabled;
+    }
+    
+    /**
+     * Sets the directory where map generation checkpoints will be saved.
+     * 
+     * @param outDir  The checkpoint directory.
+     */
+    public void setCheckpointDir(File outDir)
+    {
+        ExtendedValidate.couldBeDirectory(outDir, "Checkpoint directory");
+        checkpointDir = outDir;
+    }
+    
+    /**
+     * Sets how often map generation checkpoints will be saved.
+     * 
+     * @param seconds  The minimum number of seconds between checkpoints.
+     */
+    public void setCheckpointInterval(int seconds)
+    {
+        ExtendedValidate.isNotNegative(seconds, "Checkpoint interval");
+        checkpointInterval = seconds;
+    }
+    
+    /**
+     * Sets whether tile maps will be created by worker processes. Workers are
+     * not used when mapping through the server plugin.
+     * 
+     * @param enabled  Whether region files should be divided between worker
+     *                 processes.
+     */
+    public void setWorkersEnabled(boolean enabled)
+    {
+        workersEnabled = enabled;
+    }
+    
+    /**
+     * Sets the directory where worker jobs and results will be shared.
+     * 
+     * @param jobDir  A directory that all worker processes can access.
+     */
+    public void setWorkerJobDir(File jobDir)
+    {
+        ExtendedValidate.couldBeDirectory(jobDir, "Worker job directory");
+        workerJobDir = jobDir;
+    }
+    
+    /**
+     * Sets the number of worker processes to launch.
+     * 
+     * @param processes  The number of local worker processes. If zero, jobs
+     *                   will only be handled by externally started workers and
+     *                   by this process.
+     */
+    public void setWorkerProcesses(int processes)
+    {
+        ExtendedValidate.isNotNegative(processes, "Worker process count");
+        workerProcesses = processes;
+    }
+    
+    /**
+     * Sets extra options passed to the Java runtime when launching worker
+     * processes.
+     * 
+     * @param jvmOptions  A list of Java runtime options, such as a maximum
+     *                    heap size.
+     */
+    public void setWorkerJvmOptions(String[] jvmOptions)
+    {
+        Validate.notNull(jvmOptions, "JVM options cannot be null.");
+        workerJvmOptions = Arrays.copyOf(jvmOptions, jvmOptions.length);
+    }
+    
+    /**
+     * Maps all jobs found in a shared job directory, waiting briefly for new
+     * jobs once none remain. This is used when running as a worker process.
+     * 
+     * @param jobDir  The directory where jobs are shared.
+     * 
+     * @return        The number of jobs successfully completed.
+     */
+    public int runWorkerJobs(File jobDir)
+    {
+        final String FN_NAME = "runWorkerJobs";
+        JobDirectory jobs = new JobDirectory(jobDir);
+        int completed = 0;
+        long lastJobTime = System.currentTimeMillis();
+        while ((System.currentTimeMillis() - lastJobTime)
+                < WORKER_IDLE_TIMEOUT)
+        {
+            WorkerJob job = jobs.claimNextJob();
+            if (job == null)
+            {
+                try
+                {
+                    Thread.sleep(WORKER_POLL_INTERVAL);
+                }
+                catch (InterruptedException e)
+                {
+                    break;
+                }
+                continue;
+            }
+            if (runWorkerJob(job, jobs))
+            {
+                completed++;
+            }
+            lastJobTime = System.currentTimeMillis();
+        }
+        LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                "No jobs remaining, worker finished {0} jobs.", completed);
+        return completed;
+    }
+    
     /**
      * Sets whether single-image maps will be generated.
      * 
@@ -524,6 +1009,19 @@ public final class MapCreator
         this.height = height;
     }
     
+    /**
+     * Sets whether single-image map bounds are reduced to the area covered by
+     * each region's files, so that unexplored space around the region isn't
+     * included in the map images.
+     * 
+     * @param enabled  Whether single-image maps are cropped to their region
+     *                 file extents.
+     */
+    public void setImageAutoCropEnabled(boolean enabled)
+    {
+        autoCropImages = enabled;
+    }
+    
     /**
      * Sets the width and height in pixels used when drawing individual
      * Minecraft map chunks.
@@ -536,6 +1034,21 @@ public final class MapCreator
         this.pixelsPerChunk = pixelsPerChunk;
     }
     
+    /**
+     * Sets whether map pixel data will be held outside of the Java heap.
+     * Single-image map pages are allocated in direct memory, and tile maps
+     * keep compressed tiles in direct memory with only a few reused tile
+     * images on the heap. This keeps large maps from causing long garbage
+     * collection pauses, which matters most when mapping within a running
+     * server.
+     * 
+     * @param enabled  Whether map rasters should be held off-heap.
+     */
+    public void setOffHeapRastersEnabled(boolean enabled)
+    {
+        offHeapRasters = enabled;
+    }
+    
     /**
      * Adds a new Minecraft region directory that should be mapped.
      * 
@@ -638,12 +1151,82 @@ public final class MapCreator
     }
     
     /**
-     * Gets map keys from all generated maps.
+     * Sets the PNG encoder used to save map images of every type without its
+     * own encoder.
      * 
-     * @return  A JSON array of map key data, or null if maps have not been
-     *          generated yet.
+     * @param encoder  The default PNG encoder.
      */
-    public JsonArray getMapKeys()
+    public void setDefaultPngEncoder(PngEncoder encoder)
+    {
+        Validate.notNull(encoder, "PNG encoder cannot be null.");
+        defaultPngEncoder = encoder;
+    }
+    
+    /**
+     * Sets the PNG encoder used to save map images of a specific type.
+     * 
+     * @param type     The map type that will use the encoder.
+     * 
+     * @param encoder  The type's encoder, or null to use the default encoder.
+     */
+    public void setPngEncoder(MapType type, PngEncoder encoder)
+    {
+        Validate.notNull(type, "Map type cannot be null.");
+        if (encoder == null)
+        {
+            typePngEncoders.remove(type);
+        }
+        else
+        {
+            typePngEncoders.put(type, encoder);
+        }
+    }
+    
+    /**
+     * Sets the number of threads used to encode and save finished map tiles.
+     * 
+     * @param threadCount  The number of encoder threads, or zero to use one
+     *                     thread per available processor.
+     */
+    public void setEncoderThreads(int threadCount)
+    {
+        ExtendedValidate.isNotNegative(threadCount, "Encoder thread count");
+        encoderThreads = threadCount;
+    }
+    
+    /**
+     * Sets a web server connection used to upload map tiles as soon as they
+     * are finished, while the rest of the map is still being generated.
+     * 
+     * @param connection  The connection used to upload tiles, or null to
+     *                    disable early tile uploads.
+     */
+    public void setTileUploadConnection(Connection connection)
+    {
+        uploadConnection = connection;
+    }
+    
+    /**
+     * Gets the paths of all map tiles that were successfully uploaded during
+     * map generation.
+     * 
+     * @return  The set of uploaded tile image paths.
+     */
+    public Set<String> getUploadedTiles()
+    {
+        synchronized (uploadedTiles)
+        {
+            return new HashSet<>(uploadedTiles);
+        }
+    }
+    
+    /**
+     * Gets map keys from all generated maps.
+     * 
+     * @return  A JSON array of map key data, or null if maps have not been
+     *          generated yet.
+     */
+    public JsonArray getMapKeys()
     {
         return keyBuilder.build();
     }
@@ -659,55 +1242,279 @@ public final class MapCreator
         return tileListBuilder.build();
     }
     
+    /**
+     * Gets the list of all data tile paths created by the MapCreator.
+     * 
+     * @return  A JSON object holding lists of data tile paths, indexed by
+     *          region.
+     */
+    public JsonObject getDataTileList()
+    {
+        return dataTileListBuilder.build();
+    }
+    
     /**
      * Apply the current settings to create tile maps for a region directory.
      * 
-     * @param mapRegion  A Minecraft region directory path and its associated
-     *                   region name.
+     * @param mapRegion   A Minecraft region directory path and its associated
+     *                    region name.
      * 
-     * @param outDir     A region-specific output directory where tiles will be
-     *                   saved.
+     * @param outDir      A region-specific output directory where tiles will
+     *                    be saved.
+     * 
+     * @param resumed     An optional saved checkpoint to resume, or null to
+     *                    map all region files.
+     * 
+     * @param updated     An optional manifest saved with tiles from an earlier
+     *                    run. If non-null and not resuming, only areas
+     *                    covered by region files that changed since that run
+     *                    will be redrawn.
+     * 
+     * @param savedFiles  An optional manifest of all files saved by the last
+     *                    completed run. If updating tiles, it is used to find
+     *                    the saved tiles that will be kept.
+     * 
+     * @param imageDir    An optional directory where single-image maps will
+     *                    be saved, built from the finished tiles. If null,
+     *                    only tiles are created.
      */
-    private void createTileMaps(Region mapRegion, File outDir)
+    private void createTileMaps(Region mapRegion, File outDir,
+            MapCheckpoint resumed, TileManifest updated,
+            GenerationManifest savedFiles, File imageDir)
     {
         final String FN_NAME = "createTileMaps";
         Validate.notNull(mapRegion, "Mapped region cannot be null.");
         ExtendedValidate.couldBeDirectory(outDir, "Tile output directory");
         LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
                 "Creating tile maps for region {0}.", mapRegion.name);
+        if (tileRenderBounds != null && tileArchives && ! incrementalUpdates
+                && ! tileHashesUsed())
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Saved tile images are removed once archived, so they "
+                    + "can't be redrawn within render bounds. Skipping "
+                    + "region {0}.", mapRegion.name);
+            if (savedFiles != null)
+            {
+                saveGenerationManifest(savedFiles);
+            }
+            return;
+        }
         ArrayList<File> regionFiles = new ArrayList<>(Arrays.asList(
                 mapRegion.directory.listFiles()));
-        mappers = new MapCollector(outDir, mapRegion.name, mapRegion.world,
-                tileSize, altTileSizes, pixelsPerChunk, enabledMapTypes);
-        // If more than one tile fits in a region, sort regions by tile:
-        if (tileSize > 32)
+        // Record region files before reading them, so the next run finds any
+        // changes made while mapping:
+        TileManifest manifest = null;
+        if (incrementalUpdates && tileRenderBounds == null)
+        {
+            manifest = new TileManifest(outDir, tileSize, altTileSizes,
+                    pixelsPerChunk, enabledMapTypes, zoomLevelsEnabled,
+                    dataTiles);
+            manifest.recordRegions(regionFiles, updated);
+        }
+        if (tileRenderBounds != null)
         {
-            class RegionSort implements Comparator<File>
+            // Only read region files overlapping the redrawn area:
+            final int regionSize = MapUnit.convert(1, MapUnit.REGION,
+                    MapUnit.CHUNK);
+            regionFiles.removeIf((file) ->
             {
-                // Get the coordinates of the tile that hold a region file's
-                // upper left point.
-                private Point getTilePt(File regionFile)
+                Point regionPt;
+                try
                 {
-                    Point chunkPt = MCAFile.getChunkCoords(regionFile);
-                    return TileMap.getTilePoint(chunkPt.x, chunkPt.y,
-                            tileSize);
+                    regionPt = MCAFile.getChunkCoords(file);
                 }
-                
-                @Override
-                public int compare(File first, File second)
+                catch (NumberFormatException e)
                 {
-                    Point firstTile = getTilePt(first);
-                    Point secondTile = getTilePt(second);
-                    if (firstTile.y == secondTile.y)
+                    regionPt = null;
+                }
+                return regionPt == null || ! tileRenderBounds.intersects(
+                        new Rectangle(regionPt.x, regionPt.y, regionSize,
+                        regionSize));
+            });
+        }
+        // Group regions by tile, scanning the highest priority tiles first:
+        renderOrder.sort(regionFiles, tileSize);
+        final MapOptions options = createMapOptions(enabledMapTypes.size());
+        options.setPyramidEnabled(zoomLevelsEnabled);
+        options.setContentHashesEnabled(tileHashesUsed());
+        options.setSharedTileCacheEnabled(sharedTileCache);
+        options.setDataTilesEnabled(dataTiles);
+        // Record all files saved while mapping, starting with the saved tiles
+        // kept when only updating changed areas:
+        final boolean keepSavedFiles = tileRenderBounds != null
+                || (updated != null && manifest != null);
+        final GenerationManifest generated
+                = (keepSavedFiles && savedFiles != null)
+                ? savedFiles : new GenerationManifest(outDir, mapRegion.name);
+        MapCheckpoint checkpoint = null;
+        boolean useWorkers = false;
+        long startTime = 0;
+        if (resumed != null)
+        {
+            mappers = new MapCollector(outDir, mapRegion.name,
+                    mapRegion.world, tileSize, altTileSizes, pixelsPerChunk,
+                    enabledMapTypes, resumed.getStartTime(), options);
+            // Tiles saved before the interruption were never recorded:
+            mappers.setGenerationManifest(generated);
+            mappers.recordSavedTiles();
+            try
+            {
+                resumed.restoreMapperState(mappers);
+                checkpoint = resumed;
+                regionFiles.removeIf((file) -> resumed.isRegionComplete(file));
+                LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                        "Resuming from checkpoint, skipping {0} completed "
+                        + "region files.", resumed.getCompletedRegionCount());
+            }
+            catch (IOException e)
+            {
+                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                        "Failed to load checkpoint, mapping all regions:", e);
+            }
+        }
+        boolean updatingTiles = false;
+        if (checkpoint == null)
+        {
+            updatingTiles = tileRenderBounds != null
+                    || (updated != null && manifest != null);
+            List<Rectangle> changedAreas = new ArrayList<>();
+            if (tileRenderBounds != null)
+            {
+                LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                        "Redrawing {0}x{1} chunks at ({2}, {3}) from {4} "
+                        + "region files.", new Object[] {
+                        tileRenderBounds.width, tileRenderBounds.height,
+                        tileRenderBounds.x, tileRenderBounds.y,
+                        regionFiles.size() });
+                changedAreas.add(new Rectangle(tileRenderBounds));
+            }
+            else if (updatingTiles)
+            {
+                final Set<String> changedRegions
+                        = manifest.getChangedRegions(updated);
+                LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                        "{0} region files changed, updating {1} of {2} tiles.",
+                        new Object[] { changedRegions.size(),
+                        manifest.getChangedTiles(updated).size(),
+                        manifest.getTileCount() });
+                final int regionSize = MapUnit.convert(1, MapUnit.REGION,
+                        MapUnit.CHUNK);
+                for (String name : changedRegions)
+                {
+                    Point regionPt;
+                    try
+                    {
+                        regionPt = MCAFile.getChunkCoords(new File(name));
+                    }
+                    catch (NumberFormatException e)
+                    {
+                        regionPt = null;
+                    }
+                    if (regionPt != null)
                     {
-                        return firstTile.x - secondTile.x;
+                        changedAreas.add(new Rectangle(regionPt.x, regionPt.y,
+                                regionSize, regionSize));
                     }
-                    return firstTile.y - secondTile.y;
                 }
+                regionFiles.removeIf((file) ->
+                {
+                    return ! changedRegions.contains(file.getName());
+                });
+            }
+            else if (previewEnabled)
+            {
+                drawPreview(mapRegion.name, outDir, regionFiles, options);
+            }
+            // Preview tiles must be older than the start time, so they are
+            // replaced instead of reloaded by the full mapping pass:
+            startTime = System.currentTimeMillis();
+            mappers = new MapCollector(outDir, mapRegion.name,
+                    mapRegion.world, tileSize, altTileSizes, pixelsPerChunk,
+                    enabledMapTypes, startTime, options);
+            mappers.setGenerationManifest(generated);
+            if (tileRenderBounds != null)
+            {
+                if (! mappers.supportsIncrementalUpdates())
+                {
+                    LogConfig.getLogger().logp(Level.INFO, CLASSNAME,
+                            FN_NAME, "Some enabled map types need data from "
+                            + "every chunk, so their tiles won't be redrawn "
+                            + "within render bounds.");
+                }
+                mappers.setChunkBounds(tileRenderBounds);
+            }
+            if (updatingTiles && generated != savedFiles)
+            {
+                // No manifest was saved with the tiles being updated:
+                mappers.recordSavedTiles();
+            }
+            if (updatingTiles)
+            {
+                mappers.updateSavedTiles(changedAreas);
             }
-            Collections.sort(regionFiles, new RegionSort());
+            useWorkers = workersEnabled && workerJobDir != null;
+            if (useWorkers && updatingTiles)
+            {
+                LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                        "Worker processes can't update saved tiles, mapping "
+                        + "changed regions in this process.");
+                useWorkers = false;
+            }
+            if (useWorkers && mapRegion.world != null)
+            {
+                LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                        "Worker processes can't load server world data, "
+                        + "mapping region {0} in this process.",
+                        mapRegion.name);
+                useWorkers = false;
+            }
+            if (! useWorkers && checkpointsEnabled && checkpointDir != null
+                    && tileRenderBounds == null)
+            {
+                checkpoint = new MapCheckpoint(checkpointDir, mapRegion.name,
+                        startTime, tileSize, altTileSizes, pixelsPerChunk,
+                        enabledMapTypes, dataTiles);
+            }
+        }
+        if (imageDir != null)
+        {
+            LogConfig.getLogger().logp(Level.CONFIG, CLASSNAME, FN_NAME,
+                    "Creating full region maps from map tiles.");
+            mappers.composeImages(imageDir, xMin, zMin, width, height,
+                    pixelsPerChunk, tileSize, drawBackgrounds);
+        }
+        final Integer chunksMapped;
+        if (useWorkers)
+        {
+            chunksMapped = mapRegionWithWorkers(mapRegion.name, outDir,
+                    regionFiles, startTime);
         }
-        final Integer chunksMapped = mapRegion(mapRegion.name, regionFiles);
+        else
+        {
+            // Track remaining regions per tile so finished tiles can be saved
+            // before all regions are read:
+            TileTracker tileTracker = new TileTracker(regionFiles, tileSize);
+            chunksMapped = mapRegion(mapRegion.name, regionFiles, tileTracker,
+                    checkpoint, ! updatingTiles);
+        }
+        if (checkpoint != null)
+        {
+            // Maps are complete, the checkpoint is no longer needed:
+            checkpoint.delete();
+        }
+        if (manifest != null)
+        {
+            saveTileManifest(manifest);
+        }
+        if (tileArchives)
+        {
+            final int archived = mappers.archiveTiles(! incrementalUpdates
+                    && ! tileHashesUsed());
+            LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                    "Archived {0} new or changed tiles.", archived);
+        }
+        saveGenerationManifest(generated);
         if (chunksMapped > 0)
         {
             final Double mapKM = (double) MapUnit.convert(chunksMapped,
@@ -768,12 +1575,41 @@ public final class MapCreator
                     mapRegion.directory);
             return;          
         }
+        int mapXMin = xMin;
+        int mapZMin = zMin;
+        int mapWidth = width;
+        int mapHeight = height;
+        if (autoCropImages)
+        {
+            // Region file names give the extents of all mapped chunks:
+            int regionXEnd = Integer.MIN_VALUE;
+            int regionZEnd = Integer.MIN_VALUE;
+            mapXMin = Integer.MAX_VALUE;
+            mapZMin = Integer.MAX_VALUE;
+            for (File regionFile : regionFiles)
+            {
+                final Point regionPt = MCAFile.getChunkCoords(regionFile);
+                mapXMin = Math.min(mapXMin, regionPt.x);
+                mapZMin = Math.min(mapZMin, regionPt.y);
+                regionXEnd = Math.max(regionXEnd, regionPt.x + regionChunks);
+                regionZEnd = Math.max(regionZEnd, regionPt.y + regionChunks);
+            }
+            mapXMin = Math.max(xMin, mapXMin);
+            mapZMin = Math.max(zMin, mapZMin);
+            mapWidth = Math.min(xMin + width, regionXEnd) - mapXMin;
+            mapHeight = Math.min(zMin + height, regionZEnd) - mapZMin;
+            LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                    "Cropped map bounds to {0}x{1} chunks at ({2}, {3}).",
+                    new Object[] { mapWidth, mapHeight, mapXMin, mapZMin });
+        }
         mappers = new MapCollector(outDir, mapRegion.name, mapRegion.world,
-                xMin, zMin, width, height, pixelsPerChunk, enabledMapTypes);
-        final int chunksMapped = mapRegion(mapRegion.name, regionFiles);
+                mapXMin, mapZMin, mapWidth, mapHeight, pixelsPerChunk,
+                enabledMapTypes, createMapOptions(enabledMapTypes.size()));
+        final int chunksMapped = mapRegion(mapRegion.name, regionFiles,
+                null, null, false);
         if (chunksMapped > 0)
         {
-            final int numChunks = width * height;
+            final int numChunks = mapWidth * mapHeight;
             final double explorePercent = (double) chunksMapped * 100
                     / numChunks;
             LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
@@ -795,24 +1631,85 @@ public final class MapCreator
      * 
      * @param regionFiles  The set of Minecraft region files to map.
      * 
+     * @param tileTracker  An optional tracker used to save map tiles as soon
+     *                     as all of their region files are processed.
+     * 
+     * @param checkpoint   An optional checkpoint used to periodically save
+     *                     map generation progress.
+     * 
+     * @param removeStale  Whether tiles saved before mapping started should
+     *                     be removed if they weren't replaced.
+     * 
      * @return             The total number of region chunks mapped.
      */
-    private int mapRegion(String regionName, ArrayList<File> regionFiles)
+    private int mapRegion(String regionName, ArrayList<File> regionFiles,
+            TileTracker tileTracker, MapCheckpoint checkpoint,
+            boolean removeStale)
     {
-        final String FN_NAME = "mapRegion";
         ExtendedValidate.notNullOrEmpty(regionName, "Region name");
-        Validate.notNull(regionFiles, "Region files cannot be null.");
         Validate.notNull(mappers, "MapCollector cannot be null.");
+        final int chunkCount = scanRegionFiles(mappers, regionFiles,
+                tileTracker, checkpoint, 0);
+        saveRegionMaps(regionName, removeStale);
+        return chunkCount;
+    }
+    
+    /**
+     * Reads a set of Minecraft region files within multiple threads, passing
+     * all chunk data to a MapCollector.
+     * 
+     * @param collector      The MapCollector that will receive chunk data.
+     * 
+     * @param regionFiles    The set of Minecraft region files to read.
+     * 
+     * @param tileTracker    An optional tracker used to save map tiles as
+     *                       soon as all of their region files are processed.
+     * 
+     * @param checkpoint     An optional checkpoint used to periodically save
+     *                       map generation progress.
+     * 
+     * @param readerThreads  The number of region reader threads to use, or
+     *                       zero to choose based on the number of available
+     *                       processors.
+     * 
+     * @return               The total number of region chunks read.
+     */
+    private int scanRegionFiles(MapCollector collector,
+            ArrayList<File> regionFiles, TileTracker tileTracker,
+            MapCheckpoint checkpoint, int readerThreads)
+    {
+        final String FN_NAME = "scanRegionFiles";
+        Validate.notNull(collector, "MapCollector cannot be null.");
+        Validate.notNull(regionFiles, "Region files cannot be null.");
+        ExtendedValidate.isNotNegative(readerThreads, "Reader thread count");
         int numRegionFiles = regionFiles.size();
         // Provide threadsafe tracking of processed region and chunk counts:
         ProgressThread progressThread = new ProgressThread(numRegionFiles);
         progressThread.start();
+        if (tileTracker != null && uploadConnection != null)
+        {
+            collector.addTileWriteListener((tileFile) ->
+            {
+                uploadTile(tileFile, true);
+            });
+        }
+        if (tileTracker != null)
+        {
+            // Let zoom level tiles be saved as soon as the tiles they cover
+            // are finished:
+            collector.expectTiles(tileTracker.getTilePoints());
+        }
         // Handle all map updates within a single thread:
-        MapperThread mapperThread = new MapperThread(mappers);
+        MapperThread mapperThread = new MapperThread(collector, tileTracker,
+                checkpoint, TimeUnit.SECONDS.toMillis(checkpointInterval));
         mapperThread.start();
         // Divide region file updates between multiple threads:
         int numReaderThreads;
-        if (MULTI_REGION_THREADS)
+        if (readerThreads > 0)
+        {
+            numReaderThreads = readerThreads;
+        }
+        else if (MULTI_REGION_THREADS)
         {
             numReaderThreads = Math.max(1,
                     Runtime.getRuntime().availableProcessors() - 2);
@@ -872,8 +1769,31 @@ public final class MapCreator
             catch (InterruptedException e) { }
         }
         LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME, 
-                "All support threads joined, saving map image files.");
+                "All support threads joined.");
+        return progressThread.getChunkCount();
+    }
+    
+    /**
+     * Saves all maps held by the MapCollector, and records their keys and
+     * files for the next server update.
+     * 
+     * @param regionName   The name of the mapped region.
+     * 
+     * @param removeStale  Whether unused preview tiles or tiles kept from an
+     *                     earlier run should be removed once tile maps are
+     *                     saved.
+     */
+    private void saveRegionMaps(String regionName, boolean removeStale)
+    {
+        final String FN_NAME = "saveRegionMaps";
         mappers.saveMapFile();
+        if ((previewEnabled || tileHashesUsed()) && removeStale)
+        {
+            int removed = mappers.removeStaleTiles();
+            LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                    "Removed {0} unused tiles.", removed);
+        }
+        mappers.finishComposedImages();
         JsonArray regionKey = mappers.getMapKeys();
         LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME, 
                 "Saving {0} region map key items.", regionKey.size());
@@ -882,7 +1802,450 @@ public final class MapCreator
             keyBuilder.add(regionKey.get(i));
         }
         tileListBuilder.add(regionName, mappers.getMapFiles());
-        return progressThread.getChunkCount();
+        JsonArray dataTileFiles = mappers.getDataTileFiles();
+        if (dataTileFiles != null)
+        {
+            dataTileListBuilder.add(regionName, dataTileFiles);
+        }
+    }
+    
+    /**
+     * Maps a set of region files by dividing them between worker processes,
+     * then merges all worker results into the main MapCollector before saving
+     * the final maps.
+     * 
+     *  Workers save tiles for map types that draw chunks immediately directly
+     * to the shared output directory. Chunk data used by other map types is
+     * returned in each worker's result, so color ranges and map keys are
+     * calculated from the entire region.
+     * 
+     * @param regionName   The name of the mapped region.
+     * 
+     * @param outDir       The region-specific tile output directory.
+     * 
+     * @param regionFiles  The set of Minecraft region files to map.
+     * 
+     * @param startTime    The time map generation started, in milliseconds
+     *                     since the epoch.
+     * 
+     * @return             The total number of region chunks mapped.
+     */
+    private int mapRegionWithWorkers(String regionName, File outDir,
+            ArrayList<File> regionFiles, long startTime)
+    {
+        final String FN_NAME = "mapRegionWithWorkers";
+        Validate.notNull(mappers, "MapCollector cannot be null.");
+        JobDirectory jobs = new JobDirectory(workerJobDir);
+        jobs.clear();
+        final int workerCount = Math.max(1, workerProcesses);
+        final int readerThreads = Math.max(1,
+                (Runtime.getRuntime().availableProcessors() - 2)
+                / workerCount);
+        List<List<File>> shards = WorkerJob.shardRegions(regionFiles,
+                tileSize, workerCount * JOBS_PER_WORKER);
+        List<String> jobNames = new ArrayList<>();
+        try
+        {
+            for (int i = 0; i < shards.size(); i++)
+            {
+                WorkerJob job = new WorkerJob(regionName + "-" + i,
+                        regionName, outDir, shards.get(i), tileSize,
+                        altTileSizes, pixelsPerChunk, enabledMapTypes,
+                        startTime, readerThreads, dataTiles);
+                jobs.addJob(job);
+                jobNames.add(job.getName());
+            }
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.SEVERE, CLASSNAME, FN_NAME,
+                    "Failed to create worker jobs, mapping region in this "
+                    + "process:", e);
+            jobs.clear();
+            return mapRegion(regionName, regionFiles,
+                    new TileTracker(regionFiles, tileSize), null, true);
+        }
+        List<Process> workers = launchWorkers(workerProcesses);
+        LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                "Divided {0} region files into {1} jobs for {2} workers.",
+                new Object[] { regionFiles.size(), jobNames.size(),
+                workers.size() });
+        // Merge results as they arrive. Once launched workers exit, finish
+        // any remaining jobs in this process. Jobs that failed too many times
+        // are attempted once more in this process:
+        int chunkCount = 0;
+        Set<String> completedJobs = new HashSet<>();
+        while (completedJobs.size() < jobNames.size())
+        {
+            boolean foundResult = false;
+            for (String jobName : jobNames)
+            {
+                if (completedJobs.contains(jobName))
+                {
+                    continue;
+                }
+                if (jobs.isFinished(jobName))
+                {
+                    chunkCount += mergeWorkerResult(
+                            jobs.getResultFile(jobName));
+                    completedJobs.add(jobName);
+                    foundResult = true;
+                }
+                else if (jobs.isFailed(jobName))
+                {
+                    LogConfig.getLogger().logp(Level.WARNING, CLASSNAME,
+                            FN_NAME, "Retrying failed job {0} in this "
+                            + "process.", jobName);
+                    WorkerJob job = jobs.claimFailedJob(jobName);
+                    if (job == null || ! runWorkerJob(job, jobs))
+                    {
+                        LogConfig.getLogger().logp(Level.SEVERE, CLASSNAME,
+                                FN_NAME, "Job {0} failed, its regions will be"
+                                + " missing from the map.", jobName);
+                        completedJobs.add(jobName);
+                    }
+                    foundResult = true;
+                }
+            }
+            if (foundResult)
+            {
+                continue;
+            }
+            jobs.releaseStaleClaims(CLAIM_TIMEOUT);
+            if (workers.stream().noneMatch((worker) -> worker.isAlive()))
+            {
+                // Failed jobs return to the queue until they are marked as
+                // failed:
+                WorkerJob job = jobs.claimNextJob();
+                if (job != null)
+                {
+                    runWorkerJob(job, jobs);
+                    continue;
+                }
+            }
+            try
+            {
+                Thread.sleep(WORKER_POLL_INTERVAL);
+            }
+            catch (InterruptedException e)
+            {
+                // Just check again.
+            }
+        }
+        jobs.clear();
+        LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME, 
+                "All worker jobs merged, saving map image files.");
+        // Tiles saved by workers weren't recorded in the manifest:
+        mappers.recordSavedTiles();
+        saveRegionMaps(regionName, true);
+        return chunkCount;
+    }
+    
+    /**
+     * Creates the options used by a single mapping run, dividing any
+     * configured tile memory budget between the TileMaps of each mapped type
+     * and selecting PNG encoders and off-heap rasters.
+     * 
+     * @param mapCount  The number of map types that will be created at once.
+     * 
+     * @return          A new set of map options.
+     */
+    private MapOptions createMapOptions(int mapCount)
+    {
+        MapOptions options = new MapOptions();
+        if (tileMemoryBudgetMB > 0)
+        {
+            final long budget = tileMemoryBudgetMB * BYTES_PER_MB;
+            options.setTileMemoryBudget(Math.max(1,
+                    budget / Math.max(1, mapCount)));
+        }
+        options.setDefaultPngEncoder(defaultPngEncoder);
+        for (MapType type : MapType.values())
+        {
+            options.setPngEncoder(type, typePngEncoders.get(type));
+        }
+        options.setTileWriterThreads(encoderThreads);
+        options.setOffHeapEnabled(offHeapRasters);
+        return options;
+    }
+    
+    /**
+     * Saves the manifest of region files used to create a set of tiles, so
+     * the next run can update them. If any map type can't update saved tiles,
+     * the manifest is removed instead.
+     * 
+     * @param manifest  A manifest recorded before region files were read.
+     */
+    private void saveTileManifest(TileManifest manifest)
+    {
+        final String FN_NAME = "saveTileManifest";
+        if (! mappers.supportsIncrementalUpdates())
+        {
+            LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                    "Some enabled map types need data from every chunk, so "
+                    + "tiles will be recreated instead of updated.");
+            manifest.delete();
+            return;
+        }
+        try
+        {
+            manifest.save();
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Failed to save tile manifest, all tiles will be "
+                    + "recreated next time:", e);
+            manifest.delete();
+        }
+    }
+    
+    /**
+     * Saves the manifest of all files created while mapping a region, so the
+     * next run can find them without searching tile directories.
+     * 
+     * @param manifest  The manifest recording every tile saved.
+     */
+    private void saveGenerationManifest(GenerationManifest manifest)
+    {
+        final String FN_NAME = "saveGenerationManifest";
+        try
+        {
+            manifest.save();
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Failed to save generation manifest, tile directories "
+                    + "will be searched next time:", e);
+        }
+    }
+    
+    /**
+     * Checks if tile hashes will be used to skip saving unchanged and empty
+     * tiles. Tiles skipped after the last checkpoint couldn't be reloaded
+     * when resuming, so hashes are never used while checkpoints are enabled.
+     * 
+     * @return  Whether tile maps should keep hashes of their saved tiles.
+     */
+    private boolean tileHashesUsed()
+    {
+        return skipUnchangedTiles
+                && ! (checkpointsEnabled && checkpointDir != null);
+    }
+    
+    /**
+     * Maps a single worker job, saving its tiles and writing its result to
+     * the job directory. If mapping fails for any reason, the job is released
+     * so it can be attempted again, or marked as failed once it reaches the
+     * maximum number of attempts.
+     * 
+     * @param job   A job claimed by this process.
+     * 
+     * @param jobs  The directory the job was claimed from.
+     * 
+     * @return      Whether the job was completed successfully.
+     */
+    private boolean runWorkerJob(WorkerJob job, JobDirectory jobs)
+    {
+        final String FN_NAME = "runWorkerJob";
+        LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                "Mapping job {0} with {1} region files.", new Object[]
+                { job.getName(), job.getRegionFiles().size() });
+        // Show other processes that the job is still in progress:
+        Timer heartbeat = new Timer(true);
+        heartbeat.scheduleAtFixedRate(new TimerTask()
+        {
+            @Override
+            public void run()
+            {
+                jobs.touchClaim(job);
+            }
+        }, CLAIM_HEARTBEAT, CLAIM_HEARTBEAT);
+        try
+        {
+            final MapOptions options
+                    = createMapOptions(job.getMapTypes().size());
+            options.setDataTilesEnabled(job.dataTilesEnabled());
+            MapCollector jobMappers = new MapCollector(job.getOutDir(),
+                    job.getRegionName(), null, job.getTileSize(),
+                    job.getAltSizes(), job.getPixelsPerChunk(),
+                    job.getMapTypes(), job.getStartTime(), options);
+            ArrayList<File> jobFiles = new ArrayList<>(job.getRegionFiles());
+            final int chunkCount = scanRegionFiles(jobMappers, jobFiles,
+                    new TileTracker(jobFiles, job.getTileSize()), null,
+                    job.getReaderThreads());
+            jobMappers.savePartialMaps();
+            try (DataOutputStream out = new DataOutputStream(
+                    new GZIPOutputStream(new BufferedOutputStream(
+                    new FileOutputStream(jobs.getTempResultFile(job))))))
+            {
+                out.writeInt(chunkCount);
+                jobMappers.writeState(out);
+            }
+            jobs.finishJob(job);
+            return true;
+        }
+        catch (Exception e)
+        {
+            LogConfig.getLogger().logp(Level.SEVERE, CLASSNAME, FN_NAME,
+                    "Job " + job.getName() + " failed:", e);
+            jobs.getTempResultFile(job).delete();
+            jobs.releaseFailedJob(job);
+            return false;
+        }
+        finally
+        {
+            heartbeat.cancel();
+        }
+    }
+    
+    /**
+     * Launches local worker processes that map jobs from the worker job
+     * directory. Each worker writes its log output to a file in the job
+     * directory.
+     * 
+     * @param count  The number of worker processes to launch.
+     * 
+     * @return       All successfully launched worker processes.
+     */
+    private List<Process> launchWorkers(int count)
+    {
+        final String FN_NAME = "launchWorkers";
+        List<Process> workers = new ArrayList<>();
+        List<String> command = new ArrayList<>();
+        command.add(new File(new File(System.getProperty("java.home"), "bin"),
+                "java").getPath());
+        command.addAll(Arrays.asList(workerJvmOptions));
+        command.add("-cp");
+        command.add(System.getProperty("java.class.path"));
+        command.add(Main.class.getName());
+        command.add("--worker-jobs");
+        command.add(workerJobDir.getAbsolutePath());
+        for (int i = 0; i < count; i++)
+        {
+            ProcessBuilder builder = new ProcessBuilder(command);
+            builder.redirectErrorStream(true);
+            builder.redirectOutput(new File(workerJobDir,
+                    "worker" + i + ".log"));
+            try
+            {
+                workers.add(builder.start());
+            }
+            catch (IOException e)
+            {
+                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                        "Failed to launch worker process:", e);
+            }
+        }
+        return workers;
+    }
+    
+    /**
+     * Loads a worker job result into the main MapCollector.
+     * 
+     * @param resultFile  A finished job's result file.
+     * 
+     * @return            The number of chunks mapped by the job.
+     */
+    private int mergeWorkerResult(File resultFile)
+    {
+        final String FN_NAME = "mergeWorkerResult";
+        try (DataInputStream in = new DataInputStream(new GZIPInputStream(
+                new BufferedInputStream(new FileInputStream(resultFile)))))
+        {
+            final int chunkCount = in.readInt();
+            mappers.readState(in);
+            return chunkCount;
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.SEVERE, CLASSNAME, FN_NAME,
+                    "Failed to load worker result '" + resultFile + "':", e);
+            return 0;
+        }
+    }
+    
+    /**
+     * Quickly draws and saves low-detail preview tiles for every enabled map
+     * type, uploading them if early tile uploads are enabled.
+     * 
+     * @param regionName   The name of the mapped region.
+     * 
+     * @param outDir       The region-specific tile output directory.
+     * 
+     * @param regionFiles  All region files that will be mapped, grouped by
+     *                     tile.
+     * 
+     * @param options      The options used when mapping the region.
+     */
+    private void drawPreview(String regionName, File outDir,
+            List<File> regionFiles, MapOptions options)
+    {
+        final String FN_NAME = "drawPreview";
+        final long previewStart = System.currentTimeMillis();
+        MapPreview preview = new MapPreview(outDir, regionName, tileSize,
+                altTileSizes, pixelsPerChunk, enabledMapTypes, options);
+        TileWriter previewWriter = new TileWriter(PREVIEW_WRITER_THREADS);
+        if (uploadConnection != null)
+        {
+            // Previews will be replaced, so they aren't recorded as uploaded:
+            previewWriter.addWriteListener((tileFile) ->
+            {
+                uploadTile(tileFile, false);
+            });
+        }
+        final int tileCount = preview.draw(regionFiles, previewWriter);
+        previewWriter.shutdown();
+        LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                "Created {0} preview tiles in {1} ms.", new Object[]
+                { tileCount, System.currentTimeMillis() - previewStart });
+    }
+    
+    /**
+     * Uploads a map tile to the web server. This is called from tile writer
+     * threads as soon as each tile is saved.
+     * 
+     * @param tileFile  A saved map tile image file.
+     * 
+     * @param isFinal   Whether the tile is finished. Only finished tiles are
+     *                  recorded as uploaded, so that preview tiles are still
+     *                  replaced when the server update is sent.
+     */
+    private void uploadTile(File tileFile, boolean isFinal)
+    {
+        final String FN_NAME = "uploadTile";
+        final Connection connection = uploadConnection;
+        if (connection == null)
+        {
+            return;
+        }
+        final String path = tileFile.getPath();
+        Map<String, String> imageHeaders = new HashMap<>();
+        imageHeaders.put("path", path);
+        try
+        {
+            int status = connection.sendPng(path, imageHeaders,
+                    TILE_UPLOAD_PATH);
+            if (status == HTTP_OK)
+            {
+                if (isFinal)
+                {
+                    uploadedTiles.add(path);
+                }
+            }
+            else
+            {
+                LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                        "Early upload of '{0}' returned status {1}.",
+                        new Object[] { path, status });
+            }
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Error sending '{0}': {1}", new Object[] { path, e });
+        }
     }
     
     // Image map options:
@@ -893,17 +2256,51 @@ public final class MapCreator
     private int zMin = 0;
     private int width = 0;
     private int height = 0;
+    private boolean autoCropImages = false;
     
     // Tile options
     private boolean tilesEnabled = false;
     private File tileOutDir = null;
     private int tileSize = 0;
     private int[] altTileSizes = null;
+    private RegionOrder renderOrder = RegionOrder.POSITION;
+    private boolean previewEnabled = false;
+    private int tileMemoryBudgetMB = 0;
+    private boolean zoomLevelsEnabled = false;
+    private boolean incrementalUpdates = false;
+    private boolean skipUnchangedTiles = false;
+    private boolean sharedTileCache = false;
+    private boolean tileArchives = false;
+    private boolean dataTiles = false;
+    private Rectangle tileRenderBounds = null;
+    
+    // PNG encoding options:
+    private PngEncoder defaultPngEncoder = PngEncoder.DEFAULT;
+    private final Map<MapType, PngEncoder> typePngEncoders
+            = new EnumMap<>(MapType.class);
+    private int encoderThreads = 0;
+    
+    // Worker process options:
+    private boolean workersEnabled = false;
+    private File workerJobDir = null;
+    private int workerProcesses = 0;
+    private String[] workerJvmOptions = new String[0];
+    
+    // Checkpoint options:
+    private boolean checkpointsEnabled = false;
+    private File checkpointDir = null;
+    private int checkpointInterval = 0;
+    
+    // Early tile upload options:
+    private volatile Connection uploadConnection = null;
+    private final Set<String> uploadedTiles;
     
     private MapCollector mappers = null;
     private final JsonArrayBuilder keyBuilder;
     private final JsonObjectBuilder tileListBuilder;
+    private final JsonObjectBuilder dataTileListBuilder;
     private final ArrayList<Region> regionsToMap;
     private Set<MapType> enabledMapTypes;
     private int pixelsPerChunk = 0;  
+    private boolean offHeapRasters = false;
 }
@@ -113,6 +113,7 @@ public class MapUpdater
         // Generate or load update data:
         final MapCreator mapCreator;
         ServerUpdate updateManager = null;
+        Connection serverConnection = null;
         if (reuseCache && updateJson != null)
         {
             LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
@@ -145,6 +146,13 @@ public class MapUpdater
                             "Error applying command line options:", e);
                 }
             }
+            if (webConfig != null && webConfig.uploadFinishedTiles())
+            {
+                LogConfig.getLogger().logp(Level.CONFIG, CLASSNAME, FN_NAME,
+                        "Uploading map tiles as they are finished.");
+                serverConnection = new Connection(webConfig);
+                mapCreator.setTileUploadConnection(serverConnection);
+            }
             LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
                     "Options loaded, creating new server maps.");
             mapCreator.createMaps();
@@ -170,7 +178,10 @@ public class MapUpdater
         {
             LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
                     "Sending update data to ChunkAtlas-Viewer web server.");
-            Connection serverConnection = new Connection(webConfig);
+            if (serverConnection == null)
+            {
+                serverConnection = new Connection(webConfig);
+            }
             updateManager.sendUpdate(serverConnection);
         }
         else
@@ -5,10 +5,15 @@
  */
 package com.centuryglass.chunk_atlas.config;
 
+import com.centuryglass.chunk_atlas.mapping.images.PngEncoder;
 import com.centuryglass.chunk_atlas.mapping.maptype.MapType;
+import com.centuryglass.chunk_atlas.threads.RegionOrder;
 import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.Rectangle;
 import java.io.File;
 import java.util.Arrays;
+import java.util.EnumMap;
+import java.util.Map;
 import java.util.Set;
 import java.util.TreeSet;
 import java.util.function.BiConsumer;
@@ -121,9 +126,13 @@ public class MapGenConfig extends ConfigFile
          * @param width            The width in chunks of the mapped area.
          * 
          * @param height           The height in chunks of the mapped area. 
+         * 
+         * @param autoCrop         Whether the mapped area is reduced to the
+         *                         area covered by region files.
          */
         protected SingleImage(boolean enabled, boolean drawBackground,
-                String outPath, int xMin, int zMin, int width, int height)
+                String outPath, int xMin, int zMin, int width, int height,
+                boolean autoCrop)
         {
             ExtendedValidate.couldBeDirectory(new File(outPath),
                     " Image output path");
@@ -134,6 +143,7 @@ public class MapGenConfig extends ConfigFile
             this.zMin = zMin;
             this.width = width;
             this.height = height;
+            this.autoCrop = autoCrop;
         }
         
         public final boolean enabled;
@@ -143,6 +153,7 @@ public class MapGenConfig extends ConfigFile
         public final int zMin;
         public final int width;
         public final int height;
+        public final boolean autoCrop;
     }
     
     /**
@@ -171,8 +182,10 @@ public class MapGenConfig extends ConfigFile
         final int zMin = imageOptions.getInt(JsonKeys.Z_MIN);
         final int width = imageOptions.getInt(JsonKeys.WIDTH);
         final int height = imageOptions.getInt(JsonKeys.HEIGHT);
+        final boolean autoCrop = imageOptions.getBoolean(JsonKeys.AUTO_CROP,
+                false);
         return new SingleImage(enabled, drawBackground, path, xMin, zMin,
-                width, height);
+                width, height, autoCrop);
     }
         
     /**
@@ -194,16 +207,65 @@ public class MapGenConfig extends ConfigFile
          * 
          * @param alternateSizes   An array of alternate tile sizes to create
          *                         by rescaling the main set of tile images.
+         * 
+         * @param renderOrder      The order in which region files are scanned.
+         * 
+         * @param preview          Whether low-detail preview tiles will be
+         *                         created before full detail tiles.
+         * 
+         * @param memoryBudgetMB   The maximum number of megabytes all tile
+         *                         images held in memory may use, or zero to
+         *                         use the default budget for each map type.
+         * 
+         * @param zoomLevels       Whether a pyramid of zoomed out tiles will
+         *                         be built from the map tiles.
+         * 
+         * @param incremental      Whether tiles saved by an earlier run will
+         *                         be reused, redrawing only regions that
+         *                         changed.
+         * 
+         * @param skipUnchanged    Whether tiles identical to their saved
+         *                         images, and empty tiles, won't be written.
+         * 
+         * @param sharedCache      Whether all map types will hold their tiles
+         *                         in one shared multi-layer tile cache.
+         * 
+         * @param archive          Whether each map type's tiles will be
+         *                         copied into a single archive file.
+         * 
+         * @param dataTiles        Whether compact data tiles holding the
+         *                         chunk values used by every map type will be
+         *                         saved.
+         * 
+         * @param renderBounds     Optional chunk coordinate bounds of the only
+         *                         area redrawn within saved tiles, or null to
+         *                         draw all chunks.
          */
         protected MapTiles(boolean enabled, String outPath, int tileSize,
-                int[] alternateSizes)
+                int[] alternateSizes, RegionOrder renderOrder, boolean preview,
+                int memoryBudgetMB, boolean zoomLevels, boolean incremental,
+                boolean skipUnchanged, boolean sharedCache, boolean archive,
+                boolean dataTiles, Rectangle renderBounds)
         {
+            Validate.notNull(renderOrder, "Render order cannot be null.");
+            ExtendedValidate.isNotNegative(memoryBudgetMB,
+                    "Tile memory budget");
             ExtendedValidate.couldBeDirectory(new File(outPath),
                     "Tile output path");
             this.enabled = enabled;
             this.outPath = outPath;
             this.tileSize = tileSize;
             this.alternateSizes = alternateSizes;
+            this.renderOrder = renderOrder;
+            this.preview = preview;
+            this.memoryBudgetMB = memoryBudgetMB;
+            this.zoomLevels = zoomLevels;
+            this.incremental = incremental;
+            this.skipUnchanged = skipUnchanged;
+            this.sharedCache = sharedCache;
+            this.archive = archive;
+            this.dataTiles = dataTiles;
+            this.renderBounds = renderBounds;
         }
         
         /**
@@ -218,10 +280,33 @@ public class MapGenConfig extends ConfigFile
             return Arrays.copyOf(alternateSizes, alternateSizes.length);
         }
         
+        /**
+         * Gets the bounds of the area that should be redrawn within saved map
+         * tiles.
+         * 
+         * @return  The chunk coordinate bounds of the redrawn area, or null if
+         *          all chunks should be drawn.
+         */
+        public Rectangle getRenderBounds()
+        {
+            if (renderBounds == null) { return null; }
+            return new Rectangle(renderBounds);
+        }
+        
         public final boolean enabled;
         public final String outPath;
         public final int tileSize;
+        public final RegionOrder renderOrder;
+        public final boolean preview;
+        public final int memoryBudgetMB;
+        public final boolean zoomLevels;
+        public final boolean incremental;
+        public final boolean skipUnchanged;
+        public final boolean sharedCache;
+        public final boolean archive;
+        public final boolean dataTiles;
         private final int[] alternateSizes;
+        private final Rectangle renderBounds;
     }
     
     /**
@@ -251,7 +336,320 @@ public class MapGenConfig extends ConfigFile
         {
             altSizes[i] = altSizeJson.getInt(i);
         }
-        return new MapTiles(enabled, path, tileSize, altSizes);
+        final String orderName = tileOptions.getString(JsonKeys.RENDER_ORDER,
+                RegionOrder.POSITION.name());
+        RegionOrder renderOrder = RegionOrder.fromString(orderName);
+        if (renderOrder == null)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Invalid render order \"{0}\", using {1}.",
+                    new Object[] { orderName, RegionOrder.POSITION });
+            renderOrder = RegionOrder.POSITION;
+        }
+        final boolean preview = tileOptions.getBoolean(JsonKeys.PREVIEW_TILES,
+                false);
+        final int memoryBudgetMB = tileOptions.getInt(JsonKeys.MEMORY_BUDGET,
+                0);
+        final boolean zoomLevels = tileOptions.getBoolean(
+                JsonKeys.ZOOM_LEVELS, false);
+        final boolean incremental = tileOptions.getBoolean(
+                JsonKeys.INCREMENTAL_UPDATES, false);
+        final boolean skipUnchanged = tileOptions.getBoolean(
+                JsonKeys.SKIP_UNCHANGED_TILES, false);
+        final boolean sharedCache = tileOptions.getBoolean(
+                JsonKeys.SHARED_TILE_CACHE, false);
+        final boolean archive = tileOptions.getBoolean(
+                JsonKeys.ARCHIVE_TILES, false);
+        final boolean dataTiles = tileOptions.getBoolean(JsonKeys.DATA_TILES,
+                false);
+        Rectangle renderBounds = null;
+        JsonObject boundsOptions = tileOptions.getJsonObject(
+                JsonKeys.RENDER_BOUNDS);
+        if (boundsOptions != null && boundsOptions.getBoolean(
+                JsonKeys.RENDER_BOUNDS_ENABLED, false))
+        {
+            final int width = boundsOptions.getInt(JsonKeys.WIDTH);
+            final int height = boundsOptions.getInt(JsonKeys.HEIGHT);
+            if (width > 0 && height > 0)
+            {
+                renderBounds = new Rectangle(
+                        boundsOptions.getInt(JsonKeys.X_MIN),
+                        boundsOptions.getInt(JsonKeys.Z_MIN), width, height);
+            }
+            else
+            {
+                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                        "Invalid tile render bounds size {0}x{1}, drawing all"
+                        + " chunks.", new Object[] { width, height });
+            }
+        }
+        return new MapTiles(enabled, path, tileSize, altSizes, renderOrder,
+                preview, memoryBudgetMB, zoomLevels, incremental,
+                skipUnchanged, sharedCache, archive, dataTiles, renderBounds);
+    }
+    
+    /**
+     * Holds options for saving and resuming from map generation checkpoints
+     * within an immutable data structure.
+     */
+    public class Checkpoints
+    {
+        /**
+         * Sets all checkpoint options on construction.
+         * 
+         * @param enabled   Whether checkpoints will be saved and loaded.
+         * 
+         * @param outPath   The path to the directory where checkpoints will
+         *                  be saved.
+         * 
+         * @param interval  The minimum number of seconds between saved
+         *                  checkpoints.
+         */
+        protected Checkpoints(boolean enabled, String outPath, int interval)
+        {
+            ExtendedValidate.couldBeDirectory(new File(outPath),
+                    "Checkpoint path");
+            ExtendedValidate.isNotNegative(interval, "Checkpoint interval");
+            this.enabled = enabled;
+            this.outPath = outPath;
+            this.interval = interval;
+        }
+        
+        public final boolean enabled;
+        public final String outPath;
+        public final int interval;
+    }
+    
+    /**
+     * Gets all options used for saving map generation checkpoints.
+     * 
+     * @return  The set of checkpoint options, or null if checkpoint options
+     *          could not be loaded.
+     */
+    public Checkpoints getCheckpointOptions()
+    {
+        final String FN_NAME = "getCheckpointOptions";
+        JsonObject checkpointOptions = getObjectOption(
+                JsonKeys.CHECKPOINT_OPTIONS, null);
+        if (checkpointOptions == null)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Checkpoint {0}", INVALID_OPTION_MSG);
+            return null;
+        }
+        final boolean enabled = checkpointOptions.getBoolean(
+                JsonKeys.CHECKPOINTS_ENABLED, false);
+        final String path = checkpointOptions.getString(JsonKeys.OUTPUT_PATH);
+        final int interval = checkpointOptions.getInt(
+                JsonKeys.CHECKPOINT_INTERVAL);
+        return new Checkpoints(enabled, path, interval);
+    }
+    
+    /**
+     * Holds options for dividing map generation between multiple worker
+     * processes within an immutable data structure.
+     */
+    public class Workers
+    {
+        /**
+         * Sets all worker options on construction.
+         * 
+         * @param enabled     Whether tile maps will be created by worker
+         *                    processes.
+         * 
+         * @param jobPath     The path to the directory where worker jobs and
+         *                    results will be shared.
+         * 
+         * @param processes   The number of worker processes to launch. If
+         *                    zero, only externally started workers will be
+         *                    used.
+         * 
+         * @param jvmOptions  Extra options passed to the Java runtime when
+         *                    launching each worker process.
+         */
+        protected Workers(boolean enabled, String jobPath, int processes,
+                String[] jvmOptions)
+        {
+            ExtendedValidate.couldBeDirectory(new File(jobPath),
+                    "Worker job path");
+            ExtendedValidate.isNotNegative(processes, "Worker process count");
+            Validate.notNull(jvmOptions, "JVM options cannot be null.");
+            this.enabled = enabled;
+            this.jobPath = jobPath;
+            this.processes = processes;
+            this.jvmOptions = jvmOptions;
+        }
+        
+        /**
+         * Gets the extra options used when launching worker processes.
+         * 
+         * @return  An array of Java runtime options.
+         */
+        public String[] getJvmOptions()
+        {
+            return Arrays.copyOf(jvmOptions, jvmOptions.length);
+        }
+        
+        public final boolean enabled;
+        public final String jobPath;
+        public final int processes;
+        private final String[] jvmOptions;
+    }
+    
+    /**
+     * Gets all options used for creating maps with worker processes.
+     * 
+     * @return  The set of worker options, or null if worker options could not
+     *          be loaded.
+     */
+    public Workers getWorkerOptions()
+    {
+        final String FN_NAME = "getWorkerOptions";
+        JsonObject workerOptions = getObjectOption(JsonKeys.WORKER_OPTIONS,
+                null);
+        if (workerOptions == null)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Worker process {0}", INVALID_OPTION_MSG);
+            return null;
+        }
+        final boolean enabled = workerOptions.getBoolean(
+                JsonKeys.WORKERS_ENABLED, false);
+        final String path = workerOptions.getString(JsonKeys.WORKER_JOB_PATH);
+        final int processes = workerOptions.getInt(JsonKeys.WORKER_PROCESSES);
+        JsonArray optionJson = workerOptions.getJsonArray(
+                JsonKeys.WORKER_JVM_OPTIONS);
+        final String[] jvmOptions = new String[(optionJson == null) ? 0
+                : optionJson.size()];
+        for (int i = 0; i < jvmOptions.length; i++)
+        {
+            jvmOptions[i] = optionJson.getString(i);
+        }
+        return new Workers(enabled, path, processes, jvmOptions);
+    }
+    
+    /**
+     * Holds options for encoding map images as PNG files within an immutable
+     * data structure.
+     */
+    public class PngEncoding
+    {
+        /**
+         * Sets all PNG encoding options on construction.
+         * 
+         * @param defaultEncoder  The encoder used by map types without their
+         *                        own encoding options.
+         * 
+         * @param typeEncoders    Encoders used by specific map types.
+         * 
+         * @param encoderThreads  The number of threads used to encode tiles,
+         *                        or zero to use one per available processor.
+         */
+        protected PngEncoding(PngEncoder defaultEncoder,
+                Map<MapType, PngEncoder> typeEncoders, int encoderThreads)
+        {
+            Validate.notNull(defaultEncoder, "PNG encoder cannot be null.");
+            Validate.notNull(typeEncoders, "Type encoders cannot be null.");
+            ExtendedValidate.isNotNegative(encoderThreads,
+                    "PNG encoder thread count");
+            this.defaultEncoder = defaultEncoder;
+            this.typeEncoders = new EnumMap<>(MapType.class);
+            this.typeEncoders.putAll(typeEncoders);
+            this.encoderThreads = encoderThreads;
+        }
+        
+        /**
+         * Gets the encoders selected for specific map types.
+         * 
+         * @return  A new map holding every map type with its own encoding
+         *          options, mapped to its encoder.
+         */
+        public Map<MapType, PngEncoder> getTypeEncoders()
+        {
+            return new EnumMap<>(typeEncoders);
+        }
+        
+        public final PngEncoder defaultEncoder;
+        public final int encoderThreads;
+        private final Map<MapType, PngEncoder> typeEncoders;
+    }
+    
+    /**
+     * Gets all options used for encoding map images.
+     * 
+     * @return  The set of PNG encoding options, or null if encoding options
+     *          could not be loaded.
+     */
+    public PngEncoding getPngEncodingOptions()
+    {
+        final String FN_NAME = "getPngEncodingOptions";
+        JsonObject encodingOptions = getObjectOption(JsonKeys.PNG_OPTIONS,
+                null);
+        if (encodingOptions == null)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "PNG encoding {0}", INVALID_OPTION_MSG);
+            return null;
+        }
+        final PngEncoder defaultEncoder = readPngEncoder(encodingOptions,
+                PngEncoder.DEFAULT);
+        Map<MapType, PngEncoder> typeEncoders = new EnumMap<>(MapType.class);
+        JsonObject typeOptions = encodingOptions.getJsonObject(
+                JsonKeys.PNG_TYPE_OPTIONS);
+        if (typeOptions != null)
+        {
+            for (MapType type : MapType.values())
+            {
+                JsonObject options = typeOptions.getJsonObject(type.name());
+                if (options != null)
+                {
+                    typeEncoders.put(type, readPngEncoder(options,
+                            defaultEncoder));
+                }
+            }
+        }
+        final int encoderThreads = encodingOptions.getInt(
+                JsonKeys.PNG_ENCODER_THREADS, 0);
+        return new PngEncoding(defaultEncoder, typeEncoders,
+                Math.max(0, encoderThreads));
+    }
+    
+    /**
+     * Creates a PNG encoder from a set of JSON encoding options.
+     * 
+     * @param options   A JSON object that may define a compression level, row
+     *                  filter, and whether indexed color is used.
+     * 
+     * @param fallback  An encoder providing values for options that are
+     *                  missing or invalid.
+     * 
+     * @return          The configured encoder.
+     */
+    private PngEncoder readPngEncoder(JsonObject options, PngEncoder fallback)
+    {
+        final String FN_NAME = "readPngEncoder";
+        int level = options.getInt(JsonKeys.PNG_COMPRESSION_LEVEL,
+                fallback.getCompressionLevel());
+        if (level < 0 || level > 9)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Invalid PNG compression level {0}, using {1}.",
+                    new Object[] { level, fallback.getCompressionLevel() });
+            level = fallback.getCompressionLevel();
+        }
+        final String filterName = options.getString(JsonKeys.PNG_FILTER,
+                fallback.getFilter().name());
+        PngEncoder.Filter filter = PngEncoder.Filter.fromString(filterName);
+        if (filter == null)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Invalid PNG filter \"{0}\", using {1}.",
+                    new Object[] { filterName, fallback.getFilter() });
+            filter = fallback.getFilter();
+        }
+        final boolean indexedColor = options.getBoolean(
+                JsonKeys.PNG_INDEXED_COLOR, fallback.usesIndexedColor());
+        return new PngEncoder(level, filter, indexedColor);
     }
     
     /**
@@ -274,6 +672,18 @@ public class MapGenConfig extends ConfigFile
         return px;
     }
     
+    /**
+     * Finds whether map image pixel data should be held outside of the Java
+     * heap while maps are drawn.
+     * 
+     * @return  Whether off-heap map rasters are enabled in the configuration
+     *          file, or false by default.
+     */
+    public boolean getOffHeapRasters()
+    {
+        return getBoolOption(JsonKeys.OFF_HEAP_RASTERS, false);
+    }
+    
     /**
      * Gets the set of MapTypes that should be generated.
      * 
@@ -312,6 +722,8 @@ public class MapGenConfig extends ConfigFile
         public static final String REGION_NAME = "name";
         // Width and height in pixels of each generated map type:
         public static final String CHUNK_PX = "pixelsPerChunk";
+        // Whether map pixel data is held outside of the Java heap:
+        public static final String OFF_HEAP_RASTERS = "offHeapRasters";
         // The set of options to use for single-image maps:
         public static final String IMAGE_MAP_OPTIONS = "singleImageMaps";
         // The set of options to use when generating map image tiles:
@@ -322,20 +734,73 @@ public class MapGenConfig extends ConfigFile
         public static final String OUTPUT_PATH = "outPath";
         // Whether single-image maps will be drawn over a background image:
         public static final String DRAW_BACKGROUND = "drawBackground";
-        // Minimum chunk x-coordinate to draw in single image maps:
+        // Minimum chunk x-coordinate of single image maps or render bounds:
         public static final String X_MIN = "xMin";
-        // Minimum chunk z-coordinate to draw in single image maps:
+        // Minimum chunk z-coordinate of single image maps or render bounds:
         public static final String Z_MIN = "zMin";
-        // Width in chunks of single image maps:
+        // Width in chunks of single image maps or render bounds:
         public static final String WIDTH = "width";
-        // Height in chunks of single image maps:
+        // Height in chunks of single image maps or render bounds:
         public static final String HEIGHT = "height";
+        // Whether single image map bounds are cropped to the area covered by
+        // region files:
+        public static final String AUTO_CROP = "autoCrop";
         // Width and height in chunks of each map tile image:
         public static final String TILE_SIZE = "tileSize";
         // Alternate tile resolution sizes that should be generated from the
         // main set of tile images:
         public static final String SCALED_TILES = "createScaled";
+        // Order in which region files are scanned:
+        public static final String RENDER_ORDER = "renderOrder";
+        // Whether preview tiles are created before full detail tiles:
+        public static final String PREVIEW_TILES = "createPreview";
+        // Maximum megabytes of tile image data held in memory:
+        public static final String MEMORY_BUDGET = "memoryBudgetMB";
+        // Whether zoomed out tiles are built from the map tiles:
+        public static final String ZOOM_LEVELS = "createZoomLevels";
+        // Whether only tiles covering changed regions will be redrawn:
+        public static final String INCREMENTAL_UPDATES = "incrementalUpdates";
+        // Whether unchanged and empty tiles are left out when saving tiles:
+        public static final String SKIP_UNCHANGED_TILES = "skipUnchangedTiles";
+        // Whether all map types hold their tiles in one shared cache:
+        public static final String SHARED_TILE_CACHE = "sharedTileCache";
+        // Whether each map type's tiles are copied into one archive file:
+        public static final String ARCHIVE_TILES = "archiveTiles";
+        // Whether compact chunk data tiles are saved alongside map tiles:
+        public static final String DATA_TILES = "dataTiles";
+        // The set of options used to redraw one area within saved tiles:
+        public static final String RENDER_BOUNDS = "renderBounds";
+        // Whether only chunks within the render bounds will be redrawn:
+        public static final String RENDER_BOUNDS_ENABLED = "enabled";
         // The set of MapTypes used when generating maps:
         public static final String MAP_TYPES_USED = "mapTypes";
+        // The set of options used when saving map generation checkpoints:
+        public static final String CHECKPOINT_OPTIONS = "checkpoints";
+        // Whether checkpoints will be saved and loaded:
+        public static final String CHECKPOINTS_ENABLED = "enabled";
+        // Minimum number of seconds between saved checkpoints:
+        public static final String CHECKPOINT_INTERVAL = "intervalSeconds";
+        // The set of options used when creating maps with worker processes:
+        public static final String WORKER_OPTIONS = "workers";
+        // Whether worker processes will be used:
+        public static final String WORKERS_ENABLED = "enabled";
+        // Directory where worker jobs are shared:
+        public static final String WORKER_JOB_PATH = "jobPath";
+        // Number of worker processes to launch:
+        public static final String WORKER_PROCESSES = "processes";
+        // Extra Java runtime options used when launching workers:
+        public static final String WORKER_JVM_OPTIONS = "jvmOptions";
+        // The set of options used when encoding map images:
+        public static final String PNG_OPTIONS = "pngEncoding";
+        // zlib compression level used when encoding map images:
+        public static final String PNG_COMPRESSION_LEVEL = "compressionLevel";
+        // Row filter strategy used when encoding map images:
+        public static final String PNG_FILTER = "filter";
+        // Whether images with few colors are saved with a palette:
+        public static final String PNG_INDEXED_COLOR = "indexedColor";
+        // Number of threads used to encode map tiles:
+        public static final String PNG_ENCODER_THREADS = "encoderThreads";
+        // Encoding options used for specific map types:
+        public static final String PNG_TYPE_OPTIONS = "mapTypes";
     } 
 }
@@ -83,6 +83,19 @@ public class WebServerConfig extends ConfigFile
         return getBoolOption(JsonKeys.SEND_CACHE, false);
     }
     
+    /**
+     * Checks whether map tiles should be uploaded to the web server as soon
+     * as they are finished, instead of waiting for the server to request them
+     * after map generation completes.
+     * 
+     * @return  Whether finished tiles should be uploaded during map
+     *          generation.
+     */
+    public boolean uploadFinishedTiles()
+    {
+        return getBoolOption(JsonKeys.UPLOAD_FINISHED, false);
+    }
+    
     /**
      * Gets the File holding this application's public RSA key.
      * 
@@ -129,6 +142,7 @@ public class WebServerConfig extends ConfigFile
         public static final String ADDRESS = "address";
         public static final String CACHE = "cached update";
         public static final String SEND_CACHE = "send cached";
+        public static final String UPLOAD_FINISHED = "upload finished tiles";
         public static final String KEY_PATHS = "key paths";
         public static final String PUBLIC_KEY = "public";
         public static final String PRIVATE_KEY = "private";
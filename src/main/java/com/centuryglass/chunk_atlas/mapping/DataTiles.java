@@ -0,0 +1,911 @@
+/**
+ * @file DataTiles.java
+ *
+ * Saves compact binary tiles holding the chunk values used by all map types.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.FileUtil;
+import com.centuryglass.chunk_atlas.util.PointLongMap;
+import com.centuryglass.chunk_atlas.worldinfo.Biome;
+import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
+import com.centuryglass.chunk_atlas.worldinfo.Structure;
+import java.awt.Point;
+import java.awt.Rectangle;
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeSet;
+import java.util.logging.Level;
+import java.util.zip.Deflater;
+import java.util.zip.DeflaterOutputStream;
+import java.util.zip.InflaterInputStream;
+import org.apache.commons.lang.Validate;
+
+/**
+ * DataTiles stores the values each map type draws from every chunk: its
+ * error flag, inhabited time, last update time, most common biome, and
+ * highest priority structure. Once all chunks are received, these values are
+ * saved in one small compressed data tile for each map tile area. A client
+ * can then draw any map type from the same data, instead of downloading
+ * separate images for every map type.
+ *
+ *  Data tiles are saved within the DIR_NAME directory of the region's tile
+ * output directory, in a subdirectory named after the tile size. Each file
+ * is named after the region and the coordinates of the tile's upper left
+ * chunk, like map tile images. A file starts with an uncompressed header:
+ *
+ *  int MAGIC, short VERSION, int tile x-coordinate, int tile z-coordinate,
+ * int tile size, int chunk count.
+ *
+ *  The remainder of the file is compressed with DEFLATE, and holds the
+ * biome name table (int count, then UTF names), the structure name table
+ * (int count, then UTF names), and then each chunk field stored in its own
+ * column, with chunks sorted by their offset (z * tileSize + x) within the
+ * tile:
+ *
+ *  - Offsets, as unsigned varints holding the gap after the last offset.
+ *  - Flags, as bytes holding the ErrorFlag ordinal in the lower four bits and
+ *    FLAG_HAS_CHUNK if chunk data was found.
+ *  - Inhabited times, as unsigned varints.
+ *  - Last update times, as unsigned varints.
+ *  - Biomes, as unsigned varints holding one plus the biome table index, or
+ *    zero for chunks without biomes.
+ *  - Structures, as unsigned varints holding one plus the structure table
+ *    index, or zero for chunks without structures.
+ *
+ *  DataTiles is not thread-safe, and chunks should be added by a single
+ * thread.
+ */
+public class DataTiles
+{
+    private static final String CLASSNAME = DataTiles.class.getName();
+
+    /**
+     * Data tile directory name, within the region tile output directory.
+     */
+    public static final String DIR_NAME = "Data";
+    /**
+     * Data tile file extension.
+     */
+    public static final String FILE_EXTENSION = ".dat";
+    /**
+     * Identifies the start of a data tile file.
+     */
+    public static final int MAGIC = 0x43414454;
+    /**
+     * Data tile file format version.
+     */
+    public static final short VERSION = 1;
+    /**
+     * Flag bit set for chunks with saved chunk data. Chunks without it only
+     * hold a structure referenced by other chunks.
+     */
+    public static final int FLAG_HAS_CHUNK = 0x10;
+    // Flag bits holding the chunk's ErrorFlag ordinal:
+    private static final int FLAG_ERROR_MASK = 0x0f;
+    private static final String TEMP_SUFFIX = ".tmp";
+    private static final Biome[] BIOMES = Biome.values();
+    private static final Structure[] STRUCTURES = Structure.values();
+    private static final ChunkData.ErrorFlag[] ERROR_FLAGS
+            = ChunkData.ErrorFlag.values();
+
+    /**
+     * Creates an empty set of data tiles on construction.
+     *
+     * @param tileDir   The region-specific tile output directory.
+     *
+     * @param region    The name of the mapped region.
+     *
+     * @param tileSize  The width and height in chunks of each data tile.
+     */
+    public DataTiles(File tileDir, String region, int tileSize)
+    {
+        ExtendedValidate.couldBeDirectory(tileDir, "Tile output directory");
+        ExtendedValidate.notNullOrEmpty(region, "Region name");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        dataDir = new File(new File(tileDir, DIR_NAME),
+                String.valueOf(tileSize));
+        this.region = region;
+        this.tileSize = tileSize;
+        chunkInfo = new PointLongMap();
+        inhabitedTimes = new PointLongMap();
+        updateTimes = new PointLongMap();
+        structureRefs = new PointLongMap();
+        changedTileAreas = new HashMap<>();
+        writtenFiles = new ArrayList<>();
+    }
+
+    /**
+     * Stores the values of a single chunk.
+     *
+     * @param chunk  The world chunk to add to the data tiles.
+     */
+    public void addChunk(ChunkData chunk)
+    {
+        Validate.notNull(chunk, "Chunk cannot be null.");
+        final int x = chunk.getXPos();
+        final int z = chunk.getZPos();
+        long info = FLAG_HAS_CHUNK | chunk.getErrorType().ordinal();
+        Biome mainBiome = null;
+        int mainCount = 0;
+        for (Map.Entry<Biome, Integer> entry
+                : chunk.getBiomeCounts().entrySet())
+        {
+            final int count = entry.getValue();
+            if (mainBiome == null || count > mainCount
+                    || (count == mainCount
+                    && entry.getKey().ordinal() < mainBiome.ordinal()))
+            {
+                mainBiome = entry.getKey();
+                mainCount = count;
+            }
+        }
+        if (mainBiome != null)
+        {
+            info |= (long) (mainBiome.ordinal() + 1) << 8;
+        }
+        chunkInfo.put(x, z, info);
+        if (chunk.getInhabitedTime() != 0)
+        {
+            inhabitedTimes.put(x, z, chunk.getInhabitedTime());
+        }
+        if (chunk.getLastUpdate() != 0)
+        {
+            updateTimes.put(x, z, chunk.getLastUpdate());
+        }
+        for (Map.Entry<Point, Structure> entry
+                : chunk.getStructureRefs().entrySet())
+        {
+            final Point refPt = entry.getKey();
+            final long savedRef = structureRefs.get(refPt.x, refPt.y, -1);
+            if (savedRef < 0 || STRUCTURES[(int) savedRef].getPriority()
+                    < entry.getValue().getPriority())
+            {
+                structureRefs.put(refPt.x, refPt.y,
+                        entry.getValue().ordinal());
+            }
+        }
+    }
+
+    /**
+     * Reuses data tiles saved by an earlier run, replacing only the values
+     * within changed areas. Saved chunk values outside of those areas are
+     * kept when the tiles holding them are saved again. This should be
+     * called before any chunks are added.
+     *
+     * @param changedAreas  The chunk coordinate bounds of every area that
+     *                      will be read again.
+     */
+    public void updateSavedTiles(Collection<Rectangle> changedAreas)
+    {
+        Validate.notNull(changedAreas, "Changed areas cannot be null.");
+        for (Rectangle area : changedAreas)
+        {
+            final int firstX = area.x - Math.floorMod(area.x, tileSize);
+            final int firstZ = area.y - Math.floorMod(area.y, tileSize);
+            for (int z = firstZ; z < area.y + area.height; z += tileSize)
+            {
+                for (int x = firstX; x < area.x + area.width; x += tileSize)
+                {
+                    final Point tilePt = new Point(x, z);
+                    List<Rectangle> tileAreas = changedTileAreas.get(tilePt);
+                    if (tileAreas == null)
+                    {
+                        tileAreas = new ArrayList<>();
+                        changedTileAreas.put(tilePt, tileAreas);
+                    }
+                    tileAreas.add(area.intersection(new Rectangle(x, z,
+                            tileSize, tileSize)));
+                }
+            }
+        }
+    }
+
+    /**
+     * Records every data tile file saved or removed in a generation manifest.
+     * This should be called before any tiles are saved.
+     *
+     * @param manifest  The manifest of the mapped region.
+     */
+    public void setGenerationManifest(GenerationManifest manifest)
+    {
+        Validate.notNull(manifest, "Generation manifest cannot be null.");
+        this.manifest = manifest;
+    }
+
+    /**
+     * Adds all data tiles already saved in the data tile directory to the
+     * generation manifest, for tiles saved by an earlier run that didn't save
+     * a manifest.
+     */
+    public void recordSavedTiles()
+    {
+        if (manifest == null || ! dataDir.isDirectory())
+        {
+            return;
+        }
+        final String prefix = region + ".";
+        for (File file : dataDir.listFiles())
+        {
+            final String name = file.getName();
+            if (! file.isFile() || ! name.startsWith(prefix)
+                    || ! name.endsWith(FILE_EXTENSION))
+            {
+                continue;
+            }
+            final String[] coords = name.substring(prefix.length(),
+                    name.length() - FILE_EXTENSION.length()).split("\\.");
+            try
+            {
+                if (coords.length == 2)
+                {
+                    manifest.record(DIR_NAME, 0, tileSize,
+                            Integer.parseInt(coords[0]),
+                            Integer.parseInt(coords[1]), file);
+                }
+            }
+            catch (NumberFormatException e)
+            {
+                // Not a data tile, ignore it.
+            }
+        }
+    }
+
+    /**
+     * Saves every data tile holding added chunks, along with saved tiles
+     * with changed areas. Saved values outside of changed areas are kept, and
+     * tiles left without any chunks are removed.
+     *
+     * @return  The number of data tile files written.
+     */
+    public int save()
+    {
+        final String FN_NAME = "save";
+        // Group all chunk coordinates by tile:
+        final Map<Point, TileKeys> tileKeys = new HashMap<>();
+        final Point lookupPt = new Point();
+        PointLongMap.EntryConsumer addKey = (x, z, value) ->
+        {
+            lookupPt.setLocation(x - Math.floorMod(x, tileSize),
+                    z - Math.floorMod(z, tileSize));
+            TileKeys keys = tileKeys.get(lookupPt);
+            if (keys == null)
+            {
+                keys = new TileKeys();
+                tileKeys.put(new Point(lookupPt), keys);
+            }
+            keys.add((z - lookupPt.y) * tileSize + (x - lookupPt.x));
+        };
+        chunkInfo.forEach(addKey);
+        structureRefs.forEach((x, z, value) ->
+        {
+            if (! chunkInfo.containsKey(x, z))
+            {
+                addKey.accept(x, z, value);
+            }
+        });
+        TreeSet<Point> tilePoints = new TreeSet<>((first, second) ->
+        {
+            if (first.y == second.y)
+            {
+                return Integer.compare(first.x, second.x);
+            }
+            return Integer.compare(first.y, second.y);
+        });
+        tilePoints.addAll(tileKeys.keySet());
+        tilePoints.addAll(changedTileAreas.keySet());
+        if (! tilePoints.isEmpty() && ! dataDir.isDirectory())
+        {
+            Validate.isTrue(dataDir.mkdirs(), "Couldn't create data tile "
+                    + "directory '" + dataDir + "'.");
+        }
+        int written = 0;
+        for (Point tilePt : tilePoints)
+        {
+            final File tileFile = getTileFile(tilePt);
+            TileKeys keys = tileKeys.get(tilePt);
+            TileRecords records = createRecords(tilePt, keys);
+            List<Rectangle> changedAreas = changedTileAreas.get(tilePt);
+            if (changedAreas != null && tileFile.isFile())
+            {
+                try
+                {
+                    records = mergeSavedRecords(readTile(tileFile),
+                            records, tilePt, changedAreas);
+                }
+                catch (IOException e)
+                {
+                    LogConfig.getLogger().logp(Level.WARNING, CLASSNAME,
+                            FN_NAME, "Replacing invalid data tile '{0}': {1}",
+                            new Object[] { tileFile, e });
+                }
+            }
+            if (records.count == 0)
+            {
+                if (tileFile.delete() && manifest != null)
+                {
+                    manifest.remove(tileFile);
+                }
+                continue;
+            }
+            try
+            {
+                writeTile(tileFile, tilePt, records);
+                written++;
+                writtenFiles.add(tileFile);
+                if (manifest != null)
+                {
+                    manifest.record(DIR_NAME, 0, tileSize, tilePt.x,
+                            tilePt.y, tileFile);
+                }
+            }
+            catch (IOException e)
+            {
+                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                        "Failed to save data tile '{0}': {1}",
+                        new Object[] { tileFile, e });
+            }
+        }
+        changedTileAreas.clear();
+        LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                "Saved {0} data tiles for region {1}.",
+                new Object[] { written, region });
+        return written;
+    }
+
+    /**
+     * Gets all saved data tile files. If a generation manifest is set, this
+     * includes tiles kept from earlier runs.
+     *
+     * @return  The list of data tile files.
+     */
+    public List<File> getTileFiles()
+    {
+        if (manifest == null)
+        {
+            return new ArrayList<>(writtenFiles);
+        }
+        List<File> files = new ArrayList<>();
+        manifest.getEntries(DIR_NAME).forEach((entry) ->
+        {
+            files.add(entry.file);
+        });
+        return files;
+    }
+
+    /**
+     * Writes all stored chunk values, so they can be restored after an
+     * interruption or merged from a worker process.
+     *
+     * @param out           The stream where chunk values will be written.
+     *
+     * @throws IOException  If unable to write to the stream.
+     */
+    public void writeState(DataOutputStream out) throws IOException
+    {
+        for (PointLongMap values : new PointLongMap[] { chunkInfo,
+                inhabitedTimes, updateTimes, structureRefs })
+        {
+            out.writeInt(values.size());
+            for (long key : values.keys())
+            {
+                final int x = PointLongMap.unpackX(key);
+                final int z = PointLongMap.unpackZ(key);
+                out.writeInt(x);
+                out.writeInt(z);
+                out.writeLong(values.get(x, z, 0));
+            }
+        }
+    }
+
+    /**
+     * Loads chunk values saved with writeState.
+     *
+     * @param in            A stream holding saved chunk values.
+     *
+     * @throws IOException  If unable to read valid state data.
+     */
+    public void readState(DataInputStream in) throws IOException
+    {
+        for (PointLongMap values : new PointLongMap[] { chunkInfo,
+                inhabitedTimes, updateTimes, structureRefs })
+        {
+            final int count = in.readInt();
+            for (int i = 0; i < count; i++)
+            {
+                final int x = in.readInt();
+                final int z = in.readInt();
+                final long value = in.readLong();
+                if (values == structureRefs)
+                {
+                    if (value < 0 || value >= STRUCTURES.length)
+                    {
+                        throw new IOException("Invalid structure " + value);
+                    }
+                    final long savedRef = structureRefs.get(x, z, -1);
+                    if (savedRef >= 0 && STRUCTURES[(int) savedRef]
+                            .getPriority() >= STRUCTURES[(int) value]
+                            .getPriority())
+                    {
+                        continue;
+                    }
+                }
+                values.put(x, z, value);
+            }
+        }
+    }
+
+    /**
+     * Gets the file used to save a data tile.
+     *
+     * @param tilePt  The coordinates of the tile's upper left chunk.
+     *
+     * @return        The data tile file.
+     */
+    private File getTileFile(Point tilePt)
+    {
+        return new File(dataDir, region + "." + tilePt.x + "." + tilePt.y
+                + FILE_EXTENSION);
+    }
+
+    /**
+     * Creates the records of all stored chunks within a tile.
+     *
+     * @param tilePt  The coordinates of the tile's upper left chunk.
+     *
+     * @param keys    The offsets of all stored chunks within the tile, or
+     *                null if the tile holds no stored chunks.
+     *
+     * @return        The tile's chunk records, sorted by offset.
+     */
+    private TileRecords createRecords(Point tilePt, TileKeys keys)
+    {
+        if (keys == null)
+        {
+            return new TileRecords(0);
+        }
+        final int[] offsets = Arrays.copyOf(keys.offsets, keys.count);
+        Arrays.sort(offsets);
+        TileRecords records = new TileRecords(offsets.length);
+        for (int offset : offsets)
+        {
+            final int x = tilePt.x + (offset % tileSize);
+            final int z = tilePt.y + (offset / tileSize);
+            final long info = chunkInfo.get(x, z, 0);
+            records.add(offset, (int) (info & 0xff),
+                    inhabitedTimes.get(x, z, 0), updateTimes.get(x, z, 0),
+                    (int) (info >>> 8), (int) (structureRefs.get(x, z, -1)
+                    + 1));
+        }
+        return records;
+    }
+
+    /**
+     * Combines a saved tile's records with new records, keeping only saved
+     * records outside of changed areas that weren't replaced.
+     *
+     * @param saved         Records loaded from the saved tile.
+     *
+     * @param added         New records for the same tile.
+     *
+     * @param tilePt        The coordinates of the tile's upper left chunk.
+     *
+     * @param changedAreas  All changed areas within the tile.
+     *
+     * @return              The combined records, sorted by offset.
+     */
+    private TileRecords mergeSavedRecords(TileRecords saved,
+            TileRecords added, Point tilePt, List<Rectangle> changedAreas)
+    {
+        TileRecords merged = new TileRecords(saved.count + added.count);
+        int savedIdx = 0;
+        int addedIdx = 0;
+        while (savedIdx < saved.count || addedIdx < added.count)
+        {
+            if (addedIdx < added.count && (savedIdx == saved.count
+                    || added.offsets[addedIdx] <= saved.offsets[savedIdx]))
+            {
+                if (savedIdx < saved.count
+                        && added.offsets[addedIdx] == saved.offsets[savedIdx])
+                {
+                    savedIdx++;
+                }
+                merged.add(added, addedIdx++);
+                continue;
+            }
+            final int offset = saved.offsets[savedIdx];
+            final int x = tilePt.x + (offset % tileSize);
+            final int z = tilePt.y + (offset / tileSize);
+            boolean changed = false;
+            for (Rectangle area : changedAreas)
+            {
+                if (area.contains(x, z))
+                {
+                    changed = true;
+                    break;
+                }
+            }
+            if (! changed)
+            {
+                merged.add(saved, savedIdx);
+            }
+            savedIdx++;
+        }
+        return merged;
+    }
+
+    /**
+     * Writes a data tile file.
+     *
+     * @param tileFile      The file where the tile will be saved.
+     *
+     * @param tilePt        The coordinates of the tile's upper left chunk.
+     *
+     * @param records       The tile's chunk records, sorted by offset.
+     *
+     * @throws IOException  If unable to write the file.
+     */
+    private void writeTile(File tileFile, Point tilePt, TileRecords records)
+            throws IOException
+    {
+        // Find the biomes and structures used within the tile:
+        final int[] biomeIndices = new int[BIOMES.length + 1];
+        final int[] structureIndices = new int[STRUCTURES.length + 1];
+        for (int i = 0; i < records.count; i++)
+        {
+            biomeIndices[records.biomes[i]] = 1;
+            structureIndices[records.structures[i]] = 1;
+        }
+        List<String> biomeNames = new ArrayList<>();
+        for (int i = 1; i < biomeIndices.length; i++)
+        {
+            if (biomeIndices[i] != 0)
+            {
+                biomeNames.add(BIOMES[i - 1].name());
+                biomeIndices[i] = biomeNames.size();
+            }
+        }
+        List<String> structureNames = new ArrayList<>();
+        for (int i = 1; i < structureIndices.length; i++)
+        {
+            if (structureIndices[i] != 0)
+            {
+                structureNames.add(STRUCTURES[i - 1].name());
+                structureIndices[i] = structureNames.size();
+            }
+        }
+        File tempFile = new File(dataDir, tileFile.getName() + TEMP_SUFFIX);
+        Deflater deflater = new Deflater(Deflater.BEST_COMPRESSION);
+        try (DataOutputStream out = new DataOutputStream(
+                new BufferedOutputStream(new FileOutputStream(tempFile))))
+        {
+            out.writeInt(MAGIC);
+            out.writeShort(VERSION);
+            out.writeInt(tilePt.x);
+            out.writeInt(tilePt.y);
+            out.writeInt(tileSize);
+            out.writeInt(records.count);
+            DeflaterOutputStream compressed = new DeflaterOutputStream(out,
+                    deflater);
+            DataOutputStream body = new DataOutputStream(
+                    new BufferedOutputStream(compressed));
+            body.writeInt(biomeNames.size());
+            for (String name : biomeNames)
+            {
+                body.writeUTF(name);
+            }
+            body.writeInt(structureNames.size());
+            for (String name : structureNames)
+            {
+                body.writeUTF(name);
+            }
+            int lastOffset = -1;
+            for (int i = 0; i < records.count; i++)
+            {
+                writeVarLong(body, records.offsets[i] - lastOffset - 1);
+                lastOffset = records.offsets[i];
+            }
+            for (int i = 0; i < records.count; i++)
+            {
+                body.writeByte(records.flags[i]);
+            }
+            for (int i = 0; i < records.count; i++)
+            {
+                writeVarLong(body, records.inhabited[i]);
+            }
+            for (int i = 0; i < records.count; i++)
+            {
+                writeVarLong(body, records.updates[i]);
+            }
+            for (int i = 0; i < records.count; i++)
+            {
+                writeVarLong(body, biomeIndices[records.biomes[i]]);
+            }
+            for (int i = 0; i < records.count; i++)
+            {
+                writeVarLong(body, structureIndices[records.structures[i]]);
+            }
+            body.flush();
+            compressed.finish();
+        }
+        finally
+        {
+            deflater.end();
+        }
+        FileUtil.replaceFile(tempFile, tileFile);
+    }
+
+    /**
+     * Reads all chunk records from a data tile file.
+     *
+     * @param tileFile      A file written by DataTiles with the same tile
+     *                      size.
+     *
+     * @return              The tile's chunk records, sorted by offset.
+     *
+     * @throws IOException  If the file couldn't be read, or isn't a valid data
+     *                      tile.
+     */
+    private TileRecords readTile(File tileFile) throws IOException
+    {
+        try (DataInputStream in = new DataInputStream(
+                new BufferedInputStream(new FileInputStream(tileFile))))
+        {
+            if (in.readInt() != MAGIC || in.readShort() != VERSION)
+            {
+                throw new IOException("Unsupported data tile format");
+            }
+            in.readInt();
+            in.readInt();
+            final int savedSize = in.readInt();
+            final int count = in.readInt();
+            if (savedSize != tileSize || count < 0
+                    || count > tileSize * tileSize)
+            {
+                throw new IOException("Mismatched data tile size");
+            }
+            return readRecords(new DataInputStream(new BufferedInputStream(
+                    new InflaterInputStream(in))), count, tileSize * tileSize);
+        }
+    }
+
+    /**
+     * Reads the compressed chunk records of a data tile file.
+     *
+     * @param input         A stream holding the decompressed body of a data
+     *                      tile file. The stream will be closed once all
+     *                      records are read.
+     *
+     * @param count         The number of records saved in the file.
+     *
+     * @param maxOffset     The number of chunks within a tile.
+     *
+     * @return              The tile's chunk records, sorted by offset.
+     *
+     * @throws IOException  If the stream doesn't hold valid records.
+     */
+    private static TileRecords readRecords(DataInputStream input, int count,
+            int maxOffset) throws IOException
+    {
+        try (DataInputStream body = input)
+        {
+            final int biomeCount = body.readInt();
+            if (biomeCount < 0 || biomeCount > BIOMES.length)
+            {
+                throw new IOException("Invalid biome count");
+            }
+            final int[] biomeOrdinals = new int[biomeCount + 1];
+            for (int i = 1; i < biomeOrdinals.length; i++)
+            {
+                try
+                {
+                    biomeOrdinals[i] = Biome.valueOf(body.readUTF())
+                            .ordinal() + 1;
+                }
+                catch (IllegalArgumentException e)
+                {
+                    biomeOrdinals[i] = 0;
+                }
+            }
+            final int structureCount = body.readInt();
+            if (structureCount < 0 || structureCount > STRUCTURES.length)
+            {
+                throw new IOException("Invalid structure count");
+            }
+            final int[] structureOrdinals = new int[structureCount + 1];
+            for (int i = 1; i < structureOrdinals.length; i++)
+            {
+                try
+                {
+                    structureOrdinals[i] = Structure.valueOf(body.readUTF())
+                            .ordinal() + 1;
+                }
+                catch (IllegalArgumentException e)
+                {
+                    structureOrdinals[i] = 0;
+                }
+            }
+            TileRecords records = new TileRecords(count);
+            records.count = count;
+            int offset = -1;
+            for (int i = 0; i < count; i++)
+            {
+                final long gap = readVarLong(body);
+                if (gap >= maxOffset - offset - 1)
+                {
+                    throw new IOException("Invalid chunk offset");
+                }
+                offset += (int) gap + 1;
+                records.offsets[i] = offset;
+            }
+            for (int i = 0; i < count; i++)
+            {
+                records.flags[i] = body.readByte();
+                if ((records.flags[i] & FLAG_ERROR_MASK)
+                        >= ERROR_FLAGS.length)
+                {
+                    throw new IOException("Invalid chunk error flag");
+                }
+            }
+            for (int i = 0; i < count; i++)
+            {
+                records.inhabited[i] = readVarLong(body);
+            }
+            for (int i = 0; i < count; i++)
+            {
+                records.updates[i] = readVarLong(body);
+            }
+            for (int i = 0; i < count; i++)
+            {
+                records.biomes[i] = biomeOrdinals[(int) readVarLong(body)];
+            }
+            for (int i = 0; i < count; i++)
+            {
+                records.structures[i]
+                        = structureOrdinals[(int) readVarLong(body)];
+            }
+            return records;
+        }
+        catch (IndexOutOfBoundsException e)
+        {
+            throw new IOException("Invalid data tile table index", e);
+        }
+    }
+
+    /**
+     * Writes a value as an unsigned variable-length integer, using seven
+     * bits per byte with the highest bit set on all but the last byte.
+     *
+     * @param out           The stream where the value will be written.
+     *
+     * @param value         The value to write.
+     *
+     * @throws IOException  If unable to write to the stream.
+     */
+    private static void writeVarLong(DataOutputStream out, long value)
+            throws IOException
+    {
+        while ((value & ~0x7fL) != 0)
+        {
+            out.writeByte((int) ((value & 0x7f) | 0x80));
+            value >>>= 7;
+        }
+        out.writeByte((int) value);
+    }
+
+    /**
+     * Reads an unsigned variable-length integer written by writeVarLong.
+     *
+     * @param in            The stream holding the value.
+     *
+     * @return              The value read.
+     *
+     * @throws IOException  If unable to read a valid value.
+     */
+    private static long readVarLong(DataInputStream in) throws IOException
+    {
+        long value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            final int next = in.readUnsignedByte();
+            value |= (long) (next & 0x7f) << shift;
+            if ((next & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw new IOException("Invalid variable-length value");
+    }
+
+    // The offsets of all stored chunks within one tile, in no particular
+    // order:
+    private static class TileKeys
+    {
+        public void add(int offset)
+        {
+            if (count == offsets.length)
+            {
+                offsets = Arrays.copyOf(offsets, count * 2);
+            }
+            offsets[count++] = offset;
+        }
+        public int[] offsets = new int[16];
+        public int count = 0;
+    }
+
+    // All chunk records within one tile, stored in parallel arrays sorted by
+    // offset. Biomes and structures hold their ordinal plus one, or zero if
+    // not present:
+    private static class TileRecords
+    {
+        public TileRecords(int capacity)
+        {
+            offsets = new int[capacity];
+            flags = new byte[capacity];
+            inhabited = new long[capacity];
+            updates = new long[capacity];
+            biomes = new int[capacity];
+            structures = new int[capacity];
+        }
+        public void add(int offset, int flag, long inhabitedTime,
+                long lastUpdate, int biome, int structure)
+        {
+            offsets[count] = offset;
+            flags[count] = (byte) flag;
+            inhabited[count] = inhabitedTime;
+            updates[count] = lastUpdate;
+            biomes[count] = biome;
+            structures[count] = structure;
+            count++;
+        }
+        public void add(TileRecords source, int index)
+        {
+            add(source.offsets[index], source.flags[index],
+                    source.inhabited[index], source.updates[index],
+                    source.biomes[index], source.structures[index]);
+        }
+        public final int[] offsets;
+        public final byte[] flags;
+        public final long[] inhabited;
+        public final long[] updates;
+        public final int[] biomes;
+        public final int[] structures;
+        public int count = 0;
+    }
+
+    // Directory where data tiles are saved:
+    private final File dataDir;
+    // Name of the mapped region:
+    private final String region;
+    // Width and height in chunks of each data tile:
+    private final int tileSize;
+    // Chunk flags in the lowest byte, with the main biome ordinal plus one in
+    // the following bits, mapped by chunk coordinate:
+    private final PointLongMap chunkInfo;
+    // Nonzero inhabited times, mapped by chunk coordinate:
+    private final PointLongMap inhabitedTimes;
+    // Nonzero last update times, mapped by chunk coordinate:
+    private final PointLongMap updateTimes;
+    // Structure ordinal values, mapped by chunk coordinate:
+    private final PointLongMap structureRefs;
+    // Areas within saved tiles that will be replaced, mapped by tile:
+    private final Map<Point, List<Rectangle>> changedTileAreas;
+    // Data tile files written by this object:
+    private final List<File> writtenFiles;
+    // Optional manifest recording all saved data tiles:
+    private GenerationManifest manifest = null;
+}
@@ -0,0 +1,347 @@
+/**
+ * @file GenerationManifest.java
+ *
+ * Records every map file created while generating a region's maps.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.FileUtil;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.logging.Level;
+import javax.json.Json;
+import javax.json.JsonArray;
+import javax.json.JsonArrayBuilder;
+import javax.json.JsonException;
+import javax.json.JsonObject;
+import javax.json.JsonReader;
+import javax.json.JsonWriter;
+import org.apache.commons.lang.Validate;
+
+/**
+ * GenerationManifest keeps an in-memory record of every map tile file written
+ * or confirmed to be current while a region's maps are generated, along with
+ * each file's map type, zoom level, tile size, and coordinates. Lists of
+ * created tiles are built from the manifest instead of searching output
+ * directories, which is slow with many tiles and also finds stale files.
+ *
+ *  Once all of a region's maps are finished, the manifest is saved in the
+ * region's tile output directory. The next run loads it to find tiles it can
+ * keep, or tiles it needs to delete, and removes the saved file before any
+ * tiles change, so a saved manifest always describes a completed run.
+ *
+ *  GenerationManifest is thread-safe.
+ */
+public class GenerationManifest
+{
+    private static final String CLASSNAME
+            = GenerationManifest.class.getName();
+
+    // Manifest file name, within the region tile output directory:
+    private static final String MANIFEST_NAME = "generationManifest.json";
+    private static final String TEMP_SUFFIX = ".tmp";
+
+    /**
+     * A single map file recorded in the manifest.
+     */
+    public static class Entry
+    {
+        /**
+         * Stores file properties on construction.
+         *
+         * @param file     The map file.
+         *
+         * @param region   The name of the mapped region.
+         *
+         * @param mapType  The name of the file's map type.
+         *
+         * @param zoom     The number of times the tile was zoomed out from
+         *                 full detail, or zero for full detail tiles.
+         *
+         * @param size     The tile set size, matching the name of the full
+         *                 detail tile directory holding the file.
+         *
+         * @param x        The x-coordinate of the tile's upper left chunk.
+         *
+         * @param z        The z-coordinate of the tile's upper left chunk.
+         */
+        protected Entry(File file, String region, String mapType, int zoom,
+                int size, int x, int z)
+        {
+            this.file = file;
+            this.region = region;
+            this.mapType = mapType;
+            this.zoom = zoom;
+            this.size = size;
+            this.x = x;
+            this.z = z;
+        }
+        public final File file;
+        public final String region;
+        public final String mapType;
+        public final int zoom;
+        public final int size;
+        public final int x;
+        public final int z;
+    }
+
+    /**
+     * Creates an empty manifest on construction.
+     *
+     * @param tileDir  The region-specific tile output directory where the
+     *                 manifest will be saved.
+     *
+     * @param region   The name of the mapped region.
+     */
+    public GenerationManifest(File tileDir, String region)
+    {
+        ExtendedValidate.couldBeDirectory(tileDir, "Tile output directory");
+        ExtendedValidate.notNullOrEmpty(region, "Region name");
+        this.tileDir = tileDir;
+        this.region = region;
+        entries = new HashMap<>();
+    }
+
+    /**
+     * Loads the manifest saved by the last completed run, if one exists. The
+     * saved file is deleted once loaded, since it won't describe the output
+     * directory once map generation begins.
+     *
+     * @param tileDir  The region-specific tile output directory where the
+     *                 manifest is saved.
+     *
+     * @param region   The name of the mapped region.
+     *
+     * @return         The saved manifest, or null if no valid manifest was
+     *                 found.
+     */
+    public static GenerationManifest load(File tileDir, String region)
+    {
+        final String FN_NAME = "load";
+        File manifestFile = new File(tileDir, MANIFEST_NAME);
+        if (! manifestFile.isFile())
+        {
+            return null;
+        }
+        GenerationManifest manifest = new GenerationManifest(tileDir, region);
+        try (JsonReader reader = Json.createReader(
+                new FileInputStream(manifestFile)))
+        {
+            JsonArray files = reader.readObject().getJsonArray(
+                    JsonKeys.FILES);
+            for (int i = 0; i < files.size(); i++)
+            {
+                JsonObject file = files.getJsonObject(i);
+                manifest.record(file.getString(JsonKeys.MAP_TYPE),
+                        file.getInt(JsonKeys.ZOOM), file.getInt(JsonKeys.SIZE),
+                        file.getInt(JsonKeys.X), file.getInt(JsonKeys.Z),
+                        new File(file.getString(JsonKeys.PATH)));
+            }
+        }
+        catch (IOException | JsonException | NullPointerException
+                | ClassCastException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Ignoring invalid generation manifest '{0}': {1}",
+                    new Object[] { manifestFile, e });
+            manifest = null;
+        }
+        manifestFile.delete();
+        return manifest;
+    }
+
+    /**
+     * Gets the name of the region the manifest describes.
+     *
+     * @return  The mapped region's name.
+     */
+    public String getRegion()
+    {
+        return region;
+    }
+
+    /**
+     * Records a map file that was written or found to be current, replacing
+     * any earlier entry for the same file.
+     *
+     * @param mapType  The name of the file's map type.
+     *
+     * @param zoom     The number of times the tile was zoomed out from full
+     *                 detail, or zero for full detail tiles.
+     *
+     * @param size     The tile set size, matching the name of the full detail
+     *                 tile directory holding the file.
+     *
+     * @param x        The x-coordinate of the tile's upper left chunk.
+     *
+     * @param z        The z-coordinate of the tile's upper left chunk.
+     *
+     * @param file     The map file.
+     */
+    public synchronized void record(String mapType, int zoom, int size,
+            int x, int z, File file)
+    {
+        ExtendedValidate.notNullOrEmpty(mapType, "Map type name");
+        ExtendedValidate.isNotNegative(zoom, "Zoom level");
+        Validate.notNull(file, "Map file cannot be null.");
+        entries.put(file.getPath(), new Entry(file, region, mapType, zoom,
+                size, x, z));
+    }
+
+    /**
+     * Removes a deleted map file from the manifest.
+     *
+     * @param file  A map file that no longer exists.
+     */
+    public synchronized void remove(File file)
+    {
+        Validate.notNull(file, "Map file cannot be null.");
+        entries.remove(file.getPath());
+    }
+
+    /**
+     * Checks if the manifest holds no files.
+     *
+     * @return  Whether no files were recorded.
+     */
+    public synchronized boolean isEmpty()
+    {
+        return entries.isEmpty();
+    }
+
+    /**
+     * Gets every recorded map file.
+     *
+     * @return  A new list holding all manifest entries, in no particular
+     *          order.
+     */
+    public synchronized List<Entry> getEntries()
+    {
+        return new ArrayList<>(entries.values());
+    }
+
+    /**
+     * Gets all recorded files of a map type.
+     *
+     * @param mapType  The name of a map type.
+     *
+     * @return         A new list holding the map type's entries, in no
+     *                 particular order.
+     */
+    public synchronized List<Entry> getEntries(String mapType)
+    {
+        List<Entry> typeEntries = new ArrayList<>();
+        for (Entry entry : entries.values())
+        {
+            if (entry.mapType.equals(mapType))
+            {
+                typeEntries.add(entry);
+            }
+        }
+        return typeEntries;
+    }
+
+    /**
+     * Gets all recorded files of a map type in one tile set and zoom level.
+     *
+     * @param mapType  The name of a map type.
+     *
+     * @param zoom     A zoom level, where zero is full detail.
+     *
+     * @param size     A tile set size.
+     *
+     * @return         A new list holding the matching entries, in no
+     *                 particular order.
+     */
+    public synchronized List<Entry> getEntries(String mapType, int zoom,
+            int size)
+    {
+        List<Entry> tileEntries = new ArrayList<>();
+        for (Entry entry : entries.values())
+        {
+            if (entry.zoom == zoom && entry.size == size
+                    && entry.mapType.equals(mapType))
+            {
+                tileEntries.add(entry);
+            }
+        }
+        return tileEntries;
+    }
+
+    /**
+     * Saves the manifest in the tile output directory. This should only be
+     * called once all of the region's maps are finished.
+     *
+     * @throws IOException  If unable to write the manifest file.
+     */
+    public void save() throws IOException
+    {
+        final String FN_NAME = "save";
+        // Sort files so unchanged maps produce identical manifests:
+        Map<String, Entry> sorted;
+        synchronized (this)
+        {
+            sorted = new TreeMap<>(entries);
+        }
+        JsonArrayBuilder fileBuilder = Json.createArrayBuilder();
+        sorted.forEach((path, entry) ->
+        {
+            fileBuilder.add(Json.createObjectBuilder()
+                    .add(JsonKeys.PATH, path)
+                    .add(JsonKeys.MAP_TYPE, entry.mapType)
+                    .add(JsonKeys.ZOOM, entry.zoom)
+                    .add(JsonKeys.SIZE, entry.size)
+                    .add(JsonKeys.X, entry.x)
+                    .add(JsonKeys.Z, entry.z));
+        });
+        JsonObject manifest = Json.createObjectBuilder()
+                .add(JsonKeys.REGION, region)
+                .add(JsonKeys.FILES, fileBuilder)
+                .build();
+        if (! tileDir.isDirectory())
+        {
+            Validate.isTrue(tileDir.mkdirs(), "Couldn't create tile output "
+                    + "directory '" + tileDir + "'.");
+        }
+        File manifestFile = new File(tileDir, MANIFEST_NAME);
+        File tempFile = new File(tileDir, MANIFEST_NAME + TEMP_SUFFIX);
+        try (JsonWriter writer = Json.createWriter(
+                new FileOutputStream(tempFile)))
+        {
+            writer.writeObject(manifest);
+        }
+        FileUtil.replaceFile(tempFile, manifestFile);
+        LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                "Saved generation manifest for {0} with {1} files.",
+                new Object[] { region, sorted.size() });
+    }
+
+    // All JSON keys used in manifest files:
+    private static class JsonKeys
+    {
+        public static final String REGION = "region";
+        public static final String FILES = "files";
+        public static final String PATH = "path";
+        public static final String MAP_TYPE = "type";
+        public static final String ZOOM = "zoom";
+        public static final String SIZE = "size";
+        public static final String X = "x";
+        public static final String Z = "z";
+    }
+
+    // Region-specific tile output directory holding the manifest:
+    private final File tileDir;
+    // Name of the mapped region:
+    private final String region;
+    // Recorded map files, mapped by path:
+    private final Map<String, Entry> entries;
+}
@@ -0,0 +1,376 @@
+/**
+ * @file MapCheckpoint.java
+ *
+ * Saves and loads partial map generation progress.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.mapping.maptype.MapType;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.FileUtil;
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.HashSet;
+import java.util.Set;
+import java.util.logging.Level;
+import java.util.zip.GZIPInputStream;
+import java.util.zip.GZIPOutputStream;
+import javax.json.Json;
+import javax.json.JsonArray;
+import javax.json.JsonArrayBuilder;
+import javax.json.JsonException;
+import javax.json.JsonObject;
+import javax.json.JsonObjectBuilder;
+import javax.json.JsonReader;
+import javax.json.JsonWriter;
+import org.apache.commons.lang.Validate;
+
+/**
+ * MapCheckpoint records the progress of tile map generation for a single
+ * region, so that an interrupted run can resume without rescanning region
+ * files that were already mapped.
+ *
+ *  Each checkpoint is made of a JSON index file listing completed region files
+ * and the settings used to create the map, and a compressed binary file
+ * holding intermediate Mapper data. Tile images are flushed to the disk
+ * before each checkpoint is saved, so the saved tiles always contain every
+ * completed region.
+ */
+public class MapCheckpoint
+{
+    private static final String CLASSNAME = MapCheckpoint.class.getName();
+
+    // Checkpoint file name suffixes:
+    private static final String INDEX_SUFFIX = ".checkpoint.json";
+    private static final String STATE_SUFFIX = ".state.gz";
+    private static final String TEMP_SUFFIX = ".tmp";
+
+    /**
+     * Creates a new, empty checkpoint for a map generation run.
+     *
+     * @param checkpointDir   The directory where checkpoint files are saved.
+     *
+     * @param regionName      The name of the mapped region.
+     *
+     * @param startTime       The time map generation started, in milliseconds
+     *                        since the epoch.
+     *
+     * @param tileSize        The width and height in chunks of each map tile.
+     *
+     * @param altSizes        Alternate scaled tile sizes being created.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param mapTypes        The set of map types being created.
+     *
+     * @param dataTiles       Whether data tiles are being created.
+     */
+    public MapCheckpoint(File checkpointDir, String regionName,
+            long startTime, int tileSize, int[] altSizes, int pixelsPerChunk,
+            Set<MapType> mapTypes, boolean dataTiles)
+    {
+        ExtendedValidate.couldBeDirectory(checkpointDir,
+                "Checkpoint directory");
+        ExtendedValidate.notNullOrEmpty(regionName, "Region name");
+        Validate.notNull(mapTypes, "Map types cannot be null.");
+        this.checkpointDir = checkpointDir;
+        this.regionName = regionName;
+        this.startTime = startTime;
+        settings = createSettings(tileSize, altSizes, pixelsPerChunk,
+                mapTypes, dataTiles);
+        completedRegions = new HashSet<>();
+    }
+
+    /**
+     * Loads a saved checkpoint, if one exists and was created using the same
+     * map settings.
+     *
+     * @param checkpointDir   The directory where checkpoint files are saved.
+     *
+     * @param regionName      The name of the mapped region.
+     *
+     * @param tileSize        The width and height in chunks of each map tile.
+     *
+     * @param altSizes        Alternate scaled tile sizes being created.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param mapTypes        The set of map types being created.
+     *
+     * @param dataTiles       Whether data tiles are being created.
+     *
+     * @return                The saved checkpoint, or null if no matching
+     *                        checkpoint could be loaded.
+     */
+    public static MapCheckpoint load(File checkpointDir, String regionName,
+            int tileSize, int[] altSizes, int pixelsPerChunk,
+            Set<MapType> mapTypes, boolean dataTiles)
+    {
+        final String FN_NAME = "load";
+        ExtendedValidate.notNullOrEmpty(regionName, "Region name");
+        File indexFile = new File(checkpointDir, regionName + INDEX_SUFFIX);
+        File stateFile = new File(checkpointDir, regionName + STATE_SUFFIX);
+        if (! indexFile.isFile() || ! stateFile.isFile())
+        {
+            return null;
+        }
+        JsonObject index;
+        try (JsonReader reader = Json.createReader(
+                new FileInputStream(indexFile)))
+        {
+            index = reader.readObject();
+        }
+        catch (IOException | JsonException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Ignoring unreadable checkpoint '{0}': {1}",
+                    new Object[] { indexFile, e });
+            return null;
+        }
+        try
+        {
+            JsonObject settings = createSettings(tileSize, altSizes,
+                    pixelsPerChunk, mapTypes, dataTiles);
+            if (! settings.equals(index.getJsonObject(JsonKeys.SETTINGS)))
+            {
+                LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                        "Map settings changed since region {0} was "
+                        + "checkpointed, ignoring saved checkpoint.",
+                        regionName);
+                return null;
+            }
+            MapCheckpoint checkpoint = new MapCheckpoint(checkpointDir,
+                    regionName, index.getJsonNumber(JsonKeys.START_TIME)
+                    .longValue(), tileSize, altSizes, pixelsPerChunk,
+                    mapTypes, dataTiles);
+            JsonArray completed = index.getJsonArray(
+                    JsonKeys.COMPLETED_REGIONS);
+            for (int i = 0; i < completed.size(); i++)
+            {
+                checkpoint.completedRegions.add(completed.getString(i));
+            }
+            return checkpoint;
+        }
+        catch (NullPointerException | ClassCastException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Ignoring invalid checkpoint '{0}': {1}",
+                    new Object[] { indexFile, e });
+            return null;
+        }
+    }
+
+    /**
+     * Gets the time map generation started.
+     *
+     * @return  The original map generation start time, in milliseconds since
+     *          the epoch.
+     */
+    public long getStartTime()
+    {
+        return startTime;
+    }
+
+    /**
+     * Checks if a region file was completely mapped when the checkpoint was
+     * saved.
+     *
+     * @param regionFile  A Minecraft region file.
+     *
+     * @return            Whether the region file can be skipped.
+     */
+    public synchronized boolean isRegionComplete(File regionFile)
+    {
+        Validate.notNull(regionFile, "Region file cannot be null.");
+        return completedRegions.contains(regionFile.getName());
+    }
+
+    /**
+     * Gets the number of region files marked as complete.
+     *
+     * @return  The completed region file count.
+     */
+    public synchronized int getCompletedRegionCount()
+    {
+        return completedRegions.size();
+    }
+
+    /**
+     * Marks a region file as completely mapped. This will not be recorded
+     * until the next time the checkpoint is saved.
+     *
+     * @param regionFile  A region file with all chunks drawn to the maps.
+     */
+    public synchronized void addCompletedRegion(File regionFile)
+    {
+        Validate.notNull(regionFile, "Region file cannot be null.");
+        completedRegions.add(regionFile.getName());
+    }
+
+    /**
+     * Saves all map tiles and mapper state, then updates the checkpoint
+     * index. This should only be called from the thread that draws chunks
+     * to the maps.
+     *
+     * @param mappers       The MapCollector holding all map data.
+     *
+     * @throws IOException  If unable to write checkpoint files.
+     */
+    public void save(MapCollector mappers) throws IOException
+    {
+        final String FN_NAME = "save";
+        Validate.notNull(mappers, "MapCollector cannot be null.");
+        if (! checkpointDir.isDirectory())
+        {
+            Validate.isTrue(checkpointDir.mkdirs(), "Couldn't create "
+                    + "checkpoint directory '" + checkpointDir + "'.");
+        }
+        final JsonArrayBuilder completedBuilder = Json.createArrayBuilder();
+        final int completedCount;
+        synchronized (this)
+        {
+            completedRegions.forEach((name) -> completedBuilder.add(name));
+            completedCount = completedRegions.size();
+        }
+        mappers.flushTiles();
+
+        File stateFile = new File(checkpointDir, regionName + STATE_SUFFIX);
+        File tempStateFile = new File(checkpointDir, stateFile.getName()
+                + TEMP_SUFFIX);
+        try (DataOutputStream out = new DataOutputStream(
+                new GZIPOutputStream(new BufferedOutputStream(
+                new FileOutputStream(tempStateFile)))))
+        {
+            mappers.writeState(out);
+        }
+        FileUtil.replaceFile(tempStateFile, stateFile);
+
+        JsonObject index = Json.createObjectBuilder()
+                .add(JsonKeys.START_TIME, startTime)
+                .add(JsonKeys.SETTINGS, settings)
+                .add(JsonKeys.COMPLETED_REGIONS, completedBuilder.build())
+                .build();
+        File indexFile = new File(checkpointDir, regionName + INDEX_SUFFIX);
+        File tempIndexFile = new File(checkpointDir, indexFile.getName()
+                + TEMP_SUFFIX);
+        try (JsonWriter writer = Json.createWriter(
+                new FileOutputStream(tempIndexFile)))
+        {
+            writer.writeObject(index);
+        }
+        FileUtil.replaceFile(tempIndexFile, indexFile);
+        LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                "Saved checkpoint for region {0}, {1} region files complete.",
+                new Object[] { regionName, completedCount });
+    }
+
+    /**
+     * Loads saved mapper state into a MapCollector.
+     *
+     * @param mappers       A MapCollector using the same settings as the
+     *                      saved checkpoint.
+     *
+     * @throws IOException  If unable to read saved state data.
+     */
+    public void restoreMapperState(MapCollector mappers) throws IOException
+    {
+        Validate.notNull(mappers, "MapCollector cannot be null.");
+        File stateFile = new File(checkpointDir, regionName + STATE_SUFFIX);
+        try (DataInputStream in = new DataInputStream(new GZIPInputStream(
+                new BufferedInputStream(new FileInputStream(stateFile)))))
+        {
+            mappers.readState(in);
+        }
+    }
+
+    /**
+     * Removes all saved checkpoint files. This should be called once map
+     * generation finishes.
+     */
+    public void delete()
+    {
+        for (String suffix : new String[] { INDEX_SUFFIX, STATE_SUFFIX })
+        {
+            File checkpointFile = new File(checkpointDir, regionName + suffix);
+            if (checkpointFile.isFile())
+            {
+                checkpointFile.delete();
+            }
+        }
+    }
+
+    /**
+     * Creates a JSON object holding all settings that must match for a
+     * checkpoint to be reused.
+     *
+     * @param tileSize        The width and height in chunks of each map tile.
+     *
+     * @param altSizes        Alternate scaled tile sizes being created.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param mapTypes        The set of map types being created.
+     *
+     * @param dataTiles       Whether data tiles are being created. This is
+     *                        only included in the settings when enabled, so
+     *                        settings saved before data tiles were added still
+     *                        match.
+     *
+     * @return                The JSON settings object.
+     */
+    static JsonObject createSettings(int tileSize, int[] altSizes,
+            int pixelsPerChunk, Set<MapType> mapTypes, boolean dataTiles)
+    {
+        JsonArrayBuilder altSizeBuilder = Json.createArrayBuilder();
+        if (altSizes != null)
+        {
+            for (int size : altSizes)
+            {
+                altSizeBuilder.add(size);
+            }
+        }
+        JsonArrayBuilder typeBuilder = Json.createArrayBuilder();
+        mapTypes.forEach((type) -> typeBuilder.add(type.name()));
+        JsonObjectBuilder builder = Json.createObjectBuilder()
+                .add(JsonKeys.TILE_SIZE, tileSize)
+                .add(JsonKeys.ALT_SIZES, altSizeBuilder.build())
+                .add(JsonKeys.CHUNK_PX, pixelsPerChunk)
+                .add(JsonKeys.MAP_TYPES, typeBuilder.build());
+        if (dataTiles)
+        {
+            builder.add(JsonKeys.DATA_TILES, true);
+        }
+        return builder.build();
+    }
+
+    // All JSON keys used in checkpoint index files:
+    private static class JsonKeys
+    {
+        public static final String START_TIME = "startTime";
+        public static final String SETTINGS = "settings";
+        public static final String COMPLETED_REGIONS = "completedRegions";
+        public static final String TILE_SIZE = "tileSize";
+        public static final String ALT_SIZES = "altSizes";
+        public static final String CHUNK_PX = "pixelsPerChunk";
+        public static final String MAP_TYPES = "mapTypes";
+        public static final String DATA_TILES = "dataTiles";
+    }
+
+    // Directory where checkpoint files are saved:
+    private final File checkpointDir;
+    // Name of the checkpointed region:
+    private final String regionName;
+    // Original map generation start time:
+    private final long startTime;
+    // Settings that must match when resuming:
+    private final JsonObject settings;
+    // Names of all region files that were completely mapped:
+    private final Set<String> completedRegions;
+}
@@ -5,6 +5,7 @@
  */
 package com.centuryglass.chunk_atlas.mapping;
 
+import com.centuryglass.chunk_atlas.config.LogConfig;
 import com.centuryglass.chunk_atlas.mapping.maptype.Mapper;
 import com.centuryglass.chunk_atlas.mapping.maptype.MapType;
 import com.centuryglass.chunk_atlas.mapping.maptype.StructureMapper;
@@ -13,15 +14,28 @@ import com.centuryglass.chunk_atlas.mapping.maptype.BiomeMapper;
 import com.centuryglass.chunk_atlas.mapping.maptype.RecentMapper;
 import com.centuryglass.chunk_atlas.mapping.maptype.BasicMapper;
 import com.centuryglass.chunk_atlas.mapping.maptype.ActivityMapper;
+import com.centuryglass.chunk_atlas.mapping.images.TileComposer;
+import com.centuryglass.chunk_atlas.mapping.images.TileWriter;
 import com.centuryglass.chunk_atlas.util.ExtendedValidate;
 import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
+import java.awt.Point;
+import java.awt.Rectangle;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
 import java.io.File;
+import java.io.IOException;
 import java.util.ArrayList;
 import java.util.Arrays;
-import java.util.HashMap;
+import java.util.Collection;
+import java.util.List;
 import java.util.Map;
 import java.util.Set;
+import java.util.TreeMap;
 import java.util.TreeSet;
+import java.util.function.Consumer;
+import java.util.logging.Level;
 import javax.json.Json;
 import javax.json.JsonArray;
 import javax.json.JsonArrayBuilder;
@@ -38,6 +52,8 @@ import org.bukkit.World;
  */
 public class MapCollector
 {
+    private static final String CLASSNAME = MapCollector.class.getName();
+    
     /**
      * Initializes all mappers to create single-image maps with fixed sizes.
      * 
@@ -74,12 +90,12 @@ public class MapCollector
         mappers = new ArrayList<>();
         initImageMappers(imageDir, regionName, region, xMin, zMin,
                 widthInChunks, heightInChunks, pixelsPerChunk,
-                getFullTypeSet());
+                getFullTypeSet(), new MapOptions());
     }
     
     /**
      * Initializes a specific set of mappers to create single-image maps with
-     * fixed sizes.
+     * fixed sizes, applying a set of map options.
      * 
      * @param imageDir        The directory where map images will be saved.
      * 
@@ -101,6 +117,10 @@ public class MapCollector
      * @param pixelsPerChunk  Width/height in pixels of each chunk.
      * 
      * @param mapTypes        The set of Mapper types that should be used.
+     * 
+     * @param options         Options applied to every map image. The
+     *                        MapCollector keeps its own copy, so later
+     *                        changes to these options have no effect on it.
      */
     public MapCollector(
             File imageDir,
@@ -111,12 +131,15 @@ public class MapCollector
             int widthInChunks,
             int heightInChunks,
             int pixelsPerChunk,
-            Set<MapType> mapTypes)
+            Set<MapType> mapTypes,
+            MapOptions options)
     {
         validateInitParams(imageDir, regionName, pixelsPerChunk);
+        Validate.notNull(options, "Map options cannot be null.");
         mappers = new ArrayList<>();
         initImageMappers(imageDir, regionName, region, xMin, zMin,
-                widthInChunks, heightInChunks, pixelsPerChunk, mapTypes);
+                widthInChunks, heightInChunks, pixelsPerChunk, mapTypes,
+                options);
     }
     
     /**
@@ -144,11 +167,14 @@ public class MapCollector
         validateInitParams(imageDir, regionName, pixelsPerChunk);
         mappers = new ArrayList<>();
         initTileMappers(imageDir, regionName, region, tileSize, altSizes,
-                pixelsPerChunk, getFullTypeSet());
+                pixelsPerChunk, getFullTypeSet(), System.currentTimeMillis(),
+                new MapOptions());
     }
         
     /**
-     * Initializes a specific set of mappers to create tiled image map folders.
+     * Initializes a specific set of mappers to create tiled image map folders,
+     * reusing any tiles saved since a specific time and applying a set of map
+     * options.
      * 
      * @param imageDir        The directory where map images will be saved.
      * 
@@ -166,6 +192,14 @@ public class MapCollector
      *                        chunk.
      * 
      * @param mapTypes        The set of Mapper types that should be used.
+     * 
+     * @param startTime       The time map generation started, in milliseconds
+     *                        since the epoch. When resuming from a checkpoint,
+     *                        this should be the original start time.
+     * 
+     * @param options         Options applied to every tile map. The
+     *                        MapCollector keeps its own copy, so later
+     *                        changes to these options have no effect on it.
      */
     public MapCollector(File imageDir,
             String regionName,
@@ -173,12 +207,15 @@ public class MapCollector
             int tileSize,
             int[] altSizes,
             int pixelsPerChunk,
-            Set<MapType> mapTypes)
+            Set<MapType> mapTypes,
+            long startTime,
+            MapOptions options)
     {
         validateInitParams(imageDir, regionName, pixelsPerChunk);
+        Validate.notNull(options, "Map options cannot be null.");
         mappers = new ArrayList<>();
         initTileMappers(imageDir, regionName, region, tileSize, altSizes,
-                pixelsPerChunk, mapTypes);
+                pixelsPerChunk, mapTypes, startTime, options);
     }
     
     /**
@@ -210,9 +247,361 @@ public class MapCollector
     public void saveMapFile()
     {
         mappers.forEach((mapper) -> {
-            mapper.saveMapFile();
+            if (chunkBounds == null || mapper.supportsIncrementalUpdates())
+            {
+                mapper.saveMapFile();
+            }
+        });
+        if (dataTiles != null)
+        {
+            dataTiles.save();
+        }
+        if (tileWriter != null)
+        {
+            tileWriter.shutdown();
+        }
+    }
+    
+    /**
+     * Saves all tiles drawn so far and stops the background tile writer,
+     * without running the final processing steps that draw stored chunk data.
+     * This is used when mapper state will be saved with writeState and merged
+     * into another MapCollector that creates the final maps.
+     */
+    public void savePartialMaps()
+    {
+        flushTiles();
+        if (tileWriter != null)
+        {
+            tileWriter.shutdown();
+        }
+    }
+    
+    /**
+     * Provides all Mappers with the set of tiles that will be drawn, so that
+     * zoomed out tiles can be saved as soon as the tiles they cover are
+     * finished.
+     * 
+     * @param tilePoints  The upper left chunk coordinates of every tile that
+     *                    will be drawn.
+     */
+    public void expectTiles(Collection<Point> tilePoints)
+    {
+        Validate.notNull(tilePoints, "Tile points cannot be null.");
+        mappers.forEach((mapper) ->
+        {
+            mapper.expectTiles(tilePoints);
+        });
+    }
+    
+    /**
+     * Checks if every Mapper can update saved tiles by redrawing only the
+     * areas that changed.
+     * 
+     * @return  Whether all maps can be updated incrementally.
+     */
+    public boolean supportsIncrementalUpdates()
+    {
+        for (Mapper mapper : mappers)
+        {
+            if (! mapper.supportsIncrementalUpdates())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    /**
+     * Makes all Mappers reuse tiles saved by an earlier run, redrawing only
+     * the areas that changed. This should be called before any chunks are
+     * drawn.
+     * 
+     * @param changedAreas  The chunk coordinate bounds of every area that will
+     *                      be redrawn.
+     */
+    public void updateSavedTiles(Collection<Rectangle> changedAreas)
+    {
+        Validate.notNull(changedAreas, "Changed areas cannot be null.");
+        mappers.forEach((mapper) ->
+        {
+            mapper.updateSavedTiles(changedAreas);
+        });
+        if (dataTiles != null)
+        {
+            dataTiles.updateSavedTiles(changedAreas);
+        }
+    }
+    
+    /**
+     * Limits drawing to chunks within an area, so that only that area of
+     * saved tiles is redrawn. Mappers that can't update saved tiles receive
+     * no chunks and don't save their maps, so their saved tiles are left
+     * unchanged. This should be called before any chunks are drawn.
+     * 
+     * @param bounds  The chunk coordinate bounds of the drawn area, or null
+     *                to draw all chunks with every Mapper.
+     */
+    public void setChunkBounds(Rectangle bounds)
+    {
+        chunkBounds = (bounds == null) ? null : new Rectangle(bounds);
+    }
+    
+    /**
+     * Saves and unloads a set of finished map tiles from all Mappers that
+     * support saving tiles early.
+     * 
+     * @param tilePoints  The upper left chunk coordinates of tiles that will
+     *                    not receive any more chunk data.
+     */
+    public void finishTiles(Collection<Point> tilePoints)
+    {
+        Validate.notNull(tilePoints, "Tile points cannot be null.");
+        if (tilePoints.isEmpty())
+        {
+            return;
+        }
+        mappers.forEach((mapper) ->
+        {
+            mapper.finishTiles(tilePoints);
+        });
+    }
+    
+    /**
+     * Deletes saved tile images created before map generation started, such as
+     * preview tiles that were never replaced. This should only be called after
+     * all maps are saved.
+     * 
+     * @return  The total number of tile images deleted.
+     */
+    public int removeStaleTiles()
+    {
+        int deleted = 0;
+        for (Mapper mapper : mappers)
+        {
+            deleted += mapper.removeStaleTiles();
+        }
+        return deleted;
+    }
+    
+    /**
+     * Makes all Mappers record every tile file they save in a generation
+     * manifest. This should be called before any chunks are drawn.
+     * 
+     * @param manifest  The manifest of the mapped region.
+     */
+    public void setGenerationManifest(GenerationManifest manifest)
+    {
+        Validate.notNull(manifest, "Generation manifest cannot be null.");
+        mappers.forEach((mapper) ->
+        {
+            mapper.setGenerationManifest(manifest);
+        });
+        if (dataTiles != null)
+        {
+            dataTiles.setGenerationManifest(manifest);
+        }
+    }
+    
+    /**
+     * Adds all tiles already saved in Mapper tile directories to the
+     * generation manifest, for tiles saved by worker processes or by an
+     * earlier run that didn't save a manifest.
+     */
+    public void recordSavedTiles()
+    {
+        mappers.forEach((mapper) ->
+        {
+            mapper.recordSavedTiles();
+        });
+        if (dataTiles != null)
+        {
+            dataTiles.recordSavedTiles();
+        }
+    }
+    
+    /**
+     * Copies the tiles of every Mapper into a single archive file per map
+     * type. This should only be called after all maps are saved.
+     * 
+     * @param removeFiles  Whether tile image files should be deleted once
+     *                     they are archived.
+     * 
+     * @return             The total number of tiles added to archives or
+     *                     replaced within them.
+     */
+    public int archiveTiles(boolean removeFiles)
+    {
+        int written = 0;
+        for (Mapper mapper : mappers)
+        {
+            written += mapper.archiveTiles(removeFiles);
+        }
+        return written;
+    }
+    
+    /**
+     * Builds single-image maps from the finished tiles of every Mapper that
+     * creates tile maps, so images don't need to be stitched together from
+     * saved tiles. This should be called before any tiles are finished.
+     * 
+     * @param imageDir        The directory where map images will be saved.
+     * 
+     * @param xMin            The lowest chunk x-coordinate shown within the
+     *                        map images.
+     * 
+     * @param zMin            The lowest chunk z-coordinate shown within the
+     *                        map images.
+     * 
+     * @param width           The width in chunks of the mapped area.
+     * 
+     * @param height          The height in chunks of the mapped area.
+     * 
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     * 
+     * @param tileSize        The width and height in chunks of each tile.
+     * 
+     * @param drawBackground  Whether the Minecraft map background texture
+     *                        should be drawn behind each map.
+     */
+    public void composeImages(File imageDir, int xMin, int zMin, int width,
+            int height, int pixelsPerChunk, int tileSize,
+            boolean drawBackground)
+    {
+        final String FN_NAME = "composeImages";
+        ExtendedValidate.couldBeDirectory(imageDir, "Image output directory");
+        for (Mapper mapper : mappers)
+        {
+            File outFile = new File(imageDir, mapper.getTypeName() + ".png");
+            try
+            {
+                TileComposer composer = new TileComposer(outFile, xMin, zMin,
+                        width, height, pixelsPerChunk, tileSize,
+                        drawBackground);
+                if (! mapper.setTileComposer(composer))
+                {
+                    composer.close();
+                }
+            }
+            catch (IOException e)
+            {
+                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                        "Failed to create map image '{0}': {1}",
+                        new Object[] { outFile, e });
+            }
+        }
+    }
+    
+    /**
+     * Saves all single-image maps built from finished tiles. This should
+     * only be called after all maps are saved.
+     */
+    public void finishComposedImages()
+    {
+        mappers.forEach((mapper) ->
+        {
+            mapper.finishComposedImage();
+        });
+    }
+    
+    /**
+     * Ensures all tile images drawn so far are saved, waiting for any pending
+     * background tile writes to finish.
+     */
+    public void flushTiles()
+    {
+        if (tileWriter != null)
+        {
+            tileWriter.awaitCompletion();
+        }
+        mappers.forEach((mapper) ->
+        {
+            mapper.flushMap();
         });
     }
+    
+    /**
+     * Writes the intermediate state of every Mapper to a stream.
+     * 
+     * @param out           The stream where mapper state will be written.
+     * 
+     * @throws IOException  If unable to write to the stream.
+     */
+    public void writeState(DataOutputStream out) throws IOException
+    {
+        Validate.notNull(out, "Output stream cannot be null.");
+        out.writeInt(mappers.size() + ((dataTiles == null) ? 0 : 1));
+        for (Mapper mapper : mappers)
+        {
+            // Store each state with its size, so unused types can be skipped:
+            ByteArrayOutputStream stateBytes = new ByteArrayOutputStream();
+            DataOutputStream stateOut = new DataOutputStream(stateBytes);
+            mapper.writeState(stateOut);
+            stateOut.flush();
+            out.writeUTF(mapper.getTypeName());
+            out.writeInt(stateBytes.size());
+            stateBytes.writeTo(out);
+        }
+        if (dataTiles != null)
+        {
+            ByteArrayOutputStream stateBytes = new ByteArrayOutputStream();
+            DataOutputStream stateOut = new DataOutputStream(stateBytes);
+            dataTiles.writeState(stateOut);
+            stateOut.flush();
+            out.writeUTF(DataTiles.DIR_NAME);
+            out.writeInt(stateBytes.size());
+            stateBytes.writeTo(out);
+        }
+    }
+    
+    /**
+     * Loads Mapper state previously saved with writeState. Saved state for
+     * map types that aren't in use will be ignored.
+     * 
+     * @param in            A stream holding saved mapper state.
+     * 
+     * @throws IOException  If unable to read valid state data.
+     */
+    public void readState(DataInputStream in) throws IOException
+    {
+        Validate.notNull(in, "Input stream cannot be null.");
+        final int mapperCount = in.readInt();
+        for (int i = 0; i < mapperCount; i++)
+        {
+            final String typeName = in.readUTF();
+            byte[] state = new byte[in.readInt()];
+            in.readFully(state);
+            if (dataTiles != null && typeName.equals(DataTiles.DIR_NAME))
+            {
+                dataTiles.readState(new DataInputStream(
+                        new ByteArrayInputStream(state)));
+            }
+            for (Mapper mapper : mappers)
+            {
+                if (mapper.getTypeName().equals(typeName))
+                {
+                    mapper.readState(new DataInputStream(
+                            new ByteArrayInputStream(state)));
+                }
+            }
+        }
+    }
+    
+    /**
+     * Adds a function that will receive each map tile file as soon as it is
+     * saved. This has no effect if the MapCollector is not creating tile maps.
+     * 
+     * @param listener  A function that accepts saved tile image files. This
+     *                  will be called from tile writer threads.
+     */
+    public void addTileWriteListener(Consumer<File> listener)
+    {
+        Validate.notNull(listener, "Tile listener cannot be null.");
+        if (tileWriter != null)
+        {
+            tileWriter.addWriteListener(listener);
+        }
+    }
 
     /**
      * Updates all maps with data from a single chunk.
@@ -222,9 +611,20 @@ public class MapCollector
     public void drawChunk(ChunkData chunk)
     {
         Validate.notNull("Chunk data cannot be null.");
+        if (chunkBounds != null && ! chunkBounds.contains(chunk.getPos()))
+        {
+            return;
+        }
+        if (dataTiles != null)
+        {
+            dataTiles.addChunk(chunk);
+        }
         mappers.forEach((mapper) ->
         {
-            mapper.drawChunk(chunk);
+            if (chunkBounds == null || mapper.supportsIncrementalUpdates())
+            {
+                mapper.drawChunk(chunk);
+            }
         });
     }
     
@@ -247,6 +647,26 @@ public class MapCollector
         return builder.build();
     }
     
+    /**
+     * Gets all data tile files saved for the mapped region.
+     * 
+     * @return  A JSON array holding each data tile file path, or null if data
+     *          tiles aren't enabled.
+     */
+    public JsonArray getDataTileFiles()
+    {
+        if (dataTiles == null)
+        {
+            return null;
+        }
+        JsonArrayBuilder builder = Json.createArrayBuilder();
+        dataTiles.getTileFiles().forEach((file) ->
+        {
+            builder.add(file.getPath());
+        });
+        return builder.build();
+    }
+    
     /**
      * Gets a JSON object storing all map files created by all Mappers.
      * 
@@ -258,32 +678,34 @@ public class MapCollector
         JsonObjectBuilder builder = Json.createObjectBuilder();
         mappers.forEach((mapper) ->
         {
-            Map<Integer, JsonArrayBuilder> sizeBuilders = new HashMap<>();
-            JsonArrayBuilder fileListBuilder = Json.createArrayBuilder();
-            ArrayList<File> mapFiles = mapper.getMapFileList();
-            mapFiles.forEach((file) ->
+            List<GenerationManifest.Entry> tileEntries
+                    = mapper.getTileEntries();
+            if (tileEntries == null)
             {
-                try
-                {
-                    int tileSize
-                            = Integer.parseInt(file.getParentFile().getName());
-                    if (! sizeBuilders.containsKey(tileSize))
-                    {
-                        sizeBuilders.put(tileSize, Json.createArrayBuilder());
-                    }
-                    sizeBuilders.get(tileSize).add(file.getPath());
-                }
-                catch (NumberFormatException e)
+                JsonArrayBuilder fileListBuilder = Json.createArrayBuilder();
+                mapper.getMapFileList().forEach((file) ->
                 {
                     fileListBuilder.add(file.getPath());
-                }
-            });
-            if (sizeBuilders.isEmpty())
-            {
+                });
                 builder.add(mapper.getTypeName(), fileListBuilder.build());
             }
             else
             {
+                // Only full detail tiles are listed, grouped by tile size:
+                Map<Integer, JsonArrayBuilder> sizeBuilders = new TreeMap<>();
+                for (GenerationManifest.Entry entry : tileEntries)
+                {
+                    if (entry.zoom != 0)
+                    {
+                        continue;
+                    }
+                    if (! sizeBuilders.containsKey(entry.size))
+                    {
+                        sizeBuilders.put(entry.size,
+                                Json.createArrayBuilder());
+                    }
+                    sizeBuilders.get(entry.size).add(entry.file.getPath());
+                }
                 JsonObjectBuilder typeBuilder = Json.createObjectBuilder();
                 for (Map.Entry<Integer, JsonArrayBuilder> entry
                         : sizeBuilders.entrySet())
@@ -320,6 +742,8 @@ public class MapCollector
      * @param pixelsPerChunk  Width/height in pixels of each chunk.
      * 
      * @param mapTypes        The set of Mapper types that should be used.
+     * 
+     * @param options         Options applied to every map image.
      */
     private void initImageMappers(
             File imageDir,
@@ -330,13 +754,15 @@ public class MapCollector
             int widthInChunks,
             int heightInChunks,
             int pixelsPerChunk,
-            Set<MapType> mapTypes)
+            Set<MapType> mapTypes,
+            MapOptions options)
     {
+        this.options = new MapOptions(options);
         createMappers(imageDir, regionName, region, mapTypes);
         mappers.forEach((mapper) ->
         {
             mapper.initImageMap(xMin, zMin, widthInChunks, heightInChunks,
-                    pixelsPerChunk);
+                    pixelsPerChunk, this.options);
         });
     }
     
@@ -359,6 +785,11 @@ public class MapCollector
      *                        chunk.
      * 
      * @param mapTypes        The set of Mapper types that will be used.
+     * 
+     * @param startTime       The time map generation started, in milliseconds
+     *                        since the epoch.
+     * 
+     * @param options         Options applied to every tile map.
      */
     private void initTileMappers(File imageDir,
             String regionName,
@@ -366,13 +797,29 @@ public class MapCollector
             int tileSize,
             int[] altSizes,
             int pixelsPerChunk,
-            Set<MapType> mapTypes)
+            Set<MapType> mapTypes,
+            long startTime,
+            MapOptions options)
     {
+        this.options = new MapOptions(options);
         createMappers(imageDir, regionName, region, mapTypes);
-        mappers.forEach((mapper) ->
+        tileWriter = new TileWriter(this.options.getTileWriterThreads());
+        TileCache sharedCache = null;
+        if (this.options.isSharedTileCacheEnabled() && ! mappers.isEmpty())
         {
-            mapper.initTileMap(tileSize, altSizes, pixelsPerChunk);
-        });
+            sharedCache = new TileCache(this.options.getTileMemoryBudget()
+                    * mappers.size(), mappers.size());
+            sharedCache.setOffHeap(this.options.isOffHeapEnabled());
+        }
+        for (int i = 0; i < mappers.size(); i++)
+        {
+            mappers.get(i).initTileMap(tileSize, altSizes, pixelsPerChunk,
+                    tileWriter, startTime, sharedCache, i, this.options);
+        }
+        if (this.options.isDataTilesEnabled())
+        {
+            dataTiles = new DataTiles(imageDir, regionName, tileSize);
+        }
     }
     
     /**
@@ -430,7 +877,15 @@ public class MapCollector
         types.addAll(Arrays.asList(MapType.values()));
         return types;
     }
-
+    
     // All initialized mappers:
     private final ArrayList<Mapper> mappers;
+    // Options applied to every map:
+    private MapOptions options = null;
+    // Saves finished tiles in the background, if creating tile maps:
+    private TileWriter tileWriter = null;
+    // Optional bounds of the only area drawn within saved tiles:
+    private Rectangle chunkBounds = null;
+    // Saves compact chunk data tiles, if enabled for tile maps:
+    private DataTiles dataTiles = null;
 }
@@ -7,17 +7,25 @@
 package com.centuryglass.chunk_atlas.mapping;
 import com.centuryglass.chunk_atlas.config.LogConfig;
 import com.centuryglass.chunk_atlas.mapping.images.MapBackground;
+import com.centuryglass.chunk_atlas.mapping.images.PngEncoder;
 import com.centuryglass.chunk_atlas.util.ExtendedValidate;
 import java.awt.Color;
 import java.awt.Graphics2D;
 import java.awt.Point;
 import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.io.BufferedOutputStream;
 import java.io.File;
+import java.io.FileOutputStream;
 import java.io.IOException;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.function.Consumer;
 import java.util.logging.Level;
-import javax.imageio.ImageIO;
 import org.apache.commons.lang.Validate;
 
 /**
@@ -27,14 +35,29 @@ import org.apache.commons.lang.Validate;
  *  In addition to providing convenience functions for coloring specific map
  * chunks, the MapImage also optionally draws a background and border
  * resembling the Minecraft map item.
+ *
+ *  Image pixels are stored in fixed-size square pages, each allocated only
+ * when a pixel within it is first drawn, so unexplored parts of the mapped
+ * area use no memory. The background is only drawn while the image is saved,
+ * one row of pages at a time, behind every pixel that was never drawn or was
+ * drawn fully transparent.
+ *
+ *  Pages may optionally be allocated in direct memory outside of the Java
+ * heap, so that large maps don't add to garbage collection pauses. Pixels are
+ * only copied onto the heap one band at a time while the image is encoded.
  */
 public class MapImage extends WorldMap
 {   
     private static final String CLASSNAME = "MapImage";
     
+    // Width and height in pixels of each image page:
+    private static final int PAGE_SIZE = 256;
+    // Size of the buffer used when writing image files:
+    private static final int OUTPUT_BUFFER_SIZE = 64 << 10;
+    
     /**
-     * Loads image properties on construction, and optionally draws the default
-     * background and border.
+     * Loads image properties on construction. No image pages are allocated
+     * until pixels are drawn.
      *
      * @param imageFile        The file where the image will be saved.
      * 
@@ -56,12 +79,46 @@ public class MapImage extends WorldMap
             int widthInChunks,
             int heightInChunks,
             int pixelsPerChunk)
+    {
+        this(imageFile, xMin, zMin, widthInChunks, heightInChunks,
+                pixelsPerChunk, new MapOptions());
+    }
+    
+    /**
+     * Loads image properties on construction, applying a set of map options.
+     * No image pages are allocated until pixels are drawn.
+     *
+     * @param imageFile        The file where the image will be saved.
+     * 
+     * @param xMin             Lowest x-coordinate within the mapped area,
+     *                         measured in chunks.
+     * 
+     * @param zMin             Lowest z-coordinate within the mapped area,
+     *                         measured in chunks.
+     * 
+     * @param  widthInChunks   The map's width, measured in chunks.
+     *
+     * @param  heightInChunks  The map's height, measured in chunks.
+     *
+     * @param  pixelsPerChunk  The width and height in pixels of each chunk.
+     * 
+     * @param  options         Options selecting whether image pages are
+     *                         allocated in direct memory.
+     */
+    public MapImage(File imageFile,
+            int xMin,
+            int zMin,
+            int widthInChunks,
+            int heightInChunks,
+            int pixelsPerChunk,
+            MapOptions options)
     {
         super(imageFile.getParentFile(), imageFile.getName(), pixelsPerChunk);
         ExtendedValidate.couldBeFile(imageFile, "Image file");
         ExtendedValidate.isPositive(widthInChunks, "Width in chunks");
         ExtendedValidate.isPositive(heightInChunks, "Height in chunks");
         ExtendedValidate.isPositive(pixelsPerChunk, "Pixels per chunk");
+        Validate.notNull(options, "Map options cannot be null.");
         
         this.xMin = xMin;
         this.zMin = zMin;
@@ -78,19 +135,16 @@ public class MapImage extends WorldMap
             imageHeight += (2 * borderPixelWidth);
         }
         borderWidth = borderPixelWidth / pixelsPerChunk;
-        mapImage = new BufferedImage(imageWidth, imageHeight,
-                BufferedImage.TYPE_INT_ARGB);
+        this.imageWidth = imageWidth;
+        this.imageHeight = imageHeight;
+        pagesWide = (imageWidth + PAGE_SIZE - 1) / PAGE_SIZE;
+        pagesHigh = (imageHeight + PAGE_SIZE - 1) / PAGE_SIZE;
+        Validate.isTrue((long) pagesWide * pagesHigh <= Integer.MAX_VALUE,
+                "Map image is too large.");
+        pages = new IntBuffer[pagesWide * pagesHigh];
+        backgroundDrawn = drawBackgrounds;
+        offHeapPages = options.isOffHeapEnabled();
         mapFiles = new ArrayList<>();
-        if (drawBackgrounds)
-        {
-            BufferedImage sourceImage = MapBackground.getBackgroundImage();
-            if (sourceImage != null)
-            {
-                Graphics2D graphics = mapImage.createGraphics();
-                graphics.drawImage(sourceImage, 0, 0, imageWidth, imageHeight,
-                        null);
-            }
-        }
     }  
     
     /**
@@ -113,9 +167,9 @@ public class MapImage extends WorldMap
      */
     private void validatePixelCoords(int xPos, int yPos)
     {
-        ExtendedValidate.inInclusiveBounds(xPos, 0, mapImage.getWidth() - 1,
+        ExtendedValidate.inInclusiveBounds(xPos, 0, imageWidth - 1,
                 "Pixel x-coordinate");
-        ExtendedValidate.inInclusiveBounds(yPos, 0, mapImage.getHeight() - 1,
+        ExtendedValidate.inInclusiveBounds(yPos, 0, imageHeight - 1,
                 "Pixel y-coordinate");
     }
     
@@ -132,7 +186,7 @@ public class MapImage extends WorldMap
     public Color getPixelColor(int xPos, int yPos)
     {
         validatePixelCoords(xPos, yPos);
-        return new Color(mapImage.getRGB(xPos, yPos));
+        return new Color(getPixel(xPos, yPos));
     }
     
     /**
@@ -153,7 +207,30 @@ public class MapImage extends WorldMap
         {
             return null;
         }
-        return new Color(mapImage.getRGB(pixelPos.x, pixelPos.y));
+        return new Color(getPixel(pixelPos.x, pixelPos.y));
+    }
+    
+    /**
+     * Gets the packed ARGB color applied to a specific chunk.
+     *
+     * @param xPos  The chunk's x-coordinate.
+     *
+     * @param zPos  The chunk's z-coordinate.
+     *
+     * @return      The chunk's color as an ARGB integer, or zero if the
+     *              coordinate is out of bounds.
+     */
+    @Override
+    public int getChunkRGB(int xPos, int zPos)
+    {
+        final int pixelX = chunkToPixelX(xPos);
+        final int pixelY = chunkToPixelY(zPos);
+        if (pixelX < 0 || pixelX >= imageWidth
+                || pixelY < 0 || pixelY >= imageHeight)
+        {
+            return 0;
+        }
+        return getPixel(pixelX, pixelY);
     }
     
     /**
@@ -169,44 +246,49 @@ public class MapImage extends WorldMap
     {
         validatePixelCoords(xPos, yPos);
         Validate.notNull(color, "Pixel color cannot be null.");
-        if(xPos < mapImage.getWidth() && yPos < mapImage.getHeight()
-                && xPos >= 0 && yPos >=0)
-        {
-            mapImage.setRGB(xPos, yPos, color.getRGB());
-        }
+        getPage(xPos / PAGE_SIZE, yPos / PAGE_SIZE).put((yPos % PAGE_SIZE)
+                * PAGE_SIZE + xPos % PAGE_SIZE, color.getRGB());
     }
     
     /**
-     * Sets the color of a specific chunk.
+     * Sets every pixel of a specific chunk to a packed ARGB color, writing
+     * directly to the pixel buffers of the chunk's image pages.
      *
-     * @param xPos   The chunk's x-coordinate.
+     * @param xPos  The chunk's x-coordinate.
      *
-     * @param zPos   The chunk's z-coordinate.
+     * @param zPos  The chunk's z-coordinate.
      *
-     * @param color  The color value to apply.
+     * @param argb  The color value to apply, as an ARGB integer.
      */
     @Override
-    public void setChunkColor(int xPos, int zPos, Color color)
+    public void setChunkRGB(int xPos, int zPos, int argb)
     {
-        Validate.notNull(color, "Chunk color cannot be null.");
-        final Point pixelPos = chunkToPixel(xPos, zPos);
-        if (pixelPos == null || pixelPos.x < 0 || pixelPos.y < 0)
+        final int pixelX = chunkToPixelX(xPos);
+        final int pixelY = chunkToPixelY(zPos);
+        if (pixelX < 0 || pixelX >= imageWidth
+                || pixelY < 0 || pixelY >= imageHeight)
         {
             return;
         }
-        for (int y = pixelPos.y; y < (pixelPos.y + getChunkSize()); y++)
+        final int xEnd = Math.min(pixelX + getChunkSize(), imageWidth);
+        final int yEnd = Math.min(pixelY + getChunkSize(), imageHeight);
+        for (int y = pixelY; y < yEnd; y++)
         {
-            if (y < 0 || y >= mapImage.getHeight())
-            {
-                continue;
-            }
-            for (int x = pixelPos.x; x < (pixelPos.x + getChunkSize()); x++)
+            final int pageY = y / PAGE_SIZE;
+            final int rowStart = (y % PAGE_SIZE) * PAGE_SIZE;
+            int x = pixelX;
+            while (x < xEnd)
             {
-                if (x < 0 || x >= mapImage.getWidth())
+                final int pageX = x / PAGE_SIZE;
+                final int pageLeft = pageX * PAGE_SIZE;
+                final int segmentEnd = Math.min(xEnd, pageLeft + PAGE_SIZE);
+                final IntBuffer page = getPage(pageX, pageY);
+                final int end = rowStart + segmentEnd - pageLeft;
+                for (int i = rowStart + x - pageLeft; i < end; i++)
                 {
-                    continue;
+                    page.put(i, argb);
                 }
-                mapImage.setRGB(x, y, color.getRGB());
+                x = segmentEnd;
             }
         }
     }
@@ -275,7 +357,8 @@ public class MapImage extends WorldMap
     }
     
     /**
-     * Saves the image to its output path.
+     * Saves the image to its output path, drawing and encoding one row of
+     * image pages at a time.
      * 
      * @param mapDir    The directory where the map images will be saved.
      * 
@@ -287,10 +370,59 @@ public class MapImage extends WorldMap
         final String FN_NAME = "saveMapData";
         ExtendedValidate.couldBeDirectory(mapDir, "Image output directory");
         ExtendedValidate.notNullOrEmpty(baseName, "Map image name");
-        try
+        final BufferedImage background = backgroundDrawn
+                ? MapBackground.getBackgroundImage() : null;
+        File imageFile = new File(mapDir, baseName + ".png");
+        try (OutputStream out = new BufferedOutputStream(
+                new FileOutputStream(imageFile), OUTPUT_BUFFER_SIZE))
         {
-            File imageFile = new File(mapDir, baseName + ".png");
-            ImageIO.write(mapImage, "png", imageFile);
+            PngEncoder.ScanlineWriter writer = getPngEncoder().startImage(out,
+                    imageWidth, imageHeight);
+            BufferedImage band = new BufferedImage(imageWidth,
+                    Math.min(PAGE_SIZE, imageHeight),
+                    BufferedImage.TYPE_INT_ARGB);
+            final int[] bandPixels = ((DataBufferInt) band.getRaster()
+                    .getDataBuffer()).getData();
+            for (int pageY = 0; pageY < pagesHigh; pageY++)
+            {
+                final int bandTop = pageY * PAGE_SIZE;
+                final int bandRows = Math.min(PAGE_SIZE,
+                        imageHeight - bandTop);
+                Arrays.fill(bandPixels, 0);
+                if (background != null)
+                {
+                    Graphics2D graphics = band.createGraphics();
+                    graphics.drawImage(background, 0, -bandTop, imageWidth,
+                            imageHeight, null);
+                    graphics.dispose();
+                }
+                for (int pageX = 0; pageX < pagesWide; pageX++)
+                {
+                    final IntBuffer page = pages[pageY * pagesWide + pageX];
+                    if (page == null)
+                    {
+                        continue;
+                    }
+                    final int pageLeft = pageX * PAGE_SIZE;
+                    final int pageWidth = Math.min(PAGE_SIZE,
+                            imageWidth - pageLeft);
+                    for (int row = 0; row < bandRows; row++)
+                    {
+                        final int pageRow = row * PAGE_SIZE;
+                        final int bandRow = row * imageWidth + pageLeft;
+                        for (int x = 0; x < pageWidth; x++)
+                        {
+                            final int argb = page.get(pageRow + x);
+                            if ((argb >>> 24) != 0)
+                            {
+                                bandPixels[bandRow + x] = argb;
+                            }
+                        }
+                    }
+                }
+                writer.writeRows(bandPixels, bandRows);
+            }
+            writer.finish();
             if (! mapFiles.contains(imageFile))
             {
                 mapFiles.add(imageFile);
@@ -306,6 +438,51 @@ public class MapImage extends WorldMap
         }
     }
     
+    /**
+     * Gets the color of an image pixel from its page.
+     * 
+     * @param xPos  The pixel's x-coordinate, within the image bounds.
+     * 
+     * @param yPos  The pixel's y-coordinate, within the image bounds.
+     * 
+     * @return      The pixel's packed ARGB color, or zero if its page was
+     *              never drawn.
+     */
+    private int getPixel(int xPos, int yPos)
+    {
+        final IntBuffer page = pages[(yPos / PAGE_SIZE) * pagesWide
+                + xPos / PAGE_SIZE];
+        if (page == null)
+        {
+            return 0;
+        }
+        return page.get((yPos % PAGE_SIZE) * PAGE_SIZE + xPos % PAGE_SIZE);
+    }
+    
+    /**
+     * Gets an image page, allocating it if it was never drawn.
+     * 
+     * @param pageX  The page's column index.
+     * 
+     * @param pageY  The page's row index.
+     * 
+     * @return       The page's packed ARGB pixels, in row order with rows
+     *               PAGE_SIZE pixels wide.
+     */
+    private IntBuffer getPage(int pageX, int pageY)
+    {
+        final int index = pageY * pagesWide + pageX;
+        if (pages[index] == null)
+        {
+            final int pagePixels = PAGE_SIZE * PAGE_SIZE;
+            pages[index] = offHeapPages
+                    ? ByteBuffer.allocateDirect(pagePixels * Integer.BYTES)
+                            .order(ByteOrder.nativeOrder()).asIntBuffer()
+                    : IntBuffer.allocate(pagePixels);
+        }
+        return pages[index];
+    }
+    
     /**
      * Get the upper left pixel used to represent a chunk.
      *
@@ -318,15 +495,40 @@ public class MapImage extends WorldMap
      */
     private Point chunkToPixel(int xPos, int zPos)
     {
-        Point pixelPos = new Point(
-                (xPos - xMin) * getChunkSize() + borderWidth,
-                (zPos - zMin) * getChunkSize() + borderWidth);
-        if (pixelPos.x < 0 || pixelPos.x >= mapImage.getWidth()
-                || pixelPos.y < 0 || pixelPos.y >= mapImage.getHeight())
+        final int pixelX = chunkToPixelX(xPos);
+        final int pixelY = chunkToPixelY(zPos);
+        if (pixelX < 0 || pixelX >= imageWidth
+                || pixelY < 0 || pixelY >= imageHeight)
         {
             return null;
         }
-        return pixelPos;
+        return new Point(pixelX, pixelY);
+    }
+    
+    /**
+     * Gets the leftmost image x-coordinate used to represent a chunk.
+     *
+     * @param xPos  The x-coordinate of a map chunk.
+     *
+     * @return      The chunk's first pixel x-coordinate, which may be outside
+     *              of the image bounds.
+     */
+    private int chunkToPixelX(int xPos)
+    {
+        return (xPos - xMin) * getChunkSize() + borderWidth;
+    }
+    
+    /**
+     * Gets the topmost image y-coordinate used to represent a chunk.
+     *
+     * @param zPos  The z-coordinate of a map chunk.
+     *
+     * @return      The chunk's first pixel y-coordinate, which may be outside
+     *              of the image bounds.
+     */
+    private int chunkToPixelY(int zPos)
+    {
+        return (zPos - zMin) * getChunkSize() + borderWidth;
     }
     
     /**
@@ -353,8 +555,18 @@ public class MapImage extends WorldMap
         }
     }
     
-    // Saved map image data:
-    private final BufferedImage mapImage;
+    // Image size in pixels, including any border:
+    private final int imageWidth;
+    private final int imageHeight;
+    // Number of image page columns and rows:
+    private final int pagesWide;
+    private final int pagesHigh;
+    // Image pages in row-major order, each null until drawn:
+    private final IntBuffer[] pages;
+    // Whether this image's pages are allocated in direct memory:
+    private final boolean offHeapPages;
+    // Whether the background is drawn when this image is saved:
+    private final boolean backgroundDrawn;
     private final ArrayList<File> mapFiles;
     // Whether backgrounds are drawn. This setting is shared across all maps.
     private static boolean drawBackgrounds = true;
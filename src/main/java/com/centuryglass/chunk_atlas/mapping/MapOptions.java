@@ -0,0 +1,291 @@
+/**
+ * @file MapOptions.java
+ *
+ * Holds the options used when creating a set of maps.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.mapping.images.PngEncoder;
+import com.centuryglass.chunk_atlas.mapping.maptype.MapType;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.util.EnumMap;
+import java.util.Map;
+import org.apache.commons.lang.Validate;
+
+/**
+ * MapOptions holds the settings a MapCollector applies to every map it
+ * creates. Each MapCollector keeps its own copy of the options it was given,
+ * so changing a MapOptions object only affects MapCollectors created with it
+ * afterwards, and separate mapping runs never share settings.
+ */
+public class MapOptions
+{
+    // Default number of threads used to save finished map tiles:
+    private static final int DEFAULT_TILE_WRITER_THREADS = 2;
+    // Fraction of the maximum heap size each TileMap may use for tiles when
+    // no tile memory budget is set, as a divisor:
+    private static final int DEFAULT_TILE_MEMORY_DIVISOR = 8;
+
+    /**
+     * Creates a set of options using the default value of each option.
+     */
+    public MapOptions() { }
+
+    /**
+     * Creates a copy of another set of options.
+     *
+     * @param options  The options to copy.
+     */
+    public MapOptions(MapOptions options)
+    {
+        Validate.notNull(options, "Copied options cannot be null.");
+        tileMemoryBudget = options.tileMemoryBudget;
+        defaultPngEncoder = options.defaultPngEncoder;
+        typePngEncoders.putAll(options.typePngEncoders);
+        tileWriterThreads = options.tileWriterThreads;
+        pyramidEnabled = options.pyramidEnabled;
+        contentHashesEnabled = options.contentHashesEnabled;
+        sharedTileCacheEnabled = options.sharedTileCacheEnabled;
+        offHeapEnabled = options.offHeapEnabled;
+        dataTilesEnabled = options.dataTilesEnabled;
+    }
+
+    /**
+     * Sets the maximum number of bytes each TileMap may use to hold tile
+     * images in memory. If this is never set, each TileMap may use an eighth
+     * of the maximum heap size.
+     *
+     * @param bytes  The memory budget for each TileMap's tiles.
+     */
+    public void setTileMemoryBudget(long bytes)
+    {
+        ExtendedValidate.isPositive(bytes, "Tile memory budget");
+        tileMemoryBudget = bytes;
+    }
+
+    /**
+     * Gets the maximum number of bytes each TileMap may use to hold tile
+     * images in memory.
+     *
+     * @return  The memory budget for each TileMap's tiles.
+     */
+    public long getTileMemoryBudget()
+    {
+        return tileMemoryBudget;
+    }
+
+    /**
+     * Sets the PNG encoder used to save maps of every type that has no
+     * encoder of its own.
+     *
+     * @param encoder  The default PNG encoder.
+     */
+    public void setDefaultPngEncoder(PngEncoder encoder)
+    {
+        Validate.notNull(encoder, "PNG encoder cannot be null.");
+        defaultPngEncoder = encoder;
+    }
+
+    /**
+     * Sets the PNG encoder used to save maps of a specific type, so that
+     * each map type can trade file size against encoding time.
+     *
+     * @param type     The map type using the encoder.
+     *
+     * @param encoder  The type's PNG encoder, or null to use the default
+     *                 encoder.
+     */
+    public void setPngEncoder(MapType type, PngEncoder encoder)
+    {
+        Validate.notNull(type, "Map type cannot be null.");
+        if (encoder == null)
+        {
+            typePngEncoders.remove(type);
+        }
+        else
+        {
+            typePngEncoders.put(type, encoder);
+        }
+    }
+
+    /**
+     * Gets the PNG encoder used to save maps of a specific type.
+     *
+     * @param type  A map type.
+     *
+     * @return      The type's PNG encoder, or the default encoder if the type
+     *              has no encoder of its own.
+     */
+    public PngEncoder getPngEncoder(MapType type)
+    {
+        PngEncoder encoder = typePngEncoders.get(type);
+        return (encoder == null) ? defaultPngEncoder : encoder;
+    }
+
+    /**
+     * Sets the number of threads each tile map MapCollector uses to encode
+     * and save finished tiles.
+     *
+     * @param threadCount  The number of tile writer threads, or zero to use
+     *                     one thread per available processor.
+     */
+    public void setTileWriterThreads(int threadCount)
+    {
+        ExtendedValidate.isNotNegative(threadCount, "Tile writer threads");
+        tileWriterThreads = (threadCount == 0)
+                ? Runtime.getRuntime().availableProcessors() : threadCount;
+    }
+
+    /**
+     * Gets the number of threads each tile map MapCollector uses to encode
+     * and save finished tiles.
+     *
+     * @return  The number of tile writer threads.
+     */
+    public int getTileWriterThreads()
+    {
+        return tileWriterThreads;
+    }
+
+    /**
+     * Sets whether each TileMap will also save a pyramid of zoomed out tiles
+     * built from its finished tiles.
+     *
+     * @param enabled  Whether TileMaps should create zoom level tiles.
+     */
+    public void setPyramidEnabled(boolean enabled)
+    {
+        pyramidEnabled = enabled;
+    }
+
+    /**
+     * Checks whether each TileMap will also save a pyramid of zoomed out
+     * tiles built from its finished tiles.
+     *
+     * @return  Whether TileMaps will create zoom level tiles.
+     */
+    public boolean isPyramidEnabled()
+    {
+        return pyramidEnabled;
+    }
+
+    /**
+     * Sets whether each TileMap will keep hashes of its saved tiles. Finished
+     * tiles identical to their saved images are not written again, and fully
+     * transparent tiles are not saved at all.
+     *
+     *  Tile hashes may only be used by one process at a time for each map,
+     * so this should not be enabled within worker processes.
+     *
+     * @param enabled  Whether TileMaps should skip saving unchanged and empty
+     *                 tiles.
+     */
+    public void setContentHashesEnabled(boolean enabled)
+    {
+        contentHashesEnabled = enabled;
+    }
+
+    /**
+     * Checks whether each TileMap will keep hashes of its saved tiles.
+     *
+     * @return  Whether TileMaps will skip saving unchanged and empty tiles.
+     */
+    public boolean isContentHashesEnabled()
+    {
+        return contentHashesEnabled;
+    }
+
+    /**
+     * Sets whether each tile map MapCollector holds the tiles of all of its
+     * maps in a single shared tile cache. Each cached tile then holds a layer
+     * for every map type, so all layers are found with one lookup and are
+     * compressed or evicted together. The shared cache's memory budget is the
+     * TileMap memory budget multiplied by the number of map types.
+     *
+     * @param enabled  Whether MapCollectors should share one tile cache
+     *                 between all map types.
+     */
+    public void setSharedTileCacheEnabled(boolean enabled)
+    {
+        sharedTileCacheEnabled = enabled;
+    }
+
+    /**
+     * Checks whether each tile map MapCollector holds the tiles of all of its
+     * maps in a single shared tile cache.
+     *
+     * @return  Whether MapCollectors will share one tile cache between all
+     *          map types.
+     */
+    public boolean isSharedTileCacheEnabled()
+    {
+        return sharedTileCacheEnabled;
+    }
+
+    /**
+     * Sets whether map image data is held outside of the Java heap. TileMaps
+     * then keep their compressed tiles off-heap, holding only a few tiles as
+     * reused heap images at once, and MapImages allocate their image pages in
+     * direct memory. Cached tiles and image pages then don't slow down
+     * garbage collection.
+     *
+     * @param enabled  Whether maps should hold image data off-heap.
+     */
+    public void setOffHeapEnabled(boolean enabled)
+    {
+        offHeapEnabled = enabled;
+    }
+
+    /**
+     * Checks whether map image data is held outside of the Java heap.
+     *
+     * @return  Whether maps will hold image data off-heap.
+     */
+    public boolean isOffHeapEnabled()
+    {
+        return offHeapEnabled;
+    }
+
+    /**
+     * Sets whether each tile map MapCollector also saves compact data tiles,
+     * holding the chunk values used by every map type.
+     *
+     * @param enabled  Whether MapCollectors should save data tiles.
+     */
+    public void setDataTilesEnabled(boolean enabled)
+    {
+        dataTilesEnabled = enabled;
+    }
+
+    /**
+     * Checks whether each tile map MapCollector also saves compact data
+     * tiles.
+     *
+     * @return  Whether MapCollectors will save data tiles.
+     */
+    public boolean isDataTilesEnabled()
+    {
+        return dataTilesEnabled;
+    }
+
+    // Maximum bytes each TileMap may use to hold tiles in memory:
+    private long tileMemoryBudget = Runtime.getRuntime().maxMemory()
+            / DEFAULT_TILE_MEMORY_DIVISOR;
+    // PNG encoder used by map types without their own encoder:
+    private PngEncoder defaultPngEncoder = PngEncoder.DEFAULT;
+    // PNG encoders selected for specific map types:
+    private final Map<MapType, PngEncoder> typePngEncoders
+            = new EnumMap<>(MapType.class);
+    // Number of threads used to save finished map tiles:
+    private int tileWriterThreads = DEFAULT_TILE_WRITER_THREADS;
+    // Whether TileMaps create zoom level tiles:
+    private boolean pyramidEnabled = false;
+    // Whether TileMaps skip saving unchanged and empty tiles:
+    private boolean contentHashesEnabled = false;
+    // Whether tile map Mappers share one multi-layer tile cache:
+    private boolean sharedTileCacheEnabled = false;
+    // Whether tile caches and image pages are held off-heap:
+    private boolean offHeapEnabled = false;
+    // Whether tile map MapCollectors also save data tiles:
+    private boolean dataTilesEnabled = false;
+}
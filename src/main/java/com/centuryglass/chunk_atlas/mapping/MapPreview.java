@@ -0,0 +1,306 @@
+/**
+ * @file MapPreview.java
+ *
+ * Quickly draws rough preview tiles using only region file headers.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.mapping.images.TileWriter;
+import com.centuryglass.chunk_atlas.mapping.maptype.MapType;
+import com.centuryglass.chunk_atlas.savedata.MCAFile;
+import com.centuryglass.chunk_atlas.savedata.RegionHeader;
+import com.centuryglass.chunk_atlas.threads.TileTracker;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.MapUnit;
+import java.awt.Color;
+import java.awt.Point;
+import java.awt.image.BufferedImage;
+import java.io.File;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.TimeUnit;
+import java.util.logging.Level;
+import org.apache.commons.lang.Validate;
+
+/**
+ * MapPreview creates a complete but low-detail set of map tiles before any
+ * chunk data is read. Only region file headers are used, so every existing
+ * chunk is drawn in a single shade based on how recently it was saved.
+ *
+ *  Preview tiles use the same file paths as the tiles created by the full
+ * mapping pass, so each preview tile is replaced in place once its detailed
+ * version is finished. Preview files are always older than the full pass
+ * start time, so TileMap never mistakes them for partially drawn tiles.
+ */
+public class MapPreview
+{
+    private static final String CLASSNAME = MapPreview.class.getName();
+
+    // Chunks saved this recently are drawn with the brightest preview color:
+    private static final long RECENT_AGE = 1; // days
+    // Chunks older than this are drawn with the darkest preview color:
+    private static final long OLD_AGE = 365; // days
+    // Preview color of recently saved chunks:
+    private static final Color RECENT_COLOR = new Color(200, 200, 200);
+    // Preview color of old chunks:
+    private static final Color OLD_COLOR = new Color(80, 80, 80);
+
+    /**
+     * Sets the preview tile properties on construction, saving tiles with
+     * the PNG encoders selected in a set of map options.
+     *
+     * @param outDir          The region-specific directory where map tiles
+     *                        are saved.
+     *
+     * @param regionName      The name of the mapped region, used when naming
+     *                        tile images.
+     *
+     * @param tileSize        The width and height in chunks of each map tile.
+     *
+     * @param altSizes        Alternate tile sizes to create by scaling preview
+     *                        tiles.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param mapTypes        All map types that will receive preview tiles.
+     *
+     * @param options         Options selecting each map type's PNG encoder.
+     */
+    public MapPreview(File outDir, String regionName, int tileSize,
+            int[] altSizes, int pixelsPerChunk, Collection<MapType> mapTypes,
+            MapOptions options)
+    {
+        ExtendedValidate.couldBeDirectory(outDir, "Tile output directory");
+        ExtendedValidate.notNullOrEmpty(regionName, "Region name");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        ExtendedValidate.isPositive(pixelsPerChunk, "Pixels per chunk");
+        Validate.notNull(mapTypes, "Map types cannot be null.");
+        Validate.notNull(options, "Map options cannot be null.");
+        this.outDir = outDir;
+        this.regionName = regionName;
+        this.tileSize = tileSize;
+        this.altSizes = (altSizes == null) ? new int[0] : altSizes;
+        this.pixelsPerChunk = pixelsPerChunk;
+        this.mapTypes = new ArrayList<>(mapTypes);
+        this.options = new MapOptions(options);
+    }
+
+    /**
+     * Draws and saves preview tiles for a set of region files. Regions
+     * should be grouped by tile, as each tile is saved and released as soon
+     * as all of its regions are drawn.
+     *
+     * @param regionFiles  The region files to preview.
+     *
+     * @param tileWriter   The writer used to save preview tiles.
+     *
+     * @return             The number of preview tiles created for each map
+     *                     type.
+     */
+    public int draw(List<File> regionFiles, TileWriter tileWriter)
+    {
+        final String FN_NAME = "draw";
+        Validate.notNull(regionFiles, "Region files cannot be null.");
+        Validate.notNull(tileWriter, "Tile writer cannot be null.");
+        final long currentTime = TimeUnit.MILLISECONDS.toSeconds(
+                System.currentTimeMillis());
+        final int regionSize = MapUnit.convert(1, MapUnit.REGION,
+                MapUnit.CHUNK);
+        TileTracker tracker = new TileTracker(regionFiles, tileSize);
+        Map<Point, BufferedImage> openTiles = new HashMap<>();
+        int tileCount = 0;
+        for (File regionFile : regionFiles)
+        {
+            Point regionPt;
+            RegionHeader header;
+            try
+            {
+                regionPt = MCAFile.getChunkCoords(regionFile);
+                header = (regionPt == null) ? null
+                        : new RegionHeader(regionFile);
+            }
+            catch (IOException | IllegalArgumentException e)
+            {
+                LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                        "Skipping preview of {0}: {1}",
+                        new Object[] { regionFile, e });
+                header = null;
+                regionPt = null;
+            }
+            if (header != null && header.getChunkCount() > 0)
+            {
+                for (int z = 0; z < regionSize; z++)
+                {
+                    for (int x = 0; x < regionSize; x++)
+                    {
+                        if (! header.chunkExists(x, z))
+                        {
+                            continue;
+                        }
+                        long age = currentTime
+                                - header.getChunkTimestamp(x, z);
+                        drawChunk(openTiles, regionPt.x + x, regionPt.y + z,
+                                getAgeColor(age).getRGB());
+                    }
+                }
+            }
+            for (Point tilePt : tracker.regionFinished(regionFile))
+            {
+                BufferedImage tileImage = openTiles.remove(tilePt);
+                if (tileImage != null)
+                {
+                    saveTile(tilePt, tileImage, tileWriter);
+                    tileCount++;
+                }
+            }
+        }
+        // Save tiles that had regions with invalid coordinates:
+        for (Map.Entry<Point, BufferedImage> entry : openTiles.entrySet())
+        {
+            saveTile(entry.getKey(), entry.getValue(), tileWriter);
+            tileCount++;
+        }
+        return tileCount;
+    }
+
+    /**
+     * Draws a single preview chunk, creating its tile image if necessary.
+     *
+     * @param openTiles  All unsaved preview tiles.
+     *
+     * @param xPos       The chunk's x-coordinate.
+     *
+     * @param zPos       The chunk's z-coordinate.
+     *
+     * @param rgb        The chunk's preview color.
+     */
+    private void drawChunk(Map<Point, BufferedImage> openTiles, int xPos,
+            int zPos, int rgb)
+    {
+        Point tilePt = TileMap.getTilePoint(xPos, zPos, tileSize);
+        BufferedImage tileImage = openTiles.get(tilePt);
+        if (tileImage == null)
+        {
+            final int imageSize = tileSize * pixelsPerChunk;
+            tileImage = new BufferedImage(imageSize, imageSize,
+                    BufferedImage.TYPE_INT_ARGB);
+            openTiles.put(tilePt, tileImage);
+        }
+        final int x0 = (xPos - tilePt.x) * pixelsPerChunk;
+        final int y0 = (zPos - tilePt.y) * pixelsPerChunk;
+        for (int y = y0; y < y0 + pixelsPerChunk; y++)
+        {
+            for (int x = x0; x < x0 + pixelsPerChunk; x++)
+            {
+                tileImage.setRGB(x, y, rgb);
+            }
+        }
+    }
+
+    /**
+     * Submits a finished preview tile to be saved for each map type.
+     *
+     * @param tilePt      The tile's upper left chunk coordinate.
+     *
+     * @param tileImage   The finished preview image.
+     *
+     * @param tileWriter  The writer used to save the tile.
+     */
+    private void saveTile(Point tilePt, BufferedImage tileImage,
+            TileWriter tileWriter)
+    {
+        final String fileName = TileMap.getTileFileName(regionName, tilePt);
+        for (MapType type : mapTypes)
+        {
+            File typeDir = new File(outDir, type.toString());
+            Map<Integer, File> scaledFiles = new LinkedHashMap<>();
+            for (int size : altSizes)
+            {
+                scaledFiles.put(size, new File(getSizeDir(typeDir, size),
+                        fileName));
+            }
+            tileWriter.submit(tileImage, new File(getSizeDir(typeDir,
+                    tileSize), fileName), scaledFiles,
+                    options.getPngEncoder(type));
+        }
+    }
+
+    /**
+     * Gets a map type's tile directory for a specific tile size, creating it
+     * if necessary.
+     *
+     * @param typeDir  The map type's tile directory.
+     *
+     * @param size     A tile image size.
+     *
+     * @return         The directory holding tiles of that size.
+     */
+    private static File getSizeDir(File typeDir, int size)
+    {
+        File sizeDir = new File(typeDir, String.valueOf(size));
+        if (! sizeDir.isDirectory())
+        {
+            Validate.isTrue(sizeDir.mkdirs(), "Failed to create tile "
+                    + "size directory '" + sizeDir + "'.");
+        }
+        return sizeDir;
+    }
+
+    /**
+     * Gets the preview color of a chunk based on the time since it was last
+     * saved.
+     *
+     * @param ageSeconds  The chunk's age, in seconds.
+     *
+     * @return            A color between the old and recent preview colors.
+     */
+    private static Color getAgeColor(long ageSeconds)
+    {
+        final double ageDays = Math.max(0, (double) ageSeconds
+                / TimeUnit.DAYS.toSeconds(1) - RECENT_AGE);
+        // Fade quickly over the first days, slowly over the following months:
+        final double fade = Math.min(1.0, Math.log1p(ageDays)
+                / Math.log1p(OLD_AGE - RECENT_AGE));
+        return new Color(
+                blend(RECENT_COLOR.getRed(), OLD_COLOR.getRed(), fade),
+                blend(RECENT_COLOR.getGreen(), OLD_COLOR.getGreen(), fade),
+                blend(RECENT_COLOR.getBlue(), OLD_COLOR.getBlue(), fade));
+    }
+
+    /**
+     * Linearly interpolates between two color components.
+     *
+     * @param start   The initial component value.
+     *
+     * @param end     The final component value.
+     *
+     * @param amount  The fraction of the way from start to end.
+     *
+     * @return        The interpolated component.
+     */
+    private static int blend(int start, int end, double amount)
+    {
+        return (int) Math.round(start + (end - start) * amount);
+    }
+
+    // Region-specific tile output directory:
+    private final File outDir;
+    // Mapped region name:
+    private final String regionName;
+    // Width and height in chunks of each tile:
+    private final int tileSize;
+    // Alternate scaled tile sizes:
+    private final int[] altSizes;
+    // Width and height in pixels of each chunk:
+    private final int pixelsPerChunk;
+    // Map types receiving preview tiles:
+    private final List<MapType> mapTypes;
+    // Options selecting each map type's PNG encoder:
+    private final MapOptions options;
+}
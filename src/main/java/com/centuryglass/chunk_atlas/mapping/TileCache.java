@@ -0,0 +1,948 @@
+/**
+ * @file TileCache.java
+ *
+ * Holds map tile images in memory within a fixed memory budget.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.DirectBlockStore;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.Point;
+import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.nio.ByteBuffer;
+import java.util.ArrayDeque;
+import java.util.Arrays;
+import java.util.HashSet;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.Map;
+import java.util.Set;
+import java.util.function.BiConsumer;
+import java.util.logging.Level;
+import java.util.zip.DataFormatException;
+import java.util.zip.Deflater;
+import java.util.zip.Inflater;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TileCache keeps map tile images in memory, limiting the number of bytes
+ * they use instead of the number of tiles held.
+ *
+ *  Cached tiles are held in one of two memory tiers. Recently used tiles are
+ * kept as uncompressed images that can be drawn on directly. Once the budget
+ * is exceeded, the least recently used images are compressed into the second
+ * tier, where map tiles with large areas of identical color usually take a
+ * small fraction of their original size. If compressed tiles still exceed
+ * their share of the budget, the least recently used are passed to the
+ * cache's ColdStorage to be saved on disk. Compressed tiles are decompressed
+ * and moved back into the first tier when they're used again.
+ *
+ *  Each cached tile may hold several layers, so that the maps of different
+ * map types can share one cache. All of a tile's layers are found with a
+ * single lookup, and are compressed and evicted together.
+ *
+ *  In off-heap mode, compressed tiles are held in direct memory instead of
+ * the Java heap, and only a few recently used tiles are kept uncompressed.
+ * Uncompressed images are reused once their tiles are compressed, so the
+ * heap holds a small, stable set of tile rasters no matter how many tiles
+ * are cached, and cached tiles add no work for the garbage collector.
+ *
+ *  TileCache objects are not thread-safe.
+ */
+public class TileCache
+{
+    private static final String CLASSNAME = TileCache.class.getName();
+
+    // The fraction of the memory budget compressed tiles may use, as a
+    // divisor:
+    private static final int WARM_BUDGET_DIVISOR = 4;
+    // Initial size of the buffer used when reading compressed output:
+    private static final int DEFLATE_BUFFER_SIZE = 65536;
+    // Maximum number of tiles held uncompressed in off-heap mode:
+    private static final int OFF_HEAP_HOT_TILES = 4;
+    // Size of each direct memory block used in off-heap mode:
+    private static final int OFF_HEAP_BLOCK_SIZE = 4096;
+
+    /**
+     * Receives tiles removed from memory because the cache exceeded its
+     * memory budget.
+     */
+    public interface ColdStorage
+    {
+        /**
+         * Saves an evicted tile so that it can be reloaded later.
+         *
+         * @param tilePt  The upper left chunk coordinate of the evicted tile.
+         *
+         * @param image   The evicted tile image.
+         */
+        void storeTile(Point tilePt, BufferedImage image);
+    }
+
+    /**
+     * An immutable snapshot of cache usage statistics.
+     */
+    public static class Stats
+    {
+        /**
+         * Records cache statistics on construction.
+         *
+         * @param hotHits    Lookups that found an uncompressed tile.
+         *
+         * @param warmHits   Lookups that found and decompressed a tile.
+         *
+         * @param misses     Lookups that found no cached tile.
+         *
+         * @param demotions  Tiles compressed to save memory.
+         *
+         * @param evictions  Tiles passed to cold storage.
+         *
+         * @param hotBytes   Bytes used by uncompressed tiles.
+         *
+         * @param warmBytes  Bytes used by compressed tiles.
+         */
+        protected Stats(long hotHits, long warmHits, long misses,
+                long demotions, long evictions, long hotBytes, long warmBytes)
+        {
+            this.hotHits = hotHits;
+            this.warmHits = warmHits;
+            this.misses = misses;
+            this.demotions = demotions;
+            this.evictions = evictions;
+            this.hotBytes = hotBytes;
+            this.warmBytes = warmBytes;
+        }
+
+        /**
+         * Describes the cache statistics.
+         *
+         * @return  A short summary of all statistics.
+         */
+        @Override
+        public String toString()
+        {
+            return "hits=" + hotHits + ", compressed hits=" + warmHits
+                    + ", misses=" + misses + ", compressed=" + demotions
+                    + ", evicted=" + evictions + ", bytes=" + hotBytes
+                    + ", compressed bytes=" + warmBytes;
+        }
+
+        public final long hotHits;
+        public final long warmHits;
+        public final long misses;
+        public final long demotions;
+        public final long evictions;
+        public final long hotBytes;
+        public final long warmBytes;
+    }
+
+    /**
+     * Creates an empty cache holding a single layer on construction.
+     *
+     * @param memoryBudget  The maximum number of bytes that cached tiles
+     *                      should use. The most recently used tile is always
+     *                      kept in memory, even if it alone exceeds this
+     *                      budget.
+     *
+     * @param coldStorage   The object that will save tiles evicted from
+     *                      memory.
+     */
+    public TileCache(long memoryBudget, ColdStorage coldStorage)
+    {
+        this(memoryBudget, 1);
+        setColdStorage(0, coldStorage);
+    }
+
+    /**
+     * Creates an empty cache where each tile holds several layers on
+     * construction. Each layer holds the image of a different map at the
+     * same tile coordinates, and all of a tile's layers are compressed or
+     * evicted together. Cold storage must be set for every layer before
+     * tiles are added.
+     *
+     * @param memoryBudget  The maximum number of bytes that cached tiles
+     *                      should use. The most recently used tile is always
+     *                      kept in memory, even if it alone exceeds this
+     *                      budget.
+     *
+     * @param layerCount    The number of images each tile may hold.
+     */
+    public TileCache(long memoryBudget, int layerCount)
+    {
+        ExtendedValidate.isPositive(memoryBudget, "Tile memory budget");
+        ExtendedValidate.isPositive(layerCount, "Tile layer count");
+        this.memoryBudget = memoryBudget;
+        coldStorage = new ColdStorage[layerCount];
+        hotTiles = new LinkedHashMap<>(16, 0.75f, true);
+        warmTiles = new LinkedHashMap<>(16, 0.75f, true);
+        deflater = new Deflater(Deflater.BEST_SPEED);
+        inflater = new Inflater();
+        deflateBuffer = new byte[DEFLATE_BUFFER_SIZE];
+        rawBuffer = new byte[0];
+        imagePool = new ArrayDeque<>();
+    }
+
+    /**
+     * Sets whether compressed tiles are held outside of the Java heap. This
+     * must be set before any tiles are added.
+     *
+     * @param offHeap  Whether compressed tiles should be held in direct
+     *                 memory, with only a few uncompressed images kept on the
+     *                 heap and reused.
+     */
+    public void setOffHeap(boolean offHeap)
+    {
+        Validate.isTrue(hotTiles.isEmpty() && warmTiles.isEmpty(),
+                "Off-heap mode must be set before tiles are cached.");
+        offHeapStore = offHeap ? new DirectBlockStore(OFF_HEAP_BLOCK_SIZE)
+                : null;
+        imagePool.clear();
+    }
+
+    /**
+     * Checks if compressed tiles are held outside of the Java heap.
+     *
+     * @return  Whether the cache is in off-heap mode.
+     */
+    public boolean isOffHeap()
+    {
+        return offHeapStore != null;
+    }
+
+    /**
+     * Creates a fully transparent tile image. In off-heap mode, this reuses
+     * an image left over from a compressed tile when possible.
+     *
+     * @param width   The image width in pixels.
+     *
+     * @param height  The image height in pixels.
+     *
+     * @return        A TYPE_INT_ARGB image with every pixel cleared.
+     */
+    public BufferedImage createImage(int width, int height)
+    {
+        ExtendedValidate.isPositive(width, "Tile image width");
+        ExtendedValidate.isPositive(height, "Tile image height");
+        BufferedImage image = takePooledImage(width, height);
+        if (image == null)
+        {
+            return new BufferedImage(width, height,
+                    BufferedImage.TYPE_INT_ARGB);
+        }
+        Arrays.fill(((DataBufferInt) image.getRaster().getDataBuffer())
+                .getData(), 0);
+        return image;
+    }
+
+    /**
+     * Sets the object that saves a layer's tiles once they are evicted from
+     * memory.
+     *
+     * @param layer        The index of a cache layer.
+     *
+     * @param coldStorage  The object that will save that layer's evicted
+     *                     tiles.
+     */
+    public void setColdStorage(int layer, ColdStorage coldStorage)
+    {
+        validateLayer(layer);
+        Validate.notNull(coldStorage, "Cold storage cannot be null.");
+        this.coldStorage[layer] = coldStorage;
+    }
+
+    /**
+     * Gets the number of images each cached tile may hold.
+     *
+     * @return  The cache's layer count.
+     */
+    public int getLayerCount()
+    {
+        return coldStorage.length;
+    }
+
+    /**
+     * Gets the number of times any uncompressed tile image left memory or
+     * was compressed. Objects keeping a reference to a cached image's pixel
+     * data can compare this with its earlier value to check whether the
+     * reference might no longer point to cached data.
+     *
+     * @return  A count that increases each time cached images are compressed,
+     *          evicted, or removed.
+     */
+    public long getHotChanges()
+    {
+        return hotChanges;
+    }
+
+    /**
+     * Gets a cached tile image, decompressing it if necessary. This marks the
+     * tile as the most recently used.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @param layer   The index of the layer holding the image.
+     *
+     * @return        The tile image, or null if the tile is not cached.
+     */
+    public BufferedImage get(Point tilePt, int layer)
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        validateLayer(layer);
+        BufferedImage[] layers = getHotLayers(tilePt);
+        if (layers == null)
+        {
+            layers = promoteWarmTile(tilePt);
+            if (layers != null && layers[layer] != null)
+            {
+                warmHits++;
+                return layers[layer];
+            }
+        }
+        else if (layers[layer] != null)
+        {
+            hotHits++;
+            return layers[layer];
+        }
+        misses++;
+        return null;
+    }
+
+    /**
+     * Adds a tile image to the cache as the most recently used tile, saving
+     * or compressing older tiles if this exceeds the memory budget.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @param layer   The index of the layer that will hold the image.
+     *
+     * @param image   A TYPE_INT_ARGB tile image.
+     */
+    public void put(Point tilePt, int layer, BufferedImage image)
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        validateLayer(layer);
+        Validate.notNull(image, "Tile image cannot be null.");
+        Validate.isTrue(image.getType() == BufferedImage.TYPE_INT_ARGB,
+                "Cached tiles must be TYPE_INT_ARGB images.");
+        BufferedImage[] layers = getHotLayers(tilePt);
+        if (layers == null)
+        {
+            // Decompress the tile's other layers so all are held together:
+            layers = promoteWarmTile(tilePt);
+        }
+        if (layers == null)
+        {
+            layers = new BufferedImage[coldStorage.length];
+            layers[layer] = image;
+            addHotTile(tilePt, layers);
+            return;
+        }
+        if (layers[layer] != null)
+        {
+            hotBytes -= getImageBytes(layers[layer]);
+            hotChanges++;
+        }
+        layers[layer] = image;
+        hotBytes += getImageBytes(image);
+        enforceBudget();
+    }
+
+    /**
+     * Removes a tile image from the cache.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @param layer   The index of the layer holding the image.
+     *
+     * @return        The removed tile image, or null if the tile was not
+     *                cached.
+     */
+    public BufferedImage remove(Point tilePt, int layer)
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        validateLayer(layer);
+        BufferedImage[] layers = hotTiles.get(tilePt);
+        if (layers != null)
+        {
+            BufferedImage image = layers[layer];
+            if (image != null)
+            {
+                layers[layer] = null;
+                hotBytes -= getImageBytes(image);
+                hotChanges++;
+                if (isEmpty(layers))
+                {
+                    hotTiles.remove(tilePt);
+                    lastLayers = null;
+                }
+            }
+            return image;
+        }
+        CompressedTile[] compressed = warmTiles.get(tilePt);
+        if (compressed != null && compressed[layer] != null)
+        {
+            warmBytes -= compressed[layer].bytes;
+            BufferedImage image = decompress(compressed[layer]);
+            release(compressed[layer]);
+            compressed[layer] = null;
+            if (isEmpty(compressed))
+            {
+                warmTiles.remove(tilePt);
+            }
+            return image;
+        }
+        return null;
+    }
+
+    /**
+     * Checks if a tile image is held in either memory tier.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @param layer   The index of the layer that would hold the image.
+     *
+     * @return        Whether the tile is cached.
+     */
+    public boolean contains(Point tilePt, int layer)
+    {
+        validateLayer(layer);
+        BufferedImage[] layers = hotTiles.get(tilePt);
+        if (layers != null)
+        {
+            return layers[layer] != null;
+        }
+        CompressedTile[] compressed = warmTiles.get(tilePt);
+        return compressed != null && compressed[layer] != null;
+    }
+
+    /**
+     * Gets the coordinates of every cached tile image within a layer.
+     *
+     * @param layer  The index of a cache layer.
+     *
+     * @return       A new set holding the upper left chunk coordinates of all
+     *               of the layer's cached tiles.
+     */
+    public Set<Point> getTilePoints(int layer)
+    {
+        validateLayer(layer);
+        Set<Point> tilePoints = new HashSet<>();
+        hotTiles.forEach((tilePt, layers) ->
+        {
+            if (layers[layer] != null)
+            {
+                tilePoints.add(tilePt);
+            }
+        });
+        warmTiles.forEach((tilePt, compressed) ->
+        {
+            if (compressed[layer] != null)
+            {
+                tilePoints.add(tilePt);
+            }
+        });
+        return tilePoints;
+    }
+
+    /**
+     * Runs an action on every cached tile image within a layer without
+     * changing which tiles were most recently used. Compressed tiles are
+     * decompressed into temporary images, so the action should not modify
+     * tile images or keep them after it returns.
+     *
+     * @param layer       The index of a cache layer.
+     *
+     * @param tileAction  An action that will receive each tile's coordinates
+     *                    and image.
+     */
+    public void forEachTile(int layer,
+            BiConsumer<Point, BufferedImage> tileAction)
+    {
+        validateLayer(layer);
+        Validate.notNull(tileAction, "Tile action cannot be null.");
+        for (Map.Entry<Point, BufferedImage[]> entry : hotTiles.entrySet())
+        {
+            if (entry.getValue()[layer] != null)
+            {
+                tileAction.accept(entry.getKey(), entry.getValue()[layer]);
+            }
+        }
+        for (Map.Entry<Point, CompressedTile[]> entry : warmTiles.entrySet())
+        {
+            if (entry.getValue()[layer] != null)
+            {
+                BufferedImage image = decompress(entry.getValue()[layer]);
+                tileAction.accept(entry.getKey(), image);
+                recycleImage(image);
+            }
+        }
+    }
+
+    /**
+     * Gets the cache's current usage statistics.
+     *
+     * @return  A snapshot of all cache statistics.
+     */
+    public Stats getStats()
+    {
+        return new Stats(hotHits, warmHits, misses, demotions, evictions,
+                hotBytes, warmBytes);
+    }
+
+    /**
+     * Ensures a layer index is valid.
+     *
+     * @param layer  An index that must be within the cache's layer count.
+     */
+    private void validateLayer(int layer)
+    {
+        ExtendedValidate.inInclusiveBounds(layer, 0, coldStorage.length - 1,
+                "Tile layer");
+    }
+
+    /**
+     * Finds an uncompressed tile's layers, marking the tile as the most
+     * recently used. Consecutive lookups of the same tile from different
+     * layers reuse the last result, but still move the tile to the end of the
+     * access order so it isn't evicted before less recently used tiles.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @return        The tile's layers, or null if the tile isn't held
+     *                uncompressed.
+     */
+    private BufferedImage[] getHotLayers(Point tilePt)
+    {
+        if (lastLayers != null && tilePt.x == lastTileX
+                && tilePt.y == lastTileZ)
+        {
+            // Accessing the tile marks it as the most recently used:
+            hotTiles.get(tilePt);
+            return lastLayers;
+        }
+        BufferedImage[] layers = hotTiles.get(tilePt);
+        if (layers != null)
+        {
+            lastTileX = tilePt.x;
+            lastTileZ = tilePt.y;
+            lastLayers = layers;
+        }
+        return layers;
+    }
+
+    /**
+     * Decompresses all of a compressed tile's layers, moving the tile back
+     * into the uncompressed tier as the most recently used.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @return        The tile's decompressed layers, or null if the tile
+     *                isn't held compressed.
+     */
+    private BufferedImage[] promoteWarmTile(Point tilePt)
+    {
+        CompressedTile[] compressed = warmTiles.remove(tilePt);
+        if (compressed == null)
+        {
+            return null;
+        }
+        BufferedImage[] layers = new BufferedImage[compressed.length];
+        for (int i = 0; i < layers.length; i++)
+        {
+            if (compressed[i] != null)
+            {
+                warmBytes -= compressed[i].bytes;
+                layers[i] = decompress(compressed[i]);
+                release(compressed[i]);
+            }
+        }
+        addHotTile(tilePt, layers);
+        return layers;
+    }
+
+    /**
+     * Checks if a set of tile layers holds no data.
+     *
+     * @param layers  An array of tile layers.
+     *
+     * @return        Whether every layer is null.
+     */
+    private static boolean isEmpty(Object[] layers)
+    {
+        for (Object layer : layers)
+        {
+            if (layer != null)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Adds a tile's layers to the uncompressed tier, then enforces the memory
+     * budget.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile. This point
+     *                is copied, so the caller may reuse it.
+     *
+     * @param layers  The tile layers to add.
+     */
+    private void addHotTile(Point tilePt, BufferedImage[] layers)
+    {
+        hotTiles.put(new Point(tilePt), layers);
+        for (BufferedImage image : layers)
+        {
+            if (image != null)
+            {
+                hotBytes += getImageBytes(image);
+            }
+        }
+        lastTileX = tilePt.x;
+        lastTileZ = tilePt.y;
+        lastLayers = layers;
+        enforceBudget();
+    }
+
+    /**
+     * Compresses and evicts the least recently used tiles until the memory
+     * budget is met. The most recently used tile is never compressed.
+     */
+    private void enforceBudget()
+    {
+        final boolean offHeap = isOffHeap();
+        // Compress the least recently used tiles until the budget is met:
+        Iterator<Map.Entry<Point, BufferedImage[]>> hotIter
+                = hotTiles.entrySet().iterator();
+        while (((hotBytes + warmBytes) > memoryBudget
+                || (offHeap && hotTiles.size() > OFF_HEAP_HOT_TILES))
+                && hotTiles.size() > 1)
+        {
+            Map.Entry<Point, BufferedImage[]> oldest = hotIter.next();
+            hotIter.remove();
+            if (oldest.getValue() == lastLayers)
+            {
+                lastLayers = null;
+            }
+            final BufferedImage[] layers = oldest.getValue();
+            final CompressedTile[] compressed
+                    = new CompressedTile[layers.length];
+            for (int i = 0; i < layers.length; i++)
+            {
+                if (layers[i] != null)
+                {
+                    hotBytes -= getImageBytes(layers[i]);
+                    compressed[i] = compress(layers[i]);
+                    warmBytes += compressed[i].bytes;
+                    recycleImage(layers[i]);
+                }
+            }
+            warmTiles.put(oldest.getKey(), compressed);
+            demotions++;
+            hotChanges++;
+        }
+        // Move compressed tiles to storage until they fit in their share of
+        // the budget. Off-heap, compressed tiles may use the whole budget:
+        Iterator<Map.Entry<Point, CompressedTile[]>> warmIter
+                = warmTiles.entrySet().iterator();
+        while (warmIter.hasNext()
+                && ((! offHeap
+                && warmBytes > (memoryBudget / WARM_BUDGET_DIVISOR))
+                || (hotBytes + warmBytes) > memoryBudget))
+        {
+            Map.Entry<Point, CompressedTile[]> oldest = warmIter.next();
+            warmIter.remove();
+            final CompressedTile[] compressed = oldest.getValue();
+            for (int i = 0; i < compressed.length; i++)
+            {
+                if (compressed[i] != null)
+                {
+                    warmBytes -= compressed[i].bytes;
+                    BufferedImage image = decompress(compressed[i]);
+                    release(compressed[i]);
+                    coldStorage[i].storeTile(oldest.getKey(), image);
+                }
+            }
+            evictions++;
+        }
+    }
+
+    /**
+     * Gets the number of bytes used by an image's pixel data.
+     *
+     * @param image  A TYPE_INT_ARGB image.
+     *
+     * @return       The image's size in bytes.
+     */
+    private static long getImageBytes(BufferedImage image)
+    {
+        return (long) image.getWidth() * image.getHeight() * Integer.BYTES;
+    }
+
+    /**
+     * Gets a reusable buffer large enough to hold raw image data.
+     *
+     * @param size  The number of bytes needed.
+     *
+     * @return      A buffer holding at least that many bytes.
+     */
+    private byte[] getRawBuffer(int size)
+    {
+        if (rawBuffer.length < size)
+        {
+            rawBuffer = new byte[size];
+        }
+        return rawBuffer;
+    }
+
+    /**
+     * Compresses a tile image's pixel data.
+     *
+     * @param image  A TYPE_INT_ARGB tile image.
+     *
+     * @return       The compressed tile.
+     */
+    private CompressedTile compress(BufferedImage image)
+    {
+        final int[] pixels = ((DataBufferInt) image.getRaster()
+                .getDataBuffer()).getData();
+        final int rawSize = pixels.length * Integer.BYTES;
+        final byte[] raw = getRawBuffer(rawSize);
+        ByteBuffer.wrap(raw, 0, rawSize).asIntBuffer().put(pixels);
+        deflater.reset();
+        deflater.setInput(raw, 0, rawSize);
+        deflater.finish();
+        int length = 0;
+        while (! deflater.finished())
+        {
+            if (length == deflateBuffer.length)
+            {
+                deflateBuffer = Arrays.copyOf(deflateBuffer, length * 2);
+            }
+            length += deflater.deflate(deflateBuffer, length,
+                    deflateBuffer.length - length);
+        }
+        if (isOffHeap())
+        {
+            return new CompressedTile(image.getWidth(), image.getHeight(),
+                    offHeapStore.store(deflateBuffer, length), length,
+                    (long) offHeapStore.getBlockCount(length)
+                    * OFF_HEAP_BLOCK_SIZE);
+        }
+        return new CompressedTile(image.getWidth(), image.getHeight(),
+                Arrays.copyOf(deflateBuffer, length));
+    }
+
+    /**
+     * Restores a compressed tile's image. The compressed tile is left
+     * unchanged.
+     *
+     * @param compressed  The compressed tile.
+     *
+     * @return            A TYPE_INT_ARGB image holding the tile's pixels,
+     *                    which is either new or reused from the image pool.
+     */
+    private BufferedImage decompress(CompressedTile compressed)
+    {
+        final String FN_NAME = "decompress";
+        BufferedImage image = takePooledImage(compressed.width,
+                compressed.height);
+        if (image == null)
+        {
+            image = new BufferedImage(compressed.width, compressed.height,
+                    BufferedImage.TYPE_INT_ARGB);
+        }
+        final int[] pixels = ((DataBufferInt) image.getRaster()
+                .getDataBuffer()).getData();
+        final int rawSize = pixels.length * Integer.BYTES;
+        final byte[] raw = getRawBuffer(rawSize);
+        inflater.reset();
+        if (compressed.blocks != null)
+        {
+            // Copy off-heap data into the unused compression buffer:
+            if (deflateBuffer.length < compressed.length)
+            {
+                deflateBuffer = new byte[compressed.length];
+            }
+            offHeapStore.read(compressed.blocks, compressed.length,
+                    deflateBuffer);
+            inflater.setInput(deflateBuffer, 0, compressed.length);
+        }
+        else
+        {
+            inflater.setInput(compressed.data);
+        }
+        try
+        {
+            int offset = 0;
+            while (offset < rawSize && ! inflater.finished())
+            {
+                final int length = inflater.inflate(raw, offset,
+                        rawSize - offset);
+                if (length == 0 && inflater.needsInput())
+                {
+                    break;
+                }
+                offset += length;
+            }
+            ByteBuffer.wrap(raw, 0, rawSize).asIntBuffer().get(pixels);
+        }
+        catch (DataFormatException e)
+        {
+            LogConfig.getLogger().logp(Level.SEVERE, CLASSNAME, FN_NAME,
+                    "Compressed tile data is invalid, tile data may be lost.",
+                    e);
+        }
+        return image;
+    }
+
+    /**
+     * Releases the direct memory blocks held by a compressed tile, if any.
+     * The tile's data can't be decompressed afterwards.
+     *
+     * @param compressed  A compressed tile leaving the cache.
+     */
+    private void release(CompressedTile compressed)
+    {
+        if (compressed.blocks != null)
+        {
+            offHeapStore.free(compressed.blocks);
+        }
+    }
+
+    /**
+     * Takes an unused image of a given size from the image pool.
+     *
+     * @param width   The image width in pixels.
+     *
+     * @param height  The image height in pixels.
+     *
+     * @return        A pooled image with unspecified contents, or null if no
+     *                pooled image has that size.
+     */
+    private BufferedImage takePooledImage(int width, int height)
+    {
+        Iterator<BufferedImage> iter = imagePool.iterator();
+        while (iter.hasNext())
+        {
+            BufferedImage image = iter.next();
+            if (image.getWidth() == width && image.getHeight() == height)
+            {
+                iter.remove();
+                return image;
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Adds an image that is no longer in use to the image pool in off-heap
+     * mode, if the pool isn't full. The image must not be used afterwards.
+     *
+     * @param image  A TYPE_INT_ARGB image no longer held by the cache.
+     */
+    private void recycleImage(BufferedImage image)
+    {
+        if (isOffHeap() && imagePool.size()
+                < (OFF_HEAP_HOT_TILES + 1) * coldStorage.length)
+        {
+            imagePool.push(image);
+        }
+    }
+
+    /**
+     * A compressed tile image.
+     */
+    private static class CompressedTile
+    {
+        /**
+         * Creates a compressed tile held in the Java heap.
+         *
+         * @param width   The tile image width in pixels.
+         *
+         * @param height  The tile image height in pixels.
+         *
+         * @param data    The compressed pixel data.
+         */
+        CompressedTile(int width, int height, byte[] data)
+        {
+            this.width = width;
+            this.height = height;
+            this.data = data;
+            this.blocks = null;
+            this.length = data.length;
+            this.bytes = data.length;
+        }
+
+        /**
+         * Creates a compressed tile held in direct memory.
+         *
+         * @param width   The tile image width in pixels.
+         *
+         * @param height  The tile image height in pixels.
+         *
+         * @param blocks  The direct memory blocks holding the compressed
+         *                pixel data.
+         *
+         * @param length  The size in bytes of the compressed pixel data.
+         *
+         * @param bytes   The total size in bytes of all blocks.
+         */
+        CompressedTile(int width, int height, int[] blocks, int length,
+                long bytes)
+        {
+            this.width = width;
+            this.height = height;
+            this.data = null;
+            this.blocks = blocks;
+            this.length = length;
+            this.bytes = bytes;
+        }
+        public final int width;
+        public final int height;
+        // Compressed data held on the heap, or null if held in blocks:
+        public final byte[] data;
+        // Direct memory blocks holding compressed data, or null if held on
+        // the heap:
+        public final int[] blocks;
+        // Compressed data size in bytes:
+        public final int length;
+        // Memory used by the compressed data:
+        public final long bytes;
+    }
+
+    // Maximum bytes used by all cached tiles:
+    private final long memoryBudget;
+    // Saves tiles evicted from memory, for each layer:
+    private final ColdStorage[] coldStorage;
+    // Uncompressed tile layers, ordered from least to most recently used:
+    private final LinkedHashMap<Point, BufferedImage[]> hotTiles;
+    // Compressed tile layers, ordered from least to most recently used:
+    private final LinkedHashMap<Point, CompressedTile[]> warmTiles;
+    // The most recently used uncompressed tile's coordinates and layers:
+    private int lastTileX;
+    private int lastTileZ;
+    private BufferedImage[] lastLayers = null;
+    // Bytes used by each memory tier:
+    private long hotBytes = 0;
+    private long warmBytes = 0;
+    // Reusable compression objects and buffers:
+    private final Deflater deflater;
+    private final Inflater inflater;
+    private byte[] deflateBuffer;
+    private byte[] rawBuffer;
+    // Holds compressed tiles in off-heap mode, or null otherwise:
+    private DirectBlockStore offHeapStore = null;
+    // Unused images available for reuse in off-heap mode:
+    private final ArrayDeque<BufferedImage> imagePool;
+    // Usage statistics:
+    private long hotHits = 0;
+    private long warmHits = 0;
+    private long misses = 0;
+    private long demotions = 0;
+    private long evictions = 0;
+    // Number of times uncompressed images were compressed or removed:
+    private long hotChanges = 0;
+}
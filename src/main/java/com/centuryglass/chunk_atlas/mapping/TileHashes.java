@@ -0,0 +1,334 @@
+/**
+ * @file TileHashes.java
+ *
+ * Records a content hash of each saved map tile.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.FileUtil;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.TreeSet;
+import java.util.logging.Level;
+import javax.json.Json;
+import javax.json.JsonException;
+import javax.json.JsonObject;
+import javax.json.JsonObjectBuilder;
+import javax.json.JsonReader;
+import javax.json.JsonWriter;
+import javax.json.JsonValue;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TileHashes keeps a manifest of hashes computed over the raw ARGB pixels of
+ * each tile image saved within a map directory. Before a finished tile is
+ * saved, its hash is compared with the hash recorded for its file. If they
+ * match, the file already holds the same image and doesn't need to be
+ * written again, so its modification time is left unchanged and it isn't
+ * reported as a new file.
+ *
+ *  Each hash is stored with the size and modification time its file had once
+ * it was written. A hash is only trusted while the file still has that size
+ * and modification time, so files replaced by other processes or by
+ * interrupted runs are always written again. Tiles that were found to be
+ * unchanged also record when that was last checked, so they can be treated
+ * like tiles written at that time.
+ *
+ *  The manifest is saved within the map directory. TileHashes is not
+ * thread-safe, and should be used by a single thread.
+ */
+public class TileHashes
+{
+    private static final String CLASSNAME = TileHashes.class.getName();
+
+    // Manifest file name, within the map directory:
+    private static final String MANIFEST_NAME = "tileHashes.json";
+    private static final String TEMP_SUFFIX = ".tmp";
+    // File state used for tiles that are still being written:
+    private static final long UNKNOWN = -1;
+    // FNV-1a 64-bit hash parameters:
+    private static final long FNV_OFFSET = 0xcbf29ce484222325L;
+    private static final long FNV_PRIME = 0x100000001b3L;
+
+    /**
+     * Loads any hashes saved in a map directory on construction.
+     *
+     * @param mapDir  The directory holding all of a map's tile images.
+     */
+    public TileHashes(File mapDir)
+    {
+        final String FN_NAME = "TileHashes";
+        ExtendedValidate.couldBeDirectory(mapDir, "Map directory");
+        this.mapDir = mapDir;
+        tileStates = new HashMap<>();
+        File manifestFile = new File(mapDir, MANIFEST_NAME);
+        if (! manifestFile.isFile())
+        {
+            return;
+        }
+        try (JsonReader reader = Json.createReader(
+                new FileInputStream(manifestFile)))
+        {
+            JsonObject tiles = reader.readObject().getJsonObject(
+                    JsonKeys.TILES);
+            for (Map.Entry<String, JsonValue> entry : tiles.entrySet())
+            {
+                JsonObject state = (JsonObject) entry.getValue();
+                tileStates.put(entry.getKey(), new TileState(
+                        state.getJsonNumber(JsonKeys.HASH).longValue(),
+                        state.getJsonNumber(JsonKeys.SIZE).longValue(),
+                        state.getJsonNumber(JsonKeys.MODIFIED).longValue(),
+                        state.getJsonNumber(JsonKeys.VERIFIED).longValue()));
+            }
+        }
+        catch (IOException | JsonException | ClassCastException
+                | NullPointerException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Ignoring unreadable tile hash manifest '{0}': {1}",
+                    new Object[] { manifestFile, e });
+            tileStates.clear();
+        }
+    }
+
+    /**
+     * Checks if a tile image is fully transparent.
+     *
+     * @param pixels  The tile's packed ARGB pixel data.
+     *
+     * @return        Whether every pixel has zero alpha.
+     */
+    public static boolean isEmpty(int[] pixels)
+    {
+        Validate.notNull(pixels, "Tile pixels cannot be null.");
+        for (int pixel : pixels)
+        {
+            if ((pixel >>> 24) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Computes the hash of a tile image's raw pixel data.
+     *
+     * @param pixels  The tile's packed ARGB pixel data.
+     *
+     * @return        A 64-bit FNV-1a hash of every pixel value.
+     */
+    public static long hashPixels(int[] pixels)
+    {
+        Validate.notNull(pixels, "Tile pixels cannot be null.");
+        long hash = FNV_OFFSET ^ pixels.length;
+        for (int pixel : pixels)
+        {
+            hash = (hash ^ pixel) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    /**
+     * Checks if a tile file already holds an image with a specific hash. If
+     * it does, the file is marked as checked at the current time.
+     *
+     * @param tileFile  The file where the tile would be saved.
+     *
+     * @param hash      The hash of the tile's current image.
+     *
+     * @return          Whether the file exists, hasn't changed since its hash
+     *                  was recorded, and has the same hash.
+     */
+    public boolean checkUnchanged(File tileFile, long hash)
+    {
+        Validate.notNull(tileFile, "Tile file cannot be null.");
+        final String key = getKey(tileFile);
+        TileState state = tileStates.get(key);
+        if (state == null || state.hash != hash || ! matchesFile(state,
+                tileFile))
+        {
+            return false;
+        }
+        tileStates.put(key, new TileState(hash, state.size, state.modified,
+                System.currentTimeMillis()));
+        return true;
+    }
+
+    /**
+     * Records the hash of a tile image that is about to be written. The
+     * file's size and modification time are read when the hashes are saved,
+     * so all writes must be finished by then. If the file wasn't replaced by
+     * that time, the hash is discarded.
+     *
+     * @param tileFile  The file where the tile is being saved.
+     *
+     * @param hash      The hash of the tile's image.
+     */
+    public void recordWrite(File tileFile, long hash)
+    {
+        Validate.notNull(tileFile, "Tile file cannot be null.");
+        tileStates.put(getKey(tileFile), new TileState(hash, UNKNOWN,
+                UNKNOWN, System.currentTimeMillis()));
+    }
+
+    /**
+     * Removes the recorded hash of a tile that is no longer saved.
+     *
+     * @param tileFile  The tile's image file.
+     */
+    public void remove(File tileFile)
+    {
+        Validate.notNull(tileFile, "Tile file cannot be null.");
+        tileStates.remove(getKey(tileFile));
+    }
+
+    /**
+     * Checks if a tile file was found to be unchanged at or after a specific
+     * time, without being replaced since.
+     *
+     * @param tileFile  The tile's image file.
+     *
+     * @param time      A time in milliseconds since the epoch.
+     *
+     * @return          Whether the file's saved image was last confirmed to
+     *                  be current at or after the given time.
+     */
+    public boolean isVerifiedSince(File tileFile, long time)
+    {
+        Validate.notNull(tileFile, "Tile file cannot be null.");
+        TileState state = tileStates.get(getKey(tileFile));
+        return state != null && state.verified >= time
+                && matchesFile(state, tileFile);
+    }
+
+    /**
+     * Saves all recorded hashes to the map directory, reading the final size
+     * and modification time of each tile written since the last save. Tiles
+     * that no longer exist or failed to be written are dropped.
+     *
+     * @throws IOException  If the manifest file couldn't be written.
+     */
+    public void save() throws IOException
+    {
+        final String FN_NAME = "save";
+        JsonObjectBuilder tileBuilder = Json.createObjectBuilder();
+        for (String key : new TreeSet<>(tileStates.keySet()))
+        {
+            TileState state = tileStates.get(key);
+            final File tileFile = new File(mapDir, key);
+            if (! tileFile.isFile() || (state.modified == UNKNOWN
+                    && tileFile.lastModified() < state.verified))
+            {
+                tileStates.remove(key);
+                continue;
+            }
+            if (state.modified == UNKNOWN)
+            {
+                state = new TileState(state.hash, tileFile.length(),
+                        tileFile.lastModified(), state.verified);
+                tileStates.put(key, state);
+            }
+            tileBuilder.add(key, Json.createObjectBuilder()
+                    .add(JsonKeys.HASH, state.hash)
+                    .add(JsonKeys.SIZE, state.size)
+                    .add(JsonKeys.MODIFIED, state.modified)
+                    .add(JsonKeys.VERIFIED, state.verified));
+        }
+        if (! mapDir.isDirectory())
+        {
+            Validate.isTrue(mapDir.mkdirs(), "Couldn't create map directory '"
+                    + mapDir + "'.");
+        }
+        File manifestFile = new File(mapDir, MANIFEST_NAME);
+        File tempFile = new File(mapDir, MANIFEST_NAME + TEMP_SUFFIX);
+        try (JsonWriter writer = Json.createWriter(
+                new FileOutputStream(tempFile)))
+        {
+            writer.writeObject(Json.createObjectBuilder()
+                    .add(JsonKeys.TILES, tileBuilder).build());
+        }
+        FileUtil.replaceFile(tempFile, manifestFile);
+        LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                "Saved {0} tile hashes for {1}.",
+                new Object[] { tileStates.size(), mapDir });
+    }
+
+    /**
+     * Checks if a tile file still has the size and modification time recorded
+     * with its hash.
+     *
+     * @param state     The tile's recorded state.
+     *
+     * @param tileFile  The tile's image file.
+     *
+     * @return          Whether the file exists and matches its recorded
+     *                  state.
+     */
+    private static boolean matchesFile(TileState state, File tileFile)
+    {
+        return state.modified != UNKNOWN && tileFile.isFile()
+                && tileFile.lastModified() == state.modified
+                && tileFile.length() == state.size;
+    }
+
+    /**
+     * Gets the key used to store a tile file's hash.
+     *
+     * @param tileFile  A tile image file within the map directory.
+     *
+     * @return          The file's path relative to the map directory, using
+     *                  '/' as the separator.
+     */
+    private String getKey(File tileFile)
+    {
+        return mapDir.toPath().relativize(tileFile.toPath()).toString()
+                .replace(File.separatorChar, '/');
+    }
+
+    /**
+     * A tile's image hash, and the state of its file.
+     */
+    private static class TileState
+    {
+        protected TileState(long hash, long size, long modified,
+                long verified)
+        {
+            this.hash = hash;
+            this.size = size;
+            this.modified = modified;
+            this.verified = verified;
+        }
+        // Hash of the tile's raw ARGB pixels:
+        protected final long hash;
+        // File size in bytes, once written:
+        protected final long size;
+        // File modification time in milliseconds since the epoch, once
+        // written:
+        protected final long modified;
+        // Last time the file was written or found to be unchanged, in
+        // milliseconds since the epoch:
+        protected final long verified;
+    }
+
+    // All JSON keys used in manifest files:
+    private static class JsonKeys
+    {
+        public static final String TILES = "tiles";
+        public static final String HASH = "hash";
+        public static final String SIZE = "size";
+        public static final String MODIFIED = "modified";
+        public static final String VERIFIED = "verified";
+    }
+
+    // Directory holding all of the map's tiles and the manifest:
+    private final File mapDir;
+    // Recorded tile states, mapped by path within the map directory:
+    private final Map<String, TileState> tileStates;
+}
@@ -0,0 +1,476 @@
+/**
+ * @file TileManifest.java
+ *
+ * Records the region files used to create each map tile.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.mapping.maptype.MapType;
+import com.centuryglass.chunk_atlas.savedata.RegionHeader;
+import com.centuryglass.chunk_atlas.threads.TileTracker;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.FileUtil;
+import java.awt.Point;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeSet;
+import java.util.logging.Level;
+import javax.json.Json;
+import javax.json.JsonArray;
+import javax.json.JsonArrayBuilder;
+import javax.json.JsonException;
+import javax.json.JsonObject;
+import javax.json.JsonObjectBuilder;
+import javax.json.JsonReader;
+import javax.json.JsonWriter;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TileManifest records which region files each map tile was drawn from, along
+ * with the state of each region file when it was read. Comparing the manifest
+ * saved by the last completed run with the current region files shows which
+ * regions changed, so only those regions need to be mapped again.
+ *
+ *  Each region file's state is its modification time and a checksum of its
+ * chunk timestamp table. Modification times are only used to skip re-reading
+ * headers of files that weren't touched. A region file counts as changed if
+ * its timestamp checksum changed, so copying or touching region files does
+ * not force tiles to be redrawn.
+ *
+ *  The manifest is saved in the region's tile output directory along with the
+ * settings used to create the tiles. A saved manifest is ignored if those
+ * settings change.
+ */
+public class TileManifest
+{
+    private static final String CLASSNAME = TileManifest.class.getName();
+
+    // Manifest file name, within the region tile output directory:
+    private static final String MANIFEST_NAME = "tileManifest.json";
+    private static final String TEMP_SUFFIX = ".tmp";
+    // File extension used by Minecraft region files:
+    private static final String REGION_SUFFIX = ".mca";
+    // Timestamp checksum used when a region header couldn't be read:
+    private static final long UNKNOWN_HASH = -1;
+
+    /**
+     * Creates a new, empty manifest for a set of map tiles.
+     *
+     * @param tileDir         The region-specific tile output directory where
+     *                        the manifest is saved.
+     *
+     * @param tileSize        The width and height in chunks of each map tile.
+     *
+     * @param altSizes        Alternate scaled tile sizes being created.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param mapTypes        The set of map types being created.
+     *
+     * @param zoomLevels      Whether zoom level tiles are being created.
+     *
+     * @param dataTiles       Whether data tiles are being created.
+     */
+    public TileManifest(File tileDir, int tileSize, int[] altSizes,
+            int pixelsPerChunk, Set<MapType> mapTypes, boolean zoomLevels,
+            boolean dataTiles)
+    {
+        ExtendedValidate.couldBeDirectory(tileDir, "Tile output directory");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        Validate.notNull(mapTypes, "Map types cannot be null.");
+        this.tileDir = tileDir;
+        this.tileSize = tileSize;
+        settings = createSettings(tileSize, altSizes, pixelsPerChunk,
+                mapTypes, zoomLevels, dataTiles);
+        regionStates = new HashMap<>();
+        tileRegions = new HashMap<>();
+    }
+
+    /**
+     * Loads the manifest saved by the last completed run, if one exists and
+     * was created using the same map settings.
+     *
+     * @param tileDir         The region-specific tile output directory where
+     *                        the manifest is saved.
+     *
+     * @param tileSize        The width and height in chunks of each map tile.
+     *
+     * @param altSizes        Alternate scaled tile sizes being created.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param mapTypes        The set of map types being created.
+     *
+     * @param zoomLevels      Whether zoom level tiles are being created.
+     *
+     * @param dataTiles       Whether data tiles are being created.
+     *
+     * @return                The saved manifest, or null if no matching
+     *                        manifest could be loaded.
+     */
+    public static TileManifest load(File tileDir, int tileSize,
+            int[] altSizes, int pixelsPerChunk, Set<MapType> mapTypes,
+            boolean zoomLevels, boolean dataTiles)
+    {
+        final String FN_NAME = "load";
+        File manifestFile = new File(tileDir, MANIFEST_NAME);
+        if (! manifestFile.isFile())
+        {
+            return null;
+        }
+        JsonObject saved;
+        try (JsonReader reader = Json.createReader(
+                new FileInputStream(manifestFile)))
+        {
+            saved = reader.readObject();
+        }
+        catch (IOException | JsonException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Ignoring unreadable tile manifest '{0}': {1}",
+                    new Object[] { manifestFile, e });
+            return null;
+        }
+        TileManifest manifest = new TileManifest(tileDir, tileSize, altSizes,
+                pixelsPerChunk, mapTypes, zoomLevels, dataTiles);
+        try
+        {
+            if (! manifest.settings.equals(saved.getJsonObject(
+                    JsonKeys.SETTINGS)))
+            {
+                LogConfig.getLogger().logp(Level.INFO, CLASSNAME, FN_NAME,
+                        "Map settings changed since tiles in '{0}' were "
+                        + "created, ignoring saved tile manifest.", tileDir);
+                return null;
+            }
+            JsonObject regions = saved.getJsonObject(JsonKeys.REGIONS);
+            regions.forEach((name, value) ->
+            {
+                JsonObject state = (JsonObject) value;
+                manifest.regionStates.put(name, new RegionState(
+                        state.getJsonNumber(JsonKeys.MODIFIED).longValue(),
+                        state.getJsonNumber(JsonKeys.TIMESTAMP_HASH)
+                        .longValue()));
+            });
+            JsonArray tiles = saved.getJsonArray(JsonKeys.TILES);
+            for (int i = 0; i < tiles.size(); i++)
+            {
+                JsonObject tile = tiles.getJsonObject(i);
+                JsonArray names = tile.getJsonArray(JsonKeys.TILE_REGIONS);
+                Set<String> dependencies = new TreeSet<>();
+                for (int j = 0; j < names.size(); j++)
+                {
+                    dependencies.add(names.getString(j));
+                }
+                manifest.tileRegions.put(new Point(tile.getInt(JsonKeys.X),
+                        tile.getInt(JsonKeys.Z)), dependencies);
+            }
+            return manifest;
+        }
+        catch (NullPointerException | ClassCastException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Ignoring invalid tile manifest '{0}': {1}",
+                    new Object[] { manifestFile, e });
+            return null;
+        }
+    }
+
+    /**
+     * Records the current state of a set of region files, and the tiles each
+     * region file overlaps. This should be called before the region files are
+     * read, so changes made while mapping will be found by the next run.
+     *
+     * @param regionFiles  All region files used to create the map tiles.
+     *
+     * @param previous     An optional manifest from an earlier run. Region
+     *                     files with unchanged modification times reuse their
+     *                     saved timestamp checksums instead of reading their
+     *                     headers again.
+     */
+    public void recordRegions(Collection<File> regionFiles,
+            TileManifest previous)
+    {
+        final String FN_NAME = "recordRegions";
+        Validate.notNull(regionFiles, "Region files cannot be null.");
+        for (File regionFile : regionFiles)
+        {
+            if (! regionFile.isFile()
+                    || ! regionFile.getName().endsWith(REGION_SUFFIX))
+            {
+                continue;
+            }
+            final String name = regionFile.getName();
+            final long modified = regionFile.lastModified();
+            RegionState savedState = (previous == null) ? null
+                    : previous.regionStates.get(name);
+            long timestampHash;
+            if (savedState != null && savedState.modified == modified
+                    && savedState.timestampHash != UNKNOWN_HASH)
+            {
+                timestampHash = savedState.timestampHash;
+            }
+            else
+            {
+                try
+                {
+                    timestampHash = new RegionHeader(regionFile)
+                            .getTimestampHash();
+                }
+                catch (IOException e)
+                {
+                    LogConfig.getLogger().logp(Level.WARNING, CLASSNAME,
+                            FN_NAME, "Couldn't read region header '{0}', "
+                            + "region will always be remapped: {1}",
+                            new Object[] { regionFile, e });
+                    timestampHash = UNKNOWN_HASH;
+                }
+            }
+            regionStates.put(name, new RegionState(modified, timestampHash));
+            for (Point tilePt : TileTracker.getRegionTiles(regionFile,
+                    tileSize))
+            {
+                Set<String> dependencies = tileRegions.get(tilePt);
+                if (dependencies == null)
+                {
+                    dependencies = new TreeSet<>();
+                    tileRegions.put(tilePt, dependencies);
+                }
+                dependencies.add(name);
+            }
+        }
+    }
+
+    /**
+     * Finds all region files that changed since an earlier manifest was
+     * recorded, including region files that no longer exist.
+     *
+     * @param previous  The manifest saved by an earlier run.
+     *
+     * @return          The names of all new, changed, or removed region
+     *                  files.
+     */
+    public Set<String> getChangedRegions(TileManifest previous)
+    {
+        Validate.notNull(previous, "Previous manifest cannot be null.");
+        Set<String> changed = new HashSet<>();
+        regionStates.forEach((name, state) ->
+        {
+            RegionState savedState = previous.regionStates.get(name);
+            if (savedState == null || state.timestampHash == UNKNOWN_HASH
+                    || savedState.timestampHash != state.timestampHash)
+            {
+                changed.add(name);
+            }
+        });
+        previous.regionStates.keySet().forEach((name) ->
+        {
+            if (! regionStates.containsKey(name))
+            {
+                changed.add(name);
+            }
+        });
+        return changed;
+    }
+
+    /**
+     * Finds all tiles with changed inputs since an earlier manifest was
+     * recorded. A tile's inputs changed if any region file it depends on
+     * changed, or if it now depends on a different set of region files.
+     *
+     * @param previous  The manifest saved by an earlier run.
+     *
+     * @return          The upper left chunk coordinates of each tile that
+     *                  needs to be redrawn.
+     */
+    public Set<Point> getChangedTiles(TileManifest previous)
+    {
+        Validate.notNull(previous, "Previous manifest cannot be null.");
+        final Set<String> changedRegions = getChangedRegions(previous);
+        Set<Point> changed = new HashSet<>();
+        List<Map<Point, Set<String>>> manifests = new ArrayList<>();
+        manifests.add(tileRegions);
+        manifests.add(previous.tileRegions);
+        for (Map<Point, Set<String>> tiles : manifests)
+        {
+            tiles.forEach((tilePt, dependencies) ->
+            {
+                if (! dependencies.equals(tileRegions.get(tilePt))
+                        || ! dependencies.equals(previous.tileRegions.get(
+                        tilePt)))
+                {
+                    changed.add(tilePt);
+                    return;
+                }
+                for (String name : dependencies)
+                {
+                    if (changedRegions.contains(name))
+                    {
+                        changed.add(tilePt);
+                        return;
+                    }
+                }
+            });
+        }
+        return changed;
+    }
+
+    /**
+     * Gets the number of tiles recorded in the manifest.
+     *
+     * @return  The number of tiles overlapping any recorded region file.
+     */
+    public int getTileCount()
+    {
+        return tileRegions.size();
+    }
+
+    /**
+     * Saves the manifest, replacing any manifest saved by an earlier run. This
+     * should only be called once all tiles are saved.
+     *
+     * @throws IOException  If unable to write the manifest file.
+     */
+    public void save() throws IOException
+    {
+        final String FN_NAME = "save";
+        JsonObjectBuilder regionBuilder = Json.createObjectBuilder();
+        new TreeSet<>(regionStates.keySet()).forEach((name) ->
+        {
+            RegionState state = regionStates.get(name);
+            regionBuilder.add(name, Json.createObjectBuilder()
+                    .add(JsonKeys.MODIFIED, state.modified)
+                    .add(JsonKeys.TIMESTAMP_HASH, state.timestampHash));
+        });
+        // Sort tiles so unchanged maps produce identical manifests:
+        Set<Point> tilePoints = new TreeSet<>((p1, p2) ->
+        {
+            return (p1.y != p2.y) ? Integer.compare(p1.y, p2.y)
+                    : Integer.compare(p1.x, p2.x);
+        });
+        tilePoints.addAll(tileRegions.keySet());
+        JsonArrayBuilder tileBuilder = Json.createArrayBuilder();
+        for (Point tilePt : tilePoints)
+        {
+            JsonArrayBuilder nameBuilder = Json.createArrayBuilder();
+            tileRegions.get(tilePt).forEach((name) -> nameBuilder.add(name));
+            tileBuilder.add(Json.createObjectBuilder()
+                    .add(JsonKeys.X, tilePt.x)
+                    .add(JsonKeys.Z, tilePt.y)
+                    .add(JsonKeys.TILE_REGIONS, nameBuilder));
+        }
+        JsonObject manifest = Json.createObjectBuilder()
+                .add(JsonKeys.SETTINGS, settings)
+                .add(JsonKeys.REGIONS, regionBuilder)
+                .add(JsonKeys.TILES, tileBuilder)
+                .build();
+        if (! tileDir.isDirectory())
+        {
+            Validate.isTrue(tileDir.mkdirs(), "Couldn't create tile output "
+                    + "directory '" + tileDir + "'.");
+        }
+        File manifestFile = new File(tileDir, MANIFEST_NAME);
+        File tempFile = new File(tileDir, MANIFEST_NAME + TEMP_SUFFIX);
+        try (JsonWriter writer = Json.createWriter(
+                new FileOutputStream(tempFile)))
+        {
+            writer.writeObject(manifest);
+        }
+        FileUtil.replaceFile(tempFile, manifestFile);
+        LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                "Saved tile manifest with {0} region files and {1} tiles.",
+                new Object[] { regionStates.size(), tileRegions.size() });
+    }
+
+    /**
+     * Removes any saved manifest from the tile output directory, so that the
+     * next run recreates every tile.
+     */
+    public void delete()
+    {
+        File manifestFile = new File(tileDir, MANIFEST_NAME);
+        if (manifestFile.isFile())
+        {
+            manifestFile.delete();
+        }
+    }
+
+    /**
+     * Creates a JSON object holding all settings that must match for saved
+     * tiles to be reused.
+     *
+     * @param tileSize        The width and height in chunks of each map tile.
+     *
+     * @param altSizes        Alternate scaled tile sizes being created.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param mapTypes        The set of map types being created.
+     *
+     * @param zoomLevels      Whether zoom level tiles are being created.
+     *
+     * @param dataTiles       Whether data tiles are being created.
+     *
+     * @return                The JSON settings object.
+     */
+    private static JsonObject createSettings(int tileSize, int[] altSizes,
+            int pixelsPerChunk, Set<MapType> mapTypes, boolean zoomLevels,
+            boolean dataTiles)
+    {
+        return Json.createObjectBuilder(MapCheckpoint.createSettings(tileSize,
+                altSizes, pixelsPerChunk, mapTypes, dataTiles))
+                .add(JsonKeys.ZOOM_LEVELS, zoomLevels)
+                .build();
+    }
+
+    /**
+     * The state of a region file when it was last read.
+     */
+    private static class RegionState
+    {
+        protected RegionState(long modified, long timestampHash)
+        {
+            this.modified = modified;
+            this.timestampHash = timestampHash;
+        }
+        // File modification time, in milliseconds since the epoch:
+        protected final long modified;
+        // Region header timestamp checksum:
+        protected final long timestampHash;
+    }
+
+    // All JSON keys used in manifest files:
+    private static class JsonKeys
+    {
+        public static final String SETTINGS = "settings";
+        public static final String ZOOM_LEVELS = "zoomLevels";
+        public static final String REGIONS = "regions";
+        public static final String MODIFIED = "modified";
+        public static final String TIMESTAMP_HASH = "timestampHash";
+        public static final String TILES = "tiles";
+        public static final String X = "x";
+        public static final String Z = "z";
+        public static final String TILE_REGIONS = "regions";
+    }
+
+    // Region-specific tile output directory holding the manifest:
+    private final File tileDir;
+    // The width and height in chunks of each map tile:
+    private final int tileSize;
+    // Settings that must match when reusing saved tiles:
+    private final JsonObject settings;
+    // The state of each recorded region file, mapped by file name:
+    private final Map<String, RegionState> regionStates;
+    // Names of the region files each tile depends on:
+    private final Map<Point, Set<String>> tileRegions;
+}
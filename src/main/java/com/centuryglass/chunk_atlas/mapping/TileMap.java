@@ -7,19 +7,34 @@
 package com.centuryglass.chunk_atlas.mapping;
 
 import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.mapping.images.TileArchive;
+import com.centuryglass.chunk_atlas.mapping.images.TileComposer;
+import com.centuryglass.chunk_atlas.mapping.images.TileWriter;
 import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.AlphaComposite;
 import java.awt.Color;
 import java.awt.Graphics2D;
 import java.awt.Point;
+import java.awt.Rectangle;
 import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
 import java.io.File;
 import java.io.IOException;
+import java.nio.file.Files;
 import java.util.ArrayDeque;
 import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collection;
 import java.util.Deque;
 import java.util.HashMap;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.List;
 import java.util.Map;
+import java.util.Set;
+import java.util.TreeMap;
 import java.util.function.Consumer;
+import java.util.function.LongToIntFunction;
 import java.util.logging.Level;
 import javax.imageio.ImageIO;
 import org.apache.commons.lang.Validate;
@@ -36,11 +51,29 @@ public class TileMap extends WorldMap
 {
     private static final String CLASSNAME = TileMap.class.getName();
     
-    // Usual number of tiles to keep loaded at once:
-    private static final int BASE_TILES_IN_MEMORY = 100;
-    // Maximum number of tiles to keep loaded:
-    private static final int MAX_TILES_IN_MEMORY = 150;
-    // TODO: Use bounds based on current memory use instead of file count.
+    // Name of the directory within the map directory holding zoomed out
+    // tiles:
+    private static final String PYRAMID_DIR_NAME = "zoom";
+    // Name of the archive file within the map directory holding all tiles:
+    private static final String ARCHIVE_NAME = "tiles.archive";
+    
+    /**
+     * Provides the numeric value a map has drawn for each chunk.
+     */
+    public interface ChunkValues
+    {
+        /**
+         * Gets the value drawn for a chunk.
+         * 
+         * @param xPos  The chunk's x-coordinate.
+         * 
+         * @param zPos  The chunk's z-coordinate.
+         * 
+         * @return      The chunk's value, or TilePyramid.NO_VALUE if the
+         *              chunk has no value.
+         */
+        long getValue(int xPos, int zPos);
+    }
     
     /**
      * Sets initial map data on construction.
@@ -60,20 +93,348 @@ public class TileMap extends WorldMap
      */
     public TileMap(File mapDir, String baseName, int tileSize, int[] altSizes,
             int pixelsPerChunk)
+    {
+        this(mapDir, baseName, tileSize, altSizes, pixelsPerChunk, null,
+                System.currentTimeMillis(), null, 0, new MapOptions());
+    }
+    
+    /**
+     * Sets initial map data on construction, applying a set of map options.
+     * 
+     * @param mapDir          The directory where image tiles will be saved.
+     * 
+     * @param baseName        The base string to use when naming image files.
+     * 
+     * @param tileSize        The width and height in chunks of each map tile
+     *                        image.
+     * 
+     * @param altSizes        An optional list of alternate tile sizes to
+     *                        create.
+     * 
+     * @param pixelsPerChunk  The width and height in pixels of each mapped
+     *                        chunk.
+     * 
+     * @param tileWriter      An optional TileWriter used to save finished
+     *                        tiles. If null, tiles will be saved within the
+     *                        calling thread.
+     * 
+     * @param startTime       The time map generation started, in milliseconds
+     *                        since the epoch. Tile images saved after this
+     *                        time will be loaded and updated, older tile
+     *                        images will be replaced.
+     * 
+     * @param sharedCache     An optional cache holding the tiles of several
+     *                        maps with the same tile size. If null, the map
+     *                        creates its own cache using the memory budget.
+     * 
+     * @param cacheLayer      The index of the shared cache layer reserved for
+     *                        this map's tiles. This is ignored if no shared
+     *                        cache is provided.
+     * 
+     * @param options         Options controlling how tiles are held in memory
+     *                        and saved.
+     */
+    public TileMap(File mapDir, String baseName, int tileSize, int[] altSizes,
+            int pixelsPerChunk, TileWriter tileWriter, long startTime,
+            TileCache sharedCache, int cacheLayer, MapOptions options)
     {
         super(mapDir, baseName, pixelsPerChunk);
+        Validate.notNull(options, "Map options cannot be null.");
         ExtendedValidate.couldBeDirectory(mapDir, "Tile output directory");
         ExtendedValidate.notNullOrEmpty(baseName, "Base tile name");
         ExtendedValidate.isPositive(tileSize, "Tile size");
-        initTime = System.currentTimeMillis();
-        mapTiles = new HashMap<>();
-        recentTiles = new ArrayDeque<>();
+        initTime = startTime;
+        TileCache.ColdStorage coldStorage = (tilePt, image) ->
+        {
+            spillTile(tilePt, image);
+        };
+        if (sharedCache == null)
+        {
+            tileCache = new TileCache(options.getTileMemoryBudget(),
+                    coldStorage);
+            tileCache.setOffHeap(options.isOffHeapEnabled());
+            this.cacheLayer = 0;
+        }
+        else
+        {
+            tileCache = sharedCache;
+            this.cacheLayer = cacheLayer;
+            tileCache.setColdStorage(cacheLayer, coldStorage);
+        }
         this.tileSize = tileSize;
-        this.altSizes = altSizes;
+        this.altSizes = (altSizes == null) ? new int[0] : altSizes;
+        this.tileWriter = tileWriter;
+        buildPyramid = options.isPyramidEnabled();
+        changedTileAreas = new HashMap<>();
         if (! mapDir.isDirectory())
         {
             mapDir.mkdirs();
         }
+        tileHashes = options.isContentHashesEnabled()
+                ? new TileHashes(mapDir) : null;
+    }
+    
+    /**
+     * Sets a TileComposer that will receive the pixels of every tile finished
+     * afterwards, so a single-image map can be built without loading saved
+     * tiles again.
+     * 
+     * @param composer  The composer building this map's image, or null to
+     *                  stop passing finished tiles to a composer.
+     */
+    public void setComposer(TileComposer composer)
+    {
+        this.composer = composer;
+    }
+    
+    /**
+     * Sets a GenerationManifest that records every tile file this map saves
+     * or finds to be unchanged afterwards. Once set, lists of saved tiles are
+     * taken from the manifest instead of searching tile directories, so tiles
+     * saved by an earlier run must already be in the manifest, or must be
+     * added with recordSavedTiles.
+     * 
+     * @param manifest  The manifest of the map's region, or null to search
+     *                  tile directories again.
+     * 
+     * @param mapType   The name of the map's type.
+     */
+    public void setGenerationManifest(GenerationManifest manifest,
+            String mapType)
+    {
+        Validate.isTrue(manifest == null || mapType != null,
+                "Map type name cannot be null.");
+        this.manifest = manifest;
+        manifestType = mapType;
+        if (pyramid != null)
+        {
+            pyramid.setManifest(manifest, mapType, tileSize);
+        }
+    }
+    
+    /**
+     * Adds every tile image already saved in this map's tile directories to
+     * its GenerationManifest. This is used when tiles were saved by other
+     * processes, or by an earlier run without a saved manifest. This does
+     * nothing if no manifest was set.
+     */
+    public void recordSavedTiles()
+    {
+        if (manifest == null)
+        {
+            return;
+        }
+        List<Integer> sizes = new ArrayList<>();
+        sizes.add(tileSize);
+        for (int size : altSizes)
+        {
+            sizes.add(size);
+        }
+        for (int size : sizes)
+        {
+            findTileFiles(getTileSizeDir(size)).forEach((tilePt, tileFile) ->
+            {
+                manifest.record(manifestType, 0, size, tilePt.x, tilePt.y,
+                        tileFile);
+            });
+        }
+        // Zoom level tiles are saved as "level/x/z.png":
+        File[] levelDirs = new File(getMapDir(), PYRAMID_DIR_NAME)
+                .listFiles();
+        if (levelDirs == null)
+        {
+            return;
+        }
+        for (File levelDir : levelDirs)
+        {
+            File[] columnDirs = levelDir.listFiles();
+            if (columnDirs == null)
+            {
+                continue;
+            }
+            for (File columnDir : columnDirs)
+            {
+                File[] tileFiles = columnDir.listFiles();
+                if (tileFiles == null)
+                {
+                    continue;
+                }
+                for (File tileFile : tileFiles)
+                {
+                    final String name = tileFile.getName();
+                    if (! name.endsWith(".png") || ! tileFile.isFile())
+                    {
+                        continue;
+                    }
+                    try
+                    {
+                        final int level = Integer.parseInt(
+                                levelDir.getName());
+                        final int chunkSize = tileSize << level;
+                        manifest.record(manifestType, level, tileSize,
+                                Integer.parseInt(columnDir.getName())
+                                * chunkSize,
+                                Integer.parseInt(name.substring(0,
+                                name.length() - 4)) * chunkSize, tileFile);
+                    }
+                    catch (NumberFormatException e)
+                    {
+                        // Not a zoom level tile, ignore it.
+                    }
+                }
+            }
+        }
+    }
+    
+    /**
+     * Builds zoom level tiles from the values used to color each chunk instead
+     * of downsampling tile colors. Each zoomed out chunk area is drawn with
+     * the color of its greatest value, so areas with high values don't fade
+     * into their surroundings. This has no effect if zoom level tiles aren't
+     * being created, and must be called before any tiles are finished.
+     * 
+     * @param values       The source of every drawn chunk's value.
+     * 
+     * @param valueColors  A function that selects the ARGB color drawn for
+     *                     each value.
+     */
+    public void setPyramidValues(ChunkValues values,
+            LongToIntFunction valueColors)
+    {
+        Validate.notNull(values, "Chunk values cannot be null.");
+        Validate.notNull(valueColors, "Value color function cannot be null.");
+        pyramidValues = values;
+        pyramidValueColors = valueColors;
+        if (pyramid != null)
+        {
+            pyramid.setValueColors(tileSize, valueColors);
+        }
+    }
+    
+    /**
+     * Adds any saved tiles the TileComposer didn't receive, then saves its
+     * image and removes it from the map. This does nothing if no composer
+     * was set, and should only be called after the map is saved.
+     */
+    public void finishComposer()
+    {
+        final String FN_NAME = "finishComposer";
+        if (composer == null)
+        {
+            return;
+        }
+        try
+        {
+            if (manifest != null)
+            {
+                composer.addSavedTiles(getSavedTileFiles().values());
+            }
+            else
+            {
+                composer.addSavedTiles(getTileSizeDir(tileSize));
+            }
+            composer.finish();
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Failed to save map image '{0}': {1}",
+                    new Object[] { composer.getOutFile(), e });
+        }
+        composer = null;
+    }
+    
+    /**
+     * Sets the tiles that will be finished while creating this map, so that
+     * zoomed out tiles can be saved as soon as all the tiles they cover are
+     * finished. Finished tiles already saved since the map's start time are
+     * added to the zoomed out tiles immediately. This has no effect if zoom
+     * level tiles aren't being created.
+     * 
+     * @param tilePoints  The upper left chunk coordinates of all tiles that
+     *                    will be drawn and finished.
+     */
+    public void expectTiles(Collection<Point> tilePoints)
+    {
+        Validate.notNull(tilePoints, "Tile points cannot be null.");
+        TilePyramid pyramid = getPyramid();
+        if (pyramid == null)
+        {
+            return;
+        }
+        Set<Point> tileIndices = new HashSet<>();
+        tilePoints.forEach((tilePt) -> tileIndices.add(getTileIndex(tilePt)));
+        pyramid.expectTiles(tileIndices);
+        addSavedTilesToPyramid(findSavedTiles(tileIndices));
+    }
+    
+    /**
+     * Reuses tiles saved by an earlier run, redrawing only the areas that
+     * changed. Saved tiles overlapping a changed area are loaded instead of
+     * being replaced, with the changed area cleared so it can be drawn again.
+     * Tiles never loaded while drawing are updated when the map is saved, so
+     * areas that no longer hold any chunks are cleared. If zoom level tiles
+     * are being created, only those covering changed areas are rebuilt.
+     * 
+     *  This should be called before any chunks are drawn.
+     * 
+     * @param changedAreas  The chunk coordinate bounds of every area that will
+     *                      be redrawn.
+     */
+    public void updateSavedTiles(Collection<Rectangle> changedAreas)
+    {
+        Validate.notNull(changedAreas, "Changed areas cannot be null.");
+        for (Rectangle area : changedAreas)
+        {
+            final Point firstTile = getTilePoint(area.x, area.y);
+            for (int z = firstTile.y; z < area.y + area.height; z += tileSize)
+            {
+                for (int x = firstTile.x; x < area.x + area.width;
+                        x += tileSize)
+                {
+                    final Point tilePt = new Point(x, z);
+                    List<Rectangle> tileAreas = changedTileAreas.get(tilePt);
+                    if (tileAreas == null)
+                    {
+                        tileAreas = new ArrayList<>();
+                        changedTileAreas.put(tilePt, tileAreas);
+                    }
+                    tileAreas.add(area.intersection(new Rectangle(x, z,
+                            tileSize, tileSize)));
+                }
+            }
+        }
+        TilePyramid pyramid = getPyramid();
+        if (pyramid == null)
+        {
+            return;
+        }
+        Set<Point> changedIndices = new HashSet<>();
+        changedTileAreas.keySet().forEach((tilePt) ->
+        {
+            changedIndices.add(getTileIndex(tilePt));
+        });
+        Set<Point> unchangedIndices = new HashSet<>(
+                getSavedTileFiles().keySet());
+        unchangedIndices.removeAll(changedIndices);
+        pyramid.setUnchangedTiles(unchangedIndices, (tileIndex) ->
+        {
+            return getTileFile(new Point(tileIndex.x * tileSize,
+                    tileIndex.y * tileSize));
+        });
+        pyramid.expectTiles(changedIndices);
+    }
+    
+    /**
+     * Gets usage statistics for the map's tile cache. If the cache is shared
+     * with other maps, this includes all of their tiles.
+     * 
+     * @return  The number of cache hits, misses, and evictions, and the
+     *          memory used by cached tiles.
+     */
+    public TileCache.Stats getCacheStats()
+    {
+        return tileCache.getStats();
     }
     
     /**
@@ -89,36 +450,122 @@ public class TileMap extends WorldMap
     @Override
     public Color getChunkColor(int xPos, int zPos)
     {        
-        TilePixelData chunkData = getChunkPixelData(xPos, zPos);
-        return new Color(chunkData.tile.getRGB(chunkData.pixelCoords.x,
-                chunkData.pixelCoords.y));
+        return new Color(getChunkRGB(xPos, zPos));
     }   
     
     /**
-     * Sets the color of a specific chunk.
+     * Gets the packed ARGB color applied to a specific chunk, loading or
+     * creating its tile if necessary.
+     *
+     * @param xPos  The chunk's x-coordinate.
+     *
+     * @param zPos  The chunk's z-coordinate.
+     *
+     * @return      The chunk's color as an ARGB integer.
+     */
+    @Override
+    public int getChunkRGB(int xPos, int zPos)
+    {
+        final int chunkSize = getChunkSize();
+        final int tileX = xPos - Math.floorMod(xPos, tileSize);
+        final int tileZ = zPos - Math.floorMod(zPos, tileSize);
+        final int[] pixels = getTilePixels(tileX, tileZ);
+        return pixels[(zPos - tileZ) * chunkSize * tileSize * chunkSize
+                + (xPos - tileX) * chunkSize];
+    }
+    
+    /**
+     * Sets every pixel of a specific chunk to a packed ARGB color, writing
+     * directly to the tile image's pixel array.
      *
-     * @param xPos   The chunk's x-coordinate.
+     * @param xPos  The chunk's x-coordinate.
      *
-     * @param zPos   The chunk's z-coordinate.
+     * @param zPos  The chunk's z-coordinate.
      *
-     * @param color  The color value to apply.
+     * @param argb  The color value to apply, as an ARGB integer.
      */
     @Override
-    public void setChunkColor(int xPos, int zPos, Color color)
+    public void setChunkRGB(int xPos, int zPos, int argb)
     {
-        Validate.notNull(color, "Color cannot be null.");
-        TilePixelData chunkData = getChunkPixelData(xPos, zPos);
-        chunkData.tile.setRGB(chunkData.pixelCoords.x, chunkData.pixelCoords.y,
-                color.getRGB());
+        final int chunkSize = getChunkSize();
+        final int tilePxSize = tileSize * chunkSize;
+        final int tileX = xPos - Math.floorMod(xPos, tileSize);
+        final int tileZ = zPos - Math.floorMod(zPos, tileSize);
+        final int[] pixels = getTilePixels(tileX, tileZ);
+        int rowStart = (zPos - tileZ) * chunkSize * tilePxSize
+                + (xPos - tileX) * chunkSize;
+        for (int y = 0; y < chunkSize; y++)
+        {
+            for (int i = rowStart; i < (rowStart + chunkSize); i++)
+            {
+                pixels[i] = argb;
+            }
+            rowStart += tilePxSize;
+        }
     }
     
     /**
-     * Gets the list of all files used to hold map data.
+     * Gets the list of all files used to hold map data. If a
+     * GenerationManifest was set, this holds the full detail tiles it
+     * recorded, otherwise tile size directories are searched.
      * 
      * @return  The list of map image files. 
      */
     @Override
     public ArrayList<File> getMapFiles()
+    {
+        final ArrayList<File> files = new ArrayList<>();
+        for (GenerationManifest.Entry entry : getTileEntries())
+        {
+            if (entry.zoom == 0)
+            {
+                files.add(entry.file);
+            }
+        }
+        return files;
+    }
+    
+    /**
+     * Gets a manifest entry for every tile file saved by this map, holding
+     * each tile's size, zoom level, and coordinates. If a GenerationManifest
+     * was set, this holds every tile it recorded for this map, otherwise
+     * full detail tiles are found by searching tile size directories.
+     * 
+     * @return  A new list of tile entries, in no particular order.
+     */
+    public List<GenerationManifest.Entry> getTileEntries()
+    {
+        if (manifest != null)
+        {
+            return manifest.getEntries(manifestType);
+        }
+        final GenerationManifest found = new GenerationManifest(getMapDir(),
+                getFileName());
+        final String typeName = getMapDir().getName();
+        List<Integer> sizes = new ArrayList<>();
+        sizes.add(tileSize);
+        for (int size : altSizes)
+        {
+            sizes.add(size);
+        }
+        for (int size : sizes)
+        {
+            findTileFiles(getTileSizeDir(size)).forEach((tilePt, tileFile) ->
+            {
+                found.record(typeName, 0, size, tilePt.x, tilePt.y,
+                        tileFile);
+            });
+        }
+        return found.getEntries();
+    }
+    
+    /**
+     * Finds every file within the map's tile size directories.
+     * 
+     * @return  All files found in the main and alternate tile size
+     *          directories.
+     */
+    private ArrayList<File> listTileDirFiles()
     {
         final ArrayList<File> files = new ArrayList<>();
         Deque<File> mapDirs = new ArrayDeque<>();
@@ -162,26 +609,6 @@ public class TileMap extends WorldMap
         }
     }
     
-    /**
-     * Gets all data needed to get or set the upper-left image pixel mapped to
-     * a specific Minecraft chunk.
-     * 
-     * @param xPos          The chunk's x-coordinate.
-     * 
-     * @param zPos          The chunk's z-coordinate.
-     * 
-     * @return              TilePixelData holding the requested chunk's image
-     *                      object and image pixel coordinates.
-     */
-    private TilePixelData getChunkPixelData(int xPos, int zPos)
-    {
-        final int chunkSize = getChunkSize();
-        final Point tilePt = getTilePoint(xPos, zPos);
-        return new TilePixelData(getTileImage(tilePt), new Point(
-                (xPos - tilePt.x) * chunkSize,
-                (zPos - tilePt.y) * chunkSize));
-    }
-    
     /**
      * Gets all data needed to get or set a pixel at a specific offset from a
      * Minecraft map chunk.
@@ -291,6 +718,7 @@ public class TileMap extends WorldMap
     @Override
     protected void saveMapData(File mapDir, String baseName)
     {
+        final String FN_NAME = "saveMapData";
         ExtendedValidate.couldBeDirectory(mapDir, "Map tile output directory");
         Validate.notNull(baseName, "Base tile image name cannot be null.");
         Validate.notEmpty(baseName, "Base image name cannot be empty.");
@@ -299,87 +727,527 @@ public class TileMap extends WorldMap
             Validate.isTrue(mapDir.mkdirs(),
                     "Couldn't create map tile output directory");
         }
-        while (! mapTiles.isEmpty())
+        LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                "Tile cache for {0}: {1}", new Object[] { getMapDir(),
+                tileCache.getStats() });
+        // Clear changed areas from saved tiles that weren't drawn over:
+        for (Point tilePt : new ArrayList<>(changedTileAreas.keySet()))
+        {
+            if (getTileFile(tilePt).isFile())
+            {
+                getTileImage(tilePt);
+            }
+            changedTileAreas.remove(tilePt);
+        }
+        TilePyramid pyramid = getPyramid();
+        Map<Point, File> savedTiles = null;
+        if (pyramid != null)
+        {
+            List<Point> heldTiles = new ArrayList<>(
+                    tileCache.getTilePoints(cacheLayer));
+            if (spillFile != null)
+            {
+                heldTiles.addAll(spillFile.getTilePoints());
+            }
+            Set<Point> tileIndices = new HashSet<>();
+            heldTiles.forEach((tilePt) ->
+            {
+                tileIndices.add(getTileIndex(tilePt));
+            });
+            // Include finished tiles saved by other processes or earlier
+            // runs, expecting them before any zoomed out tile is saved:
+            savedTiles = findSavedTiles(tileIndices);
+            tileIndices.addAll(savedTiles.keySet());
+            pyramid.expectTiles(tileIndices);
+        }
+        for (Point tilePt : tileCache.getTilePoints(cacheLayer))
+        {
+            saveTileToDisk(tilePt, true);
+        }
+        if (spillFile != null)
+        {
+            for (Point tilePt : spillFile.getTilePoints())
+            {
+                saveTileToDisk(tilePt, true);
+            }
+            spillFile.close();
+            spillFile = null;
+        }
+        if (pyramid != null)
         {
-            Point tilePt = mapTiles.keySet().iterator().next();
-            saveTileToDisk(tilePt);
+            addSavedTilesToPyramid(savedTiles);
+            pyramid.finish();
         }
+        saveTileHashes();
     }
     
     /**
-     * Saves a buffered tile image to the disk, creates scaled images, and
-     * removes the buffered image from memory.
-     * 
-     * @param tilePt  The coordinates of a buffered tile image. If no such
-     *                image exists, files will not be saved.
+     * Saves every tile image held in memory without unloading it, so that all
+     * saved tiles are up to date.
      */
-    private void saveTileToDisk(Point tilePt)
+    public void flushToDisk()
     {
-        final String FN_NAME = "saveTileToDisk";
-        Validate.notNull(tilePt, "Tile point cannot be null.");
-        BufferedImage tileImage = mapTiles.get(tilePt);
-        mapTiles.remove(tilePt);
-        if (tileImage == null)
+        tileCache.forEachTile(cacheLayer, (tilePt, image) ->
         {
-            return;
-        }
-        File imageFile = getTileFile(tilePt);
-        try
+            File imageFile = getTileFile(tilePt);
+            Map<Integer, File> scaledFiles = getScaledTileFiles(imageFile);
+            TileWriter.writeTile(image, imageFile, scaledFiles,
+                    getPngEncoder());
+            recordTile(tilePt, imageFile, scaledFiles);
+        });
+        if (spillFile != null)
         {
-            ImageIO.write(tileImage, "png", imageFile);
-            // Also create alternate tile sizes:
-            for (int size : altSizes)
+            for (Point tilePt : spillFile.getTilePoints())
             {
-                File resizedDir = getTileSizeDir(size);
-                BufferedImage resizedImage = new BufferedImage(size,
-                        size, BufferedImage.TYPE_INT_ARGB);
-                Graphics2D graphics = resizedImage.createGraphics();
-                graphics.drawImage(tileImage, 0, 0, size, size, null);
-                ImageIO.write(resizedImage, "png", new File(resizedDir,
-                        imageFile.getName()));
+                BufferedImage image = spillFile.read(tilePt);
+                if (image != null)
+                {
+                    File imageFile = getTileFile(tilePt);
+                    Map<Integer, File> scaledFiles
+                            = getScaledTileFiles(imageFile);
+                    TileWriter.writeTile(image, imageFile, scaledFiles,
+                            getPngEncoder());
+                    recordTile(tilePt, imageFile, scaledFiles);
+                }
             }
         }
-        catch (IOException e)
-        {
-            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
-                    "Failed to save tile '{0}' to disk: {1}",
-                    new Object[] { imageFile, e });
-        } 
-        
+        saveTileHashes();
     }
-        
+    
     /**
-     * Gets the upper left chunk coordinate of a chunk's tile image.
-     * 
-     * @param xPos      The chunk's x-coordinate.
-     * 
-     * @param zPos      The chunk's z-coordinate.
-     * 
-     * @param tileSize  The size in chunks of each map tile.
+     * Deletes all saved tile images older than the map's start time, except
+     * for tiles found to be unchanged since then. Once all tiles are saved,
+     * this removes any preview tiles or tiles from earlier runs that were
+     * never replaced with current map data. Stale tiles are never recorded
+     * in a GenerationManifest, so tile directories are always searched.
      * 
-     * @return          The corresponding tile coordinate.
+     * @return  The number of image files deleted.
      */
-    public static Point getTilePoint(int xPos, int zPos, int tileSize)
+    public int removeStaleTiles()
     {
-        ExtendedValidate.isPositive(tileSize, "Tile size");
-        int [] offsets = { xPos, zPos };
-        for (int i = 0; i < 2; i++)
+        int deleted = 0;
+        List<File> tileFiles = listTileDirFiles();
+        // Also remove zoom level tiles that weren't replaced:
+        Deque<File> pyramidDirs = new ArrayDeque<>();
+        pyramidDirs.push(new File(getMapDir(), PYRAMID_DIR_NAME));
+        while (! pyramidDirs.isEmpty())
         {
-            offsets[i] = offsets[i] % tileSize;
-            if (offsets[i] < 0)
+            File[] childFiles = pyramidDirs.pop().listFiles();
+            if (childFiles == null)
             {
-                offsets[i] += tileSize;
+                continue;
+            }
+            for (File child : childFiles)
+            {
+                if (child.isDirectory())
+                {
+                    pyramidDirs.push(child);
+                }
+                else
+                {
+                    tileFiles.add(child);
+                }
             }
         }
-        return new Point(xPos - offsets[0], zPos - offsets[1]);
+        for (File tileFile : tileFiles)
+        {
+            if (tileFile.getName().endsWith(".png")
+                    && tileFile.lastModified() < initTime
+                    && ! isVerifiedTile(tileFile) && tileFile.delete())
+            {
+                if (manifest != null)
+                {
+                    manifest.remove(tileFile);
+                }
+                deleted++;
+            }
+        }
+        return deleted;
     }
     
     /**
-     * Gets the upper left chunk coordinate of a chunk's tile image.
+     * Copies every tile recorded in the map's GenerationManifest into the
+     * tile archive within the map directory, and removes archived tiles that
+     * are no longer recorded. Tiles identical to their archived data aren't
+     * written again. This does nothing if no manifest was set, and should
+     * only be called once the map is saved.
      * 
-     * @param xPos  The chunk's x-coordinate.
+     * @param removeFiles  Whether tile image files should be deleted once
+     *                     they are archived.
      * 
-     * @param zPos  The chunk's z-coordinate.
+     * @return             The number of tiles added to the archive or
+     *                     replaced within it.
+     */
+    public int archiveTiles(boolean removeFiles)
+    {
+        final String FN_NAME = "archiveTiles";
+        if (manifest == null)
+        {
+            return 0;
+        }
+        if (tileWriter != null)
+        {
+            tileWriter.awaitCompletion();
+        }
+        final File archiveFile = new File(getMapDir(), ARCHIVE_NAME);
+        List<File> archivedFiles = new ArrayList<>();
+        int written = 0;
+        try (TileArchive archive = new TileArchive(archiveFile, tileSize))
+        {
+            Set<TileArchive.Entry> recorded = new HashSet<>();
+            for (GenerationManifest.Entry entry
+                    : manifest.getEntries(manifestType))
+            {
+                TileArchive.Entry archiveEntry;
+                if (entry.zoom == 0)
+                {
+                    archiveEntry = new TileArchive.Entry(entry.size, 0,
+                            entry.x, entry.z);
+                }
+                else
+                {
+                    final int chunkSize = tileSize << entry.zoom;
+                    archiveEntry = new TileArchive.Entry(tileSize,
+                            entry.zoom, Math.floorDiv(entry.x, chunkSize),
+                            Math.floorDiv(entry.z, chunkSize));
+                }
+                recorded.add(archiveEntry);
+                // Files already removed are kept as they were archived:
+                if (! entry.file.isFile())
+                {
+                    continue;
+                }
+                final byte[] data = Files.readAllBytes(entry.file.toPath());
+                if (archive.write(archiveEntry, data, data.length))
+                {
+                    written++;
+                }
+                archivedFiles.add(entry.file);
+            }
+            for (TileArchive.Entry archiveEntry : archive.getEntries())
+            {
+                if (! recorded.contains(archiveEntry))
+                {
+                    archive.remove(archiveEntry);
+                }
+            }
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Failed to archive tiles in '{0}': {1}",
+                    new Object[] { archiveFile, e });
+            return written;
+        }
+        if (removeFiles)
+        {
+            archivedFiles.forEach((file) -> file.delete());
+        }
+        return written;
+    }
+    
+    /**
+     * Reads a tile image from the archive of the map directory where it would
+     * have been saved, so tiles can be used after their image files are
+     * removed.
+     * 
+     * @param tileFile      The file where the tile image would be saved.
+     * 
+     * @param archives      Archives opened by earlier calls, mapped by
+     *                      archive file. Any archive opened to find the tile
+     *                      is added, and must be closed by the caller.
+     * 
+     * @return              The tile's PNG data, or null if the file isn't a
+     *                      tile image path or the tile isn't archived.
+     * 
+     * @throws IOException  If the archive couldn't be read.
+     */
+    public static byte[] readArchivedTile(File tileFile,
+            Map<File, TileArchive> archives) throws IOException
+    {
+        Validate.notNull(tileFile, "Tile file cannot be null.");
+        Validate.notNull(archives, "Archive map cannot be null.");
+        final String name = tileFile.getName();
+        final File parent = tileFile.getParentFile();
+        final File grandparent = (parent == null) ? null
+                : parent.getParentFile();
+        if (grandparent == null || ! name.endsWith(".png"))
+        {
+            return null;
+        }
+        final String[] nameParts = name.substring(0, name.length() - 4)
+                .split("\\.");
+        // Zoom level tiles are saved as "mapDir/zoom/level/x/z.png", and full
+        // detail tiles as "mapDir/size/baseName.x.z.png":
+        final File pyramidDir = grandparent.getParentFile();
+        final boolean zoomTile = nameParts.length == 1 && pyramidDir != null
+                && pyramidDir.getName().equals(PYRAMID_DIR_NAME);
+        final File mapDir = zoomTile ? pyramidDir.getParentFile()
+                : grandparent;
+        if (mapDir == null || (! zoomTile && nameParts.length < 3))
+        {
+            return null;
+        }
+        final File archiveFile = new File(mapDir, ARCHIVE_NAME);
+        TileArchive archive = archives.get(archiveFile);
+        if (archive == null)
+        {
+            if (! archiveFile.isFile())
+            {
+                return null;
+            }
+            archive = new TileArchive(archiveFile);
+            archives.put(archiveFile, archive);
+        }
+        try
+        {
+            if (zoomTile)
+            {
+                return archive.read(new TileArchive.Entry(
+                        archive.getTileSize(),
+                        Integer.parseInt(grandparent.getName()),
+                        Integer.parseInt(parent.getName()),
+                        Integer.parseInt(nameParts[0])));
+            }
+            return archive.read(new TileArchive.Entry(
+                    Integer.parseInt(parent.getName()), 0,
+                    Integer.parseInt(nameParts[nameParts.length - 2]),
+                    Integer.parseInt(nameParts[nameParts.length - 1])));
+        }
+        catch (NumberFormatException e)
+        {
+            return null;
+        }
+    }
+    
+    /**
+     * Marks a tile as complete, immediately saving it and removing it from
+     * memory. This should only be called once no more chunks will be drawn
+     * within the tile.
+     * 
+     * @param tilePt  The upper left chunk coordinate of the finished tile.
+     */
+    public void finishTile(Point tilePt)
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        if (tileCache.contains(tilePt, cacheLayer)
+                || (spillFile != null && spillFile.contains(tilePt)))
+        {
+            saveTileToDisk(tilePt, true);
+            return;
+        }
+        // If the tile was already offloaded, its saved files are final:
+        File imageFile = getTileFile(tilePt);
+        if (tileWriter != null && imageFile.isFile()
+                && imageFile.lastModified() >= initTime)
+        {
+            tileWriter.announceSaved(imageFile, getScaledTileFiles(imageFile));
+        }
+    }
+    
+    /**
+     * Saves a buffered or spilled tile image to the disk, creates scaled
+     * images, and removes the tile from memory and the spill file.
+     * 
+     * @param tilePt    The coordinates of a buffered tile image. If no such
+     *                  image exists, files will not be saved.
+     * 
+     * @param finished  Whether the tile is complete. Finished tiles are passed
+     *                  to the TileWriter if one exists, while unfinished tiles
+     *                  are always saved immediately so they can be reloaded.
+     */
+    private void saveTileToDisk(Point tilePt, boolean finished)
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        BufferedImage tileImage = tileCache.remove(tilePt, cacheLayer);
+        lastTilePixels = null;
+        if (tileImage == null && spillFile != null)
+        {
+            tileImage = spillFile.remove(tilePt);
+        }
+        if (tileImage != null)
+        {
+            saveTileImage(tilePt, tileImage, finished);
+        }
+    }
+    
+    /**
+     * Saves a tile image to the disk and creates scaled images. If tile
+     * hashes are kept, finished tiles are skipped if they are empty or
+     * identical to their saved images.
+     * 
+     * @param tilePt     The coordinates of the tile.
+     * 
+     * @param tileImage  The tile image to save.
+     * 
+     * @param finished   Whether the tile is complete. Finished tiles are
+     *                   passed to the TileWriter if one exists, while
+     *                   unfinished tiles are always saved immediately so they
+     *                   can be reloaded.
+     */
+    private void saveTileImage(Point tilePt, BufferedImage tileImage,
+            boolean finished)
+    {
+        File imageFile = getTileFile(tilePt);
+        Map<Integer, File> scaledFiles = getScaledTileFiles(imageFile);
+        final int[] pixels = ((DataBufferInt) tileImage.getRaster()
+                .getDataBuffer()).getData();
+        if (finished)
+        {
+            addToPyramid(tilePt, pixels);
+        }
+        if (finished && composer != null)
+        {
+            composer.addTile(tilePt, pixels);
+        }
+        if (finished && tileHashes != null)
+        {
+            if (TileHashes.isEmpty(pixels))
+            {
+                // Remove empty tiles instead of saving them:
+                tileHashes.remove(imageFile);
+                imageFile.delete();
+                scaledFiles.values().forEach((file) -> file.delete());
+                if (manifest != null)
+                {
+                    manifest.remove(imageFile);
+                    scaledFiles.values().forEach((file) ->
+                    {
+                        manifest.remove(file);
+                    });
+                }
+                return;
+            }
+            final long hash = TileHashes.hashPixels(pixels);
+            if (scaledFiles.values().stream().allMatch((file) -> file.isFile())
+                    && tileHashes.checkUnchanged(imageFile, hash))
+            {
+                recordTile(tilePt, imageFile, scaledFiles);
+                return;
+            }
+            tileHashes.recordWrite(imageFile, hash);
+        }
+        recordTile(tilePt, imageFile, scaledFiles);
+        if (finished && tileWriter != null)
+        {
+            tileWriter.submit(tileImage, imageFile, scaledFiles,
+                    getPngEncoder());
+        }
+        else
+        {
+            TileWriter.writeTile(tileImage, imageFile, scaledFiles,
+                    getPngEncoder());
+        }
+    }
+    
+    /**
+     * Moves an unfinished tile evicted from memory into the spill file,
+     * creating the spill file if necessary. If the spill file can't be used,
+     * the tile image is saved to the disk instead.
+     * 
+     * @param tilePt  The coordinates of the evicted tile.
+     * 
+     * @param image   The evicted tile image.
+     */
+    private void spillTile(Point tilePt, BufferedImage image)
+    {
+        final String FN_NAME = "spillTile";
+        try
+        {
+            if (spillFile == null)
+            {
+                spillFile = new TileSpillFile(getMapDir(), getFileName(),
+                        tileSize * getChunkSize());
+            }
+            spillFile.store(tilePt, image);
+            return;
+        }
+        catch (IOException | IllegalArgumentException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Couldn't spill tile to scratch file, saving as an image"
+                    + " instead: {0}", e);
+        }
+        saveTileImage(tilePt, image, false);
+    }
+    
+    /**
+     * Adds a tile's saved image files to the GenerationManifest, if one was
+     * set.
+     * 
+     * @param tilePt       The upper left chunk coordinate of the tile.
+     * 
+     * @param imageFile    The file holding the full-size tile image.
+     * 
+     * @param scaledFiles  Each alternate tile size, mapped to the file
+     *                     holding that scaled copy of the tile.
+     */
+    private void recordTile(Point tilePt, File imageFile,
+            Map<Integer, File> scaledFiles)
+    {
+        if (manifest == null)
+        {
+            return;
+        }
+        manifest.record(manifestType, 0, tileSize, tilePt.x, tilePt.y,
+                imageFile);
+        scaledFiles.forEach((size, file) ->
+        {
+            manifest.record(manifestType, 0, size, tilePt.x, tilePt.y, file);
+        });
+    }
+    
+    /**
+     * Gets the files where scaled copies of a tile image will be saved.
+     * 
+     * @param imageFile  The file where the full-size tile image is saved.
+     * 
+     * @return           Each alternate tile size, mapped to the file where
+     *                   that tile size will be saved.
+     */
+    private Map<Integer, File> getScaledTileFiles(File imageFile)
+    {
+        Map<Integer, File> scaledFiles = new LinkedHashMap<>();
+        for (int size : altSizes)
+        {
+            scaledFiles.put(size, new File(getTileSizeDir(size),
+                    imageFile.getName()));
+        }
+        return scaledFiles;
+    }
+        
+    /**
+     * Gets the upper left chunk coordinate of a chunk's tile image.
+     * 
+     * @param xPos      The chunk's x-coordinate.
+     * 
+     * @param zPos      The chunk's z-coordinate.
+     * 
+     * @param tileSize  The size in chunks of each map tile.
+     * 
+     * @return          The corresponding tile coordinate.
+     */
+    public static Point getTilePoint(int xPos, int zPos, int tileSize)
+    {
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        int [] offsets = { xPos, zPos };
+        for (int i = 0; i < 2; i++)
+        {
+            offsets[i] = offsets[i] % tileSize;
+            if (offsets[i] < 0)
+            {
+                offsets[i] += tileSize;
+            }
+        }
+        return new Point(xPos - offsets[0], zPos - offsets[1]);
+    }
+    
+    /**
+     * Gets the upper left chunk coordinate of a chunk's tile image.
+     * 
+     * @param xPos  The chunk's x-coordinate.
+     * 
+     * @param zPos  The chunk's z-coordinate.
      * 
      * @return      The corresponding tile coordinate.
      */
@@ -398,47 +1266,414 @@ public class TileMap extends WorldMap
      */
     private BufferedImage getTileImage(Point tilePt)
     {
-        final String FN_NAME = "getTileImage";
         Validate.notNull(tilePt, "Chunk coordinate cannot be null.");
-        BufferedImage tileImage = mapTiles.get(tilePt);
+        // Loading or decompressing a tile may compress the cached pixel
+        // array's tile:
+        lastTilePixels = null;
+        BufferedImage tileImage = tileCache.get(tilePt, cacheLayer);
         if (tileImage != null)
         {
             return tileImage;
         }
-        // Check if tile was created and offloaded to disk:
+        // Check if the tile was evicted to the spill file:
+        if (spillFile != null)
+        {
+            tileImage = spillFile.remove(tilePt);
+        }
+        // Check if tile was created and saved to disk by an earlier run:
         File tileFile = getTileFile(tilePt);
-        if (tileFile.isFile() && tileFile.lastModified() > initTime)
+        if (tileImage == null && tileFile.isFile()
+                && (tileFile.lastModified() > initTime
+                || isVerifiedTile(tileFile)))
         {
-            try
-            {
-                tileImage = ImageIO.read(tileFile);
-            }
-            catch (IOException e)
+            tileImage = loadTileFile(tileFile);
+        }
+        // Check if the tile was saved by an earlier run and only partially
+        // changed:
+        if (tileImage == null && ! changedTileAreas.isEmpty())
+        {
+            List<Rectangle> changedAreas = changedTileAreas.remove(tilePt);
+            if (changedAreas != null && tileFile.isFile())
             {
-                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
-                        "Opening tile image '{0}' failed, tile data may be"
-                        + " lost.", tileFile);
+                tileImage = loadTileFile(tileFile);
+                if (tileImage != null)
+                {
+                    clearAreas(tilePt, tileImage, changedAreas);
+                }
             }
         }
         if (tileImage == null)
         {
             final int imageSize = tileSize * getChunkSize();
             // No existing file found, create new image data:
-            tileImage = new BufferedImage(imageSize, imageSize,
-                    BufferedImage.TYPE_INT_ARGB);
+            tileImage = tileCache.createImage(imageSize, imageSize);
         }
-        mapTiles.put(tilePt, tileImage);
-        recentTiles.push(tilePt);
-        if (recentTiles.size() > MAX_TILES_IN_MEMORY)
+        // Adding the tile may compress or offload older tiles:
+        tileCache.put(tilePt, cacheLayer, tileImage);
+        return tileImage;
+    }
+    
+    /**
+     * Gets the pixel array of the tile image holding a chunk, loading or
+     * creating the tile if necessary. The most recently used array is cached,
+     * so repeated calls within the same tile don't need a map lookup. The
+     * cached array is discarded whenever the tile cache compresses or removes
+     * any image, as it might have been the cached array's tile.
+     * 
+     * @param tileX  The x-coordinate of the tile's upper left chunk.
+     * 
+     * @param tileZ  The z-coordinate of the tile's upper left chunk.
+     * 
+     * @return       The tile's ARGB pixel data, stored in row-major order.
+     */
+    private int[] getTilePixels(int tileX, int tileZ)
+    {
+        if (lastTilePixels != null && tileX == lastTileX
+                && tileZ == lastTileZ
+                && tileCache.getHotChanges() == lastTileChanges)
         {
-            while (recentTiles.size() > BASE_TILES_IN_MEMORY)
+            return lastTilePixels;
+        }
+        tileLookupPt.setLocation(tileX, tileZ);
+        BufferedImage tileImage = getTileImage(tileLookupPt);
+        lastTileX = tileX;
+        lastTileZ = tileZ;
+        lastTilePixels = ((DataBufferInt) tileImage.getRaster()
+                .getDataBuffer()).getData();
+        lastTileChanges = tileCache.getHotChanges();
+        return lastTilePixels;
+    }
+    
+    /**
+     * Clears areas within a tile image, making them fully transparent.
+     * 
+     * @param tilePt     The upper left chunk coordinate of the tile.
+     * 
+     * @param tileImage  The tile's TYPE_INT_ARGB image.
+     * 
+     * @param areas      The chunk coordinate bounds of each area to clear,
+     *                   all within the tile.
+     */
+    private void clearAreas(Point tilePt, BufferedImage tileImage,
+            List<Rectangle> areas)
+    {
+        final int chunkSize = getChunkSize();
+        final int tilePxSize = tileSize * chunkSize;
+        final int[] pixels = ((DataBufferInt) tileImage.getRaster()
+                .getDataBuffer()).getData();
+        for (Rectangle area : areas)
+        {
+            final int left = (area.x - tilePt.x) * chunkSize;
+            final int right = left + area.width * chunkSize;
+            final int top = (area.y - tilePt.y) * chunkSize;
+            final int bottom = top + area.height * chunkSize;
+            for (int y = top; y < bottom; y++)
             {
-                // Offload oldest tile from memory to disk:
-                Point toRemove = recentTiles.removeLast();
-                saveTileToDisk(toRemove);
+                Arrays.fill(pixels, y * tilePxSize + left,
+                        y * tilePxSize + right, 0);
             }
         }
-        return tileImage;
+    }
+    
+    /**
+     * Loads a saved tile image as a TYPE_INT_ARGB image.
+     * 
+     * @param tileFile  A saved tile image file.
+     * 
+     * @return          The loaded tile image, or null if loading failed.
+     */
+    static BufferedImage loadTileFile(File tileFile)
+    {
+        final String FN_NAME = "loadTileFile";
+        try
+        {
+            BufferedImage tileImage = ImageIO.read(tileFile);
+            if (tileImage != null && tileImage.getType()
+                    != BufferedImage.TYPE_INT_ARGB)
+            {
+                tileImage = toIntARGB(tileImage);
+            }
+            return tileImage;
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Opening tile image '{0}' failed, tile data may be"
+                    + " lost.", tileFile);
+        }
+        return null;
+    }
+    
+    /**
+     * Gets the map's zoom level tile pyramid, creating it if necessary.
+     * 
+     * @return  The tile pyramid, or null if this map doesn't create zoom
+     *          level tiles.
+     */
+    private TilePyramid getPyramid()
+    {
+        if (buildPyramid && pyramid == null)
+        {
+            pyramid = new TilePyramid(new File(getMapDir(), PYRAMID_DIR_NAME),
+                    tileSize * getChunkSize(), getPngEncoder(), tileWriter,
+                    tileHashes);
+            if (pyramidValues != null)
+            {
+                pyramid.setValueColors(tileSize, pyramidValueColors);
+            }
+            if (manifest != null)
+            {
+                pyramid.setManifest(manifest, manifestType, tileSize);
+            }
+        }
+        return pyramid;
+    }
+    
+    /**
+     * Adds a finished tile to the zoom level tile pyramid, if one is being
+     * created. If the pyramid is built from chunk values, the tile's values
+     * are added instead of its pixels.
+     * 
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     * 
+     * @param pixels  The tile's ARGB pixels. These are ignored if the
+     *                pyramid is built from chunk values.
+     */
+    private void addToPyramid(Point tilePt, int[] pixels)
+    {
+        TilePyramid pyramid = getPyramid();
+        if (pyramid == null)
+        {
+            return;
+        }
+        if (pyramidValues != null)
+        {
+            final long[] values = new long[tileSize * tileSize];
+            int i = 0;
+            for (int z = tilePt.y; z < tilePt.y + tileSize; z++)
+            {
+                for (int x = tilePt.x; x < tilePt.x + tileSize; x++)
+                {
+                    values[i++] = pyramidValues.getValue(x, z);
+                }
+            }
+            pyramid.addValueTile(getTileIndex(tilePt), values);
+        }
+        else
+        {
+            pyramid.addTile(getTileIndex(tilePt), pixels);
+        }
+    }
+    
+    /**
+     * Checks if a saved tile was found to be unchanged since the map's start
+     * time, so that it can be used like a tile saved during this run.
+     * 
+     * @param tileFile  A tile image file.
+     * 
+     * @return          Whether tile hashes are kept and show that the file
+     *                  is current.
+     */
+    private boolean isVerifiedTile(File tileFile)
+    {
+        return tileHashes != null
+                && tileHashes.isVerifiedSince(tileFile, initTime);
+    }
+    
+    /**
+     * Saves the hashes of all tiles saved so far, after waiting for any
+     * pending background tile writes to finish.
+     */
+    private void saveTileHashes()
+    {
+        final String FN_NAME = "saveTileHashes";
+        if (tileHashes == null)
+        {
+            return;
+        }
+        if (tileWriter != null)
+        {
+            tileWriter.awaitCompletion();
+        }
+        try
+        {
+            tileHashes.save();
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Failed to save tile hashes, unchanged tiles will be "
+                    + "saved again next time:", e);
+        }
+    }
+    
+    /**
+     * Gets a tile's position within the grid of map tiles.
+     * 
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     * 
+     * @return        The tile's grid index, as used by the TilePyramid.
+     */
+    private Point getTileIndex(Point tilePt)
+    {
+        return new Point(Math.floorDiv(tilePt.x, tileSize),
+                Math.floorDiv(tilePt.y, tileSize));
+    }
+    
+    /**
+     * Gets every tile image saved in the main tile size. If a
+     * GenerationManifest was set, this holds the tiles it recorded, otherwise
+     * the main tile size directory is searched.
+     * 
+     * @return  The saved tile files, mapped to their grid indices and sorted
+     *          in row order.
+     */
+    private Map<Point, File> getSavedTileFiles()
+    {
+        Map<Point, File> savedTiles = new TreeMap<>((p1, p2) ->
+        {
+            return (p1.y != p2.y) ? Integer.compare(p1.y, p2.y)
+                    : Integer.compare(p1.x, p2.x);
+        });
+        if (manifest != null)
+        {
+            for (GenerationManifest.Entry entry
+                    : manifest.getEntries(manifestType, 0, tileSize))
+            {
+                savedTiles.put(getTileIndex(new Point(entry.x, entry.z)),
+                        entry.file);
+            }
+            return savedTiles;
+        }
+        findTileFiles(getTileSizeDir(tileSize)).forEach((tilePt, tileFile) ->
+        {
+            savedTiles.put(getTileIndex(tilePt), tileFile);
+        });
+        return savedTiles;
+    }
+    
+    /**
+     * Finds every tile image saved within a tile size directory.
+     * 
+     * @param tileDir  A directory holding tile images of a single size.
+     * 
+     * @return         The saved tile files, mapped to the upper left chunk
+     *                 coordinates of their tiles.
+     */
+    private Map<Point, File> findTileFiles(File tileDir)
+    {
+        Map<Point, File> tileFiles = new HashMap<>();
+        File[] childFiles = tileDir.listFiles();
+        if (childFiles == null)
+        {
+            return tileFiles;
+        }
+        final String prefix = getFileName() + ".";
+        for (File tileFile : childFiles)
+        {
+            final String name = tileFile.getName();
+            if (! name.startsWith(prefix) || ! name.endsWith(".png"))
+            {
+                continue;
+            }
+            String[] coords = name.substring(prefix.length(),
+                    name.length() - 4).split("\\.");
+            if (coords.length != 2)
+            {
+                continue;
+            }
+            try
+            {
+                tileFiles.put(new Point(Integer.parseInt(coords[0]),
+                        Integer.parseInt(coords[1])), tileFile);
+            }
+            catch (NumberFormatException e)
+            {
+                // Not a tile image file, ignore it.
+            }
+        }
+        return tileFiles;
+    }
+    
+    /**
+     * Finds every tile saved or found to be unchanged since the map's start
+     * time that the tile pyramid hasn't received.
+     * 
+     * @param excluded  Grid indices of tiles that shouldn't be included,
+     *                  because they will be added to the pyramid later.
+     * 
+     * @return          The saved tile files, mapped to their grid indices
+     *                  and sorted in row order.
+     */
+    private Map<Point, File> findSavedTiles(Set<Point> excluded)
+    {
+        Map<Point, File> savedTiles = getSavedTileFiles();
+        TilePyramid pyramid = getPyramid();
+        savedTiles.entrySet().removeIf((entry) ->
+        {
+            return pyramid == null || excluded.contains(entry.getKey())
+                    || pyramid.hasTile(entry.getKey())
+                    || (entry.getValue().lastModified() < initTime
+                    && ! isVerifiedTile(entry.getValue()));
+        });
+        return savedTiles;
+    }
+    
+    /**
+     * Loads saved tiles and adds them to the tile pyramid. Tiles are added in
+     * iteration order, so sorting them by row lets zoomed out tiles be
+     * finished and released as early as possible. If the pyramid is built
+     * from chunk values, the tiles' values are added without loading their
+     * images.
+     * 
+     * @param savedTiles  Saved tile files mapped to their grid indices, as
+     *                    returned by findSavedTiles.
+     */
+    private void addSavedTilesToPyramid(Map<Point, File> savedTiles)
+    {
+        TilePyramid pyramid = getPyramid();
+        if (pyramid == null || savedTiles.isEmpty())
+        {
+            return;
+        }
+        pyramid.expectTiles(savedTiles.keySet());
+        final int tilePxSize = tileSize * getChunkSize();
+        savedTiles.forEach((tileIndex, tileFile) ->
+        {
+            final Point tilePt = new Point(tileIndex.x * tileSize,
+                    tileIndex.y * tileSize);
+            if (pyramidValues != null)
+            {
+                addToPyramid(tilePt, null);
+                return;
+            }
+            BufferedImage tileImage = loadTileFile(tileFile);
+            if (tileImage != null && tileImage.getWidth() == tilePxSize
+                    && tileImage.getHeight() == tilePxSize)
+            {
+                addToPyramid(tilePt, ((DataBufferInt) tileImage
+                        .getRaster().getDataBuffer()).getData());
+            }
+        });
+    }
+    
+    /**
+     * Copies an image into a new TYPE_INT_ARGB image, so that its pixels can
+     * be accessed directly as packed ARGB values.
+     * 
+     * @param image  The source image.
+     * 
+     * @return       An ARGB copy of the source image.
+     */
+    private static BufferedImage toIntARGB(BufferedImage image)
+    {
+        BufferedImage argbImage = new BufferedImage(image.getWidth(),
+                image.getHeight(), BufferedImage.TYPE_INT_ARGB);
+        Graphics2D graphics = argbImage.createGraphics();
+        graphics.setComposite(AlphaComposite.Src);
+        graphics.drawImage(image, 0, 0, null);
+        graphics.dispose();
+        return argbImage;
     }
     
     /**
@@ -451,9 +1686,23 @@ public class TileMap extends WorldMap
     private File getTileFile(Point tilePt)
     {
         Validate.notNull(tilePt, "Chunk coordinate cannot be null.");
-        String filename = getFileName() + "." + tilePt.x + "." + tilePt.y
-                + ".png";
-        return new File(getTileSizeDir(tileSize), filename);
+        return new File(getTileSizeDir(tileSize),
+                getTileFileName(getFileName(), tilePt));
+    }
+    
+    /**
+     * Gets the name of the file used to save a specific map tile.
+     * 
+     * @param baseName  The base string used when naming image files.
+     * 
+     * @param tilePt    The coordinates of a map tile.
+     * 
+     * @return          The tile's image file name.
+     */
+    public static String getTileFileName(String baseName, Point tilePt)
+    {
+        Validate.notNull(tilePt, "Chunk coordinate cannot be null.");
+        return baseName + "." + tilePt.x + "." + tilePt.y + ".png";
     }
     
     /**
@@ -479,7 +1728,9 @@ public class TileMap extends WorldMap
         
     /**
      * Iterates through each chunk in the map, running a callback for each
-     * chunk's coordinates. Empty chunks may or may not be skipped.
+     * chunk's coordinates. Empty chunks may or may not be skipped. This
+     * includes chunks within tiles evicted to the spill file, which are
+     * reloaded as the callback reads them.
      *
      * @param chunkAction  The action to perform for each valid chunk.
      */
@@ -487,11 +1738,19 @@ public class TileMap extends WorldMap
     protected void foreachChunk(Consumer<Point> chunkAction)
     {
         Validate.notNull(chunkAction, "Chunk action cannot be null.");
+        // Copy all tile points first, as reading chunks may move tiles
+        // between the cache and the spill file:
+        Set<Point> tilePoints = new HashSet<>(
+                tileCache.getTilePoints(cacheLayer));
+        if (spillFile != null)
+        {
+            tilePoints.addAll(spillFile.getTilePoints());
+        }
         Point chunkPt = new Point();
-        for (Map.Entry<Point, BufferedImage> entry : mapTiles.entrySet())
+        for (Point tilePt : tilePoints)
         {
-            final int x0 = entry.getKey().x;
-            final int y0 = entry.getKey().y;
+            final int x0 = tilePt.x;
+            final int y0 = tilePt.y;
             for (chunkPt.y = y0; chunkPt.y < (y0 + tileSize); chunkPt.y++)
             {
                 for (chunkPt.x = x0; chunkPt.x < (x0 + tileSize); chunkPt.x++)
@@ -504,13 +1763,42 @@ public class TileMap extends WorldMap
     
     // TileMap creation time, used when checking if tiles need to be updated:
     private final long initTime;
-    // All initialized map tiles, generated as needed:
-    private final Map<Point, BufferedImage> mapTiles;
-    // A list of recently modified tile points, used to decide when to load or
-    // unload tile data from memory:
-    private final Deque<Point> recentTiles;
+    // All map tiles held in memory, generated as needed:
+    private final TileCache tileCache;
+    // The tile cache layer holding this map's tiles:
+    private final int cacheLayer;
+    // Unfinished tiles evicted from memory, created when first needed:
+    private TileSpillFile spillFile = null;
     // The width and height in chunks/pixels of each map tile:
     private final int tileSize;
     // Optional alternate tile sizes:
     private final int[] altSizes;
+    // Optional background writer used to save finished tiles:
+    private final TileWriter tileWriter;
+    // Whether this map creates zoom level tiles:
+    private final boolean buildPyramid;
+    // Zoom level tiles built from finished tiles, created when first needed:
+    private TilePyramid pyramid = null;
+    // Optional chunk values and value colors used to build zoom level tiles:
+    private ChunkValues pyramidValues = null;
+    private LongToIntFunction pyramidValueColors = null;
+    // Hashes of saved tiles, or null if unchanged tiles are always saved:
+    private final TileHashes tileHashes;
+    // Optional single-image map built from finished tiles:
+    private TileComposer composer = null;
+    // Optional record of saved tile files, and the map type name used when
+    // recording them:
+    private GenerationManifest manifest = null;
+    private String manifestType = null;
+    // Areas of tiles saved by an earlier run that will be redrawn, for each
+    // saved tile not yet loaded:
+    private final Map<Point, List<Rectangle>> changedTileAreas;
+    // Reusable key for finding cached tiles without allocating a new Point:
+    private final Point tileLookupPt = new Point();
+    // The most recently drawn tile's coordinates and pixel data:
+    private int lastTileX;
+    private int lastTileZ;
+    private int[] lastTilePixels = null;
+    // The tile cache's change count when the last pixel array was found:
+    private long lastTileChanges;
 }
@@ -0,0 +1,888 @@
+/**
+ * @file TilePyramid.java
+ *
+ * Builds lower zoom level tiles from finished map tiles.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.mapping.images.PngEncoder;
+import com.centuryglass.chunk_atlas.mapping.images.TileWriter;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.Point;
+import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.io.File;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeMap;
+import java.util.function.Function;
+import java.util.function.LongToIntFunction;
+import java.util.logging.Level;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TilePyramid creates a quadtree of zoomed out map tiles above a map's full
+ * detail tiles. Each tile at zoom level n covers the area of four tiles at
+ * level n - 1, and is created by downsampling those four tiles with a 2x2 box
+ * filter. Level zero holds the full detail tiles, which TilePyramid does not
+ * save itself.
+ *
+ *  Tiles are indexed by their position in the tile grid, so the full detail
+ * tile with upper left chunk (x * tileSize, z * tileSize) has index (x, z),
+ * and its level n ancestor has index (x >> n, z >> n). Each tile above level
+ * zero is saved as "level/x/z.png" within the pyramid directory. Levels are
+ * added until all remaining tiles share the 2x2 block of tiles around the
+ * origin, which no further level could merge.
+ *
+ *  Parent tiles are built bottom-up as their children are finished. Each
+ * finished child is immediately downsampled into one quadrant of its parent,
+ * so only unfinished parents are held in memory. If the set of expected full
+ * detail tiles is known, each parent is saved as soon as all of its expected
+ * children are finished. Otherwise, or if expected tiles never arrive,
+ * remaining parents are saved when the pyramid is finished.
+ *
+ *  When only some tiles of an existing map are redrawn, the saved tiles that
+ * didn't change can be marked as unchanged. Only parents of redrawn tiles are
+ * rebuilt, loading any unchanged children they need from the disk.
+ *
+ *  Maps that color chunks by numeric value may instead build the pyramid
+ * from the values themselves. Each tile then holds a grid of values, and
+ * each parent value is the greatest of the four child values it covers, so
+ * small areas with high values remain visible when zoomed out instead of
+ * being averaged away. Value tiles are converted to colors only when saved,
+ * and can't be combined with unchanged tiles loaded from the disk.
+ *
+ *  TilePyramid is not thread-safe, and should be used by a single thread.
+ */
+public class TilePyramid
+{
+    private static final String CLASSNAME = TilePyramid.class.getName();
+
+    /**
+     * Marks value tile cells that hold no value. As the lowest possible
+     * value, it never replaces real values when tiles are combined.
+     */
+    public static final long NO_VALUE = Long.MIN_VALUE;
+
+    /**
+     * Sets the pyramid's output options on construction.
+     *
+     * @param pyramidDir  The directory where zoom level directories will be
+     *                    created.
+     *
+     * @param tilePxSize  The width and height in pixels of every tile image.
+     *
+     * @param encoder     The encoder used to save tile images.
+     *
+     * @param tileWriter  An optional TileWriter used to save tiles in the
+     *                    background. If null, tiles are saved within the
+     *                    calling thread.
+     *
+     * @param tileHashes  Optional hashes of saved tiles. If not null, empty
+     *                    tiles and tiles identical to their saved images
+     *                    won't be written.
+     */
+    public TilePyramid(File pyramidDir, int tilePxSize, PngEncoder encoder,
+            TileWriter tileWriter, TileHashes tileHashes)
+    {
+        ExtendedValidate.couldBeDirectory(pyramidDir, "Pyramid directory");
+        ExtendedValidate.isPositive(tilePxSize, "Tile pixel size");
+        Validate.notNull(encoder, "PNG encoder cannot be null.");
+        this.pyramidDir = pyramidDir;
+        this.tilePxSize = tilePxSize;
+        this.encoder = encoder;
+        this.tileWriter = tileWriter;
+        this.tileHashes = tileHashes;
+        finishedTiles = new HashSet<>();
+        expectedTiles = new HashSet<>();
+        unchangedTiles = new HashSet<>();
+        keptTiles = new ArrayList<>();
+        expectedChildren = new ArrayList<>();
+        pendingTiles = new ArrayList<>();
+        savedTiles = new ArrayList<>();
+        topLevel = 0;
+    }
+
+    /**
+     * Gets the pyramid's output directory.
+     *
+     * @return  The directory holding all zoom level directories.
+     */
+    public File getPyramidDir()
+    {
+        return pyramidDir;
+    }
+
+    /**
+     * Records every zoom level tile saved or found to be unchanged in a
+     * generation manifest, and removes tiles deleted for being empty. This
+     * must be called before any tiles are saved.
+     *
+     * @param manifest  The manifest of the map's region, or null to stop
+     *                  recording tiles.
+     *
+     * @param mapType   The name of the map's type.
+     *
+     * @param tileSize  The width and height in chunks of each full detail
+     *                  tile, used to find each tile's upper left chunk.
+     */
+    public void setManifest(GenerationManifest manifest, String mapType,
+            int tileSize)
+    {
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        this.manifest = manifest;
+        manifestType = mapType;
+        manifestTileSize = tileSize;
+    }
+
+    /**
+     * Makes the pyramid build its tiles from numeric values instead of tile
+     * colors. Once set, full detail tiles must be added with addValueTile.
+     * This must be called before any tiles are added.
+     *
+     * @param valueSize    The width and height of each tile's value grid.
+     *                     The tile pixel size must be a multiple of this
+     *                     value.
+     *
+     * @param valueColors  A function that selects the ARGB color drawn for
+     *                     each value.
+     */
+    public void setValueColors(int valueSize, LongToIntFunction valueColors)
+    {
+        ExtendedValidate.isPositive(valueSize, "Value tile size");
+        Validate.isTrue(tilePxSize % valueSize == 0,
+                "Tile pixel size must be a multiple of the value tile size.");
+        Validate.notNull(valueColors, "Value color function cannot be null.");
+        Validate.isTrue(finishedTiles.isEmpty(),
+                "Value colors must be set before tiles are added.");
+        this.valueSize = valueSize;
+        this.valueColors = valueColors;
+    }
+
+    /**
+     * Sets the full detail tiles that will be added to the pyramid, allowing
+     * parent tiles to be saved as soon as all of their children are added.
+     * This may be called more than once to expect additional tiles. Adding
+     * unexpected tiles is allowed, but slower, and a parent tile saved before
+     * an unexpected child is added will not include that child.
+     *
+     * @param tileIndices  The grid indices of all expected full detail tiles.
+     */
+    public void expectTiles(Collection<Point> tileIndices)
+    {
+        Validate.notNull(tileIndices, "Tile indices cannot be null.");
+        tileIndices.forEach((index) -> expectedTiles.add(new Point(index)));
+        updateExpectations();
+    }
+
+    /**
+     * Sets the full detail tiles saved by an earlier run that won't be
+     * redrawn. Parents of redrawn tiles load these tiles and their saved
+     * zoomed out tiles from the disk as needed, instead of expecting them to
+     * be added. This should be called before any tiles are added.
+     *
+     * @param tileIndices    The grid indices of all unchanged full detail
+     *                       tiles.
+     *
+     * @param savedTileFile  A function that returns the file where a full
+     *                       detail tile is saved, given its grid index.
+     */
+    public void setUnchangedTiles(Collection<Point> tileIndices,
+            Function<Point, File> savedTileFile)
+    {
+        Validate.notNull(tileIndices, "Tile indices cannot be null.");
+        Validate.notNull(savedTileFile, "Tile file function cannot be null.");
+        unchangedTiles.clear();
+        tileIndices.forEach((index) -> unchangedTiles.add(new Point(index)));
+        this.savedTileFile = savedTileFile;
+        updateExpectations();
+    }
+
+    /**
+     * Checks if a full detail tile was already added to the pyramid.
+     *
+     * @param tileIndex  The tile's grid index.
+     *
+     * @return           Whether the tile was added.
+     */
+    public boolean hasTile(Point tileIndex)
+    {
+        return finishedTiles.contains(tileIndex);
+    }
+
+    /**
+     * Adds a finished full detail tile to the pyramid, downsampling it into
+     * its parent tile and saving any parent tiles this completes.
+     *
+     * @param tileIndex  The tile's grid index.
+     *
+     * @param pixels     The tile's ARGB pixels in row-major order. The array
+     *                   is only read within this call.
+     */
+    public void addTile(Point tileIndex, int[] pixels)
+    {
+        Validate.notNull(tileIndex, "Tile index cannot be null.");
+        Validate.notNull(pixels, "Tile pixels cannot be null.");
+        Validate.isTrue(pixels.length == tilePxSize * tilePxSize,
+                "Tile pixel count doesn't match the pyramid tile size.");
+        Validate.isTrue(valueColors == null,
+                "Value pyramids can only receive value tiles.");
+        addChild(0, addFinishedTile(tileIndex), pixels, null);
+    }
+
+    /**
+     * Adds the values of a finished full detail tile to a pyramid built from
+     * values, combining them into its parent tile and saving any parent
+     * tiles this completes.
+     *
+     * @param tileIndex  The tile's grid index.
+     *
+     * @param values     The tile's value grid in row-major order, using
+     *                   NO_VALUE for cells without values. The array is only
+     *                   read within this call.
+     */
+    public void addValueTile(Point tileIndex, long[] values)
+    {
+        Validate.notNull(tileIndex, "Tile index cannot be null.");
+        Validate.notNull(values, "Tile values cannot be null.");
+        Validate.isTrue(valueColors != null,
+                "Value colors must be set before adding value tiles.");
+        Validate.isTrue(values.length == valueSize * valueSize,
+                "Tile value count doesn't match the value tile size.");
+        addChild(0, addFinishedTile(tileIndex), null, values);
+    }
+
+    /**
+     * Saves every remaining parent tile, including any with children that
+     * were never added. Once finished, tiles should not be added again.
+     */
+    public void finish()
+    {
+        for (int level = 1; level <= topLevel; level++)
+        {
+            if (level >= pendingTiles.size())
+            {
+                break;
+            }
+            // Sort remaining tiles so output order doesn't depend on hashing:
+            Map<Point, PendingTile> remaining = new TreeMap<>((p1, p2) ->
+            {
+                return (p1.y != p2.y) ? Integer.compare(p1.y, p2.y)
+                        : Integer.compare(p1.x, p2.x);
+            });
+            remaining.putAll(pendingTiles.get(level));
+            for (Point index : remaining.keySet())
+            {
+                saveTile(level, index);
+            }
+        }
+    }
+
+    /**
+     * Gets the file where a pyramid tile is saved.
+     *
+     * @param level  The tile's zoom level, counting up from the full detail
+     *               level.
+     *
+     * @param index  The tile's grid index within its level.
+     *
+     * @return       The tile image file.
+     */
+    public File getTileFile(int level, Point index)
+    {
+        ExtendedValidate.isPositive(level, "Pyramid level");
+        Validate.notNull(index, "Tile index cannot be null.");
+        return new File(new File(new File(pyramidDir,
+                String.valueOf(level)), String.valueOf(index.x)),
+                index.y + ".png");
+    }
+
+    /**
+     * Downsamples a square image to half its width and height, copying the
+     * result into part of another square image. Each output pixel is the
+     * alpha-weighted average of a 2x2 block of input pixels, so transparent
+     * pixels don't darken their neighbors.
+     *
+     * @param source      The source image's ARGB pixels.
+     *
+     * @param sourceSize  The source image's width and height in pixels. If
+     *                    odd, the last row and column are ignored.
+     *
+     * @param dest        The destination image's ARGB pixels.
+     *
+     * @param destSize    The destination image's width and height in pixels.
+     *
+     * @param destX       The x-coordinate where the downsampled image's left
+     *                    edge is copied.
+     *
+     * @param destY       The y-coordinate where the downsampled image's top
+     *                    edge is copied.
+     */
+    public static void downsample(int[] source, int sourceSize, int[] dest,
+            int destSize, int destX, int destY)
+    {
+        final int halfSize = sourceSize / 2;
+        Validate.isTrue(destX >= 0 && destY >= 0
+                && destX + halfSize <= destSize
+                && destY + halfSize <= destSize,
+                "Downsampled image doesn't fit within the destination.");
+        for (int y = 0; y < halfSize; y++)
+        {
+            int sourceIndex = 2 * y * sourceSize;
+            int destIndex = (destY + y) * destSize + destX;
+            for (int x = 0; x < halfSize; x++)
+            {
+                dest[destIndex++] = averagePixels(source[sourceIndex],
+                        source[sourceIndex + 1],
+                        source[sourceIndex + sourceSize],
+                        source[sourceIndex + sourceSize + 1]);
+                sourceIndex += 2;
+            }
+        }
+    }
+
+    /**
+     * Combines a square grid of values into a grid half its width and
+     * height, copying the result into part of another square grid. Each
+     * output value is the greatest of a 2x2 block of input values.
+     *
+     * @param source      The source grid's values.
+     *
+     * @param sourceSize  The source grid's width and height.
+     *
+     * @param dest        The destination grid's values.
+     *
+     * @param destSize    The destination grid's width and height.
+     *
+     * @param destX       The x-coordinate where the combined grid's left edge
+     *                    is copied.
+     *
+     * @param destY       The y-coordinate where the combined grid's top edge
+     *                    is copied.
+     */
+    public static void downsampleValues(long[] source, int sourceSize,
+            long[] dest, int destSize, int destX, int destY)
+    {
+        final int halfSize = sourceSize / 2;
+        Validate.isTrue(destX >= 0 && destY >= 0
+                && destX + halfSize <= destSize
+                && destY + halfSize <= destSize,
+                "Downsampled values don't fit within the destination.");
+        for (int y = 0; y < halfSize; y++)
+        {
+            int sourceIndex = 2 * y * sourceSize;
+            int destIndex = (destY + y) * destSize + destX;
+            for (int x = 0; x < halfSize; x++)
+            {
+                dest[destIndex++] = Math.max(
+                        Math.max(source[sourceIndex],
+                        source[sourceIndex + 1]),
+                        Math.max(source[sourceIndex + sourceSize],
+                        source[sourceIndex + sourceSize + 1]));
+                sourceIndex += 2;
+            }
+        }
+    }
+
+    /**
+     * Finds the alpha-weighted average of four ARGB pixels.
+     *
+     * @param p0  The first pixel.
+     *
+     * @param p1  The second pixel.
+     *
+     * @param p2  The third pixel.
+     *
+     * @param p3  The fourth pixel.
+     *
+     * @return    The averaged ARGB pixel.
+     */
+    private static int averagePixels(int p0, int p1, int p2, int p3)
+    {
+        final int a0 = p0 >>> 24;
+        final int a1 = p1 >>> 24;
+        final int a2 = p2 >>> 24;
+        final int a3 = p3 >>> 24;
+        final int alpha = a0 + a1 + a2 + a3;
+        if (alpha == 0)
+        {
+            return 0;
+        }
+        final int round = alpha / 2;
+        final int red = (((p0 >> 16) & 0xff) * a0 + ((p1 >> 16) & 0xff) * a1
+                + ((p2 >> 16) & 0xff) * a2 + ((p3 >> 16) & 0xff) * a3
+                + round) / alpha;
+        final int green = (((p0 >> 8) & 0xff) * a0 + ((p1 >> 8) & 0xff) * a1
+                + ((p2 >> 8) & 0xff) * a2 + ((p3 >> 8) & 0xff) * a3
+                + round) / alpha;
+        final int blue = ((p0 & 0xff) * a0 + (p1 & 0xff) * a1
+                + (p2 & 0xff) * a2 + (p3 & 0xff) * a3 + round) / alpha;
+        return (((alpha + 2) >> 2) << 24) | (red << 16) | (green << 8) | blue;
+    }
+
+    /**
+     * Records that a full detail tile was finished, expecting it if it wasn't
+     * already expected.
+     *
+     * @param tileIndex  The tile's grid index.
+     *
+     * @return           A copy of the tile index.
+     */
+    private Point addFinishedTile(Point tileIndex)
+    {
+        final Point index = new Point(tileIndex);
+        finishedTiles.add(index);
+        if (! expectedTiles.contains(index))
+        {
+            expectedTiles.add(index);
+            updateExpectations();
+        }
+        return index;
+    }
+
+    /**
+     * Downsamples a finished tile into its parent, saving the parent if all
+     * of its expected children are now finished.
+     *
+     * @param level   The finished tile's zoom level.
+     *
+     * @param index   The finished tile's grid index.
+     *
+     * @param pixels  The finished tile's ARGB pixels, or null if the pyramid
+     *                is built from values.
+     *
+     * @param values  The finished tile's value grid, or null if the pyramid
+     *                is built from pixels.
+     */
+    private void addChild(int level, Point index, int[] pixels,
+            long[] values)
+    {
+        final String FN_NAME = "addChild";
+        if (level >= topLevel)
+        {
+            return;
+        }
+        final int parentLevel = level + 1;
+        final Point parentIndex = new Point(index.x >> 1, index.y >> 1);
+        if (getSavedTiles(parentLevel).contains(parentIndex))
+        {
+            LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                    "Level {0} tile {1} changed after its parent was saved.",
+                    new Object[] { level, index });
+            return;
+        }
+        Map<Point, PendingTile> levelTiles = getPendingTiles(parentLevel);
+        PendingTile parent = levelTiles.get(parentIndex);
+        if (parent == null)
+        {
+            parent = createPendingTile(parentLevel, parentIndex);
+            levelTiles.put(parentIndex, parent);
+        }
+        if (values != null)
+        {
+            final int halfSize = valueSize / 2;
+            downsampleValues(values, valueSize, parent.values, valueSize,
+                    (index.x & 1) * halfSize, (index.y & 1) * halfSize);
+        }
+        else
+        {
+            final int halfSize = tilePxSize / 2;
+            downsample(pixels, tilePxSize, parent.pixels, tilePxSize,
+                    (index.x & 1) * halfSize, (index.y & 1) * halfSize);
+        }
+        parent.childMask |= getChildBit(index);
+        final Integer expectedMask = expectedChildren.get(parentLevel)
+                .get(parentIndex);
+        if (expectedMask != null
+                && (parent.childMask & expectedMask) == expectedMask)
+        {
+            saveTile(parentLevel, parentIndex);
+        }
+    }
+
+    /**
+     * Creates a new parent tile, drawing in any unchanged children saved by an
+     * earlier run.
+     *
+     * @param level  The new tile's zoom level.
+     *
+     * @param index  The new tile's grid index.
+     *
+     * @return       The new pending tile.
+     */
+    private PendingTile createPendingTile(int level, Point index)
+    {
+        PendingTile tile = new PendingTile(tilePxSize,
+                (valueColors == null) ? 0 : valueSize);
+        final int childLevel = level - 1;
+        // Saved tiles only hold colors, so value tiles can't load them:
+        if (childLevel >= keptTiles.size() || valueColors != null)
+        {
+            return tile;
+        }
+        final Set<Point> keptChildren = keptTiles.get(childLevel);
+        final int halfSize = tilePxSize / 2;
+        for (int i = 0; i < 4; i++)
+        {
+            Point child = new Point(index.x * 2 + (i & 1),
+                    index.y * 2 + (i >> 1));
+            if (! keptChildren.contains(child))
+            {
+                continue;
+            }
+            int[] pixels = loadTile(childLevel, child);
+            if (pixels != null)
+            {
+                downsample(pixels, tilePxSize, tile.pixels, tilePxSize,
+                        (i & 1) * halfSize, (i >> 1) * halfSize);
+            }
+            tile.childMask |= getChildBit(child);
+        }
+        return tile;
+    }
+
+    /**
+     * Loads a tile saved by an earlier run.
+     *
+     * @param level  The tile's zoom level.
+     *
+     * @param index  The tile's grid index.
+     *
+     * @return       The tile's ARGB pixels, or null if the tile couldn't be
+     *               loaded.
+     */
+    private int[] loadTile(int level, Point index)
+    {
+        final String FN_NAME = "loadTile";
+        File tileFile = (level == 0) ? savedTileFile.apply(index)
+                : getTileFile(level, index);
+        if (tileFile == null || ! tileFile.isFile())
+        {
+            return null;
+        }
+        BufferedImage image = TileMap.loadTileFile(tileFile);
+        if (image == null || image.getWidth() != tilePxSize
+                || image.getHeight() != tilePxSize)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Ignoring invalid saved tile '{0}'.", tileFile);
+            return null;
+        }
+        return ((DataBufferInt) image.getRaster().getDataBuffer()).getData();
+    }
+
+    /**
+     * Saves a pending tile, then adds it to its own parent.
+     *
+     * @param level  The tile's zoom level.
+     *
+     * @param index  The tile's grid index.
+     */
+    private void saveTile(int level, Point index)
+    {
+        PendingTile tile = getPendingTiles(level).remove(index);
+        if (tile == null)
+        {
+            return;
+        }
+        getSavedTiles(level).add(index);
+        File tileFile = getTileFile(level, index);
+        File tileDir = tileFile.getParentFile();
+        if (! tileDir.isDirectory())
+        {
+            tileDir.mkdirs();
+        }
+        // Downsample before submitting the image, since submitted images may
+        // be written at any time:
+        addChild(level, index, tile.pixels, tile.values);
+        if (tile.values != null)
+        {
+            drawValues(tile);
+        }
+        if (tileHashes != null)
+        {
+            if (TileHashes.isEmpty(tile.pixels))
+            {
+                tileHashes.remove(tileFile);
+                tileFile.delete();
+                if (manifest != null)
+                {
+                    manifest.remove(tileFile);
+                }
+                return;
+            }
+            final long hash = TileHashes.hashPixels(tile.pixels);
+            if (tileHashes.checkUnchanged(tileFile, hash))
+            {
+                recordTile(level, index, tileFile);
+                return;
+            }
+            tileHashes.recordWrite(tileFile, hash);
+        }
+        recordTile(level, index, tileFile);
+        if (tileWriter != null)
+        {
+            tileWriter.submit(tile.image, tileFile, null, encoder);
+        }
+        else
+        {
+            TileWriter.writeTile(tile.image, tileFile, null, encoder);
+        }
+    }
+
+    /**
+     * Adds a saved tile to the generation manifest, if one was set.
+     *
+     * @param level     The tile's zoom level.
+     *
+     * @param index     The tile's grid index.
+     *
+     * @param tileFile  The tile's image file.
+     */
+    private void recordTile(int level, Point index, File tileFile)
+    {
+        if (manifest == null)
+        {
+            return;
+        }
+        final int chunkSize = manifestTileSize << level;
+        manifest.record(manifestType, level, manifestTileSize,
+                index.x * chunkSize, index.y * chunkSize, tileFile);
+    }
+
+    /**
+     * Draws a value tile's colors into its image. Each value fills a square
+     * block of pixels, and cells without values are left transparent.
+     *
+     * @param tile  A pending tile holding a value grid.
+     */
+    private void drawValues(PendingTile tile)
+    {
+        final int scale = tilePxSize / valueSize;
+        for (int y = 0; y < valueSize; y++)
+        {
+            for (int x = 0; x < valueSize; x++)
+            {
+                final long value = tile.values[y * valueSize + x];
+                if (value == NO_VALUE)
+                {
+                    continue;
+                }
+                final int argb = valueColors.applyAsInt(value);
+                int rowStart = y * scale * tilePxSize + x * scale;
+                for (int row = 0; row < scale; row++)
+                {
+                    Arrays.fill(tile.pixels, rowStart, rowStart + scale,
+                            argb);
+                    rowStart += tilePxSize;
+                }
+            }
+        }
+    }
+
+    /**
+     * Updates the expected children of every parent tile, the unchanged tiles
+     * within each level, and the highest zoom level, to include all expected
+     * and unchanged full detail tiles.
+     */
+    private void updateExpectations()
+    {
+        Set<Point> levelTiles = expectedTiles;
+        // Unchanged tiles within the level that don't cover any expected
+        // tiles:
+        Set<Point> levelKept = new HashSet<>(unchangedTiles);
+        levelKept.removeAll(expectedTiles);
+        keptTiles.clear();
+        int level = 0;
+        while (! isTopLevel(levelTiles, levelKept))
+        {
+            keptTiles.add(levelKept);
+            final int parentLevel = level + 1;
+            while (expectedChildren.size() <= parentLevel)
+            {
+                expectedChildren.add(new HashMap<>());
+            }
+            Map<Point, Integer> parentMasks = expectedChildren.get(
+                    parentLevel);
+            Set<Point> parentTiles = new HashSet<>();
+            for (Point index : levelTiles)
+            {
+                Point parentIndex = new Point(index.x >> 1, index.y >> 1);
+                Integer mask = parentMasks.get(parentIndex);
+                parentMasks.put(parentIndex, ((mask == null) ? 0 : mask)
+                        | getChildBit(index));
+                parentTiles.add(parentIndex);
+            }
+            Set<Point> parentKept = new HashSet<>();
+            for (Point index : levelKept)
+            {
+                Point parentIndex = new Point(index.x >> 1, index.y >> 1);
+                if (parentTiles.contains(parentIndex))
+                {
+                    // Rebuilt parents also expect their unchanged children:
+                    parentMasks.put(parentIndex, parentMasks.get(parentIndex)
+                            | getChildBit(index));
+                }
+                else
+                {
+                    parentKept.add(parentIndex);
+                }
+            }
+            levelTiles = parentTiles;
+            levelKept = parentKept;
+            level = parentLevel;
+        }
+        topLevel = Math.max(topLevel, level);
+    }
+
+    /**
+     * Checks if a set of tiles can't be merged by adding another zoom level.
+     *
+     * @param levelTiles  The grid indices of all changed tiles within a
+     *                    level.
+     *
+     * @param levelKept   The grid indices of all unchanged tiles within the
+     *                    same level.
+     *
+     * @return            Whether the level holds no more than one tile, or
+     *                    only tiles from the 2x2 block around the origin.
+     */
+    private static boolean isTopLevel(Set<Point> levelTiles,
+            Set<Point> levelKept)
+    {
+        if ((levelTiles.size() + levelKept.size()) <= 1)
+        {
+            return true;
+        }
+        for (Set<Point> tiles : Arrays.asList(levelTiles, levelKept))
+        {
+            for (Point index : tiles)
+            {
+                if (index.x < -1 || index.x > 0 || index.y < -1
+                        || index.y > 0)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Gets the bit representing a tile's quadrant within its parent.
+     *
+     * @param index  The tile's grid index.
+     *
+     * @return       A bit flag between one and eight.
+     */
+    private static int getChildBit(Point index)
+    {
+        return 1 << ((index.x & 1) | ((index.y & 1) << 1));
+    }
+
+    /**
+     * Gets the unfinished tiles within a zoom level.
+     *
+     * @param level  A zoom level above zero.
+     *
+     * @return       The level's pending tiles, mapped by grid index.
+     */
+    private Map<Point, PendingTile> getPendingTiles(int level)
+    {
+        while (pendingTiles.size() <= level)
+        {
+            pendingTiles.add(new HashMap<>());
+        }
+        return pendingTiles.get(level);
+    }
+
+    /**
+     * Gets the indices of all saved tiles within a zoom level.
+     *
+     * @param level  A zoom level above zero.
+     *
+     * @return       The level's saved tile indices.
+     */
+    private Set<Point> getSavedTiles(int level)
+    {
+        while (savedTiles.size() <= level)
+        {
+            savedTiles.add(new HashSet<>());
+        }
+        return savedTiles.get(level);
+    }
+
+    /**
+     * An unfinished parent tile, along with the children already drawn into
+     * it.
+     */
+    private class PendingTile
+    {
+        protected PendingTile(int size, int valueSize)
+        {
+            image = new BufferedImage(size, size,
+                    BufferedImage.TYPE_INT_ARGB);
+            pixels = ((DataBufferInt) image.getRaster().getDataBuffer())
+                    .getData();
+            if (valueSize > 0)
+            {
+                values = new long[valueSize * valueSize];
+                Arrays.fill(values, NO_VALUE);
+            }
+            else
+            {
+                values = null;
+            }
+            childMask = 0;
+        }
+        protected final BufferedImage image;
+        protected final int[] pixels;
+        // The tile's value grid, or null if the pyramid is built from pixels:
+        protected final long[] values;
+        protected int childMask;
+    }
+
+    // Directory holding all zoom level directories:
+    private final File pyramidDir;
+    // Width and height in pixels of each tile:
+    private final int tilePxSize;
+    // Encoder and optional background writer used to save tiles:
+    private final PngEncoder encoder;
+    private final TileWriter tileWriter;
+    // Optional hashes used to skip saving empty or unchanged tiles:
+    private final TileHashes tileHashes;
+    // Optional manifest recording saved tiles, with the map type name and
+    // full detail tile size used to record them:
+    private GenerationManifest manifest = null;
+    private String manifestType = null;
+    private int manifestTileSize = 1;
+    // Grid indices of all full detail tiles added so far:
+    private final Set<Point> finishedTiles;
+    // Grid indices of all full detail tiles that will be added:
+    private final Set<Point> expectedTiles;
+    // Grid indices of saved full detail tiles that won't be redrawn:
+    private final Set<Point> unchangedTiles;
+    // Function that finds the saved file of an unchanged full detail tile:
+    private Function<Point, File> savedTileFile = null;
+    // Unchanged tiles in each level that rebuilt parents may need to load:
+    private final List<Set<Point>> keptTiles;
+    // Quadrant flags of every expected child, for each parent in each level:
+    private final List<Map<Point, Integer>> expectedChildren;
+    // Unfinished tiles in each level:
+    private final List<Map<Point, PendingTile>> pendingTiles;
+    // Saved tiles in each level:
+    private final List<Set<Point>> savedTiles;
+    // Highest zoom level that will be created:
+    private int topLevel;
+    // Width and height of each value grid, if built from values:
+    private int valueSize = 0;
+    // Function that colors tile values, or null if built from pixels:
+    private LongToIntFunction valueColors = null;
+}
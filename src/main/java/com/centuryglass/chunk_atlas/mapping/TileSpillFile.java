@@ -0,0 +1,316 @@
+/**
+ * @file TileSpillFile.java
+ *
+ * Temporarily stores unfinished tile images as raw pixel data on disk.
+ */
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.Point;
+import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Deque;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.TimeUnit;
+import java.util.logging.Level;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TileSpillFile holds unfinished tile images evicted from memory within a
+ * memory-mapped scratch file, so they can be reloaded without encoding or
+ * decoding PNG images.
+ *
+ *  The scratch file is divided into equal slots, each holding one tile's
+ * packed ARGB pixels. Tiles are copied into their slots by a background
+ * thread. Until that copy finishes, the pending image is kept in memory and
+ * returned directly if the tile is needed again. The scratch file is deleted
+ * when the spill file is closed.
+ *
+ *  All methods other than those used by the background thread must be called
+ * from a single thread.
+ */
+public class TileSpillFile
+{
+    private static final String CLASSNAME = TileSpillFile.class.getName();
+
+    // Maximum size of each mapped section of the scratch file:
+    private static final long MAX_SEGMENT_BYTES = 1L << 30;
+    // Maximum time to wait for pending writes when closing:
+    private static final long CLOSE_TIMEOUT = 60; // seconds
+
+    /**
+     * Creates a new scratch file on construction.
+     *
+     * @param scratchDir    The directory where the scratch file will be
+     *                      created.
+     *
+     * @param baseName      A name used as the scratch file's prefix.
+     *
+     * @param tilePxSize    The width and height in pixels of each tile.
+     *
+     * @throws IOException  If the scratch file could not be created.
+     */
+    public TileSpillFile(File scratchDir, String baseName, int tilePxSize)
+            throws IOException
+    {
+        ExtendedValidate.isDirectory(scratchDir, "Scratch file directory");
+        ExtendedValidate.notNullOrEmpty(baseName, "Scratch file name");
+        ExtendedValidate.isPositive(tilePxSize, "Tile pixel size");
+        this.tilePxSize = tilePxSize;
+        slotBytes = (long) tilePxSize * tilePxSize * Integer.BYTES;
+        slotsPerSegment = (int) Math.max(1, MAX_SEGMENT_BYTES / slotBytes);
+        scratchFile = File.createTempFile(baseName + "_", ".spill",
+                scratchDir);
+        scratchFile.deleteOnExit();
+        fileAccess = new RandomAccessFile(scratchFile, "rw");
+        channel = fileAccess.getChannel();
+        segments = new ArrayList<>();
+        tileSlots = new HashMap<>();
+        freeSlots = new ArrayDeque<>();
+        pendingTiles = new ConcurrentHashMap<>();
+        writer = Executors.newSingleThreadExecutor((runnable) ->
+        {
+            Thread thread = new Thread(runnable, "TileSpillFile");
+            thread.setDaemon(true);
+            return thread;
+        });
+    }
+
+    /**
+     * Queues an unfinished tile to be copied into the scratch file. Once
+     * stored, the image must not be changed unless it is first returned by
+     * read or remove.
+     *
+     * @param tilePt        The upper left chunk coordinate of the tile.
+     *
+     * @param image         The tile's TYPE_INT_ARGB image.
+     *
+     * @throws IOException  If the scratch file could not be expanded to hold
+     *                      the tile.
+     */
+    public void store(Point tilePt, BufferedImage image) throws IOException
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        Validate.notNull(image, "Tile image cannot be null.");
+        Validate.isTrue(image.getWidth() == tilePxSize
+                && image.getHeight() == tilePxSize,
+                "Tile image size doesn't match scratch file slots.");
+        Integer slot = tileSlots.get(tilePt);
+        if (slot == null)
+        {
+            slot = freeSlots.isEmpty() ? tileSlots.size() : freeSlots.pop();
+        }
+        final ByteBuffer slotBuffer = getSlotBuffer(slot);
+        final Point key = new Point(tilePt);
+        tileSlots.put(key, slot);
+        pendingTiles.put(key, image);
+        writer.submit(() ->
+        {
+            final int[] pixels = ((DataBufferInt) image.getRaster()
+                    .getDataBuffer()).getData();
+            slotBuffer.asIntBuffer().put(pixels);
+            pendingTiles.remove(key, image);
+        });
+    }
+
+    /**
+     * Checks if a tile is held in the spill file.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @return        Whether the tile can be read from the spill file.
+     */
+    public boolean contains(Point tilePt)
+    {
+        return tileSlots.containsKey(tilePt);
+    }
+
+    /**
+     * Gets the coordinates of every tile held in the spill file.
+     *
+     * @return  A new set holding the upper left chunk coordinates of all
+     *          stored tiles.
+     */
+    public Set<Point> getTilePoints()
+    {
+        return new HashSet<>(tileSlots.keySet());
+    }
+
+    /**
+     * Reads a stored tile without removing it from the spill file. The
+     * returned image must not be changed.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @return        The tile image, or null if the tile isn't stored.
+     */
+    public BufferedImage read(Point tilePt)
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        final Integer slot = tileSlots.get(tilePt);
+        if (slot == null)
+        {
+            return null;
+        }
+        BufferedImage pending = pendingTiles.get(tilePt);
+        if (pending != null)
+        {
+            return pending;
+        }
+        return readSlot(slot);
+    }
+
+    /**
+     * Removes a tile from the spill file, returning its image.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @return        The tile image, or null if the tile isn't stored.
+     */
+    public BufferedImage remove(Point tilePt)
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        final Integer slot = tileSlots.remove(tilePt);
+        if (slot == null)
+        {
+            return null;
+        }
+        freeSlots.push(slot);
+        // Once removed from the pending set, the background thread will not
+        // change the image again:
+        BufferedImage pending = pendingTiles.remove(tilePt);
+        if (pending != null)
+        {
+            return pending;
+        }
+        return readSlot(slot);
+    }
+
+    /**
+     * Waits for all pending writes, then closes and deletes the scratch file.
+     */
+    public void close()
+    {
+        final String FN_NAME = "close";
+        writer.shutdown();
+        try
+        {
+            writer.awaitTermination(CLOSE_TIMEOUT, TimeUnit.SECONDS);
+        }
+        catch (InterruptedException e)
+        {
+            Thread.currentThread().interrupt();
+        }
+        tileSlots.clear();
+        freeSlots.clear();
+        pendingTiles.clear();
+        segments.clear();
+        try
+        {
+            channel.close();
+            fileAccess.close();
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Error closing scratch file '{0}': {1}",
+                    new Object[] { scratchFile, e });
+        }
+        // Mapped data may keep the file open until it is garbage collected,
+        // in which case it will be deleted on exit.
+        scratchFile.delete();
+    }
+
+    /**
+     * Gets a buffer covering a single slot in the scratch file, mapping more
+     * of the file if necessary.
+     *
+     * @param slot          The slot index.
+     *
+     * @return              A native byte order buffer holding exactly one
+     *                      slot.
+     *
+     * @throws IOException  If the file could not be mapped.
+     */
+    private ByteBuffer getSlotBuffer(int slot) throws IOException
+    {
+        final int segmentIndex = slot / slotsPerSegment;
+        while (segments.size() <= segmentIndex)
+        {
+            final long segmentBytes = slotBytes * slotsPerSegment;
+            segments.add(channel.map(FileChannel.MapMode.READ_WRITE,
+                    segments.size() * segmentBytes, segmentBytes));
+        }
+        ByteBuffer slotBuffer = segments.get(segmentIndex).duplicate();
+        final int offset = (int) ((slot % slotsPerSegment) * slotBytes);
+        slotBuffer.position(offset);
+        slotBuffer.limit(offset + (int) slotBytes);
+        return slotBuffer.slice().order(ByteOrder.nativeOrder());
+    }
+
+    /**
+     * Copies a slot's pixel data into a new image.
+     *
+     * @param slot  The index of a slot with no pending writes.
+     *
+     * @return      A new TYPE_INT_ARGB tile image, or null if the slot could
+     *              not be read.
+     */
+    private BufferedImage readSlot(int slot)
+    {
+        final String FN_NAME = "readSlot";
+        BufferedImage image = new BufferedImage(tilePxSize, tilePxSize,
+                BufferedImage.TYPE_INT_ARGB);
+        final int[] pixels = ((DataBufferInt) image.getRaster()
+                .getDataBuffer()).getData();
+        try
+        {
+            getSlotBuffer(slot).asIntBuffer().get(pixels);
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Reading scratch file '{0}' failed, tile data may be"
+                    + " lost: {1}", new Object[] { scratchFile, e });
+            return null;
+        }
+        return image;
+    }
+
+    // Width and height in pixels of each tile:
+    private final int tilePxSize;
+    // Size in bytes of each tile slot:
+    private final long slotBytes;
+    // Number of slots in each mapped file section:
+    private final int slotsPerSegment;
+    // The scratch file and its open channel:
+    private final File scratchFile;
+    private final RandomAccessFile fileAccess;
+    private final FileChannel channel;
+    // Mapped file sections, in file order:
+    private final ArrayList<MappedByteBuffer> segments;
+    // Slot indices of all stored tiles:
+    private final Map<Point, Integer> tileSlots;
+    // Slots no longer holding any tile:
+    private final Deque<Integer> freeSlots;
+    // Stored tiles still being copied into the scratch file:
+    private final Map<Point, BufferedImage> pendingTiles;
+    // Background thread that copies tiles into the scratch file:
+    private final ExecutorService writer;
+}
@@ -6,6 +6,7 @@
 
 package com.centuryglass.chunk_atlas.mapping;
 
+import com.centuryglass.chunk_atlas.mapping.images.PngEncoder;
 import com.centuryglass.chunk_atlas.util.ExtendedValidate;
 import java.awt.Color;
 import java.awt.Point;
@@ -33,6 +34,7 @@ public abstract class WorldMap
         this.mapDir = mapDir;
         this.fileName = fileName;
         chunkSize = pixelsPerChunk;
+        pngEncoder = PngEncoder.DEFAULT;
     }
     
     /**
@@ -66,6 +68,28 @@ public abstract class WorldMap
         return chunkSize;
     }
 
+    /**
+     * Sets the encoder used when saving map images.
+     * 
+     * @param encoder  A PNG encoder with the compression settings this map
+     *                 should use.
+     */
+    public void setPngEncoder(PngEncoder encoder)
+    {
+        Validate.notNull(encoder, "PNG encoder cannot be null.");
+        pngEncoder = encoder;
+    }
+    
+    /**
+     * Gets the encoder used when saving map images.
+     * 
+     * @return  The map's PNG encoder.
+     */
+    public PngEncoder getPngEncoder()
+    {
+        return pngEncoder;
+    }
+
     /**
      * Gets the color applied to a specific chunk.
      *
@@ -87,7 +111,36 @@ public abstract class WorldMap
      *
      * @param color  The color value to apply.
      */
-    public abstract void setChunkColor(int xPos, int zPos, Color color);
+    public final void setChunkColor(int xPos, int zPos, Color color)
+    {
+        Validate.notNull(color, "Chunk color cannot be null.");
+        setChunkRGB(xPos, zPos, color.getRGB());
+    }
+    
+    /**
+     * Gets the packed ARGB color applied to a specific chunk.
+     *
+     * @param xPos  The chunk's x-coordinate.
+     *
+     * @param zPos  The chunk's z-coordinate.
+     *
+     * @return      The chunk's color as an ARGB integer, or zero if the
+     *              coordinate is out of bounds.
+     */
+    public abstract int getChunkRGB(int xPos, int zPos);
+    
+    /**
+     * Sets every pixel of a specific chunk to a packed ARGB color. This is the
+     * main drawing method used by Mappers, and should not allocate any new
+     * objects when drawing within a tile or image that is already loaded.
+     *
+     * @param xPos  The chunk's x-coordinate.
+     *
+     * @param zPos  The chunk's z-coordinate.
+     *
+     * @param argb  The color value to apply, as an ARGB integer.
+     */
+    public abstract void setChunkRGB(int xPos, int zPos, int argb);
     
     /**
      * Gets the color of a single pixel within a mapped chunk.
@@ -223,4 +276,6 @@ public abstract class WorldMap
     private final String fileName;
     // pixels per chunk:
     private final int chunkSize;
+    // Encoder used to save map images:
+    private PngEncoder pngEncoder;
 }
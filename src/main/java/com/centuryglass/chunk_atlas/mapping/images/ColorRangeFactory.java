@@ -10,7 +10,6 @@ import java.awt.Color;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.Collection;
-import java.util.Collections;
 import java.util.function.Consumer;
 import java.util.function.Function;
 import org.apache.commons.lang.Validate;
@@ -56,10 +55,35 @@ public class ColorRangeFactory
      */
     public ColorRangeFactory(Collection<Long> values, ArrayList<Color> colors)
     {
-        validateCollection(values, "Value list");
+        this(toArray(values), colors);
+    }
+    
+    /**
+     * Sorts and saves a primitive value set, and sets default options.
+     * 
+     * @param values  An array of values to be represented with color ranges.
+     *                This array is not modified.
+     * 
+     * @param colors  The color values to be used by each color range, ordered
+     *                from highest to lowest. The size of this ArrayList 
+     *                determines how many color ranges the ColorRangeSet will
+     *                have.
+     */
+    public ColorRangeFactory(long[] values, ArrayList<Color> colors)
+    {
+        Validate.notNull(values, "Value list cannot be null.");
+        Validate.isTrue(values.length > 0, "Value list cannot be empty.");
         validateCollection(colors, "Color list");
-        orderedValues = values.toArray(new Long[values.size()]);
-        Arrays.sort(orderedValues, Collections.reverseOrder());
+        orderedValues = values.clone();
+        Arrays.sort(orderedValues);
+        // Reverse the sorted values, so they're ordered from greatest to
+        // least:
+        for (int i = 0, j = orderedValues.length - 1; i < j; i++, j--)
+        {
+            final long swap = orderedValues[i];
+            orderedValues[i] = orderedValues[j];
+            orderedValues[j] = swap;
+        }
         this.colors = colors;
         rangeAdjuster = value -> value;
         divisionType = DivisionType.BY_COUNT;
@@ -72,6 +96,26 @@ public class ColorRangeFactory
         }
     }
     
+    /**
+     * Copies a validated collection of values into a primitive array.
+     * 
+     * @param values  A collection of values, which must not be null, empty,
+     *                or contain null elements.
+     * 
+     * @return        The values, in collection iteration order.
+     */
+    private static long[] toArray(Collection<Long> values)
+    {
+        validateCollection(values, "Value list");
+        final long[] array = new long[values.size()];
+        int i = 0;
+        for (long value : values)
+        {
+            array[i++] = value;
+        }
+        return array;
+    }
+    
     /**
      * Validates that a collection is not null or empty, and contains no null
      * values.
@@ -80,7 +124,8 @@ public class ColorRangeFactory
      * 
      * @param name        The collection name to print on error messages.
      */
-    private void validateCollection(Collection collection, String name)
+    private static void validateCollection(Collection collection,
+            String name)
     {
         assert (name != null && ! name.isEmpty());
         Validate.notNull(collection, name + " cannot be null.");
@@ -248,7 +293,7 @@ public class ColorRangeFactory
     }
     
     // All values, ordered from greatest to least:
-    private final Long[] orderedValues;
+    private final long[] orderedValues;
     // Colors to apply to ranges, from highest to lowest range:
     private final ArrayList<Color> colors;
     // Function used to adjust the upper bounds of ranges:
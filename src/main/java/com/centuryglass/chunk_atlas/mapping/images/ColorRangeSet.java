@@ -9,7 +9,6 @@ import com.centuryglass.chunk_atlas.config.LogConfig;
 import java.awt.Color;
 import java.util.ArrayList;
 import java.util.Collections;
-import java.util.function.BiFunction;
 import java.util.logging.Level;
 import org.apache.commons.lang.Validate;
 
@@ -167,50 +166,66 @@ public final class ColorRangeSet
      */
     public Color getValueColor(long value)
     {
-        final String FN_NAME = "getValueColor";
-        for (int i = 0; i < ranges.size(); i++)
+        final int rgb = getValueRGB(value);
+        return ranges.isEmpty() ? null : new Color(rgb, true);
+    }
+    
+    /**
+     * Gets the packed ARGB color this range set uses to represent a value,
+     * without allocating any new objects.
+     * 
+     * @param value  A value within the range set.
+     * 
+     * @return       The appropriate color in the range set, or the highest
+     *               range's color if the value exceeds the highest range
+     *               value, or zero if the RangeSet contains no ranges.
+     */
+    public int getValueRGB(long value)
+    {
+        final String FN_NAME = "getValueRGB";
+        final int lastIdx = ranges.size() - 1;
+        for (int i = 0; i <= lastIdx; i++)
         {
             final InternalRange range = ranges.get(i);
             if (value > range.value)
             {
-                return range.color;
+                return range.rgb;
             }
-            final InternalRange nextRange;
-            if (i < (ranges.size() - 1))
+            final long nextValue;
+            final Color nextColor;
+            if (i < lastIdx)
             {
-                nextRange = ranges.get(i + 1);
+                nextValue = ranges.get(i + 1).value;
+                nextColor = ranges.get(i + 1).color;
             }
             else
             {
                 long minValue = Math.min(0, range.value);
-                minValue = Math.min(minValue, value - 1);
-                nextRange = new InternalRange(minValue, Color.BLACK,
-                        FadeType.TO_BLACK, 0);
+                nextValue = Math.min(minValue, value - 1);
+                nextColor = Color.BLACK;
             }
-            if (value <= nextRange.value)
+            if (value <= nextValue)
             {
                 continue;
             }
-            Color endColor = range.getRangeEndColor();
-            if (endColor == null)
+            final int endRGB = range.getRangeEndRGB(nextColor);
+            final double colorStrength = (double) (value - nextValue)
+                    / (double) (range.value - nextValue);
+            final double endColorStrength = 1.0 - colorStrength;
+            int rgb = 0xff000000;
+            for (int shift = 16; shift >= 0; shift -= 8)
             {
-                endColor = range.findRangeEndColor(nextRange.color);
+                final int upper = (range.rgb >> shift) & 0xff;
+                final int lower = (endRGB >> shift) & 0xff;
+                rgb |= ((int) (upper * colorStrength
+                        + lower * endColorStrength)) << shift;
             }
-            final double colorStrength = (double) (value - nextRange.value)
-                    / (double) (range.value - nextRange.value);
-            final double endColorStrength = 1.0 - colorStrength;
-            BiFunction<Integer, Integer, Integer> getComp
-                    = (upper, lower) -> (int) (upper * colorStrength
-                    + lower * endColorStrength);
-            return new Color(
-                    getComp.apply(range.color.getRed(), endColor.getRed()),
-                    getComp.apply(range.color.getGreen(), endColor.getGreen()),
-                    getComp.apply(range.color.getBlue(), endColor.getBlue()));
+            return rgb;
         }
         LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
                 "Failed to find color for value {0} within {1} ranges.",
                 new Object[]{value, ranges.size()});
-        return null;
+        return 0;
     }
     
     /**
@@ -271,6 +286,7 @@ public final class ColorRangeSet
                 + " inclusive, but maxFade = " + maxFade);
             this.value = value;
             this.color = color;
+            this.rgb = color.getRGB();
             this.fadeType = fadeType;
             this.maxFade = maxFade;
             this.rangeEndColor = null;
@@ -300,6 +316,25 @@ public final class ColorRangeSet
          */
         Color getRangeEndColor() { return rangeEndColor; }
         
+        /**
+         * Gets the packed ARGB color mapped to the lowest value in the range,
+         * calculating it first if necessary.
+         * 
+         * @param nextColor  The color assigned to the next range's highest
+         *                   value, used if the end color hasn't been found
+         *                   yet.
+         * 
+         * @return           The lowest value's color as an ARGB integer.
+         */
+        int getRangeEndRGB(Color nextColor)
+        {
+            if (rangeEndColor == null)
+            {
+                findRangeEndColor(nextColor);
+            }
+            return rangeEndRGB;
+        }
+        
         /**
          * Calculates and returns the color mapped to the range's lowest value.
          * This will save the calculated value internally, so that future calls
@@ -338,15 +373,19 @@ public final class ColorRangeSet
                         + minB * fadedStrength);
             }
             rangeEndColor = new Color(minR, minG, minB);
+            rangeEndRGB = rangeEndColor.getRGB();
             return rangeEndColor;
         }
         // Maximum value contained within the range:
         public final long value;
         // The color mapped to the maximum value:
         public final Color color;
+        // The maximum value's color as an ARGB integer:
+        public final int rgb;
         public final FadeType fadeType;
         public final double maxFade;
         private Color rangeEndColor;
+        private int rangeEndRGB;
     }
     
     // Holds all internal ranges:
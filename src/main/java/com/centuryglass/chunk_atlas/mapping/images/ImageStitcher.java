@@ -13,12 +13,21 @@ import java.awt.Color;
 import java.awt.Graphics2D;
 import java.awt.Point;
 import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.io.BufferedOutputStream;
 import java.io.File;
 import java.io.FileNotFoundException;
+import java.io.FileOutputStream;
 import java.io.IOException;
+import java.io.OutputStream;
+import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.HashMap;
+import java.util.List;
 import java.util.Map;
+import java.util.TreeMap;
 import java.util.logging.Level;
+import java.util.stream.Collectors;
 import javax.imageio.ImageIO;
 import org.apache.commons.lang.Validate;
 
@@ -30,6 +39,9 @@ public class ImageStitcher
 {
     private static final String CLASSNAME = ImageStitcher.class.getName();
     
+    // Size of the buffer used when writing the map image file:
+    private static final int OUTPUT_BUFFER_SIZE = 64 << 10;
+    
     /**
      * Read a tile's chunk coordinates from its file name.
      * 
@@ -38,7 +50,7 @@ public class ImageStitcher
      * @return      The Minecraft chunk coordinates of that tile's upper left
      *              corner.
      */
-    private static Point getTilePos(File tile)
+    static Point getTilePos(File tile)
     {
         Validate.notNull(tile, "Map tile file object cannot be null.");
         final String name = tile.getName();
@@ -68,7 +80,9 @@ public class ImageStitcher
     }
     
     /**
-     * Stitches a set of tile images together into a single-image map.
+     * Stitches a set of tile images together into a single-image map. The
+     * map is drawn and saved one row of tiles at a time, so memory use
+     * depends on the map's width but not its height.
      * 
      * @param tileDir                 The directory containing tile images to
      *                                stitch together.
@@ -113,7 +127,6 @@ public class ImageStitcher
             int tileSize,
             boolean drawBackground) throws FileNotFoundException, IOException
     {
-        final String FN_NAME = "stitch";
         ExtendedValidate.isDirectory(tileDir, "Tile source directory");
         ExtendedValidate.couldBeFile(outFile, "Image output path");
         ExtendedValidate.isPositive(width, "Width");
@@ -121,95 +134,219 @@ public class ImageStitcher
         ExtendedValidate.isPositive(pixelsPerChunk, "Pixels per chunk");
         ExtendedValidate.isPositive(tileSize, "Tile size");
         
+        final int xMax = xMin + width;
+        final int zMax = zMin + height;
+        // Find all tiles within the map bounds, grouped by row:
         File [] possibleTiles = tileDir.listFiles();
-        Map <File, Point> tilePoints = new HashMap<>();
+        TreeMap<Integer, Map<File, Point>> tileRows = new TreeMap<>();
         for (File tile : possibleTiles)
         {
             if (tile.isFile() && tile.getPath().endsWith(".png"))
             {
                 Point tilePt = getTilePos(tile);
-                if (tilePt != null)
+                if (tilePt == null || tilePt.x >= xMax || tilePt.y >= zMax
+                        || tilePt.x + tileSize <= xMin
+                        || tilePt.y + tileSize <= zMin)
+                {
+                    continue;
+                }
+                if (! tileRows.containsKey(tilePt.y))
                 {
-                    tilePoints.put(tile, tilePt);
+                    tileRows.put(tilePt.y, new HashMap<>());
                 }
+                tileRows.get(tilePt.y).put(tile, tilePt);
             }
         }
-        if (tilePoints.isEmpty())
+        if (tileRows.isEmpty())
         {
             return; // No valid files, don't waste time on a blank image.
         }
-        
-        BufferedImage combinedMap = new BufferedImage(width * pixelsPerChunk,
-                height * pixelsPerChunk, BufferedImage.TYPE_INT_ARGB);
-        final int xMax = xMin + width;
-        final int zMax = zMin + height;
         final int tilePixels = tileSize * pixelsPerChunk;
-        Graphics2D mapPainter = combinedMap.createGraphics();
-        for (Map.Entry<File, Point> entry : tilePoints.entrySet())
+        writeMapImage(outFile, xMin, zMin, width, height, pixelsPerChunk,
+                tileSize, drawBackground, (painter, firstRow, endRow) ->
         {
-            File tile = entry.getKey();
-            Point tilePt = entry.getValue();
-            if (tilePt == null)
+            final int zStart = zMin + firstRow / pixelsPerChunk;
+            final int zEnd = zMin + (endRow + pixelsPerChunk - 1)
+                    / pixelsPerChunk;
+            List<Map.Entry<File, Point>> bandTiles = new ArrayList<>();
+            tileRows.subMap(zStart - tileSize, false, zEnd, false).values()
+                    .forEach((row) -> bandTiles.addAll(row.entrySet()));
+            // Decode all tiles in the band in parallel:
+            List<BufferedImage> tileImages = bandTiles.parallelStream()
+                    .map((entry) -> readTile(entry.getKey()))
+                    .collect(Collectors.toList());
+            for (int i = 0; i < bandTiles.size(); i++)
             {
-                continue;
-            }
-            final int tileXMax = tilePt.x + tileSize;
-            final int tileZMax = tilePt.y + tileSize;
-            if (tilePt.x >= xMax || tilePt.y >= zMax || tileXMax < xMin 
-                    || tileZMax < zMin)
-            {
-                continue;
-            }
-            BufferedImage tileImage;
-            try
-            {
-                tileImage = ImageIO.read(tile);
-            }
-            catch (IOException e)
-            {
-                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
-                        "Error opening tile '{0}': {1}",
-                        new Object[] { tile.getName(), e });
-                continue;
+                BufferedImage tileImage = tileImages.get(i);
+                if (tileImage != null)
+                {
+                    Point tilePt = bandTiles.get(i).getValue();
+                    painter.drawImage(tileImage,
+                            (tilePt.x - xMin) * pixelsPerChunk,
+                            (tilePt.y - zMin) * pixelsPerChunk,
+                            tilePixels, tilePixels, null);
+                }
             }
-            mapPainter.drawImage(tileImage,
-                    (tilePt.x - xMin) * pixelsPerChunk,
-                    (tilePt.y - zMin) * pixelsPerChunk,
-                    tilePixels, tilePixels, null);
+        });
+    }
+    
+    /**
+     * Draws and saves a single-image map one horizontal band of pixels at a
+     * time, so that the entire image never needs to be held in memory. Bands
+     * within the map area hold at most one row of tiles, and never cross
+     * tile row boundaries.
+     * 
+     * @param outFile         The path where the map image will be saved.
+     * 
+     * @param xMin            The lowest chunk x-coordinate shown within the
+     *                        map image.
+     * 
+     * @param zMin            The lowest chunk z-coordinate shown within the
+     *                        map image.
+     * 
+     * @param width           The width in chunks of the mapped area.
+     * 
+     * @param height          The height in chunks of the mapped area.
+     * 
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     * 
+     * @param tileSize        The width and height in chunks of each tile.
+     * 
+     * @param drawBackground  Whether the Minecraft map background texture
+     *                        should be drawn behind the map.
+     * 
+     * @param mapPainter      Draws map content within each band.
+     * 
+     * @throws IOException    If unable to write the image to the output
+     *                        file.
+     */
+    static void writeMapImage(File outFile, int xMin, int zMin, int width,
+            int height, int pixelsPerChunk, int tileSize,
+            boolean drawBackground, BandPainter mapPainter)
+            throws IOException
+    {
+        final int xMax = xMin + width;
+        final int zMax = zMin + height;
+        final int mapWidth = width * pixelsPerChunk;
+        final int mapHeight = height * pixelsPerChunk;
+        int imageWidth = mapWidth;
+        int imageHeight = mapHeight;
+        BufferedImage background = null;
+        if (drawBackground)
+        {
+            final int largerEdge = Math.max(mapWidth, mapHeight);
+            final int borderWidth = MapBackground.getBorderWidth(largerEdge);
+            imageWidth = largerEdge + 2 * borderWidth;
+            imageHeight = imageWidth;
+            background = MapBackground.getBackgroundImage();
         }
-        // Draw X and Y axis if within the map bounds:
-        mapPainter.setColor(new Color(255, 0, 0, 180));
-        mapPainter.setStroke(new BasicStroke(pixelsPerChunk * 2));
-        if (xMin < 0 && xMax > 0)
+        // Position of the map area within the final image:
+        final int xOffset = (imageWidth - mapWidth) / 2;
+        final int yOffset = (imageHeight - mapHeight) / 2;
+        BufferedImage band = new BufferedImage(imageWidth,
+                Math.min(tileSize * pixelsPerChunk, imageHeight),
+                BufferedImage.TYPE_INT_ARGB);
+        final int[] bandPixels = ((DataBufferInt) band.getRaster()
+                .getDataBuffer()).getData();
+        try (OutputStream out = new BufferedOutputStream(
+                new FileOutputStream(outFile), OUTPUT_BUFFER_SIZE))
         {
-            final int xCenter = (0 - xMin) * pixelsPerChunk;
-            mapPainter.drawLine(xCenter, 0, xCenter, combinedMap.getHeight());
+            PngEncoder.ScanlineWriter writer = PngEncoder.DEFAULT.startImage(
+                    out, imageWidth, imageHeight);
+            int bandTop = 0;
+            while (bandTop < imageHeight)
+            {
+                int bandBottom = Math.min(imageHeight,
+                        bandTop + band.getHeight());
+                final int mapRow = bandTop - yOffset;
+                if (mapRow < 0)
+                {
+                    // End border bands where the map begins:
+                    bandBottom = Math.min(bandBottom, yOffset);
+                }
+                else if (mapRow < mapHeight)
+                {
+                    // End map bands at the next row of tiles:
+                    final int chunkZ = zMin + mapRow / pixelsPerChunk;
+                    final int nextRowZ = Math.floorDiv(chunkZ, tileSize)
+                            * tileSize + tileSize;
+                    bandBottom = Math.min(bandBottom, yOffset + Math.min(
+                            mapHeight, (nextRowZ - zMin) * pixelsPerChunk));
+                }
+                Arrays.fill(bandPixels, 0);
+                Graphics2D painter = band.createGraphics();
+                painter.translate(0, -bandTop);
+                if (background != null)
+                {
+                    painter.drawImage(background, 0, 0, imageWidth,
+                            imageHeight, null);
+                }
+                painter.translate(xOffset, yOffset);
+                painter.clipRect(0, 0, mapWidth, mapHeight);
+                if (mapRow >= 0 && mapRow < mapHeight)
+                {
+                    mapPainter.paint(painter, mapRow, bandBottom - yOffset);
+                }
+                // Draw X and Y axis if within the map bounds:
+                painter.setColor(new Color(255, 0, 0, 180));
+                painter.setStroke(new BasicStroke(pixelsPerChunk * 2));
+                if (xMin < 0 && xMax > 0)
+                {
+                    final int xCenter = (0 - xMin) * pixelsPerChunk;
+                    painter.drawLine(xCenter, 0, xCenter, mapHeight);
+                }
+                if (zMin < 0 && zMax > 0)
+                {
+                    final int zCenter = (0 - zMin) * pixelsPerChunk;
+                    painter.drawLine(0, zCenter, mapWidth, zCenter);
+                }
+                painter.dispose();
+                writer.writeRows(bandPixels, bandBottom - bandTop);
+                bandTop = bandBottom;
+            }
+            writer.finish();
         }
-        if (zMin < 0 && zMax > 0)
+    }
+    
+    /**
+     * Draws map content within one horizontal band of a map image.
+     */
+    interface BandPainter
+    {
+        /**
+         * Draws all map content within a range of map pixel rows.
+         * 
+         * @param painter   Graphics clipped to the band, positioned so that
+         *                  the upper left corner of the mapped area is at the
+         *                  origin.
+         * 
+         * @param firstRow  The first map pixel row within the band.
+         * 
+         * @param endRow    The map pixel row after the band's last row.
+         */
+        void paint(Graphics2D painter, int firstRow, int endRow);
+    }
+    
+    /**
+     * Loads a single tile image.
+     * 
+     * @param tile  A map tile image file.
+     * 
+     * @return      The tile image, or null if the tile couldn't be read.
+     */
+    static BufferedImage readTile(File tile)
+    {
+        final String FN_NAME = "readTile";
+        try
         {
-            final int zCenter = (0 - zMin) * pixelsPerChunk;
-            mapPainter.drawLine(0, zCenter, combinedMap.getWidth(), zCenter);
+            return ImageIO.read(tile);
         }
-        if (drawBackground)
+        catch (IOException e)
         {
-            final int largerEdge = Math.max(combinedMap.getWidth(),
-                    combinedMap.getHeight());
-            final int borderWidth = MapBackground.getBorderWidth(largerEdge);
-            final int frameSize = largerEdge + 2 * borderWidth;
-            BufferedImage imageFrame = new BufferedImage(frameSize, frameSize,
-                    BufferedImage.TYPE_INT_ARGB);
-            BufferedImage background = MapBackground.getBackgroundImage();
-            Graphics2D framePainter = imageFrame.createGraphics();
-            framePainter.drawImage(background, 0, 0, frameSize, frameSize,
-                    null);
-            framePainter.drawImage(combinedMap,
-                    (frameSize - combinedMap.getWidth()) / 2,
-                    (frameSize - combinedMap.getHeight()) / 2,
-                    combinedMap.getWidth(),
-                    combinedMap.getHeight(),
-                    null);
-            combinedMap = imageFrame;
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Error opening tile '{0}': {1}",
+                    new Object[] { tile.getName(), e });
+            return null;
         }
-        ImageIO.write(combinedMap, "png", outFile);  
     }
 }
@@ -0,0 +1,1042 @@
+/**
+ * @file PngEncoder.java
+ *
+ * Encodes map images as PNG files with configurable compression.
+ */
+package com.centuryglass.chunk_atlas.mapping.images;
+
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.io.BufferedOutputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.stream.IntStream;
+import java.util.zip.Adler32;
+import java.util.zip.CRC32;
+import java.util.zip.Deflater;
+import org.apache.commons.lang.Validate;
+
+/**
+ * PngEncoder writes map images as PNG files, using a selected zlib
+ * compression level and row filter strategy so that file size can be traded
+ * against encoding time.
+ *
+ *  Images are scanned once before encoding. Fully opaque images are saved
+ * without an alpha channel, and fully transparent images are replaced with a
+ * tiny cached indexed image of the same size. Encoders may also save images
+ * using no more than 256 colors as palette-indexed images, which suits map
+ * types that draw a small set of fixed colors. Very large images are filtered
+ * and compressed in parallel, splitting the compressed stream into
+ * independently deflated segments.
+ *
+ *  Images too large to hold in memory may instead be written a group of rows
+ * at a time using a ScanlineWriter.
+ *
+ *  PngEncoder objects are immutable, and may be shared between threads.
+ */
+public class PngEncoder
+{
+    /**
+     * Row filter strategies. Except for ADAPTIVE, values are declared in the
+     * same order as their PNG filter type codes.
+     */
+    public enum Filter
+    {
+        /**
+         * Store unchanged pixel bytes.
+         */
+        NONE,
+        /**
+         * Store each byte's difference from the pixel to its left.
+         */
+        SUB,
+        /**
+         * Store each byte's difference from the pixel above it.
+         */
+        UP,
+        /**
+         * Store each byte's difference from the average of the pixels to its
+         * left and above it.
+         */
+        AVERAGE,
+        /**
+         * Store each byte's difference from the closest of its left, upper,
+         * and upper left neighbors.
+         */
+        PAETH,
+        /**
+         * Select a filter for each row, choosing the filter with the lowest
+         * sum of absolute output values.
+         */
+        ADAPTIVE;
+
+        /**
+         * Finds a Filter from its name, ignoring case.
+         *
+         * @param name  A Filter name.
+         *
+         * @return      The matching Filter, or null if no match exists.
+         */
+        public static Filter fromString(String name)
+        {
+            if (name == null)
+            {
+                return null;
+            }
+            for (Filter filter : values())
+            {
+                if (filter.name().equalsIgnoreCase(name.trim()))
+                {
+                    return filter;
+                }
+            }
+            return null;
+        }
+    }
+
+    /**
+     * The compression level used by default.
+     */
+    public static final int DEFAULT_COMPRESSION_LEVEL = 6;
+
+    /**
+     * An encoder using the default compression level and adaptive filtering.
+     */
+    public static final PngEncoder DEFAULT = new PngEncoder(
+            DEFAULT_COMPRESSION_LEVEL, Filter.ADAPTIVE);
+
+    // Bytes that begin every PNG file:
+    private static final byte[] PNG_SIGNATURE =
+    {
+        (byte) 137, 80, 78, 71, 13, 10, 26, 10
+    };
+    // PNG color types:
+    private static final int COLOR_RGB = 2;
+    private static final int COLOR_INDEXED = 3;
+    private static final int COLOR_RGBA = 6;
+    // Bytes per pixel in RGBA images:
+    private static final int RGBA_BYTES = 4;
+    // Maximum number of colors in a palette-indexed image:
+    private static final int MAX_PALETTE_SIZE = 256;
+    // Size of the hash table used to find palette colors:
+    private static final int PALETTE_TABLE_SIZE = 1024;
+    // Number of row filter types defined by the PNG format:
+    private static final int FILTER_TYPE_COUNT = 5;
+    // Minimum amount of filtered image data that will be compressed in
+    // parallel:
+    private static final int PARALLEL_MIN_BYTES = 16 << 20;
+    // Amount of filtered image data compressed by each parallel task:
+    private static final int SEGMENT_BYTES = 1 << 20;
+    // Maximum size of the zlib history window:
+    private static final int DICTIONARY_BYTES = 32 << 10;
+    // Size of buffers used to collect compressed data:
+    private static final int BUFFER_SIZE = 64 << 10;
+    // zlib compression method and window size header byte:
+    private static final int ZLIB_CMF = 0x78;
+
+    // Encoded fully transparent images, keyed by packed width and height:
+    private static final Map<Long, byte[]> transparentImages
+            = new ConcurrentHashMap<>();
+
+    /**
+     * Sets the encoder's compression options on construction.
+     *
+     * @param compressionLevel  The zlib compression level, from zero (no
+     *                          compression) to nine (smallest files).
+     *
+     * @param filter            The row filter strategy to use.
+     */
+    public PngEncoder(int compressionLevel, Filter filter)
+    {
+        this(compressionLevel, filter, false);
+    }
+
+    /**
+     * Sets the encoder's compression and color options on construction.
+     *
+     * @param compressionLevel  The zlib compression level, from zero (no
+     *                          compression) to nine (smallest files).
+     *
+     * @param filter            The row filter strategy to use.
+     *
+     * @param indexedColor      Whether images with no more than 256 distinct
+     *                          colors should be saved as palette-indexed
+     *                          images.
+     */
+    public PngEncoder(int compressionLevel, Filter filter,
+            boolean indexedColor)
+    {
+        ExtendedValidate.inInclusiveBounds(compressionLevel,
+                Deflater.NO_COMPRESSION, Deflater.BEST_COMPRESSION,
+                "PNG compression level");
+        Validate.notNull(filter, "PNG filter cannot be null.");
+        this.compressionLevel = compressionLevel;
+        this.filter = filter;
+        this.indexedColor = indexedColor;
+    }
+
+    /**
+     * Gets the encoder's zlib compression level.
+     *
+     * @return  The compression level, from zero to nine.
+     */
+    public int getCompressionLevel()
+    {
+        return compressionLevel;
+    }
+
+    /**
+     * Gets the encoder's row filter strategy.
+     *
+     * @return  The filter used when encoding images.
+     */
+    public Filter getFilter()
+    {
+        return filter;
+    }
+
+    /**
+     * Checks if the encoder saves images with few colors as palette-indexed
+     * images.
+     *
+     * @return  Whether images with no more than 256 colors are indexed.
+     */
+    public boolean usesIndexedColor()
+    {
+        return indexedColor;
+    }
+
+    /**
+     * Saves an image to a PNG file.
+     *
+     * @param image         The image to save.
+     *
+     * @param imageFile     The file where the image will be written.
+     *
+     * @throws IOException  If the file could not be written.
+     */
+    public void write(BufferedImage image, File imageFile) throws IOException
+    {
+        Validate.notNull(image, "Image cannot be null.");
+        ExtendedValidate.couldBeFile(imageFile, "PNG image file");
+        try (OutputStream out = new BufferedOutputStream(
+                new FileOutputStream(imageFile), BUFFER_SIZE))
+        {
+            encode(image, out);
+        }
+    }
+
+    /**
+     * Writes an image to an output stream as PNG data.
+     *
+     * @param image         The image to encode.
+     *
+     * @param out           The stream where PNG data will be written. This
+     *                      stream will not be closed.
+     *
+     * @throws IOException  If writing to the stream fails.
+     */
+    public void encode(BufferedImage image, OutputStream out)
+            throws IOException
+    {
+        Validate.notNull(image, "Image cannot be null.");
+        Validate.notNull(out, "Output stream cannot be null.");
+        final int width = image.getWidth();
+        final int height = image.getHeight();
+        final int[] pixels = getPixels(image);
+        int alphaAnd = 0xff000000;
+        int alphaOr = 0;
+        for (int argb : pixels)
+        {
+            alphaAnd &= argb;
+            alphaOr |= argb;
+        }
+        if ((alphaOr >>> 24) == 0)
+        {
+            out.write(getTransparentImage(width, height));
+            return;
+        }
+        if (indexedColor && encodeIndexed(pixels, width, height, out))
+        {
+            return;
+        }
+        final boolean opaque = (alphaAnd >>> 24) == 0xff;
+        final int bytesPerPixel = opaque ? 3 : 4;
+        final int rowBytes = 1 + width * bytesPerPixel;
+        final byte[] filtered = new byte[rowBytes * height];
+        final byte[] compressed;
+        if (filtered.length >= PARALLEL_MIN_BYTES)
+        {
+            final int rowsPerBlock = Math.max(1, SEGMENT_BYTES / rowBytes);
+            final int blockCount = (height + rowsPerBlock - 1)
+                    / rowsPerBlock;
+            IntStream.range(0, blockCount).parallel().forEach((block) ->
+            {
+                final int firstRow = block * rowsPerBlock;
+                filterRows(pixels, width, bytesPerPixel, firstRow,
+                        Math.min(height, firstRow + rowsPerBlock), null,
+                        filtered);
+            });
+            compressed = compressParallel(filtered);
+        }
+        else
+        {
+            filterRows(pixels, width, bytesPerPixel, 0, height, null,
+                    filtered);
+            compressed = compress(filtered, compressionLevel);
+        }
+        DataOutputStream dataOut = new DataOutputStream(out);
+        dataOut.write(PNG_SIGNATURE);
+        writeChunk(dataOut, "IHDR", createHeader(width, height, 8,
+                opaque ? COLOR_RGB : COLOR_RGBA));
+        writeChunk(dataOut, "IDAT", compressed);
+        writeChunk(dataOut, "IEND", new byte[0]);
+        dataOut.flush();
+    }
+
+    /**
+     * Starts writing an image to an output stream as PNG data, one group of
+     * rows at a time. Only the rows being written need to be held in memory,
+     * so images too large to create as a single BufferedImage can still be
+     * saved. Images written this way always include an alpha channel.
+     *
+     * @param out           The stream where PNG data will be written. This
+     *                      stream will not be closed.
+     *
+     * @param width         The image width in pixels.
+     *
+     * @param height        The image height in pixels.
+     *
+     * @return              A writer that must receive every image row before
+     *                      it is finished.
+     *
+     * @throws IOException  If writing the PNG header fails.
+     */
+    public ScanlineWriter startImage(OutputStream out, int width, int height)
+            throws IOException
+    {
+        Validate.notNull(out, "Output stream cannot be null.");
+        ExtendedValidate.isPositive(width, "Image width");
+        ExtendedValidate.isPositive(height, "Image height");
+        return new ScanlineWriter(out, width, height);
+    }
+
+    /**
+     * Writes PNG image data incrementally, filtering and compressing each
+     * group of rows as soon as it is received. ScanlineWriter objects are
+     * created with startImage, and should be used by a single thread.
+     */
+    public class ScanlineWriter
+    {
+        /**
+         * Writes the PNG header on construction.
+         *
+         * @param out           The stream where PNG data will be written.
+         *
+         * @param width         The image width in pixels.
+         *
+         * @param height        The image height in pixels.
+         *
+         * @throws IOException  If writing to the stream fails.
+         */
+        private ScanlineWriter(OutputStream out, int width, int height)
+                throws IOException
+        {
+            this.out = new DataOutputStream(out);
+            this.width = width;
+            this.height = height;
+            rowsWritten = 0;
+            priorRow = new byte[width * RGBA_BYTES];
+            deflater = new Deflater(compressionLevel);
+            buffer = new byte[BUFFER_SIZE];
+            this.out.write(PNG_SIGNATURE);
+            writeChunk(this.out, "IHDR", createHeader(width, height, 8,
+                    COLOR_RGBA));
+        }
+
+        /**
+         * Writes the next rows of the image.
+         *
+         * @param pixels        Packed ARGB pixel data holding at least
+         *                      rowCount rows of image pixels, in row order.
+         *
+         * @param rowCount      The number of rows to write.
+         *
+         * @throws IOException  If writing to the stream fails.
+         */
+        public void writeRows(int[] pixels, int rowCount) throws IOException
+        {
+            Validate.notNull(pixels, "Pixel data cannot be null.");
+            ExtendedValidate.isPositive(rowCount, "Row count");
+            Validate.isTrue(rowsWritten + rowCount <= height,
+                    "Rows written cannot exceed the image height.");
+            Validate.isTrue(pixels.length >= rowCount * width,
+                    "Pixel data doesn't hold all written rows.");
+            final int rowBytes = 1 + width * RGBA_BYTES;
+            final byte[] filtered = new byte[rowBytes * rowCount];
+            final int rowsPerBlock = Math.max(1, SEGMENT_BYTES / rowBytes);
+            final int blockCount = (rowCount + rowsPerBlock - 1)
+                    / rowsPerBlock;
+            IntStream.range(0, blockCount).parallel().forEach((block) ->
+            {
+                final int firstRow = block * rowsPerBlock;
+                filterRows(pixels, width, RGBA_BYTES, firstRow,
+                        Math.min(rowCount, firstRow + rowsPerBlock),
+                        priorRow, filtered);
+            });
+            packRow(pixels, (rowCount - 1) * width, width, RGBA_BYTES,
+                    priorRow);
+            rowsWritten += rowCount;
+            deflater.setInput(filtered);
+            while (! deflater.needsInput())
+            {
+                writeData(deflater.deflate(buffer));
+            }
+        }
+
+        /**
+         * Finishes the compressed image data and writes the end of the PNG
+         * file. The writer can't be used after this is called.
+         *
+         * @throws IOException  If writing to the stream fails.
+         */
+        public void finish() throws IOException
+        {
+            Validate.isTrue(rowsWritten == height,
+                    "All image rows must be written before finishing.");
+            try
+            {
+                deflater.finish();
+                while (! deflater.finished())
+                {
+                    writeData(deflater.deflate(buffer));
+                }
+            }
+            finally
+            {
+                deflater.end();
+            }
+            writeChunk(out, "IEND", new byte[0]);
+            out.flush();
+        }
+
+        /**
+         * Writes compressed data from the buffer as an image data chunk.
+         *
+         * @param length        The number of buffered bytes to write.
+         *
+         * @throws IOException  If writing to the stream fails.
+         */
+        private void writeData(int length) throws IOException
+        {
+            if (length > 0)
+            {
+                writeChunk(out, "IDAT", Arrays.copyOf(buffer, length));
+            }
+        }
+
+        // Stream receiving PNG data:
+        private final DataOutputStream out;
+        // Image size in pixels:
+        private final int width;
+        private final int height;
+        // Number of rows written so far:
+        private int rowsWritten;
+        // Samples from the last row written, used when filtering:
+        private final byte[] priorRow;
+        // Compresses all filtered rows into one zlib stream:
+        private final Deflater deflater;
+        // Holds compressed data before it is written:
+        private final byte[] buffer;
+    }
+
+    /**
+     * Gets an image's pixels as packed ARGB values, without copying them if
+     * possible.
+     *
+     * @param image  Any image.
+     *
+     * @return       The image's pixels, in row order.
+     */
+    private static int[] getPixels(BufferedImage image)
+    {
+        final int width = image.getWidth();
+        final int height = image.getHeight();
+        if (image.getType() == BufferedImage.TYPE_INT_ARGB
+                && image.getRaster().getDataBuffer() instanceof DataBufferInt)
+        {
+            int[] data = ((DataBufferInt) image.getRaster().getDataBuffer())
+                    .getData();
+            if (data.length == width * height)
+            {
+                return data;
+            }
+        }
+        return image.getRGB(0, 0, width, height, null, 0, width);
+    }
+
+    /**
+     * Writes an image as a palette-indexed PNG image, if it has few enough
+     * colors. Every fully transparent pixel shares a single palette entry,
+     * and the smallest bit depth able to hold every palette index is used.
+     * Rows are not filtered, as recommended for indexed images.
+     *
+     * @param pixels        All image pixels, as packed ARGB values.
+     *
+     * @param width         The image width in pixels.
+     *
+     * @param height        The image height in pixels.
+     *
+     * @param out           The stream where PNG data will be written.
+     *
+     * @return              Whether the image was written, or false if it has
+     *                      more than 256 colors.
+     *
+     * @throws IOException  If writing to the stream fails.
+     */
+    private boolean encodeIndexed(int[] pixels, int width, int height,
+            OutputStream out) throws IOException
+    {
+        // Find each distinct color, giving up once the palette is full:
+        final int tableMask = PALETTE_TABLE_SIZE - 1;
+        final int[] tableColors = new int[PALETTE_TABLE_SIZE];
+        final short[] tableIndices = new short[PALETTE_TABLE_SIZE];
+        Arrays.fill(tableIndices, (short) -1);
+        final int[] palette = new int[MAX_PALETTE_SIZE];
+        final byte[] indices = new byte[pixels.length];
+        int colorCount = 0;
+        int lastColor = 0;
+        int lastIndex = -1;
+        for (int i = 0; i < pixels.length; i++)
+        {
+            final int argb = ((pixels[i] >>> 24) == 0) ? 0 : pixels[i];
+            if (argb == lastColor && lastIndex != -1)
+            {
+                indices[i] = (byte) lastIndex;
+                continue;
+            }
+            int slot = (argb * 0x9e3779b9) >>> 22;
+            while (tableIndices[slot] != -1 && tableColors[slot] != argb)
+            {
+                slot = (slot + 1) & tableMask;
+            }
+            if (tableIndices[slot] == -1)
+            {
+                if (colorCount == MAX_PALETTE_SIZE)
+                {
+                    return false;
+                }
+                tableColors[slot] = argb;
+                tableIndices[slot] = (short) colorCount;
+                palette[colorCount++] = argb;
+            }
+            lastColor = argb;
+            lastIndex = tableIndices[slot];
+            indices[i] = (byte) lastIndex;
+        }
+        // Put translucent colors first, so the transparency chunk only needs
+        // to cover them:
+        final byte[] remap = new byte[colorCount];
+        final int[] sorted = new int[colorCount];
+        int translucentCount = 0;
+        for (int i = 0; i < colorCount; i++)
+        {
+            if ((palette[i] >>> 24) != 0xff)
+            {
+                remap[i] = (byte) translucentCount;
+                sorted[translucentCount++] = palette[i];
+            }
+        }
+        int sortedCount = translucentCount;
+        for (int i = 0; i < colorCount; i++)
+        {
+            if ((palette[i] >>> 24) == 0xff)
+            {
+                remap[i] = (byte) sortedCount;
+                sorted[sortedCount++] = palette[i];
+            }
+        }
+        int bitDepth = 8;
+        while (bitDepth > 1 && colorCount <= (1 << (bitDepth / 2)))
+        {
+            bitDepth /= 2;
+        }
+        final int rowBytes = (width * bitDepth + 7) / 8;
+        final int pixelsPerByte = 8 / bitDepth;
+        final byte[] rows = new byte[(1 + rowBytes) * height];
+        for (int y = 0; y < height; y++)
+        {
+            // Each row begins with filter type zero:
+            final int rowOffset = y * (1 + rowBytes) + 1;
+            final int pixelOffset = y * width;
+            for (int x = 0; x < width; x++)
+            {
+                final int index = remap[indices[pixelOffset + x] & 0xff]
+                        & 0xff;
+                final int shift = 8 - bitDepth * (1 + x % pixelsPerByte);
+                rows[rowOffset + x / pixelsPerByte] |= (byte) (index
+                        << shift);
+            }
+        }
+        final byte[] paletteData = new byte[colorCount * 3];
+        final byte[] alphaData = new byte[translucentCount];
+        for (int i = 0; i < colorCount; i++)
+        {
+            paletteData[i * 3] = (byte) (sorted[i] >>> 16);
+            paletteData[i * 3 + 1] = (byte) (sorted[i] >>> 8);
+            paletteData[i * 3 + 2] = (byte) sorted[i];
+            if (i < translucentCount)
+            {
+                alphaData[i] = (byte) (sorted[i] >>> 24);
+            }
+        }
+        final byte[] compressed = (rows.length >= PARALLEL_MIN_BYTES)
+                ? compressParallel(rows) : compress(rows, compressionLevel);
+        DataOutputStream dataOut = new DataOutputStream(out);
+        dataOut.write(PNG_SIGNATURE);
+        writeChunk(dataOut, "IHDR", createHeader(width, height, bitDepth,
+                COLOR_INDEXED));
+        writeChunk(dataOut, "PLTE", paletteData);
+        if (translucentCount > 0)
+        {
+            writeChunk(dataOut, "tRNS", alphaData);
+        }
+        writeChunk(dataOut, "IDAT", compressed);
+        writeChunk(dataOut, "IEND", new byte[0]);
+        dataOut.flush();
+        return true;
+    }
+
+    /**
+     * Gets the encoded PNG data for a fully transparent image, creating and
+     * caching it if necessary.
+     *
+     * @param width   The image width in pixels.
+     *
+     * @param height  The image height in pixels.
+     *
+     * @return        A complete PNG file holding a single transparent
+     *                palette color.
+     *
+     * @throws IOException  If the image could not be encoded.
+     */
+    private static byte[] getTransparentImage(int width, int height)
+            throws IOException
+    {
+        final Long key = ((long) width << 32) | height;
+        byte[] encoded = transparentImages.get(key);
+        if (encoded != null)
+        {
+            return encoded;
+        }
+        // One bit per pixel, all selecting the only palette color:
+        final byte[] rows = new byte[(1 + (width + 7) / 8) * height];
+        ByteArrayOutputStream bytesOut = new ByteArrayOutputStream();
+        DataOutputStream dataOut = new DataOutputStream(bytesOut);
+        dataOut.write(PNG_SIGNATURE);
+        writeChunk(dataOut, "IHDR", createHeader(width, height, 1,
+                COLOR_INDEXED));
+        writeChunk(dataOut, "PLTE", new byte[3]);
+        writeChunk(dataOut, "tRNS", new byte[1]);
+        writeChunk(dataOut, "IDAT", compress(rows,
+                Deflater.BEST_COMPRESSION));
+        writeChunk(dataOut, "IEND", new byte[0]);
+        encoded = bytesOut.toByteArray();
+        transparentImages.putIfAbsent(key, encoded);
+        return encoded;
+    }
+
+    /**
+     * Creates PNG header chunk data.
+     *
+     * @param width      The image width in pixels.
+     *
+     * @param height     The image height in pixels.
+     *
+     * @param bitDepth   The number of bits per sample or palette index.
+     *
+     * @param colorType  The PNG color type code.
+     *
+     * @return           The header chunk's data bytes.
+     */
+    private static byte[] createHeader(int width, int height, int bitDepth,
+            int colorType)
+    {
+        return new byte[]
+        {
+            (byte) (width >>> 24), (byte) (width >>> 16),
+            (byte) (width >>> 8), (byte) width,
+            (byte) (height >>> 24), (byte) (height >>> 16),
+            (byte) (height >>> 8), (byte) height,
+            (byte) bitDepth, (byte) colorType,
+            0, // Deflate compression
+            0, // Adaptive filtering
+            0  // No interlacing
+        };
+    }
+
+    /**
+     * Writes a single PNG chunk.
+     *
+     * @param out           The stream where the chunk will be written.
+     *
+     * @param type          The four character chunk type.
+     *
+     * @param data          The chunk's data bytes.
+     *
+     * @throws IOException  If writing to the stream fails.
+     */
+    private static void writeChunk(DataOutputStream out, String type,
+            byte[] data) throws IOException
+    {
+        final byte[] typeBytes = type.getBytes(StandardCharsets.US_ASCII);
+        CRC32 crc = new CRC32();
+        crc.update(typeBytes);
+        crc.update(data);
+        out.writeInt(data.length);
+        out.write(typeBytes);
+        out.write(data);
+        out.writeInt((int) crc.getValue());
+    }
+
+    /**
+     * Converts a range of image rows into filtered PNG scanlines.
+     *
+     * @param pixels         All image pixels, as packed ARGB values.
+     *
+     * @param width          The image width in pixels.
+     *
+     * @param bytesPerPixel  Three to write RGB samples, or four to also write
+     *                       alpha samples.
+     *
+     * @param firstRow       The index of the first row to filter.
+     *
+     * @param endRow         The index after the last row to filter.
+     *
+     * @param initialPrior   Samples of the row above the first row in
+     *                       pixels, or null if the first row is the top of
+     *                       the image.
+     *
+     * @param filtered       The array where all filtered scanlines are
+     *                       stored, each beginning with its filter type.
+     */
+    private void filterRows(int[] pixels, int width, int bytesPerPixel,
+            int firstRow, int endRow, byte[] initialPrior, byte[] filtered)
+    {
+        final int rowLength = width * bytesPerPixel;
+        byte[] row = new byte[rowLength];
+        byte[] prior = new byte[rowLength];
+        if (firstRow > 0)
+        {
+            packRow(pixels, (firstRow - 1) * width, width, bytesPerPixel,
+                    prior);
+        }
+        else if (initialPrior != null)
+        {
+            System.arraycopy(initialPrior, 0, prior, 0, rowLength);
+        }
+        byte[][] candidates = null;
+        if (filter == Filter.ADAPTIVE)
+        {
+            candidates = new byte[FILTER_TYPE_COUNT][rowLength];
+        }
+        for (int y = firstRow; y < endRow; y++)
+        {
+            packRow(pixels, y * width, width, bytesPerPixel, row);
+            final int outOffset = y * (rowLength + 1);
+            int filterType = filter.ordinal();
+            if (candidates != null)
+            {
+                long bestSum = Long.MAX_VALUE;
+                for (int type = 0; type < FILTER_TYPE_COUNT; type++)
+                {
+                    applyFilter(type, row, prior, bytesPerPixel,
+                            candidates[type], 0);
+                    long sum = 0;
+                    for (byte value : candidates[type])
+                    {
+                        sum += Math.abs(value);
+                    }
+                    if (sum < bestSum)
+                    {
+                        bestSum = sum;
+                        filterType = type;
+                    }
+                }
+                System.arraycopy(candidates[filterType], 0, filtered,
+                        outOffset + 1, rowLength);
+            }
+            else
+            {
+                applyFilter(filterType, row, prior, bytesPerPixel, filtered,
+                        outOffset + 1);
+            }
+            filtered[outOffset] = (byte) filterType;
+            byte[] swap = prior;
+            prior = row;
+            row = swap;
+        }
+    }
+
+    /**
+     * Copies a row of packed ARGB pixels into PNG sample order.
+     *
+     * @param pixels         All image pixels.
+     *
+     * @param offset         The index of the row's first pixel.
+     *
+     * @param width          The number of pixels in the row.
+     *
+     * @param bytesPerPixel  Three to copy RGB samples, or four to also copy
+     *                       alpha samples.
+     *
+     * @param row            The array where samples will be stored.
+     */
+    private static void packRow(int[] pixels, int offset, int width,
+            int bytesPerPixel, byte[] row)
+    {
+        int i = 0;
+        for (int x = 0; x < width; x++)
+        {
+            final int argb = pixels[offset + x];
+            row[i++] = (byte) (argb >>> 16);
+            row[i++] = (byte) (argb >>> 8);
+            row[i++] = (byte) argb;
+            if (bytesPerPixel == 4)
+            {
+                row[i++] = (byte) (argb >>> 24);
+            }
+        }
+    }
+
+    /**
+     * Filters a single row of image samples.
+     *
+     * @param type           The PNG filter type code to apply.
+     *
+     * @param row            The row's samples.
+     *
+     * @param prior          The previous row's samples, or all zeros for the
+     *                       first row.
+     *
+     * @param bytesPerPixel  The number of samples in each pixel.
+     *
+     * @param out            The array where filtered bytes are stored.
+     *
+     * @param outOffset      The index of the first filtered byte in out.
+     */
+    private static void applyFilter(int type, byte[] row, byte[] prior,
+            int bytesPerPixel, byte[] out, int outOffset)
+    {
+        final int length = row.length;
+        if (type == Filter.NONE.ordinal())
+        {
+            System.arraycopy(row, 0, out, outOffset, length);
+            return;
+        }
+        for (int i = 0; i < length; i++)
+        {
+            final int left = (i >= bytesPerPixel)
+                    ? (row[i - bytesPerPixel] & 0xff) : 0;
+            final int up = prior[i] & 0xff;
+            int predicted;
+            if (type == Filter.SUB.ordinal())
+            {
+                predicted = left;
+            }
+            else if (type == Filter.UP.ordinal())
+            {
+                predicted = up;
+            }
+            else if (type == Filter.AVERAGE.ordinal())
+            {
+                predicted = (left + up) >>> 1;
+            }
+            else
+            {
+                final int upLeft = (i >= bytesPerPixel)
+                        ? (prior[i - bytesPerPixel] & 0xff) : 0;
+                final int estimate = left + up - upLeft;
+                final int leftDistance = Math.abs(estimate - left);
+                final int upDistance = Math.abs(estimate - up);
+                final int upLeftDistance = Math.abs(estimate - upLeft);
+                if (leftDistance <= upDistance
+                        && leftDistance <= upLeftDistance)
+                {
+                    predicted = left;
+                }
+                else if (upDistance <= upLeftDistance)
+                {
+                    predicted = up;
+                }
+                else
+                {
+                    predicted = upLeft;
+                }
+            }
+            out[outOffset + i] = (byte) (row[i] - predicted);
+        }
+    }
+
+    /**
+     * Compresses data into a single zlib stream.
+     *
+     * @param data   The data to compress.
+     *
+     * @param level  The zlib compression level.
+     *
+     * @return       The compressed zlib stream.
+     */
+    private static byte[] compress(byte[] data, int level)
+    {
+        Deflater deflater = new Deflater(level);
+        try
+        {
+            deflater.setInput(data);
+            deflater.finish();
+            ByteArrayOutputStream out = new ByteArrayOutputStream(
+                    Math.min(BUFFER_SIZE, data.length / 2 + 64));
+            byte[] buffer = new byte[BUFFER_SIZE];
+            while (! deflater.finished())
+            {
+                out.write(buffer, 0, deflater.deflate(buffer));
+            }
+            return out.toByteArray();
+        }
+        finally
+        {
+            deflater.end();
+        }
+    }
+
+    /**
+     * Compresses data into a single zlib stream, deflating separate segments
+     * of the data in parallel. Each segment is primed with the data preceding
+     * it and ends on a byte boundary, so the segments can be joined into one
+     * valid stream.
+     *
+     * @param data  The data to compress.
+     *
+     * @return      The compressed zlib stream.
+     */
+    private byte[] compressParallel(byte[] data)
+    {
+        final int segmentCount = (data.length + SEGMENT_BYTES - 1)
+                / SEGMENT_BYTES;
+        byte[][] segments = IntStream.range(0, segmentCount).parallel()
+                .mapToObj((segment) -> deflateSegment(data,
+                        segment * SEGMENT_BYTES,
+                        Math.min(data.length, (segment + 1) * SEGMENT_BYTES),
+                        segment == segmentCount - 1))
+                .toArray(byte[][]::new);
+        ByteArrayOutputStream out = new ByteArrayOutputStream(
+                data.length / 4);
+        int levelFlag;
+        if (compressionLevel < 2)
+        {
+            levelFlag = 0;
+        }
+        else if (compressionLevel < 6)
+        {
+            levelFlag = 1;
+        }
+        else if (compressionLevel == 6)
+        {
+            levelFlag = 2;
+        }
+        else
+        {
+            levelFlag = 3;
+        }
+        int flags = levelFlag << 6;
+        flags += 31 - (((ZLIB_CMF << 8) | flags) % 31);
+        out.write(ZLIB_CMF);
+        out.write(flags);
+        for (byte[] segment : segments)
+        {
+            out.write(segment, 0, segment.length);
+        }
+        Adler32 checksum = new Adler32();
+        checksum.update(data);
+        final int adler = (int) checksum.getValue();
+        out.write(adler >>> 24);
+        out.write(adler >>> 16);
+        out.write(adler >>> 8);
+        out.write(adler);
+        return out.toByteArray();
+    }
+
+    /**
+     * Compresses one segment of a larger block of data as raw deflate data.
+     *
+     * @param data   All data being compressed.
+     *
+     * @param start  The index of the segment's first byte.
+     *
+     * @param end    The index after the segment's last byte.
+     *
+     * @param last   Whether this is the final segment, which must end the
+     *               deflate stream.
+     *
+     * @return       The compressed segment.
+     */
+    private byte[] deflateSegment(byte[] data, int start, int end,
+            boolean last)
+    {
+        Deflater deflater = new Deflater(compressionLevel, true);
+        try
+        {
+            if (start > 0)
+            {
+                final int dictionaryLength = Math.min(DICTIONARY_BYTES,
+                        start);
+                deflater.setDictionary(data, start - dictionaryLength,
+                        dictionaryLength);
+            }
+            deflater.setInput(data, start, end - start);
+            ByteArrayOutputStream out = new ByteArrayOutputStream(
+                    (end - start) / 4 + 64);
+            byte[] buffer = new byte[BUFFER_SIZE];
+            if (last)
+            {
+                deflater.finish();
+                while (! deflater.finished())
+                {
+                    out.write(buffer, 0, deflater.deflate(buffer));
+                }
+            }
+            else
+            {
+                int written;
+                do
+                {
+                    written = deflater.deflate(buffer, 0, buffer.length,
+                            Deflater.SYNC_FLUSH);
+                    out.write(buffer, 0, written);
+                }
+                while (written == buffer.length);
+            }
+            return out.toByteArray();
+        }
+        finally
+        {
+            deflater.end();
+        }
+    }
+
+    // zlib compression level:
+    private final int compressionLevel;
+    // Row filter strategy:
+    private final Filter filter;
+    // Whether images with few colors are saved with a palette:
+    private final boolean indexedColor;
+}
@@ -0,0 +1,649 @@
+/**
+ * @file TileArchive.java
+ *
+ * Stores a map's tile images within a single indexed file.
+ */
+package com.centuryglass.chunk_atlas.mapping.images;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.io.Closeable;
+import java.io.EOFException;
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.channels.WritableByteChannel;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.logging.Level;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TileArchive holds encoded tile images of a single map within one file, so
+ * large maps don't need hundreds of thousands of small image files. Each tile
+ * is identified by its tile set size, zoom level, and coordinates. Full
+ * detail tiles use the upper left chunk coordinates found in their image file
+ * names, while zoom level tiles use their grid index within their level.
+ *
+ *  The archive begins with a header, followed by one record per stored tile.
+ * Each record starts with the tile's key and data length, and reserves some
+ * extra space so that a tile can usually be replaced in place when its image
+ * grows. Tiles that don't fit are appended to the end of the archive. Once
+ * closed, an index of every tile's record offset is written after the last
+ * record, so readers don't need to scan the whole file. If an archive wasn't
+ * closed, its index is rebuilt from the records when it is opened again.
+ *
+ *  Archives may be opened read-only to serve or upload tiles, or opened for
+ * writing to add, replace, or remove tiles. Writable archives must be closed
+ * to save their index. All methods are thread-safe.
+ */
+public class TileArchive implements Closeable
+{
+    private static final String CLASSNAME = TileArchive.class.getName();
+
+    // Identifies archive files, spelling "CATA":
+    private static final int MAGIC = 0x43415441;
+    private static final int VERSION = 1;
+    // Header: magic, version, main tile size, index entry count, and index
+    // offset:
+    private static final int HEADER_BYTES = 24;
+    // Record header: tile size, zoom, x, y, capacity, and length:
+    private static final int RECORD_HEADER_BYTES = 24;
+    // Offset of the length value within each record header:
+    private static final int RECORD_LENGTH_POS = 20;
+    // Index entry: tile size, zoom, x, y, record offset, capacity, and
+    // length:
+    private static final int INDEX_ENTRY_BYTES = 32;
+    // Length stored in records of removed tiles:
+    private static final int REMOVED = -1;
+    // Extra space reserved in each record, as a fraction of its length:
+    private static final int SPARE_DIVISOR = 8;
+
+    /**
+     * Identifies a single tile within the archive.
+     */
+    public static class Entry
+    {
+        /**
+         * Stores the tile's key values on construction.
+         *
+         * @param size  The tile set size, or the archive's main tile size for
+         *              zoom level tiles.
+         *
+         * @param zoom  The number of times the tile was zoomed out from full
+         *              detail, or zero for full detail tiles.
+         *
+         * @param x     The tile's upper left chunk x-coordinate if at full
+         *              detail, or its grid x-index within its zoom level.
+         *
+         * @param y     The tile's upper left chunk z-coordinate if at full
+         *              detail, or its grid y-index within its zoom level.
+         */
+        public Entry(int size, int zoom, int x, int y)
+        {
+            this.size = size;
+            this.zoom = zoom;
+            this.x = x;
+            this.y = y;
+        }
+
+        @Override
+        public boolean equals(Object obj)
+        {
+            if (! (obj instanceof Entry))
+            {
+                return false;
+            }
+            Entry other = (Entry) obj;
+            return size == other.size && zoom == other.zoom
+                    && x == other.x && y == other.y;
+        }
+
+        @Override
+        public int hashCode()
+        {
+            return ((size * 31 + zoom) * 31 + x) * 31 + y;
+        }
+
+        public final int size;
+        public final int zoom;
+        public final int x;
+        public final int y;
+    }
+
+    /**
+     * Opens an existing archive for reading on construction.
+     *
+     * @param archiveFile   The archive file.
+     *
+     * @throws IOException  If the file couldn't be read or isn't a valid tile
+     *                      archive.
+     */
+    public TileArchive(File archiveFile) throws IOException
+    {
+        ExtendedValidate.isFile(archiveFile, "Tile archive file");
+        this.archiveFile = archiveFile;
+        writable = false;
+        records = new HashMap<>();
+        fileAccess = new RandomAccessFile(archiveFile, "r");
+        channel = fileAccess.getChannel();
+        try
+        {
+            tileSize = readArchive();
+        }
+        catch (IOException e)
+        {
+            fileAccess.close();
+            throw e;
+        }
+    }
+
+    /**
+     * Opens an archive for writing on construction, creating it if needed.
+     * An existing archive is replaced with an empty archive if it is invalid
+     * or was created with a different main tile size.
+     *
+     * @param archiveFile   The archive file.
+     *
+     * @param tileSize      The size of the map's main tile set, used as the
+     *                      size of all zoom level tiles.
+     *
+     * @throws IOException  If the file couldn't be opened or created.
+     */
+    public TileArchive(File archiveFile, int tileSize) throws IOException
+    {
+        final String FN_NAME = "TileArchive";
+        ExtendedValidate.couldBeFile(archiveFile, "Tile archive file");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        this.archiveFile = archiveFile;
+        this.tileSize = tileSize;
+        writable = true;
+        records = new HashMap<>();
+        fileAccess = new RandomAccessFile(archiveFile, "rw");
+        channel = fileAccess.getChannel();
+        try
+        {
+            boolean reset = (channel.size() == 0);
+            if (! reset)
+            {
+                try
+                {
+                    reset = (readArchive() != tileSize);
+                }
+                catch (IOException e)
+                {
+                    LogConfig.getLogger().logp(Level.WARNING, CLASSNAME,
+                            FN_NAME, "Replacing invalid tile archive '{0}': "
+                            + "{1}", new Object[] { archiveFile, e });
+                    reset = true;
+                }
+            }
+            if (reset)
+            {
+                records.clear();
+                dataEnd = HEADER_BYTES;
+            }
+            // Remove the saved index, which will be out of date once the
+            // archive changes:
+            channel.truncate(dataEnd);
+            writeHeader(0, 0);
+        }
+        catch (IOException e)
+        {
+            fileAccess.close();
+            throw e;
+        }
+    }
+
+    /**
+     * Gets the archive's file.
+     *
+     * @return  The file holding all archived tiles.
+     */
+    public File getFile()
+    {
+        return archiveFile;
+    }
+
+    /**
+     * Gets the size of the map's main tile set, which is also the size used
+     * to store all zoom level tiles.
+     *
+     * @return  The main tile size.
+     */
+    public int getTileSize()
+    {
+        return tileSize;
+    }
+
+    /**
+     * Gets the keys of every stored tile.
+     *
+     * @return  A new list holding all tile entries, in no particular order.
+     */
+    public synchronized List<Entry> getEntries()
+    {
+        return new ArrayList<>(records.keySet());
+    }
+
+    /**
+     * Checks if a tile is stored in the archive.
+     *
+     * @param entry  The tile's key.
+     *
+     * @return       Whether the tile can be read.
+     */
+    public synchronized boolean contains(Entry entry)
+    {
+        return records.containsKey(entry);
+    }
+
+    /**
+     * Reads a stored tile's data.
+     *
+     * @param entry         The tile's key.
+     *
+     * @return              The tile's encoded image data, or null if the tile
+     *                      isn't stored.
+     *
+     * @throws IOException  If the archive couldn't be read.
+     */
+    public synchronized byte[] read(Entry entry) throws IOException
+    {
+        Validate.notNull(entry, "Tile entry cannot be null.");
+        Record record = records.get(entry);
+        if (record == null)
+        {
+            return null;
+        }
+        return readData(record);
+    }
+
+    /**
+     * Copies a stored tile's data directly to a channel, so tiles can be
+     * served without copying them into the Java heap.
+     *
+     * @param entry         The tile's key.
+     *
+     * @param target        The channel where the tile's data will be written.
+     *
+     * @return              The number of bytes written, or -1 if the tile
+     *                      isn't stored.
+     *
+     * @throws IOException  If the archive couldn't be read, or the target
+     *                      couldn't be written.
+     */
+    public synchronized long transferTo(Entry entry,
+            WritableByteChannel target) throws IOException
+    {
+        Validate.notNull(entry, "Tile entry cannot be null.");
+        Validate.notNull(target, "Target channel cannot be null.");
+        Record record = records.get(entry);
+        if (record == null)
+        {
+            return -1;
+        }
+        final long start = record.offset + RECORD_HEADER_BYTES;
+        long written = 0;
+        while (written < record.length)
+        {
+            final long count = channel.transferTo(start + written,
+                    record.length - written, target);
+            if (count <= 0)
+            {
+                throw new EOFException("Tile data in '" + archiveFile
+                        + "' is truncated.");
+            }
+            written += count;
+        }
+        return written;
+    }
+
+    /**
+     * Stores a tile's data, replacing any data already stored for the same
+     * tile. Data identical to the stored data isn't written again.
+     *
+     * @param entry         The tile's key.
+     *
+     * @param data          An array holding the tile's encoded image data.
+     *
+     * @param length        The number of bytes to store, starting from the
+     *                      beginning of the array.
+     *
+     * @return              Whether the archive changed.
+     *
+     * @throws IOException  If the archive couldn't be written.
+     */
+    public synchronized boolean write(Entry entry, byte[] data, int length)
+            throws IOException
+    {
+        Validate.notNull(entry, "Tile entry cannot be null.");
+        Validate.notNull(data, "Tile data cannot be null.");
+        ExtendedValidate.inInclusiveBounds(length, 0, data.length,
+                "Tile data length");
+        Validate.isTrue(writable, "Tile archive is read-only.");
+        Record record = records.get(entry);
+        if (record != null && record.length == length)
+        {
+            byte[] saved = readData(record);
+            if (Arrays.equals(saved, Arrays.copyOf(data, length)))
+            {
+                return false;
+            }
+        }
+        if (record != null && record.capacity >= length)
+        {
+            writeFully(ByteBuffer.wrap(data, 0, length),
+                    record.offset + RECORD_HEADER_BYTES);
+            writeLength(record.offset, length);
+            record.length = length;
+            return true;
+        }
+        if (record != null)
+        {
+            writeLength(record.offset, REMOVED);
+        }
+        final int capacity = (int) Math.min(Integer.MAX_VALUE,
+                (long) length + length / SPARE_DIVISOR);
+        ByteBuffer buffer = ByteBuffer.allocate(RECORD_HEADER_BYTES
+                + capacity);
+        buffer.putInt(entry.size).putInt(entry.zoom).putInt(entry.x)
+                .putInt(entry.y).putInt(capacity).putInt(length)
+                .put(data, 0, length);
+        buffer.rewind();
+        writeFully(buffer, dataEnd);
+        records.put(entry, new Record(dataEnd, capacity, length));
+        dataEnd += RECORD_HEADER_BYTES + capacity;
+        return true;
+    }
+
+    /**
+     * Removes a tile from the archive. Space used by removed tiles is not
+     * reclaimed.
+     *
+     * @param entry         The tile's key.
+     *
+     * @return              Whether the tile was stored in the archive.
+     *
+     * @throws IOException  If the archive couldn't be written.
+     */
+    public synchronized boolean remove(Entry entry) throws IOException
+    {
+        Validate.notNull(entry, "Tile entry cannot be null.");
+        Validate.isTrue(writable, "Tile archive is read-only.");
+        Record record = records.remove(entry);
+        if (record == null)
+        {
+            return false;
+        }
+        writeLength(record.offset, REMOVED);
+        return true;
+    }
+
+    /**
+     * Closes the archive. If opened for writing, the archive's index is saved
+     * first. The archive can't be used after it is closed.
+     *
+     * @throws IOException  If the index couldn't be written.
+     */
+    @Override
+    public synchronized void close() throws IOException
+    {
+        if (! channel.isOpen())
+        {
+            return;
+        }
+        try
+        {
+            if (writable)
+            {
+                ByteBuffer index = ByteBuffer.allocate(records.size()
+                        * INDEX_ENTRY_BYTES);
+                records.forEach((entry, record) ->
+                {
+                    index.putInt(entry.size).putInt(entry.zoom)
+                            .putInt(entry.x).putInt(entry.y)
+                            .putLong(record.offset).putInt(record.capacity)
+                            .putInt(record.length);
+                });
+                index.rewind();
+                writeFully(index, dataEnd);
+                channel.truncate(dataEnd + index.capacity());
+                writeHeader(records.size(), dataEnd);
+            }
+        }
+        finally
+        {
+            fileAccess.close();
+        }
+    }
+
+    /**
+     * Reads the archive's header and tile records, using the saved index if
+     * it is current.
+     *
+     * @return              The archive's main tile size.
+     *
+     * @throws IOException  If the file couldn't be read or isn't a valid tile
+     *                      archive.
+     */
+    private int readArchive() throws IOException
+    {
+        ByteBuffer header = ByteBuffer.allocate(HEADER_BYTES);
+        readFully(header, 0);
+        header.flip();
+        if (header.getInt() != MAGIC || header.getInt() != VERSION)
+        {
+            throw new IOException("'" + archiveFile
+                    + "' is not a tile archive.");
+        }
+        final int savedTileSize = header.getInt();
+        final int entryCount = header.getInt();
+        final long indexOffset = header.getLong();
+        final long fileSize = channel.size();
+        if (indexOffset >= HEADER_BYTES && entryCount >= 0
+                && entryCount <= Integer.MAX_VALUE / INDEX_ENTRY_BYTES
+                && indexOffset + (long) entryCount * INDEX_ENTRY_BYTES
+                == fileSize)
+        {
+            ByteBuffer index = ByteBuffer.allocate(entryCount
+                    * INDEX_ENTRY_BYTES);
+            readFully(index, indexOffset);
+            index.flip();
+            for (int i = 0; i < entryCount; i++)
+            {
+                Entry entry = new Entry(index.getInt(), index.getInt(),
+                        index.getInt(), index.getInt());
+                final long offset = index.getLong();
+                final int capacity = index.getInt();
+                final int length = index.getInt();
+                if (offset < HEADER_BYTES || length < 0 || capacity < length
+                        || offset + RECORD_HEADER_BYTES + capacity
+                        > indexOffset)
+                {
+                    throw new IOException("Invalid index in tile archive '"
+                            + archiveFile + "'.");
+                }
+                records.put(entry, new Record(offset, capacity, length));
+            }
+            dataEnd = indexOffset;
+        }
+        else
+        {
+            // The archive wasn't closed, find its tiles from their records:
+            scanRecords(fileSize);
+        }
+        return savedTileSize;
+    }
+
+    /**
+     * Reads every record in the archive, adding all stored tiles to the set
+     * of records. Scanning stops at the first incomplete record, which may
+     * have been interrupted while being written.
+     *
+     * @param fileSize      The size of the archive file in bytes.
+     *
+     * @throws IOException  If the archive couldn't be read.
+     */
+    private void scanRecords(long fileSize) throws IOException
+    {
+        ByteBuffer recordHeader = ByteBuffer.allocate(RECORD_HEADER_BYTES);
+        long offset = HEADER_BYTES;
+        while (offset + RECORD_HEADER_BYTES <= fileSize)
+        {
+            recordHeader.clear();
+            readFully(recordHeader, offset);
+            recordHeader.flip();
+            Entry entry = new Entry(recordHeader.getInt(),
+                    recordHeader.getInt(), recordHeader.getInt(),
+                    recordHeader.getInt());
+            final int capacity = recordHeader.getInt();
+            final int length = recordHeader.getInt();
+            if (capacity < 0 || length > capacity || length < REMOVED
+                    || offset + RECORD_HEADER_BYTES + capacity > fileSize)
+            {
+                break;
+            }
+            if (length != REMOVED)
+            {
+                records.put(entry, new Record(offset, capacity, length));
+            }
+            offset += RECORD_HEADER_BYTES + capacity;
+        }
+        dataEnd = offset;
+    }
+
+    /**
+     * Reads a record's tile data.
+     *
+     * @param record        A stored tile's record.
+     *
+     * @return              The tile's data.
+     *
+     * @throws IOException  If the archive couldn't be read.
+     */
+    private byte[] readData(Record record) throws IOException
+    {
+        byte[] data = new byte[record.length];
+        readFully(ByteBuffer.wrap(data), record.offset + RECORD_HEADER_BYTES);
+        return data;
+    }
+
+    /**
+     * Replaces the length value of a record.
+     *
+     * @param offset        The record's offset in the archive.
+     *
+     * @param length        The new length, or REMOVED.
+     *
+     * @throws IOException  If the archive couldn't be written.
+     */
+    private void writeLength(long offset, int length) throws IOException
+    {
+        ByteBuffer buffer = ByteBuffer.allocate(Integer.BYTES);
+        buffer.putInt(length);
+        buffer.rewind();
+        writeFully(buffer, offset + RECORD_LENGTH_POS);
+    }
+
+    /**
+     * Writes the archive header.
+     *
+     * @param entryCount    The number of entries in the saved index.
+     *
+     * @param indexOffset   The offset of the saved index, or zero if the
+     *                      index isn't current.
+     *
+     * @throws IOException  If the archive couldn't be written.
+     */
+    private void writeHeader(int entryCount, long indexOffset)
+            throws IOException
+    {
+        ByteBuffer header = ByteBuffer.allocate(HEADER_BYTES);
+        header.putInt(MAGIC).putInt(VERSION).putInt(tileSize)
+                .putInt(entryCount).putLong(indexOffset);
+        header.rewind();
+        writeFully(header, 0);
+    }
+
+    /**
+     * Fills a buffer with archive data.
+     *
+     * @param buffer        The buffer to fill, from its position to its
+     *                      limit.
+     *
+     * @param position      The archive offset of the first byte to read.
+     *
+     * @throws IOException  If the archive couldn't be read or ended before
+     *                      the buffer was filled.
+     */
+    private void readFully(ByteBuffer buffer, long position)
+            throws IOException
+    {
+        final int start = buffer.position();
+        while (buffer.hasRemaining())
+        {
+            if (channel.read(buffer, position + buffer.position() - start)
+                    < 0)
+            {
+                throw new EOFException("Tile archive '" + archiveFile
+                        + "' is truncated.");
+            }
+        }
+    }
+
+    /**
+     * Writes all of a buffer's data into the archive.
+     *
+     * @param buffer        The buffer to write, from its position to its
+     *                      limit.
+     *
+     * @param position      The archive offset where the first byte will be
+     *                      written.
+     *
+     * @throws IOException  If the archive couldn't be written.
+     */
+    private void writeFully(ByteBuffer buffer, long position)
+            throws IOException
+    {
+        final int start = buffer.position();
+        while (buffer.hasRemaining())
+        {
+            channel.write(buffer, position + buffer.position() - start);
+        }
+    }
+
+    /**
+     * The location of a stored tile's record.
+     */
+    private static class Record
+    {
+        protected Record(long offset, int capacity, int length)
+        {
+            this.offset = offset;
+            this.capacity = capacity;
+            this.length = length;
+        }
+        protected final long offset;
+        protected final int capacity;
+        protected int length;
+    }
+
+    // The archive file and its open channel:
+    private final File archiveFile;
+    private final RandomAccessFile fileAccess;
+    private final FileChannel channel;
+    // Whether tiles may be added or removed:
+    private final boolean writable;
+    // Size of the map's main tile set:
+    private final int tileSize;
+    // Records of all stored tiles:
+    private final Map<Entry, Record> records;
+    // Offset where the next appended record will be written:
+    private long dataEnd = HEADER_BYTES;
+}
@@ -0,0 +1,348 @@
+/**
+ * @file TileComposer.java
+ *
+ * Assembles a single-image map from finished map tiles.
+ */
+package com.centuryglass.chunk_atlas.mapping.images;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.AlphaComposite;
+import java.awt.Graphics2D;
+import java.awt.Point;
+import java.awt.image.BufferedImage;
+import java.awt.image.DataBufferInt;
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collection;
+import java.util.HashSet;
+import java.util.Set;
+import java.util.logging.Level;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TileComposer builds a single-image map from the pixel data of map tiles as
+ * they are finished, so the image doesn't need to be stitched together from
+ * saved tile files afterwards. The part of each tile within the image bounds
+ * is copied into a raster held in a memory-mapped scratch file, so the
+ * image's size is not limited by available memory. Once all tiles are added,
+ * the raster is saved as a PNG file one band of rows at a time.
+ *
+ *  Tiles that were never added, such as tiles saved by an earlier run or by
+ * another process, can be loaded from their saved files before the image is
+ * finished.
+ *
+ *  TileComposer is not thread-safe, and should be used by a single thread.
+ */
+public class TileComposer
+{
+    private static final String CLASSNAME = TileComposer.class.getName();
+
+    // Maximum size of each mapped section of the scratch file:
+    private static final long MAX_SEGMENT_BYTES = 1L << 30;
+
+    /**
+     * Creates the image's scratch file on construction.
+     *
+     * @param outFile         The path where the map image will be saved.
+     *
+     * @param xMin            The lowest chunk x-coordinate shown within the
+     *                        map image.
+     *
+     * @param zMin            The lowest chunk z-coordinate shown within the
+     *                        map image.
+     *
+     * @param width           The width in chunks of the mapped area.
+     *
+     * @param height          The height in chunks of the mapped area.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param tileSize        The width and height in chunks of each tile.
+     *
+     * @param drawBackground  Whether the Minecraft map background texture
+     *                        should be drawn behind the map.
+     *
+     * @throws IOException    If the scratch file could not be created.
+     */
+    public TileComposer(File outFile, int xMin, int zMin, int width,
+            int height, int pixelsPerChunk, int tileSize,
+            boolean drawBackground) throws IOException
+    {
+        ExtendedValidate.couldBeFile(outFile, "Image output path");
+        ExtendedValidate.isPositive(width, "Width");
+        ExtendedValidate.isPositive(height, "Height");
+        ExtendedValidate.isPositive(pixelsPerChunk, "Pixels per chunk");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        this.outFile = outFile;
+        this.xMin = xMin;
+        this.zMin = zMin;
+        this.width = width;
+        this.height = height;
+        this.pixelsPerChunk = pixelsPerChunk;
+        this.tileSize = tileSize;
+        this.drawBackground = drawBackground;
+        mapWidth = width * pixelsPerChunk;
+        mapHeight = height * pixelsPerChunk;
+        rowBytes = (long) mapWidth * Integer.BYTES;
+        rowsPerSegment = (int) Math.max(1, MAX_SEGMENT_BYTES / rowBytes);
+        File outDir = outFile.getAbsoluteFile().getParentFile();
+        if (! outDir.isDirectory())
+        {
+            outDir.mkdirs();
+        }
+        scratchFile = File.createTempFile(outFile.getName() + "_", ".raster",
+                outDir);
+        scratchFile.deleteOnExit();
+        fileAccess = new RandomAccessFile(scratchFile, "rw");
+        channel = fileAccess.getChannel();
+        segments = new ArrayList<>();
+        addedTiles = new HashSet<>();
+        mapDrawn = false;
+    }
+
+    /**
+     * Gets the file where the map image will be saved.
+     *
+     * @return  The image output file.
+     */
+    public File getOutFile()
+    {
+        return outFile;
+    }
+
+    /**
+     * Copies a finished tile's pixels into the map image.
+     *
+     * @param tilePt  The upper left chunk coordinate of the tile.
+     *
+     * @param pixels  The tile's packed ARGB pixels, in row order.
+     */
+    public void addTile(Point tilePt, int[] pixels)
+    {
+        Validate.notNull(tilePt, "Tile point cannot be null.");
+        Validate.notNull(pixels, "Tile pixels cannot be null.");
+        final int tilePixels = tileSize * pixelsPerChunk;
+        Validate.isTrue(pixels.length == tilePixels * tilePixels,
+                "Tile pixel data doesn't match the map tile size.");
+        addedTiles.add(new Point(tilePt));
+        // Tile position and overlap within the map, in pixels:
+        final int tileLeft = (tilePt.x - xMin) * pixelsPerChunk;
+        final int tileTop = (tilePt.y - zMin) * pixelsPerChunk;
+        final int left = Math.max(0, tileLeft);
+        final int right = Math.min(mapWidth, tileLeft + tilePixels);
+        final int top = Math.max(0, tileTop);
+        final int bottom = Math.min(mapHeight, tileTop + tilePixels);
+        if (left >= right || top >= bottom)
+        {
+            return;
+        }
+        for (int y = top; y < bottom; y++)
+        {
+            IntBuffer row = getRowBuffer(y);
+            row.position(left);
+            row.put(pixels, (y - tileTop) * tilePixels + left - tileLeft,
+                    right - left);
+        }
+        mapDrawn = true;
+    }
+
+    /**
+     * Loads and adds every tile saved within a directory that hasn't already
+     * been added.
+     *
+     * @param tileDir  A directory holding map tile images of the same size
+     *                 as added tiles.
+     */
+    public void addSavedTiles(File tileDir)
+    {
+        Validate.notNull(tileDir, "Tile directory cannot be null.");
+        File[] tileFiles = tileDir.listFiles();
+        if (tileFiles == null)
+        {
+            return;
+        }
+        addSavedTiles(Arrays.asList(tileFiles));
+    }
+
+    /**
+     * Loads and adds every saved tile in a list that hasn't already been
+     * added.
+     *
+     * @param tileFiles  Map tile image files of the same size as added tiles.
+     */
+    public void addSavedTiles(Collection<File> tileFiles)
+    {
+        Validate.notNull(tileFiles, "Tile files cannot be null.");
+        final int tilePixels = tileSize * pixelsPerChunk;
+        for (File tileFile : tileFiles)
+        {
+            if (! tileFile.isFile() || ! tileFile.getName().endsWith(".png"))
+            {
+                continue;
+            }
+            Point tilePt;
+            try
+            {
+                tilePt = ImageStitcher.getTilePos(tileFile);
+            }
+            catch (NumberFormatException e)
+            {
+                tilePt = null;
+            }
+            if (tilePt == null || addedTiles.contains(tilePt)
+                    || tilePt.x >= xMin + width || tilePt.y >= zMin + height
+                    || tilePt.x + tileSize <= xMin
+                    || tilePt.y + tileSize <= zMin)
+            {
+                continue;
+            }
+            BufferedImage tileImage = ImageStitcher.readTile(tileFile);
+            if (tileImage == null)
+            {
+                continue;
+            }
+            BufferedImage argbImage = new BufferedImage(tilePixels,
+                    tilePixels, BufferedImage.TYPE_INT_ARGB);
+            Graphics2D graphics = argbImage.createGraphics();
+            graphics.setComposite(AlphaComposite.Src);
+            graphics.drawImage(tileImage, 0, 0, tilePixels, tilePixels, null);
+            graphics.dispose();
+            addTile(tilePt, ((DataBufferInt) argbImage.getRaster()
+                    .getDataBuffer()).getData());
+        }
+    }
+
+    /**
+     * Saves the map image and deletes the scratch file. If no tile covered
+     * any part of the map, no image is saved. The composer can't be used
+     * after this is called.
+     *
+     * @throws IOException  If unable to write the image to the output file.
+     */
+    public void finish() throws IOException
+    {
+        try
+        {
+            if (mapDrawn)
+            {
+                ImageStitcher.writeMapImage(outFile, xMin, zMin, width,
+                        height, pixelsPerChunk, tileSize, drawBackground,
+                        (painter, firstRow, endRow) ->
+                {
+                    BufferedImage rows = new BufferedImage(mapWidth,
+                            endRow - firstRow, BufferedImage.TYPE_INT_ARGB);
+                    final int[] rowPixels = ((DataBufferInt) rows.getRaster()
+                            .getDataBuffer()).getData();
+                    for (int y = firstRow; y < endRow; y++)
+                    {
+                        getRowBuffer(y).get(rowPixels,
+                                (y - firstRow) * mapWidth, mapWidth);
+                    }
+                    painter.drawImage(rows, 0, firstRow, null);
+                });
+            }
+        }
+        finally
+        {
+            close();
+        }
+    }
+
+    /**
+     * Closes and deletes the scratch file without saving the map image.
+     */
+    public void close()
+    {
+        final String FN_NAME = "close";
+        segments.clear();
+        try
+        {
+            channel.close();
+            fileAccess.close();
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Error closing scratch file '{0}': {1}",
+                    new Object[] { scratchFile, e });
+        }
+        // Mapped data may keep the file open until it is garbage collected,
+        // in which case it will be deleted on exit.
+        scratchFile.delete();
+    }
+
+    /**
+     * Gets a buffer covering a single row of the map raster, mapping more of
+     * the scratch file if necessary. Map sections are only created while
+     * tiles are added, and rows never read are left empty.
+     *
+     * @param row  The index of a map pixel row.
+     *
+     * @return     A native byte order buffer holding exactly one row.
+     */
+    private IntBuffer getRowBuffer(int row)
+    {
+        final int segmentIndex = row / rowsPerSegment;
+        while (segments.size() <= segmentIndex)
+        {
+            final int firstRow = segments.size() * rowsPerSegment;
+            final int segmentRows = Math.min(rowsPerSegment,
+                    mapHeight - firstRow);
+            try
+            {
+                segments.add(channel.map(FileChannel.MapMode.READ_WRITE,
+                        firstRow * rowBytes, segmentRows * rowBytes));
+            }
+            catch (IOException e)
+            {
+                throw new IllegalStateException("Couldn't map scratch file '"
+                        + scratchFile + "': " + e.getMessage(), e);
+            }
+        }
+        ByteBuffer rowBuffer = segments.get(segmentIndex).duplicate();
+        final int offset = (int) ((row % rowsPerSegment) * rowBytes);
+        rowBuffer.position(offset);
+        rowBuffer.limit(offset + (int) rowBytes);
+        return rowBuffer.slice().order(ByteOrder.nativeOrder()).asIntBuffer();
+    }
+
+    // Image output file:
+    private final File outFile;
+    // Mapped area bounds, in chunks:
+    private final int xMin;
+    private final int zMin;
+    private final int width;
+    private final int height;
+    // Width and height in pixels of each chunk:
+    private final int pixelsPerChunk;
+    // Width and height in chunks of each tile:
+    private final int tileSize;
+    // Whether the map background is drawn behind the map:
+    private final boolean drawBackground;
+    // Mapped area size, in pixels:
+    private final int mapWidth;
+    private final int mapHeight;
+    // Size in bytes of each raster row:
+    private final long rowBytes;
+    // Number of rows in each mapped file section:
+    private final int rowsPerSegment;
+    // The scratch file holding the map raster, and its open channel:
+    private final File scratchFile;
+    private final RandomAccessFile fileAccess;
+    private final FileChannel channel;
+    // Mapped file sections, in file order:
+    private final ArrayList<MappedByteBuffer> segments;
+    // Upper left chunk coordinates of all added tiles:
+    private final Set<Point> addedTiles;
+    // Whether any added tile was within the map bounds:
+    private boolean mapDrawn;
+}
@@ -0,0 +1,278 @@
+/**
+ * @file TileWriter.java
+ *
+ * Encodes and saves finished map tile images within background threads.
+ */
+package com.centuryglass.chunk_atlas.mapping.images;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.Graphics2D;
+import java.awt.image.BufferedImage;
+import java.io.File;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.TimeUnit;
+import java.util.function.Consumer;
+import java.util.logging.Level;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TileWriter saves map tile images to PNG files within a pool of background
+ * threads, so that image encoding and disk output can overlap with region file
+ * scanning. Each tile may be saved with its own PngEncoder, allowing different
+ * map types to use different compression settings.
+ *
+ *  Listeners may be registered to receive each file once it has been written,
+ * allowing finished tiles to be uploaded without waiting for the rest of the
+ * map.
+ */
+public class TileWriter
+{
+    private static final String CLASSNAME = TileWriter.class.getName();
+
+    // Maximum time to wait for pending tiles before checking again:
+    private static final long WAIT_TIMEOUT = 1; // seconds
+
+    /**
+     * Creates the writer's thread pool on construction.
+     *
+     * @param threadCount  The number of threads to use for encoding tiles.
+     */
+    public TileWriter(int threadCount)
+    {
+        ExtendedValidate.isPositive(threadCount, "Tile writer thread count");
+        executor = Executors.newFixedThreadPool(threadCount, (runnable) ->
+        {
+            Thread thread = new Thread(runnable, "TileWriter");
+            thread.setDaemon(true);
+            return thread;
+        });
+        listeners = new ArrayList<>();
+        pendingTiles = 0;
+    }
+
+    /**
+     * Adds a function that will be called with each file this writer saves.
+     * Listeners are called within writer threads.
+     *
+     * @param listener  A function that accepts newly written image files.
+     */
+    public synchronized void addWriteListener(Consumer<File> listener)
+    {
+        Validate.notNull(listener, "Write listener cannot be null.");
+        listeners.add(listener);
+    }
+
+    /**
+     * Queues a tile image to be saved in the background. Once submitted, the
+     * image must not be changed.
+     *
+     * @param tileImage    The finished tile image to save.
+     *
+     * @param imageFile    The file where the tile will be saved.
+     *
+     * @param scaledFiles  Alternate image sizes to create by scaling the tile
+     *                     image, mapped to the files where they will be saved.
+     *                     This parameter may be null.
+     */
+    public void submit(BufferedImage tileImage, File imageFile,
+            Map<Integer, File> scaledFiles)
+    {
+        submit(tileImage, imageFile, scaledFiles, PngEncoder.DEFAULT);
+    }
+
+    /**
+     * Queues a tile image to be saved in the background using a specific PNG
+     * encoder. Once submitted, the image must not be changed.
+     *
+     * @param tileImage    The finished tile image to save.
+     *
+     * @param imageFile    The file where the tile will be saved.
+     *
+     * @param scaledFiles  Alternate image sizes to create by scaling the tile
+     *                     image, mapped to the files where they will be saved.
+     *                     This parameter may be null.
+     *
+     * @param encoder      The encoder used to save the tile and its scaled
+     *                     copies.
+     */
+    public void submit(BufferedImage tileImage, File imageFile,
+            Map<Integer, File> scaledFiles, PngEncoder encoder)
+    {
+        Validate.notNull(tileImage, "Tile image cannot be null.");
+        Validate.notNull(encoder, "PNG encoder cannot be null.");
+        ExtendedValidate.couldBeFile(imageFile, "Tile image file");
+        final List<Consumer<File>> currentListeners;
+        synchronized (this)
+        {
+            pendingTiles++;
+            currentListeners = new ArrayList<>(listeners);
+        }
+        executor.execute(() ->
+        {
+            try
+            {
+                List<File> written = writeTile(tileImage, imageFile,
+                        scaledFiles, encoder);
+                for (File file : written)
+                {
+                    currentListeners.forEach((listener) ->
+                    {
+                        listener.accept(file);
+                    });
+                }
+            }
+            finally
+            {
+                synchronized (this)
+                {
+                    pendingTiles--;
+                    notifyAll();
+                }
+            }
+        });
+    }
+
+    /**
+     * Passes a finished tile that was already saved to the disk on to all
+     * write listeners.
+     *
+     * @param imageFile    The file where the tile was saved.
+     *
+     * @param scaledFiles  Alternate image sizes that were saved, mapped to
+     *                     their files. This parameter may be null.
+     */
+    public void announceSaved(File imageFile, Map<Integer, File> scaledFiles)
+    {
+        ExtendedValidate.isFile(imageFile, "Tile image file");
+        final List<Consumer<File>> currentListeners;
+        synchronized (this)
+        {
+            currentListeners = new ArrayList<>(listeners);
+        }
+        List<File> savedFiles = new ArrayList<>();
+        savedFiles.add(imageFile);
+        if (scaledFiles != null)
+        {
+            scaledFiles.values().stream().filter((file) -> file.isFile())
+                    .forEach((file) -> savedFiles.add(file));
+        }
+        for (File file : savedFiles)
+        {
+            currentListeners.forEach((listener) -> listener.accept(file));
+        }
+    }
+
+    /**
+     * Blocks until all submitted tiles have been saved.
+     */
+    public synchronized void awaitCompletion()
+    {
+        while (pendingTiles > 0)
+        {
+            try
+            {
+                wait(TimeUnit.SECONDS.toMillis(WAIT_TIMEOUT));
+            }
+            catch (InterruptedException e)
+            {
+                // Just check again.
+            }
+        }
+    }
+
+    /**
+     * Saves all pending tiles, then stops all writer threads. The writer
+     * should not be used after this method is called.
+     */
+    public void shutdown()
+    {
+        awaitCompletion();
+        executor.shutdown();
+    }
+
+    /**
+     * Immediately saves a tile image and its scaled copies.
+     *
+     * @param tileImage    The tile image to save.
+     *
+     * @param imageFile    The file where the tile will be saved.
+     *
+     * @param scaledFiles  Alternate image sizes to create by scaling the tile
+     *                     image, mapped to the files where they will be saved.
+     *                     This parameter may be null.
+     *
+     * @return             All files that were successfully written.
+     */
+    public static List<File> writeTile(BufferedImage tileImage, File imageFile,
+            Map<Integer, File> scaledFiles)
+    {
+        return writeTile(tileImage, imageFile, scaledFiles,
+                PngEncoder.DEFAULT);
+    }
+
+    /**
+     * Immediately saves a tile image and its scaled copies using a specific
+     * PNG encoder.
+     *
+     * @param tileImage    The tile image to save.
+     *
+     * @param imageFile    The file where the tile will be saved.
+     *
+     * @param scaledFiles  Alternate image sizes to create by scaling the tile
+     *                     image, mapped to the files where they will be saved.
+     *                     This parameter may be null.
+     *
+     * @param encoder      The encoder used to save the tile and its scaled
+     *                     copies.
+     *
+     * @return             All files that were successfully written.
+     */
+    public static List<File> writeTile(BufferedImage tileImage, File imageFile,
+            Map<Integer, File> scaledFiles, PngEncoder encoder)
+    {
+        final String FN_NAME = "writeTile";
+        Validate.notNull(tileImage, "Tile image cannot be null.");
+        Validate.notNull(encoder, "PNG encoder cannot be null.");
+        ExtendedValidate.couldBeFile(imageFile, "Tile image file");
+        List<File> written = new ArrayList<>();
+        try
+        {
+            encoder.write(tileImage, imageFile);
+            written.add(imageFile);
+            if (scaledFiles != null)
+            {
+                for (Map.Entry<Integer, File> entry : scaledFiles.entrySet())
+                {
+                    final int size = entry.getKey();
+                    BufferedImage resizedImage = new BufferedImage(size,
+                            size, BufferedImage.TYPE_INT_ARGB);
+                    Graphics2D graphics = resizedImage.createGraphics();
+                    graphics.drawImage(tileImage, 0, 0, size, size, null);
+                    graphics.dispose();
+                    encoder.write(resizedImage, entry.getValue());
+                    written.add(entry.getValue());
+                }
+            }
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Failed to save tile '{0}' to disk: {1}",
+                    new Object[] { imageFile, e });
+        }
+        return written;
+    }
+
+    // Threads used to encode and save images:
+    private final ExecutorService executor;
+    // Functions to call for each written file:
+    private final List<Consumer<File>> listeners;
+    // Number of submitted tiles that haven't been saved yet:
+    private int pendingTiles;
+}
@@ -8,18 +8,21 @@ package com.centuryglass.chunk_atlas.mapping.maptype;
 
 import com.centuryglass.chunk_atlas.config.LogConfig;
 import com.centuryglass.chunk_atlas.mapping.KeyItem;
+import com.centuryglass.chunk_atlas.mapping.TileMap;
+import com.centuryglass.chunk_atlas.mapping.TilePyramid;
 import com.centuryglass.chunk_atlas.mapping.WorldMap;
+import com.centuryglass.chunk_atlas.util.PointLongMap;
 import com.centuryglass.chunk_atlas.util.TickDuration;
 import com.centuryglass.chunk_atlas.mapping.images.ColorRangeFactory;
 import com.centuryglass.chunk_atlas.mapping.images.ColorRangeSet;
 import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
 import java.awt.Color;
-import java.awt.Point;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
 import java.io.File;
+import java.io.IOException;
 import java.util.ArrayList;
-import java.util.HashMap;
 import java.util.LinkedHashSet;
-import java.util.Map;
 import java.util.Set;
 import java.util.function.Function;
 import java.util.logging.Level;
@@ -50,7 +53,7 @@ public class ActivityMapper extends Mapper
     public ActivityMapper(File imageDir, String regionName, World region)
     {
         super(imageDir, regionName, region);
-        inhabitedTimes = new HashMap<>();
+        inhabitedTimes = new PointLongMap();
         key = new LinkedHashSet<>();
     }
     
@@ -81,24 +84,77 @@ public class ActivityMapper extends Mapper
      *
      * @param chunk  Data for a new map chunk.
      *
-     * @return       Null, as chunk colors are only calculated once the full
-     *               range of inhabited times has been found.
+     * @return       NO_COLOR, as chunk colors are only calculated once the
+     *               full range of inhabited times has been found.
      */
     @Override
-    public Color getChunkColor(ChunkData chunk)
+    public long getChunkRGB(ChunkData chunk)
     {
         Validate.notNull(chunk, "Chunk cannot be null.");
         if (chunk.getErrorType() != ChunkData.ErrorFlag.NONE)
         {
-            return null;
+            return NO_COLOR;
         }
         long inhabitedTime = chunk.getInhabitedTime();
-        Point chunkPt = chunk.getPos();
-        inhabitedTimes.put(chunkPt, inhabitedTime);
+        inhabitedTimes.put(chunk.getPos().x, chunk.getPos().y, inhabitedTime);
         maxTime = Math.max(inhabitedTime, maxTime);
-        return null;
+        return NO_COLOR;
     }
 
+    /**
+     * Activity colors depend on the full range of inhabited times, so
+     * chunks are only drawn during final processing.
+     * 
+     * @return  False, as chunks are not drawn until finalProcessing.
+     */
+    @Override
+    protected boolean drawsChunksImmediately()
+    {
+        return false;
+    }
+    
+    /**
+     * Writes all saved chunk inhabited times.
+     * 
+     * @param out           The stream where mapper state will be written.
+     * 
+     * @throws IOException  If unable to write to the stream.
+     */
+    @Override
+    public void writeState(DataOutputStream out) throws IOException
+    {
+        out.writeLong(maxTime);
+        out.writeInt(inhabitedTimes.size());
+        for (long chunkKey : inhabitedTimes.keys())
+        {
+            final int x = PointLongMap.unpackX(chunkKey);
+            final int z = PointLongMap.unpackZ(chunkKey);
+            out.writeInt(x);
+            out.writeInt(z);
+            out.writeLong(inhabitedTimes.get(x, z, 0));
+        }
+    }
+    
+    /**
+     * Loads saved chunk inhabited times.
+     * 
+     * @param in            A stream holding saved mapper state.
+     * 
+     * @throws IOException  If unable to read valid state data.
+     */
+    @Override
+    public void readState(DataInputStream in) throws IOException
+    {
+        maxTime = Math.max(maxTime, in.readLong());
+        final int count = in.readInt();
+        for (int i = 0; i < count; i++)
+        {
+            final int x = in.readInt();
+            final int z = in.readInt();
+            inhabitedTimes.put(x, z, in.readLong());
+        }
+    }
+    
     /**
      * Draws chunk activity data to the map after all chunks have been
      * analyzed.
@@ -142,13 +198,18 @@ public class ActivityMapper extends Mapper
                         range.maxColor));
             }
         }
-        inhabitedTimes.entrySet().forEach((Map.Entry<Point, Long> entry) ->
+        if (map instanceof TileMap)
+        {
+            // Build zoomed out tiles from values so small areas with high
+            // values stay visible:
+            ((TileMap) map).setPyramidValues((x, z) ->
+            {
+                return inhabitedTimes.get(x, z, TilePyramid.NO_VALUE);
+            }, colorRanges::getValueRGB);
+        }
+        inhabitedTimes.forEach((x, z, mapValue) ->
         {
-            final int x = entry.getKey().x;
-            final int z = entry.getKey().y;
-            final long mapValue = entry.getValue();
-            
-            map.setChunkColor(x, z, colorRanges.getValueColor(mapValue));
+            map.setChunkRGB(x, z, colorRanges.getValueRGB(mapValue));
         });
         super.finalProcessing(map);
         TickDuration maxDuration = new TickDuration(maxTime);
@@ -158,7 +219,7 @@ public class ActivityMapper extends Mapper
     }
 
     // Inhabited times for all map chunks:
-    final Map<Point, Long> inhabitedTimes;
+    final PointLongMap inhabitedTimes;
     // Map color key:
     final Set<KeyItem> key;
     // Longest inhabited time:
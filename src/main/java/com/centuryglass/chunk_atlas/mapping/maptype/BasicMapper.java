@@ -8,8 +8,6 @@ package com.centuryglass.chunk_atlas.mapping.maptype;
 
 import com.centuryglass.chunk_atlas.mapping.KeyItem;
 import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
-import java.awt.Color;
-import java.awt.Point;
 import java.io.File;
 import java.util.LinkedHashSet;
 import java.util.Set;
@@ -22,6 +20,10 @@ import org.bukkit.World;
  */
 public class BasicMapper extends Mapper
 {   
+    // Checkerboard colors, as ARGB integers:
+    private static final int WHITE_RGB = 0xffffffff;
+    private static final int GREEN_RGB = 0xff00ff00;
+    
     /**
      * Sets the mapper's base output directory and mapped region name on
      * construction.
@@ -69,21 +71,18 @@ public class BasicMapper extends Mapper
      * @return       The chunk color.
      */
     @Override
-    public Color getChunkColor(ChunkData chunk)
+    public long getChunkRGB(ChunkData chunk)
     {
         Validate.notNull(chunk, "Chunk cannot be null.");
         if (chunk.getErrorType() != ChunkData.ErrorFlag.NONE)
         {
-            return null;
+            return NO_COLOR;
         }
-        Color white = new Color(255, 255, 255, 255);
-        Color green = new Color(0, 255, 0, 255);
-        Point chunkPoint = chunk.getPos();
-        boolean greenTile = ((chunkPoint.y % 2) == 0);
-        if ((chunkPoint.x % 2) == 0)
+        boolean greenTile = ((chunk.getZPos() % 2) == 0);
+        if ((chunk.getXPos() % 2) == 0)
         {
             greenTile = ! greenTile;
         }
-        return greenTile? green : white;
+        return chunkRGB(greenTile ? GREEN_RGB : WHITE_RGB);
     }    
 }
@@ -11,7 +11,10 @@ import com.centuryglass.chunk_atlas.worldinfo.Biome;
 import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
 import com.centuryglass.chunk_atlas.mapping.images.BiomeTextures;
 import java.awt.Color;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
 import java.io.File;
+import java.io.IOException;
 import java.util.LinkedHashSet;
 import java.util.Map;
 import java.util.Set;
@@ -83,15 +86,14 @@ public class BiomeMapper extends Mapper
      * @return       The chunk's biome color.
      */
     @Override
-    protected Color getChunkColor(ChunkData chunk)
+    protected long getChunkRGB(ChunkData chunk)
     {
         Validate.notNull(chunk, "Chunk cannot be null.");
         if (chunk.getErrorType() != ChunkData.ErrorFlag.NONE)
         {
-            return null;
+            return NO_COLOR;
         }
         Map<Biome, Integer> chunkBiomes = chunk.getBiomeCounts();
-        Color color = null;
         int biomeSum = 0;
         long red = 0;
         long green = 0;
@@ -100,7 +102,7 @@ public class BiomeMapper extends Mapper
         {
             encounteredBiomes.add(entry.getKey());
             Color biomeColor = textureData.getPixel(entry.getKey(),
-                    chunk.getPos().x, chunk.getPos().y, 1);
+                    chunk.getXPos(), chunk.getZPos(), 1);
             int count = entry.getValue();
             if (biomeColor == null)
             {
@@ -111,18 +113,58 @@ public class BiomeMapper extends Mapper
             blue += biomeColor.getBlue() * count;
             biomeSum += count;
         }
-        if (biomeSum > 0)
+        if (biomeSum == 0)
         {
-            red /= biomeSum;
-            green /= biomeSum;
-            blue /= biomeSum;
-            color = new Color((int) red, (int) green, (int) blue, 255);
+            return chunkRGB(BLACK_RGB);
         }
-        else
+        red /= biomeSum;
+        green /= biomeSum;
+        blue /= biomeSum;
+        return chunkRGB(BLACK_RGB | ((int) red << 16) | ((int) green << 8)
+                | (int) blue);
+    }
+    
+    /**
+     * Writes the set of biomes found so far, so the map key stays complete
+     * when resuming from a checkpoint.
+     * 
+     * @param out           The stream where mapper state will be written.
+     * 
+     * @throws IOException  If unable to write to the stream.
+     */
+    @Override
+    public void writeState(DataOutputStream out) throws IOException
+    {
+        out.writeInt(encounteredBiomes.size());
+        for (Biome biome : encounteredBiomes)
+        {
+            out.writeUTF(biome.name());
+        }
+    }
+    
+    /**
+     * Loads a saved set of encountered biomes.
+     * 
+     * @param in            A stream holding saved mapper state.
+     * 
+     * @throws IOException  If unable to read valid state data.
+     */
+    @Override
+    public void readState(DataInputStream in) throws IOException
+    {
+        final int count = in.readInt();
+        for (int i = 0; i < count; i++)
         {
-            color = new Color(0, 0, 0);
+            final String name = in.readUTF();
+            try
+            {
+                encounteredBiomes.add(Biome.valueOf(name));
+            }
+            catch (IllegalArgumentException e)
+            {
+                // Ignore biomes removed since the checkpoint was saved.
+            }
         }
-        return color;
     }
     
     private final BiomeTextures textureData;
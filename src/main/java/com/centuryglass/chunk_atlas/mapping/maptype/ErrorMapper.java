@@ -91,9 +91,9 @@ public class ErrorMapper extends Mapper
      * @return       The chunk color.
      */
     @Override
-    public Color getChunkColor(ChunkData chunk)
+    public long getChunkRGB(ChunkData chunk)
     {
         Validate.notNull(chunk, "Chunk cannot be null.");
-        return ERROR_COLORS.get(chunk.getErrorType());
+        return chunkRGB(ERROR_COLORS.get(chunk.getErrorType()).getRGB());
     }    
 }
@@ -5,16 +5,26 @@
  */
 package com.centuryglass.chunk_atlas.mapping.maptype;
 
+import com.centuryglass.chunk_atlas.mapping.GenerationManifest;
 import com.centuryglass.chunk_atlas.mapping.KeyItem;
 import com.centuryglass.chunk_atlas.mapping.MapImage;
+import com.centuryglass.chunk_atlas.mapping.MapOptions;
+import com.centuryglass.chunk_atlas.mapping.TileCache;
 import com.centuryglass.chunk_atlas.mapping.TileMap;
 import com.centuryglass.chunk_atlas.mapping.WorldMap;
+import com.centuryglass.chunk_atlas.mapping.images.TileComposer;
+import com.centuryglass.chunk_atlas.mapping.images.TileWriter;
 import com.centuryglass.chunk_atlas.util.ExtendedValidate;
 import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
-import java.awt.Color;
 import java.awt.Point;
+import java.awt.Rectangle;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
 import java.io.File;
+import java.io.IOException;
 import java.util.ArrayList;
+import java.util.Collection;
+import java.util.List;
 import java.util.Set;
 import org.apache.commons.lang.Validate;
 import org.bukkit.World;
@@ -27,6 +37,17 @@ import org.bukkit.World;
  */
 public abstract class Mapper
 {
+    /**
+     * The value returned by getChunkRGB when a chunk should not be drawn.
+     * Chunk colors are returned as unsigned 32-bit ARGB values, so this can't
+     * conflict with any chunk color, including fully transparent colors.
+     */
+    protected static final long NO_COLOR = -1;
+    
+    /**
+     * Opaque black, as an ARGB integer.
+     */
+    protected static final int BLACK_RGB = 0xff000000;
 
     /**
      * Sets the mapper's base output directory and mapped region name on
@@ -67,12 +88,41 @@ public abstract class Mapper
     public void initImageMap(int xMin, int zMin, int widthInChunks,
             int heightInChunks, int pixelsPerChunk)
     {
+        initImageMap(xMin, zMin, widthInChunks, heightInChunks,
+                pixelsPerChunk, new MapOptions());
+    }
+    
+    /**
+     * Initializes an empty map that will save its data within a single image,
+     * applying a set of map options.
+     * 
+     * @param xMin            The lowest x-coordinate within the mapped area,
+     *                        measured in chunks.
+     * 
+     * @param zMin            The lowest z-coordinate within the mapped area,
+     *                        measured in chunks.
+     * 
+     * @param widthInChunks   The width of the mapped region in chunks.
+     *
+     * @param heightInChunks  The height of the mapped image in chunks.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each mapped
+     *                        chunk.
+     * 
+     * @param options         Options applied to the new map image.
+     */
+    public void initImageMap(int xMin, int zMin, int widthInChunks,
+            int heightInChunks, int pixelsPerChunk, MapOptions options)
+    {
+        Validate.notNull(options, "Map options cannot be null.");
         ExtendedValidate.isPositive(widthInChunks, "Width in chunks");
         ExtendedValidate.isPositive(heightInChunks, "Height in chunks");
         ExtendedValidate.isPositive(pixelsPerChunk, "Pixels per chunk");
         map = new MapImage(
                 new File(imageDir, getTypeName() + "_" + regionName),
-                xMin, zMin, widthInChunks, heightInChunks, pixelsPerChunk);
+                xMin, zMin, widthInChunks, heightInChunks, pixelsPerChunk,
+                options);
+        map.setPngEncoder(options.getPngEncoder(getMapType()));
     }
     
     /**
@@ -89,10 +139,48 @@ public abstract class Mapper
      *                        chunk.
      */
     public void initTileMap(int tileSize, int[] altSizes, int pixelsPerChunk)
+    {
+        initTileMap(tileSize, altSizes, pixelsPerChunk, null,
+                System.currentTimeMillis(), null, 0, new MapOptions());
+    }
+    
+    /**
+     * Initializes a map that will save its data within a set of tile images,
+     * applying a set of map options.
+     * 
+     * @param tileSize        The width and height in chunks of each map tile
+     *                        image.
+     * 
+     * @param altSizes        The list of alternate scaled tile sizes to
+     *                        create.
+     * 
+     * @param pixelsPerChunk  The width and height in pixels of each mapped
+     *                        chunk.
+     * 
+     * @param tileWriter      An optional TileWriter used to save finished
+     *                        tiles in the background.
+     * 
+     * @param startTime       The time map generation started, in milliseconds
+     *                        since the epoch. Saved tiles modified after this
+     *                        time will be reloaded and updated instead of
+     *                        replaced.
+     * 
+     * @param sharedCache     An optional tile cache shared between Mappers. If
+     *                        null, the map will create its own cache.
+     * 
+     * @param cacheLayer      The shared cache layer reserved for this Mapper.
+     * 
+     * @param options         Options applied to the new tile map.
+     */
+    public void initTileMap(int tileSize, int[] altSizes, int pixelsPerChunk,
+            TileWriter tileWriter, long startTime, TileCache sharedCache,
+            int cacheLayer, MapOptions options)
     {
         ExtendedValidate.isPositive(tileSize, "Tile size");
         map = new TileMap(new File(imageDir, getTypeName()), regionName,
-                tileSize, altSizes, pixelsPerChunk);
+                tileSize, altSizes, pixelsPerChunk, tileWriter, startTime,
+                sharedCache, cacheLayer, options);
+        map.setPngEncoder(options.getPngEncoder(getMapType()));
     }
     
     /**
@@ -153,6 +241,203 @@ public abstract class Mapper
         map.saveToDisk();
     }
     
+    /**
+     * Sets the tiles that will be drawn, if this Mapper creates tile maps and
+     * draws chunks as soon as they're received. This lets zoomed out tiles be
+     * saved as soon as the tiles they cover are finished.
+     * 
+     * @param tilePoints  The upper left chunk coordinates of every tile that
+     *                    will be drawn.
+     */
+    public final void expectTiles(Collection<Point> tilePoints)
+    {
+        Validate.notNull(tilePoints, "Tile points cannot be null.");
+        if (map instanceof TileMap && drawsChunksImmediately())
+        {
+            ((TileMap) map).expectTiles(tilePoints);
+        }
+    }
+    
+    /**
+     * Checks if this Mapper can update saved tiles by redrawing only the areas
+     * that changed. This is only possible if chunks are drawn as soon as
+     * they're received, since map colors then don't depend on other chunks.
+     * 
+     * @return  Whether updateSavedTiles can be used.
+     */
+    public final boolean supportsIncrementalUpdates()
+    {
+        return drawsChunksImmediately();
+    }
+    
+    /**
+     * Reuses tiles saved by an earlier run, if this Mapper creates tile maps
+     * and supports incremental updates. Only the changed areas of saved tiles
+     * will be redrawn.
+     * 
+     * @param changedAreas  The chunk coordinate bounds of every area that will
+     *                      be redrawn.
+     */
+    public final void updateSavedTiles(Collection<Rectangle> changedAreas)
+    {
+        Validate.notNull(changedAreas, "Changed areas cannot be null.");
+        if (map instanceof TileMap && supportsIncrementalUpdates())
+        {
+            ((TileMap) map).updateSavedTiles(changedAreas);
+        }
+    }
+    
+    /**
+     * Saves and unloads a set of finished map tiles, if this Mapper creates
+     * tile maps and draws chunks as soon as they're received.
+     * 
+     * @param tilePoints  The upper left chunk coordinates of tiles that will
+     *                    not receive any more chunk data.
+     */
+    public final void finishTiles(Collection<Point> tilePoints)
+    {
+        Validate.notNull(tilePoints, "Tile points cannot be null.");
+        if (! (map instanceof TileMap) || ! drawsChunksImmediately())
+        {
+            return;
+        }
+        TileMap tileMap = (TileMap) map;
+        tilePoints.forEach((tilePt) -> tileMap.finishTile(tilePt));
+    }
+    
+    /**
+     * Deletes saved tile images created before this map's start time, such as
+     * preview tiles this Mapper never drew over. This should only be called
+     * after the map is saved.
+     * 
+     * @return  The number of tile images deleted.
+     */
+    public final int removeStaleTiles()
+    {
+        if (map instanceof TileMap)
+        {
+            return ((TileMap) map).removeStaleTiles();
+        }
+        return 0;
+    }
+    
+    /**
+     * Builds a single-image map from this Mapper's finished tiles, if it
+     * creates tile maps.
+     * 
+     * @param composer  The composer that will receive every finished tile.
+     * 
+     * @return          Whether the composer will be used. If not, it should
+     *                  be closed.
+     */
+    public final boolean setTileComposer(TileComposer composer)
+    {
+        Validate.notNull(composer, "Tile composer cannot be null.");
+        if (map instanceof TileMap)
+        {
+            ((TileMap) map).setComposer(composer);
+            return true;
+        }
+        return false;
+    }
+    
+    /**
+     * Records every tile file this Mapper saves in a generation manifest, if
+     * it creates tile maps.
+     * 
+     * @param manifest  The manifest of the mapped region.
+     */
+    public final void setGenerationManifest(GenerationManifest manifest)
+    {
+        Validate.notNull(manifest, "Generation manifest cannot be null.");
+        if (map instanceof TileMap)
+        {
+            ((TileMap) map).setGenerationManifest(manifest, getTypeName());
+        }
+    }
+    
+    /**
+     * Adds tiles already saved in this Mapper's tile directories to its
+     * generation manifest, if it creates tile maps.
+     */
+    public final void recordSavedTiles()
+    {
+        if (map instanceof TileMap)
+        {
+            ((TileMap) map).recordSavedTiles();
+        }
+    }
+    
+    /**
+     * Copies all tiles recorded in this Mapper's generation manifest into its
+     * tile archive, if it creates tile maps.
+     * 
+     * @param removeFiles  Whether tile image files should be deleted once
+     *                     they are archived.
+     * 
+     * @return             The number of tiles added to the archive or
+     *                     replaced within it.
+     */
+    public final int archiveTiles(boolean removeFiles)
+    {
+        if (map instanceof TileMap)
+        {
+            return ((TileMap) map).archiveTiles(removeFiles);
+        }
+        return 0;
+    }
+    
+    /**
+     * Saves the single-image map built from this Mapper's tiles, if a
+     * TileComposer was set. This should only be called after the map is
+     * saved.
+     */
+    public final void finishComposedImage()
+    {
+        if (map instanceof TileMap)
+        {
+            ((TileMap) map).finishComposer();
+        }
+    }
+    
+    /**
+     * Saves all tile images currently held in memory without unloading them,
+     * so that saved tiles match all chunks drawn so far.
+     */
+    public final void flushMap()
+    {
+        if (map instanceof TileMap)
+        {
+            ((TileMap) map).flushToDisk();
+        }
+    }
+    
+    /**
+     * Writes all chunk data this Mapper is holding until finalProcessing, so
+     * that map generation can later resume from a checkpoint.
+     * 
+     * The default implementation of this method writes nothing. Mapper
+     * subclasses that store chunk data to draw later should override this
+     * method and readState.
+     * 
+     * @param out           The stream where mapper state will be written.
+     * 
+     * @throws IOException  If unable to write to the stream.
+     */
+    public void writeState(DataOutputStream out) throws IOException { }
+    
+    /**
+     * Loads chunk data previously saved with writeState, adding it to any
+     * data this Mapper already holds.
+     * 
+     * The default implementation of this method reads nothing.
+     * 
+     * @param in            A stream holding saved mapper state.
+     * 
+     * @throws IOException  If unable to read valid state data.
+     */
+    public void readState(DataInputStream in) throws IOException { }
+    
     /**
      * Gets the list of map files created by this Mapper.
      * 
@@ -167,6 +452,22 @@ public abstract class Mapper
         return map.getMapFiles();
     }
     
+    /**
+     * Gets a manifest entry for every tile file saved by this Mapper, if it
+     * creates a tile map.
+     * 
+     * @return  A list of tile entries, or null if this Mapper does not create
+     *          a tile map.
+     */
+    public final List<GenerationManifest.Entry> getTileEntries()
+    {
+        if (map instanceof TileMap)
+        {
+            return ((TileMap) map).getTileEntries();
+        }
+        return null;
+    }
+    
     /**
      * Updates the map with data from a single chunk.
      *
@@ -179,26 +480,39 @@ public abstract class Mapper
         {
             return;
         }
-        Color color = getChunkColor(chunk);
-        if (color != null)
+        final long argb = getChunkRGB(chunk);
+        if (argb != NO_COLOR)
         {
-            Point chunkPos = chunk.getPos();
-            map.setChunkColor(chunkPos.x, chunkPos.y, color);
+            map.setChunkRGB(chunk.getXPos(), chunk.getZPos(), (int) argb);
         }
     }
     
+    /**
+     * Converts an ARGB integer to the unsigned value returned by getChunkRGB.
+     *
+     * @param argb  A chunk color as an ARGB integer.
+     *
+     * @return      The color as an unsigned 32-bit value.
+     */
+    protected static long chunkRGB(int argb)
+    {
+        return argb & 0xffffffffL;
+    }
+    
     /**
      * Gets what color, if any, that should be drawn to the map for a specific
      * chunk. 
      *
      * Mapper subclasses will implement this function to control the type of
-     * map that they draw.
+     * map that they draw. This is called once for every chunk in the mapped
+     * region, so implementations should avoid allocating new objects.
      *
      * @param chunk  The chunk that may be drawn.
      *
-     * @return       Any color value, or an empty color value.
+     * @return       The chunk's color as an unsigned ARGB value created with
+     *               chunkRGB, or NO_COLOR if the chunk should not be drawn.
      */
-    protected abstract Color getChunkColor(ChunkData chunk);
+    protected abstract long getChunkRGB(ChunkData chunk);
     
     /**
      * Handles any final tasks that need to be done before the map can
@@ -212,6 +526,21 @@ public abstract class Mapper
      */
     protected void finalProcessing(WorldMap map) { }
     
+    /**
+     * Checks whether this Mapper's final map colors are known as soon as each
+     * chunk is drawn. Map tiles can only be saved early if this is true.
+     *
+     * The default implementation of this method returns true. Mapper
+     * subclasses that wait until finalProcessing to select or blend map colors
+     * should override this to return false.
+     * 
+     * @return  Whether drawn chunks are final before finalProcessing runs.
+     */
+    protected boolean drawsChunksImmediately()
+    {
+        return true;
+    }
+    
     // All map image data:
     private WorldMap map = null;
     // Base directory where images will be saved:
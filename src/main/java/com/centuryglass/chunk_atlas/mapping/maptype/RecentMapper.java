@@ -8,18 +8,21 @@ package com.centuryglass.chunk_atlas.mapping.maptype;
 
 import com.centuryglass.chunk_atlas.config.LogConfig;
 import com.centuryglass.chunk_atlas.mapping.KeyItem;
+import com.centuryglass.chunk_atlas.mapping.TileMap;
+import com.centuryglass.chunk_atlas.mapping.TilePyramid;
 import com.centuryglass.chunk_atlas.mapping.WorldMap;
+import com.centuryglass.chunk_atlas.util.PointLongMap;
 import com.centuryglass.chunk_atlas.util.TickDuration;
 import com.centuryglass.chunk_atlas.mapping.images.ColorRangeFactory;
 import com.centuryglass.chunk_atlas.mapping.images.ColorRangeSet;
 import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
 import java.awt.Color;
-import java.awt.Point;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
 import java.io.File;
+import java.io.IOException;
 import java.util.ArrayList;
-import java.util.HashMap;
 import java.util.LinkedHashSet;
-import java.util.Map;
 import java.util.Set;
 import java.util.function.Function;
 import java.util.logging.Level;
@@ -46,7 +49,7 @@ public class RecentMapper extends Mapper
     public RecentMapper(File imageDir, String regionName, World region)
     {
         super(imageDir, regionName, region);
-        updateTimes = new HashMap<>();
+        updateTimes = new PointLongMap();
         key = new LinkedHashSet<>();
     }
     
@@ -77,19 +80,20 @@ public class RecentMapper extends Mapper
      * 
      * @param chunk  The Minecraft chunk data object.
      * 
-     * @return       Null, as chunk colors cannot be set until the full range
-     *               of update times has been found.
+     * @return       Black, as chunk colors cannot be set until the full range
+     *               of update times has been found, or NO_COLOR if the chunk
+     *               has no update time.
      */
     @Override
-    public Color getChunkColor(ChunkData chunk)
+    public long getChunkRGB(ChunkData chunk)
     {
         Validate.notNull(chunk, "Chunk cannot be null.");
         long lastUpdate = chunk.getLastUpdate();
         if (lastUpdate == 0)
         {
-            return null;
+            return NO_COLOR;
         }
-        updateTimes.put(chunk.getPos(), lastUpdate);
+        updateTimes.put(chunk.getPos().x, chunk.getPos().y, lastUpdate);
         if (lastUpdate < earliestTime)
         {
             earliestTime = lastUpdate;
@@ -98,7 +102,63 @@ public class RecentMapper extends Mapper
         {
             latestTime = lastUpdate;
         }
-        return new Color(0);
+        return chunkRGB(BLACK_RGB);
+    }
+    
+    /**
+     * Update time colors depend on the full range of update times, so
+     * chunks are only drawn during final processing.
+     * 
+     * @return  False, as chunks are not drawn until finalProcessing.
+     */
+    @Override
+    protected boolean drawsChunksImmediately()
+    {
+        return false;
+    }
+    
+    /**
+     * Writes all saved chunk update times.
+     * 
+     * @param out           The stream where mapper state will be written.
+     * 
+     * @throws IOException  If unable to write to the stream.
+     */
+    @Override
+    public void writeState(DataOutputStream out) throws IOException
+    {
+        out.writeLong(earliestTime);
+        out.writeLong(latestTime);
+        out.writeInt(updateTimes.size());
+        for (long chunkKey : updateTimes.keys())
+        {
+            final int x = PointLongMap.unpackX(chunkKey);
+            final int z = PointLongMap.unpackZ(chunkKey);
+            out.writeInt(x);
+            out.writeInt(z);
+            out.writeLong(updateTimes.get(x, z, 0));
+        }
+    }
+    
+    /**
+     * Loads saved chunk update times.
+     * 
+     * @param in            A stream holding saved mapper state.
+     * 
+     * @throws IOException  If unable to read valid state data.
+     */
+    @Override
+    public void readState(DataInputStream in) throws IOException
+    {
+        earliestTime = Math.min(earliestTime, in.readLong());
+        latestTime = Math.max(latestTime, in.readLong());
+        final int count = in.readInt();
+        for (int i = 0; i < count; i++)
+        {
+            final int x = in.readInt();
+            final int z = in.readInt();
+            updateTimes.put(x, z, in.readLong());
+        }
     }
     
     /**
@@ -131,11 +191,19 @@ public class RecentMapper extends Mapper
         };
         rangeFactory.setRangeAdjuster(roundOffsetFromLatest);
         ColorRangeSet colorRanges = rangeFactory.createColorRangeSet();
-        for (Map.Entry<Point, Long> entry : updateTimes.entrySet())
+        if (map instanceof TileMap)
         {
-            map.setChunkColor(entry.getKey().x, entry.getKey().y,
-                    colorRanges.getValueColor(entry.getValue()));
+            // Build zoomed out tiles from values so small areas with high
+            // values stay visible:
+            ((TileMap) map).setPyramidValues((x, z) ->
+            {
+                return updateTimes.get(x, z, TilePyramid.NO_VALUE);
+            }, colorRanges::getValueRGB);
         }
+        updateTimes.forEach((x, z, updateTime) ->
+        {
+            map.setChunkRGB(x, z, colorRanges.getValueRGB(updateTime));
+        });
         
         TickDuration max = new TickDuration(latestTime);
         TickDuration difference = new TickDuration(latestTime - earliestTime);
@@ -161,6 +229,6 @@ public class RecentMapper extends Mapper
     
     private long earliestTime = Long.MAX_VALUE;
     private long latestTime = Long.MIN_VALUE;
-    private final Map<Point, Long> updateTimes;
+    private final PointLongMap updateTimes;
     private final Set<KeyItem> key;
 }
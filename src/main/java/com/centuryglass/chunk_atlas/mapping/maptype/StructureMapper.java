@@ -10,12 +10,14 @@ import com.centuryglass.chunk_atlas.mapping.KeyItem;
 import com.centuryglass.chunk_atlas.mapping.WorldMap;
 import com.centuryglass.chunk_atlas.serverplugin.StructureScanner;
 import com.centuryglass.chunk_atlas.util.MapUnit;
+import com.centuryglass.chunk_atlas.util.PointLongMap;
 import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
 import com.centuryglass.chunk_atlas.worldinfo.Structure;
-import java.awt.Color;
 import java.awt.Point;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
 import java.io.File;
-import java.util.HashMap;
+import java.io.IOException;
 import java.util.LinkedHashSet;
 import java.util.Map;
 import java.util.Set;
@@ -39,6 +41,12 @@ public class StructureMapper extends Mapper
     // Radius used when using the server plugin interface to scan for
     // structures.
     private static final int SCAN_RADIUS = 1;
+
+    // All structure types, indexed by the ordinal values stored as structure
+    // references:
+    private static final Structure[] STRUCTURES = Structure.values();
+    // Stored in place of a structure ordinal when no reference is saved:
+    private static final long NO_STRUCTURE = -1;
     
     /**
      * Sets the mapper's base output directory and mapped region name on
@@ -54,7 +62,7 @@ public class StructureMapper extends Mapper
     public StructureMapper(File imageDir, String regionName, World region)
     {
         super(imageDir, regionName, region);
-        structureRefs = new HashMap<>();
+        structureRefs = new PointLongMap();
         encounteredStructures = new TreeSet<>();
     }
     
@@ -101,31 +109,33 @@ public class StructureMapper extends Mapper
      * @return       The chunk's structure color.
      */
     @Override
-    protected Color getChunkColor(ChunkData chunk)
+    protected long getChunkRGB(ChunkData chunk)
     {
         Validate.notNull(chunk, "Chunk cannot be null.");
         if (chunk.getErrorType() != ChunkData.ErrorFlag.NONE)
         {
-            return null;
+            return NO_COLOR;
         }
-        final Color emptyChunkColor = new Color(0);
-        Color color = emptyChunkColor;
+        final int color = BLACK_RGB;
         //if (getRegion() == null) 
         //{ 
             Map<Point, Structure> chunkStructureRefs = chunk.getStructureRefs();
-            chunkStructureRefs.entrySet().forEach((entry) ->
+            for (Map.Entry<Point, Structure> entry
+                    : chunkStructureRefs.entrySet())
             {
-                if (structureRefs.containsKey(entry.getKey()))
+                final Point refPt = entry.getKey();
+                final long savedRef = structureRefs.get(refPt.x, refPt.y,
+                        NO_STRUCTURE);
+                if (savedRef != NO_STRUCTURE
+                        && STRUCTURES[(int) savedRef].getPriority()
+                        >= entry.getValue().getPriority())
                 {
-                    if (structureRefs.get(entry.getKey()).getPriority()
-                            >= entry.getValue().getPriority())
-                    {
-                        return;
-                    }
+                    continue;
                 }
                 encounteredStructures.add(entry.getValue());
-                structureRefs.put(entry.getKey(), entry.getValue());
-            });
+                structureRefs.put(refPt.x, refPt.y,
+                        entry.getValue().ordinal());
+            }
         //}
         /*
         // Structure scanning through the bukkit/spigot interface is painfully
@@ -146,7 +156,104 @@ public class StructureMapper extends Mapper
             scanner.scan(chunkLocation, SCAN_RADIUS);
         }
         */
-        return color;
+        return chunkRGB(color);
+    }
+    
+    /**
+     * Structure colors are blended with neighboring chunks during final
+     * processing, so tiles can't be finished early.
+     * 
+     * @return  False, as chunks are not drawn until finalProcessing.
+     */
+    @Override
+    protected boolean drawsChunksImmediately()
+    {
+        return false;
+    }
+    
+    /**
+     * Writes all saved structure references.
+     * 
+     * @param out           The stream where mapper state will be written.
+     * 
+     * @throws IOException  If unable to write to the stream.
+     */
+    @Override
+    public void writeState(DataOutputStream out) throws IOException
+    {
+        out.writeInt(structureRefs.size());
+        for (long chunkKey : structureRefs.keys())
+        {
+            final int x = PointLongMap.unpackX(chunkKey);
+            final int z = PointLongMap.unpackZ(chunkKey);
+            out.writeInt(x);
+            out.writeInt(z);
+            out.writeUTF(STRUCTURES[(int) structureRefs.get(x, z,
+                    NO_STRUCTURE)].name());
+        }
+        out.writeInt(encounteredStructures.size());
+        for (Structure structure : encounteredStructures)
+        {
+            out.writeUTF(structure.name());
+        }
+    }
+    
+    /**
+     * Loads saved structure references.
+     * 
+     * @param in            A stream holding saved mapper state.
+     * 
+     * @throws IOException  If unable to read valid state data.
+     */
+    @Override
+    public void readState(DataInputStream in) throws IOException
+    {
+        final int refCount = in.readInt();
+        for (int i = 0; i < refCount; i++)
+        {
+            final int x = in.readInt();
+            final int z = in.readInt();
+            Structure structure = readStructure(in);
+            if (structure != null)
+            {
+                structureRefs.put(x, z, structure.ordinal());
+            }
+        }
+        final int structureCount = in.readInt();
+        for (int i = 0; i < structureCount; i++)
+        {
+            Structure structure = readStructure(in);
+            if (structure != null)
+            {
+                encounteredStructures.add(structure);
+            }
+        }
+    }
+    
+    /**
+     * Reads a saved Structure name from a mapper state stream.
+     * 
+     * @param in            A stream holding saved mapper state.
+     * 
+     * @return              The saved Structure, or null if the saved name
+     *                      isn't a valid Structure.
+     * 
+     * @throws IOException  If unable to read from the stream.
+     */
+    private Structure readStructure(DataInputStream in) throws IOException
+    {
+        final String name = in.readUTF();
+        try
+        {
+            return Structure.valueOf(name);
+        }
+        catch (IllegalArgumentException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME,
+                    "readStructure", "Ignoring unknown saved structure {0}.",
+                    name);
+            return null;
+        }
     }
     
     /**
@@ -171,15 +278,14 @@ public class StructureMapper extends Mapper
                 Structure type = Structure.fromStructureType(entry.getValue());
                 Point chunkPt = MapUnit.convertPoint(entry.getKey(),
                         MapUnit.BLOCK, MapUnit.CHUNK);
-                structureRefs.put(chunkPt, type);
+                structureRefs.put(chunkPt.x, chunkPt.y, type.ordinal());
             }
         }
         final double maxDistance = Math.sqrt(18);
-        for (Map.Entry<Point, Structure> entry : structureRefs.entrySet())
+        structureRefs.forEach((x, z, structureRef) ->
         {
-            Color structColor = entry.getValue().getColor();
-            int x = entry.getKey().x;
-            int z = entry.getKey().y;
+            final int structRGB = STRUCTURES[(int) structureRef].getColor()
+                    .getRGB();
             // Single structure chunks are hard to spot on a big world map.
             // Expand structure points to 5x5 chunk spaces, fading with
             // distance from the main point.
@@ -187,10 +293,10 @@ public class StructureMapper extends Mapper
             {
                 int xI = x + ((i % 5) - 2);
                 int zI = z + ((i / 5) - 2);
-                Color pointColor;
+                int pointRGB;
                 if (xI == x && zI == z)
                 {
-                    pointColor = structColor;
+                    pointRGB = structRGB;
                 }
                 else
                 {
@@ -198,26 +304,23 @@ public class StructureMapper extends Mapper
                     int dZ = z - zI;
                     double distance = Math.sqrt(dX * dX + dZ * dZ);
                     double mult = 1 - (distance / maxDistance);
-                    Color currentColor = map.getChunkColor(xI, zI);
-                    if (currentColor == null)
+                    final int currentRGB = map.getChunkRGB(xI, zI);
+                    pointRGB = BLACK_RGB;
+                    for (int shift = 16; shift >= 0; shift -= 8)
                     {
-                        currentColor = new Color(0);
+                        final int structComp = (structRGB >> shift) & 0xff;
+                        final int currentComp = (currentRGB >> shift) & 0xff;
+                        pointRGB |= ((int) (structComp * mult
+                                + currentComp * (1 - mult))) << shift;
                     }
-                    pointColor = new Color(
-                            (int) (structColor.getRed() * mult
-                                    + currentColor.getRed() * (1 - mult)),
-                            (int) (structColor.getGreen() * mult
-                                    + currentColor.getGreen() * (1 - mult)),
-                            (int) (structColor.getBlue() * mult
-                                    + currentColor.getBlue() * (1 -mult)),
-                            255);
                 }
-                map.setChunkColor(xI, zI, pointColor);  
+                map.setChunkRGB(xI, zI, pointRGB);
             }
-        }
+        });
         super.finalProcessing(map);
     }
     
-    private final Map<Point, Structure> structureRefs;
+    // Structure ordinal values, mapped by chunk coordinate:
+    private final PointLongMap structureRefs;
     private final Set<Structure> encounteredStructures;
 }
@@ -0,0 +1,166 @@
+/**
+ * @file RegionHeader.java
+ *
+ * Reads chunk locations and update times from a Minecraft region file header.
+ */
+package com.centuryglass.chunk_atlas.savedata;
+
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.util.zip.CRC32;
+
+/**
+ * RegionHeader reads only the two 4KiB tables at the start of a Minecraft
+ * region file, providing which chunks exist and when each was last saved
+ * without loading any chunk data. This is cheap enough to do for every region
+ * file before mapping begins.
+ */
+public class RegionHeader
+{
+    // Width/height in chunks of a region file:
+    private static final int DIM_IN_CHUNKS = 32;
+    // Number of chunks in a region file:
+    private static final int NUM_CHUNKS = DIM_IN_CHUNKS * DIM_IN_CHUNKS;
+    // Size in bytes of each header table:
+    private static final int TABLE_SIZE = NUM_CHUNKS * 4;
+
+    /**
+     * Reads the header of a region file on construction.
+     *
+     * @param regionFile    A Minecraft anvil region file.
+     *
+     * @throws IOException  If the file could not be read. Region files too
+     *                      short to hold a full header are treated as empty.
+     */
+    public RegionHeader(File regionFile) throws IOException
+    {
+        ExtendedValidate.isFile(regionFile, "Region file");
+        timestamps = new int[NUM_CHUNKS];
+        presentChunks = new boolean[NUM_CHUNKS];
+        int count = 0;
+        long latest = 0;
+        CRC32 checksum = new CRC32();
+        try (RandomAccessFile file = new RandomAccessFile(regionFile, "r"))
+        {
+            if (file.length() >= (TABLE_SIZE * 2))
+            {
+                byte[] headerBytes = new byte[TABLE_SIZE * 2];
+                file.readFully(headerBytes);
+                ByteBuffer header = ByteBuffer.wrap(headerBytes);
+                for (int i = 0; i < NUM_CHUNKS; i++)
+                {
+                    // Offset table entries are a three byte sector offset
+                    // followed by a one byte sector count:
+                    if (header.getInt(i * 4) != 0)
+                    {
+                        presentChunks[i] = true;
+                        count++;
+                        timestamps[i] = header.getInt(TABLE_SIZE + i * 4);
+                        latest = Math.max(latest,
+                                Integer.toUnsignedLong(timestamps[i]));
+                    }
+                }
+                // Every chunk save updates its timestamp, so the timestamp
+                // table changes whenever any chunk does:
+                checksum.update(headerBytes, TABLE_SIZE, TABLE_SIZE);
+            }
+        }
+        chunkCount = count;
+        latestUpdate = latest;
+        timestampHash = checksum.getValue();
+    }
+
+    /**
+     * Gets the number of chunks saved within the region file.
+     *
+     * @return  The saved chunk count.
+     */
+    public int getChunkCount()
+    {
+        return chunkCount;
+    }
+
+    /**
+     * Gets the most recent time any chunk in the region file was saved.
+     *
+     * @return  The latest chunk timestamp, in seconds since the epoch, or zero
+     *          if the region holds no chunks.
+     */
+    public long getLatestUpdate()
+    {
+        return latestUpdate;
+    }
+
+    /**
+     * Gets a checksum of the region file's chunk timestamp table. This
+     * changes whenever any chunk in the region is saved, but not when the
+     * file is only copied or touched.
+     *
+     * @return  A CRC32 checksum of every chunk timestamp.
+     */
+    public long getTimestampHash()
+    {
+        return timestampHash;
+    }
+
+    /**
+     * Checks if a chunk is saved within the region file.
+     *
+     * @param xOffset  The chunk's x-coordinate offset within the region.
+     *
+     * @param zOffset  The chunk's z-coordinate offset within the region.
+     *
+     * @return         Whether the chunk is saved in the region file.
+     */
+    public boolean chunkExists(int xOffset, int zOffset)
+    {
+        return presentChunks[getIndex(xOffset, zOffset)];
+    }
+
+    /**
+     * Gets the last time a chunk was saved within the region file.
+     *
+     * @param xOffset  The chunk's x-coordinate offset within the region.
+     *
+     * @param zOffset  The chunk's z-coordinate offset within the region.
+     *
+     * @return         The chunk's timestamp, in seconds since the epoch, or
+     *                 zero if the chunk doesn't exist.
+     */
+    public long getChunkTimestamp(int xOffset, int zOffset)
+    {
+        return Integer.toUnsignedLong(timestamps[getIndex(xOffset, zOffset)]);
+    }
+
+    /**
+     * Gets the header table index for a chunk within the region.
+     *
+     * @param xOffset  The chunk's x-coordinate offset within the region.
+     *
+     * @param zOffset  The chunk's z-coordinate offset within the region.
+     *
+     * @return         The chunk's table index.
+     */
+    private static int getIndex(int xOffset, int zOffset)
+    {
+        ExtendedValidate.inInclusiveBounds(xOffset, 0, DIM_IN_CHUNKS - 1,
+                "Chunk x-offset");
+        ExtendedValidate.inInclusiveBounds(zOffset, 0, DIM_IN_CHUNKS - 1,
+                "Chunk z-offset");
+        return xOffset + zOffset * DIM_IN_CHUNKS;
+    }
+
+    // Number of chunks saved in the region:
+    private final int chunkCount;
+    // Latest chunk save time, in seconds:
+    private final long latestUpdate;
+    // Checksum of the chunk timestamp table:
+    private final long timestampHash;
+    // Whether each chunk index is present:
+    private final boolean[] presentChunks;
+    // Chunk save times, stored as unsigned seconds:
+    private final int[] timestamps;
+}
@@ -0,0 +1,425 @@
+/**
+ * @file JobDirectory.java
+ *
+ * Shares worker jobs and their results between processes through a directory.
+ */
+package com.centuryglass.chunk_atlas.threads;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.FileUtil;
+import java.io.File;
+import java.io.IOException;
+import java.nio.file.NoSuchFileException;
+import java.util.Arrays;
+import java.util.logging.Level;
+import org.apache.commons.lang.Validate;
+
+/**
+ * JobDirectory is a simple queue of WorkerJob files stored in a directory
+ * shared by one coordinator and any number of worker processes on the same
+ * machine.
+ *
+ *  Workers claim a job by atomically renaming its file, so each job is only
+ * claimed once. Claimed jobs must be touched periodically while they are
+ * processed, allowing the coordinator to release jobs claimed by workers that
+ * stopped unexpectedly. Once a job is finished, its result file is moved into
+ * place and the claim is removed.
+ *
+ *  Each job records how many times it was released after failing or being
+ * abandoned. Once a job reaches the maximum number of attempts, it is marked
+ * as failed instead of returning to the queue, so a job that always fails
+ * can't keep workers busy forever.
+ */
+public class JobDirectory
+{
+    private static final String CLASSNAME = JobDirectory.class.getName();
+
+    // Job file name suffixes:
+    private static final String JOB_SUFFIX = ".job.json";
+    private static final String CLAIM_SUFFIX = ".claimed.json";
+    private static final String RESULT_SUFFIX = ".result.gz";
+    private static final String FAILED_SUFFIX = ".failed.json";
+    private static final String TEMP_SUFFIX = ".tmp";
+    // Number of failed attempts before a job is no longer offered to
+    // workers:
+    private static final int MAX_ATTEMPTS = 3;
+
+    /**
+     * Opens a job directory, creating it if necessary.
+     *
+     * @param jobDir  The shared job directory.
+     */
+    public JobDirectory(File jobDir)
+    {
+        ExtendedValidate.couldBeDirectory(jobDir, "Job directory");
+        if (! jobDir.isDirectory())
+        {
+            Validate.isTrue(jobDir.mkdirs(), "Couldn't create job directory '"
+                    + jobDir + "'.");
+        }
+        this.jobDir = jobDir;
+    }
+
+    /**
+     * Removes all job, claim, and result files from the directory.
+     */
+    public void clear()
+    {
+        for (File file : listFiles())
+        {
+            String name = file.getName();
+            if (name.endsWith(JOB_SUFFIX) || name.endsWith(CLAIM_SUFFIX)
+                    || name.endsWith(RESULT_SUFFIX)
+                    || name.endsWith(FAILED_SUFFIX)
+                    || name.endsWith(TEMP_SUFFIX))
+            {
+                file.delete();
+            }
+        }
+    }
+
+    /**
+     * Adds a new job to the directory, making it available to workers.
+     *
+     * @param job           The job to add.
+     *
+     * @throws IOException  If the job file could not be written.
+     */
+    public void addJob(WorkerJob job) throws IOException
+    {
+        Validate.notNull(job, "Job cannot be null.");
+        File jobFile = getFile(job.getName(), JOB_SUFFIX);
+        File tempFile = getFile(job.getName(), JOB_SUFFIX + TEMP_SUFFIX);
+        job.save(tempFile);
+        FileUtil.replaceFile(tempFile, jobFile);
+    }
+
+    /**
+     * Claims the next unclaimed job in the directory.
+     *
+     * @return  The claimed job, or null if no unclaimed jobs remain.
+     */
+    public WorkerJob claimNextJob()
+    {
+        final String FN_NAME = "claimNextJob";
+        File[] files = listFiles();
+        Arrays.sort(files);
+        for (File jobFile : files)
+        {
+            final String fileName = jobFile.getName();
+            if (! fileName.endsWith(JOB_SUFFIX))
+            {
+                continue;
+            }
+            final String jobName = fileName.substring(0, fileName.length()
+                    - JOB_SUFFIX.length());
+            File claimFile = getFile(jobName, CLAIM_SUFFIX);
+            try
+            {
+                FileUtil.replaceFile(jobFile, claimFile);
+            }
+            catch (NoSuchFileException e)
+            {
+                // Another worker claimed the job first.
+                continue;
+            }
+            catch (IOException e)
+            {
+                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                        "Failed to claim job '{0}': {1}",
+                        new Object[] { jobFile, e });
+                continue;
+            }
+            claimFile.setLastModified(System.currentTimeMillis());
+            try
+            {
+                return WorkerJob.load(claimFile);
+            }
+            catch (IOException e)
+            {
+                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                        "Skipping invalid job '{0}': {1}",
+                        new Object[] { claimFile, e });
+                try
+                {
+                    FileUtil.replaceFile(claimFile,
+                            getFile(jobName, FAILED_SUFFIX));
+                }
+                catch (IOException moveError)
+                {
+                    claimFile.delete();
+                }
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Claims a job that was marked as failed, so it can be attempted once
+     * more by the coordinator.
+     *
+     * @param jobName  The name of a failed job.
+     *
+     * @return         The claimed job, or null if the job is not marked as
+     *                 failed or could not be loaded.
+     */
+    public WorkerJob claimFailedJob(String jobName)
+    {
+        final String FN_NAME = "claimFailedJob";
+        File claimFile = getFile(jobName, CLAIM_SUFFIX);
+        try
+        {
+            FileUtil.replaceFile(getFile(jobName, FAILED_SUFFIX), claimFile);
+            claimFile.setLastModified(System.currentTimeMillis());
+            return WorkerJob.load(claimFile);
+        }
+        catch (IOException | IllegalArgumentException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Failed to claim failed job {0}: {1}",
+                    new Object[] { jobName, e });
+            return null;
+        }
+    }
+
+    /**
+     * Releases a job claimed by this process after it failed, recording the
+     * failed attempt. The job returns to the queue unless it has reached the
+     * maximum number of attempts, in which case it is marked as failed.
+     *
+     * @param job  A job claimed by this process.
+     *
+     * @return     Whether the job was returned to the queue.
+     */
+    public boolean releaseFailedJob(WorkerJob job)
+    {
+        final String FN_NAME = "releaseFailedJob";
+        Validate.notNull(job, "Job cannot be null.");
+        try
+        {
+            return releaseClaim(job.getName());
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Failed to release job {0}: {1}",
+                    new Object[] { job.getName(), e });
+            return false;
+        }
+    }
+
+    /**
+     * Marks a claimed job as still in progress.
+     *
+     * @param job  A job claimed by this process.
+     */
+    public void touchClaim(WorkerJob job)
+    {
+        Validate.notNull(job, "Job cannot be null.");
+        File claimFile = getFile(job.getName(), CLAIM_SUFFIX);
+        if (claimFile.isFile())
+        {
+            claimFile.setLastModified(System.currentTimeMillis());
+        }
+    }
+
+    /**
+     * Returns jobs to the queue if their claims have not been touched
+     * recently, so that jobs abandoned by stopped workers are still finished.
+     *
+     * @param maxAge  The maximum time in milliseconds since a claim was
+     *                touched before it is considered abandoned.
+     *
+     * @return        The number of released jobs.
+     */
+    public int releaseStaleClaims(long maxAge)
+    {
+        final String FN_NAME = "releaseStaleClaims";
+        ExtendedValidate.isPositive(maxAge, "Maximum claim age");
+        final long now = System.currentTimeMillis();
+        int released = 0;
+        for (File claimFile : listFiles())
+        {
+            final String fileName = claimFile.getName();
+            if (! fileName.endsWith(CLAIM_SUFFIX)
+                    || (now - claimFile.lastModified()) < maxAge)
+            {
+                continue;
+            }
+            final String jobName = fileName.substring(0, fileName.length()
+                    - CLAIM_SUFFIX.length());
+            if (isFinished(jobName))
+            {
+                continue;
+            }
+            try
+            {
+                if (releaseClaim(jobName))
+                {
+                    released++;
+                    LogConfig.getLogger().logp(Level.WARNING, CLASSNAME,
+                            FN_NAME, "Released abandoned job {0}.", jobName);
+                }
+            }
+            catch (IOException e)
+            {
+                // The job was finished or released elsewhere.
+            }
+        }
+        return released;
+    }
+
+    /**
+     * Checks if a job was marked as failed after reaching the maximum number
+     * of attempts.
+     *
+     * @param jobName  The name of a job added to this directory.
+     *
+     * @return         Whether the job is marked as failed.
+     */
+    public boolean isFailed(String jobName)
+    {
+        return getFile(jobName, FAILED_SUFFIX).isFile();
+    }
+
+    /**
+     * Gets the temporary file where a job's result should be written before
+     * calling finishJob.
+     *
+     * @param job  A claimed job.
+     *
+     * @return     The job's temporary result file.
+     */
+    public File getTempResultFile(WorkerJob job)
+    {
+        Validate.notNull(job, "Job cannot be null.");
+        return getFile(job.getName(), RESULT_SUFFIX + TEMP_SUFFIX);
+    }
+
+    /**
+     * Publishes a job's result and removes its claim.
+     *
+     * @param job           A claimed job with a complete temporary result
+     *                      file.
+     *
+     * @throws IOException  If the result file could not be moved into place.
+     */
+    public void finishJob(WorkerJob job) throws IOException
+    {
+        Validate.notNull(job, "Job cannot be null.");
+        FileUtil.replaceFile(getTempResultFile(job),
+                getResultFile(job.getName()));
+        getFile(job.getName(), CLAIM_SUFFIX).delete();
+    }
+
+    /**
+     * Checks if a job has a published result.
+     *
+     * @param jobName  The name of a job added to this directory.
+     *
+     * @return         Whether the job's result file exists.
+     */
+    public boolean isFinished(String jobName)
+    {
+        return getResultFile(jobName).isFile();
+    }
+
+    /**
+     * Gets the file holding a job's result.
+     *
+     * @param jobName  The name of a job added to this directory.
+     *
+     * @return         The job's result file.
+     */
+    public File getResultFile(String jobName)
+    {
+        return getFile(jobName, RESULT_SUFFIX);
+    }
+
+    /**
+     * Gets the directory holding all job files.
+     *
+     * @return  The shared job directory.
+     */
+    public File getDirectory()
+    {
+        return jobDir;
+    }
+
+    /**
+     * Gets a job-specific file within the directory.
+     *
+     * @param jobName  The job's name.
+     *
+     * @param suffix   The file type suffix.
+     *
+     * @return         The requested file.
+     */
+    private File getFile(String jobName, String suffix)
+    {
+        ExtendedValidate.notNullOrEmpty(jobName, "Job name");
+        return new File(jobDir, jobName + suffix);
+    }
+
+    /**
+     * Releases a claimed job, recording one more failed attempt. The job is
+     * returned to the queue, or marked as failed if it has reached the
+     * maximum number of attempts or its claim can't be read.
+     *
+     * @param jobName       The name of a claimed job.
+     *
+     * @return              Whether the job was returned to the queue.
+     *
+     * @throws IOException  If the claim was already released or finished, or
+     *                      the job file could not be written.
+     */
+    private boolean releaseClaim(String jobName) throws IOException
+    {
+        final String FN_NAME = "releaseClaim";
+        // Take the claim first, so only one process can release it:
+        File releaseFile = getFile(jobName, CLAIM_SUFFIX + TEMP_SUFFIX);
+        FileUtil.replaceFile(getFile(jobName, CLAIM_SUFFIX), releaseFile);
+        WorkerJob job;
+        try
+        {
+            job = WorkerJob.load(releaseFile);
+        }
+        catch (IOException e)
+        {
+            LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                    "Marking invalid job {0} as failed: {1}",
+                    new Object[] { jobName, e });
+            FileUtil.replaceFile(releaseFile, getFile(jobName, FAILED_SUFFIX));
+            return false;
+        }
+        job.addAttempt();
+        final boolean failed = job.getAttempts() >= MAX_ATTEMPTS;
+        final String suffix = failed ? FAILED_SUFFIX : JOB_SUFFIX;
+        File tempFile = getFile(jobName, suffix + TEMP_SUFFIX);
+        job.save(tempFile);
+        FileUtil.replaceFile(tempFile, getFile(jobName, suffix));
+        releaseFile.delete();
+        if (failed)
+        {
+            LogConfig.getLogger().logp(Level.SEVERE, CLASSNAME, FN_NAME,
+                    "Job {0} failed {1} times, no longer offering it to "
+                    + "workers.", new Object[] { jobName, job.getAttempts() });
+        }
+        return ! failed;
+    }
+
+    /**
+     * Lists all files in the job directory.
+     *
+     * @return  The directory's files, or an empty array if it can't be read.
+     */
+    private File[] listFiles()
+    {
+        File[] files = jobDir.listFiles();
+        return (files == null) ? new File[0] : files;
+    }
+
+    // Directory shared by all job processes:
+    private final File jobDir;
+}
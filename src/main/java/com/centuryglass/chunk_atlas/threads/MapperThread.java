@@ -6,8 +6,13 @@
 package com.centuryglass.chunk_atlas.threads;
 
 import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.mapping.MapCheckpoint;
 import com.centuryglass.chunk_atlas.mapping.MapCollector;
 import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
+import java.awt.Point;
+import java.io.File;
+import java.io.IOException;
+import java.util.List;
 import java.util.concurrent.BlockingQueue;
 import java.util.concurrent.LinkedBlockingQueue;
 import java.util.concurrent.TimeUnit;
@@ -29,10 +34,53 @@ public class MapperThread extends Thread
      * @param mapCollector  The container holding all map instance types.
      */
     public MapperThread(MapCollector mapCollector)
+    {
+        this(mapCollector, null);
+    }
+    
+    /**
+     *  Stores the map collection object and tile tracker on construction.
+     * 
+     * @param mapCollector  The container holding all map instance types.
+     * 
+     * @param tileTracker   An optional tracker used to find map tiles that are
+     *                      ready to be saved as region files are finished.
+     */
+    public MapperThread(MapCollector mapCollector, TileTracker tileTracker)
+    {
+        this(mapCollector, tileTracker, null, 0);
+    }
+    
+    /**
+     *  Stores the map collection object, tile tracker, and checkpoint
+     *         options on construction.
+     * 
+     * @param mapCollector        The container holding all map instance
+     *                            types.
+     * 
+     * @param tileTracker         An optional tracker used to find map tiles
+     *                            that are ready to be saved as region files
+     *                            are finished.
+     * 
+     * @param checkpoint          An optional checkpoint that will be
+     *                            periodically saved as region files are
+     *                            finished.
+     * 
+     * @param checkpointInterval  Minimum time in milliseconds between saved
+     *                            checkpoints.
+     */
+    public MapperThread(MapCollector mapCollector, TileTracker tileTracker,
+            MapCheckpoint checkpoint, long checkpointInterval)
     {
         Validate.notNull(mapCollector, "Map collector cannot be null.");
+        Validate.isTrue(checkpointInterval >= 0,
+                "Checkpoint interval cannot be negative.");
         this.mapCollector = mapCollector;
-        chunkQueue = new LinkedBlockingQueue<>();
+        this.tileTracker = tileTracker;
+        this.checkpoint = checkpoint;
+        this.checkpointInterval = checkpointInterval;
+        lastCheckpointTime = System.currentTimeMillis();
+        taskQueue = new LinkedBlockingQueue<>();
         shouldExit = new AtomicBoolean();
     }
 
@@ -45,7 +93,7 @@ public class MapperThread extends Thread
         final String FN_NAME = "requestStop";
         LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
                 "{0} map chunks remaining, exiting once all are finished.",
-                chunkQueue.size());
+                taskQueue.size());
         shouldExit.set(true);
     }
 
@@ -57,7 +105,24 @@ public class MapperThread extends Thread
     public void updateMaps(ChunkData chunk)
     {
         Validate.notNull(chunk, "Chunk data cannot be null.");
-        chunkQueue.add(chunk);
+        taskQueue.add(new MapTask(chunk, null));
+    }
+    
+    /**
+     *  Signals that all chunks from a region file have been added to the
+     *         thread. Any map tiles that no longer have unprocessed region
+     *         files will be saved once all earlier chunks are drawn, and the
+     *         region will be recorded in the next checkpoint.
+     * 
+     * @param regionFile  A region file that will not provide any more chunks.
+     */
+    public void finishRegion(File regionFile)
+    {
+        Validate.notNull(regionFile, "Region file cannot be null.");
+        if (tileTracker != null || checkpoint != null)
+        {
+            taskQueue.add(new MapTask(null, regionFile));
+        }
     }
 
     @Override
@@ -66,30 +131,99 @@ public class MapperThread extends Thread
         final String FN_NAME = "run";
         LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
                 "Starting MapperThread with ID {0}.", getId());
-        while (! shouldExit.get() || ! chunkQueue.isEmpty())
+        while (! shouldExit.get() || ! taskQueue.isEmpty())
         {
-            ChunkData chunk = null;
+            MapTask task = null;
             try
             {
-                chunk = chunkQueue.poll(TIMEOUT, TimeUnit.SECONDS);
+                task = taskQueue.poll(TIMEOUT, TimeUnit.SECONDS);
             }
             catch (InterruptedException e)
             {
                 // If interrupted, just continue on to check shouldExit
                 // again and go back to waiting.
             }
-            if (chunk != null)
+            if (task == null)
+            {
+                continue;
+            }
+            if (task.chunk != null)
             {
-                mapCollector.drawChunk(chunk);
+                mapCollector.drawChunk(task.chunk);
+            }
+            else if (task.finishedRegion != null)
+            {
+                regionFinished(task.finishedRegion);
             }
         }
         LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
                 "Stopping MapperThread with ID {0}.", getId());
     }
-    // Threadsafe data queue that allows waiting for new items:
-    private final BlockingQueue<ChunkData> chunkQueue;
+    /**
+     *  Saves finished tiles and updates the checkpoint after all chunks in
+     *         a region file have been drawn.
+     * 
+     * @param regionFile  The finished region file.
+     */
+    private void regionFinished(File regionFile)
+    {
+        final String FN_NAME = "regionFinished";
+        if (tileTracker != null)
+        {
+            List<Point> finishedTiles = tileTracker.regionFinished(regionFile);
+            if (! finishedTiles.isEmpty())
+            {
+                LogConfig.getLogger().logp(Level.FINEST, CLASSNAME, FN_NAME,
+                        "Finished {0} tile(s) after region {1}.",
+                        new Object[] { finishedTiles.size(),
+                        regionFile.getName() });
+                mapCollector.finishTiles(finishedTiles);
+            }
+        }
+        if (checkpoint != null)
+        {
+            checkpoint.addCompletedRegion(regionFile);
+            final long now = System.currentTimeMillis();
+            if ((now - lastCheckpointTime) >= checkpointInterval)
+            {
+                try
+                {
+                    checkpoint.save(mapCollector);
+                }
+                catch (IOException e)
+                {
+                    LogConfig.getLogger().logp(Level.WARNING, CLASSNAME,
+                            FN_NAME, "Failed to save checkpoint:", e);
+                }
+                lastCheckpointTime = now;
+            }
+        }
+    }
+    
+    // A single chunk to draw, or a region file that has been fully read:
+    private class MapTask
+    {
+        protected MapTask(ChunkData chunk, File finishedRegion)
+        {
+            this.chunk = chunk;
+            this.finishedRegion = finishedRegion;
+        }
+        protected final ChunkData chunk;
+        protected final File finishedRegion;
+    }
+    
+    // Threadsafe task queue that allows waiting for new items:
+    private final BlockingQueue<MapTask> taskQueue;
     // Atomically track whether the thread should exit:
     private final AtomicBoolean shouldExit;
     // Holds all map data:
     private final MapCollector mapCollector;  
+    // Optionally tracks when map tiles are ready to save:
+    private final TileTracker tileTracker;
+    // Optional saved map generation progress:
+    private final MapCheckpoint checkpoint;
+    // Minimum milliseconds between checkpoint saves:
+    private final long checkpointInterval;
+    // Last time the checkpoint was saved:
+    private long lastCheckpointTime;
 }
@@ -33,7 +33,7 @@ public class ReaderFileQueue
      */
     public synchronized File getNextFile()
     {
-        return mapFiles.pollLast();
+        return mapFiles.pollFirst();
     }
     
     /**
@@ -65,6 +65,7 @@ public class ReaderThread extends Thread
             catch (FileNotFoundException e)
             {
                 LogConfig.getLogger().warning(e.toString());
+                regionMapper.finishRegion(file);
                 continue;
             }
             ArrayList<ChunkData> regionChunks = regionFile.getLoadedChunks();
@@ -77,6 +78,7 @@ public class ReaderThread extends Thread
                     chunkCount++;
                 }
             }
+            regionMapper.finishRegion(file);
             threadProgress.addToCounts(1, chunkCount);
         }
         LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
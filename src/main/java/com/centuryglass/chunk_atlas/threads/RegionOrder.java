@@ -0,0 +1,234 @@
+/**
+ * @file RegionOrder.java
+ *
+ * Defines the order in which region files are scanned when creating maps.
+ */
+package com.centuryglass.chunk_atlas.threads;
+
+import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.mapping.TileMap;
+import com.centuryglass.chunk_atlas.savedata.MCAFile;
+import com.centuryglass.chunk_atlas.savedata.RegionHeader;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import java.awt.Point;
+import java.io.File;
+import java.io.IOException;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.logging.Level;
+import org.apache.commons.lang.Validate;
+
+/**
+ * RegionOrder values select a policy for ordering region files before they
+ * are scanned.
+ *
+ *  Region files are always grouped by the map tile holding their upper left
+ * chunk, so every region within a tile is read one after another and each
+ * tile is finished as early as possible. RECENT and CHUNK_COUNT read each
+ * region file's header to rank tiles, so the most important tiles are
+ * finished, saved, and optionally uploaded first.
+ *
+ *  ZORDER visits tiles along a Morton curve. Reader threads claim region files
+ * from the front of a shared queue, so they always work within a compact block
+ * of nearby tiles instead of sweeping across entire tile rows. Tiles and their
+ * neighbors stay in memory until they're finished, so far fewer tiles need to
+ * be evicted and reloaded than with POSITION ordering.
+ */
+public enum RegionOrder
+{
+    /**
+     * Scan tiles in row order by position.
+     */
+    POSITION,
+    /**
+     * Scan tiles holding the most recently updated chunks first.
+     */
+    RECENT,
+    /**
+     * Scan tiles holding the most saved chunks first.
+     */
+    CHUNK_COUNT,
+    /**
+     * Scan tiles in Z-order, keeping nearby tiles together.
+     */
+    ZORDER;
+
+    private static final String CLASSNAME = RegionOrder.class.getName();
+
+    /**
+     * Finds a RegionOrder from its name, ignoring case.
+     *
+     * @param name  A RegionOrder name.
+     *
+     * @return      The matching RegionOrder, or null if no match exists.
+     */
+    public static RegionOrder fromString(String name)
+    {
+        if (name == null)
+        {
+            return null;
+        }
+        for (RegionOrder order : values())
+        {
+            if (order.name().equalsIgnoreCase(name.trim()))
+            {
+                return order;
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Sorts a list of region files using this ordering policy.
+     *
+     * @param regionFiles  The list of region files to sort.
+     *
+     * @param tileSize     The width and height in chunks of each map tile.
+     */
+    public void sort(List<File> regionFiles, int tileSize)
+    {
+        final String FN_NAME = "sort";
+        Validate.notNull(regionFiles, "Region files cannot be null.");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        // Find each region file's tile, and each tile's priority:
+        final Map<File, Point> regionTiles = new HashMap<>();
+        final Map<Point, Long> tilePriority = new HashMap<>();
+        for (File regionFile : regionFiles)
+        {
+            Point tilePt = getTilePoint(regionFile, tileSize);
+            regionTiles.put(regionFile, tilePt);
+            if (this == POSITION || this == ZORDER)
+            {
+                continue;
+            }
+            long priority = 0;
+            try
+            {
+                RegionHeader header = new RegionHeader(regionFile);
+                priority = (this == RECENT) ? header.getLatestUpdate()
+                        : header.getChunkCount();
+            }
+            catch (IOException | IllegalArgumentException e)
+            {
+                LogConfig.getLogger().logp(Level.FINE, CLASSNAME, FN_NAME,
+                        "Couldn't read header of {0}: {1}",
+                        new Object[] { regionFile, e });
+            }
+            Long tileValue = tilePriority.get(tilePt);
+            if (this == RECENT)
+            {
+                priority = Math.max(priority, (tileValue == null) ? 0
+                        : tileValue);
+            }
+            else if (tileValue != null)
+            {
+                priority += tileValue;
+            }
+            tilePriority.put(tilePt, priority);
+        }
+        Comparator<Point> positionOrder = (first, second) ->
+        {
+            if (first.y == second.y)
+            {
+                return Integer.compare(first.x, second.x);
+            }
+            return Integer.compare(first.y, second.y);
+        };
+        Comparator<Point> tileOrder = positionOrder;
+        if (this == ZORDER)
+        {
+            tileOrder = (first, second) -> Long.compareUnsigned(
+                    getMortonCode(first, tileSize),
+                    getMortonCode(second, tileSize));
+        }
+        else if (this != POSITION)
+        {
+            Comparator<Point> priorityOrder = (first, second) ->
+                    Long.compare(tilePriority.get(second),
+                    tilePriority.get(first));
+            tileOrder = priorityOrder.thenComparing(positionOrder);
+        }
+        final Comparator<Point> finalTileOrder = tileOrder;
+        Collections.sort(regionFiles, (first, second) ->
+        {
+            int tileComparison = finalTileOrder.compare(
+                    regionTiles.get(first), regionTiles.get(second));
+            if (tileComparison != 0)
+            {
+                return tileComparison;
+            }
+            return first.getName().compareTo(second.getName());
+        });
+    }
+
+    /**
+     * Gets the coordinates of the tile that holds a region file's upper left
+     * chunk.
+     *
+     * @param regionFile  A Minecraft region file.
+     *
+     * @param tileSize    The width and height in chunks of each map tile.
+     *
+     * @return            The tile's upper left chunk coordinate. Files without
+     *                    valid region coordinates are placed at the origin.
+     */
+    private static Point getTilePoint(File regionFile, int tileSize)
+    {
+        Point chunkPt;
+        try
+        {
+            chunkPt = MCAFile.getChunkCoords(regionFile);
+        }
+        catch (NumberFormatException e)
+        {
+            chunkPt = null;
+        }
+        if (chunkPt == null)
+        {
+            return new Point(0, 0);
+        }
+        return TileMap.getTilePoint(chunkPt.x, chunkPt.y, tileSize);
+    }
+
+    /**
+     * Gets a tile's position along a Morton curve covering all possible tile
+     * coordinates.
+     *
+     * @param tilePt    The tile's upper left chunk coordinate.
+     *
+     * @param tileSize  The width and height in chunks of each map tile.
+     *
+     * @return          The tile's Morton code. Codes should be compared as
+     *                  unsigned values.
+     */
+    private static long getMortonCode(Point tilePt, int tileSize)
+    {
+        // Offset signed tile indices so negative coordinates sort first:
+        long x = (Math.floorDiv(tilePt.x, tileSize) ^ Integer.MIN_VALUE)
+                & 0xffffffffL;
+        long z = (Math.floorDiv(tilePt.y, tileSize) ^ Integer.MIN_VALUE)
+                & 0xffffffffL;
+        return spreadBits(x) | (spreadBits(z) << 1);
+    }
+
+    /**
+     * Spaces out the lower 32 bits of a value so that each bit is followed by
+     * an empty bit.
+     *
+     * @param value  A value holding at most 32 bits.
+     *
+     * @return       The value's bits, moved to the even bit positions.
+     */
+    private static long spreadBits(long value)
+    {
+        value = (value | (value << 16)) & 0x0000ffff0000ffffL;
+        value = (value | (value << 8)) & 0x00ff00ff00ff00ffL;
+        value = (value | (value << 4)) & 0x0f0f0f0f0f0f0f0fL;
+        value = (value | (value << 2)) & 0x3333333333333333L;
+        value = (value | (value << 1)) & 0x5555555555555555L;
+        return value;
+    }
+}
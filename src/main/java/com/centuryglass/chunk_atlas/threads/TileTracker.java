@@ -0,0 +1,159 @@
+/**
+ * @file TileTracker.java
+ *
+ * Tracks which map tiles still have unprocessed region files.
+ */
+package com.centuryglass.chunk_atlas.threads;
+
+import com.centuryglass.chunk_atlas.mapping.TileMap;
+import com.centuryglass.chunk_atlas.savedata.MCAFile;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.MapUnit;
+import java.awt.Point;
+import java.io.File;
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import org.apache.commons.lang.Validate;
+
+/**
+ * TileTracker counts the number of region files that still need to be read
+ * for each map tile. Once every region file overlapping a tile has been
+ * processed, that tile will not change again, so it can be saved and shared
+ * without waiting for the rest of the map to finish.
+ */
+public class TileTracker
+{
+    /**
+     * Counts the region files overlapping each tile on construction.
+     *
+     * @param regionFiles  All region files that will be mapped.
+     *
+     * @param tileSize     The width and height in chunks of each map tile.
+     */
+    public TileTracker(Collection<File> regionFiles, int tileSize)
+    {
+        Validate.notNull(regionFiles, "Region files cannot be null.");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        this.tileSize = tileSize;
+        remainingRegions = new HashMap<>();
+        for (File regionFile : regionFiles)
+        {
+            for (Point tilePt : getRegionTiles(regionFile, tileSize))
+            {
+                Integer count = remainingRegions.get(tilePt);
+                remainingRegions.put(tilePt, (count == null) ? 1 : count + 1);
+            }
+        }
+        allTiles = new HashSet<>(remainingRegions.keySet());
+    }
+
+    /**
+     * Gets every tile overlapping any of the tracked region files.
+     *
+     * @return  A new set holding the upper left chunk coordinates of all
+     *          tracked tiles, finished or not.
+     */
+    public Set<Point> getTilePoints()
+    {
+        return new HashSet<>(allTiles);
+    }
+
+    /**
+     * Marks a region file as processed.
+     *
+     * @param regionFile  A region file that will not provide any more chunk
+     *                    data.
+     *
+     * @return            The coordinates of all tiles that no longer have any
+     *                    unprocessed region files.
+     */
+    public synchronized List<Point> regionFinished(File regionFile)
+    {
+        Validate.notNull(regionFile, "Region file cannot be null.");
+        List<Point> finishedTiles = new ArrayList<>();
+        for (Point tilePt : getRegionTiles(regionFile, tileSize))
+        {
+            Integer count = remainingRegions.get(tilePt);
+            if (count == null)
+            {
+                continue;
+            }
+            if (count <= 1)
+            {
+                remainingRegions.remove(tilePt);
+                finishedTiles.add(tilePt);
+            }
+            else
+            {
+                remainingRegions.put(tilePt, count - 1);
+            }
+        }
+        return finishedTiles;
+    }
+
+    /**
+     * Gets the number of tiles that still have unprocessed region files.
+     *
+     * @return  The number of unfinished tiles.
+     */
+    public synchronized int getRemainingTileCount()
+    {
+        return remainingRegions.size();
+    }
+
+    /**
+     * Gets the coordinates of every tile that overlaps a region file.
+     *
+     * @param regionFile  A Minecraft region file.
+     *
+     * @param tileSize    The width and height in chunks of each map tile.
+     *
+     * @return            The upper left chunk coordinates of each tile the
+     *                    region overlaps, or an empty list if the region
+     *                    file's coordinates are invalid.
+     */
+    public static List<Point> getRegionTiles(File regionFile, int tileSize)
+    {
+        Validate.notNull(regionFile, "Region file cannot be null.");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        List<Point> tiles = new ArrayList<>();
+        Point regionPt;
+        try
+        {
+            regionPt = MCAFile.getChunkCoords(regionFile);
+        }
+        catch (NumberFormatException e)
+        {
+            regionPt = null;
+        }
+        if (regionPt == null)
+        {
+            return tiles;
+        }
+        final int regionSize = MapUnit.convert(1, MapUnit.REGION,
+                MapUnit.CHUNK);
+        Point firstTile = TileMap.getTilePoint(regionPt.x, regionPt.y,
+                tileSize);
+        for (int z = firstTile.y; z < regionPt.y + regionSize; z += tileSize)
+        {
+            for (int x = firstTile.x; x < regionPt.x + regionSize;
+                    x += tileSize)
+            {
+                tiles.add(new Point(x, z));
+            }
+        }
+        return tiles;
+    }
+
+    // The width and height in chunks of each map tile:
+    private final int tileSize;
+    // Number of unprocessed region files for each unfinished tile:
+    private final Map<Point, Integer> remainingRegions;
+    // All tiles overlapping tracked region files:
+    private final Set<Point> allTiles;
+}
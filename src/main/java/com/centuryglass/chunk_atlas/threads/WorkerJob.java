@@ -0,0 +1,481 @@
+/**
+ * @file WorkerJob.java
+ *
+ * Describes a set of region files to be mapped by a worker process.
+ */
+package com.centuryglass.chunk_atlas.threads;
+
+import com.centuryglass.chunk_atlas.mapping.TileMap;
+import com.centuryglass.chunk_atlas.mapping.maptype.MapType;
+import com.centuryglass.chunk_atlas.savedata.MCAFile;
+import com.centuryglass.chunk_atlas.util.ExtendedValidate;
+import com.centuryglass.chunk_atlas.util.MapUnit;
+import java.awt.Point;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeSet;
+import javax.json.Json;
+import javax.json.JsonArray;
+import javax.json.JsonArrayBuilder;
+import javax.json.JsonException;
+import javax.json.JsonObject;
+import javax.json.JsonReader;
+import javax.json.JsonWriter;
+import org.apache.commons.lang.Validate;
+
+/**
+ * WorkerJob holds everything a worker process needs to map one shard of a
+ * Minecraft region: the region files to read, and all settings used to draw
+ * their map tiles.
+ *
+ *  Shards are divided along blocks that are aligned to both region and tile
+ * boundaries, so no two jobs ever draw to the same tile image and workers can
+ * save tiles directly to the shared map output directory.
+ */
+public class WorkerJob
+{
+    /**
+     * Sets all job properties on construction.
+     *
+     * @param name            A name for the job, unique within its job
+     *                        directory.
+     *
+     * @param regionName      The name of the mapped region.
+     *
+     * @param outDir          The region-specific directory where map tiles
+     *                        are saved.
+     *
+     * @param regionFiles     The region files this job maps.
+     *
+     * @param tileSize        The width and height in chunks of each map tile.
+     *
+     * @param altSizes        Alternate scaled tile sizes to create.
+     *
+     * @param pixelsPerChunk  The width and height in pixels of each chunk.
+     *
+     * @param mapTypes        The set of map types to create.
+     *
+     * @param startTime       The time map generation started, in milliseconds
+     *                        since the epoch.
+     *
+     * @param readerThreads   The number of region reader threads the worker
+     *                        should use.
+     *
+     * @param dataTiles       Whether chunk values used by data tiles should be
+     *                        included in the job's result.
+     */
+    public WorkerJob(String name, String regionName, File outDir,
+            List<File> regionFiles, int tileSize, int[] altSizes,
+            int pixelsPerChunk, Set<MapType> mapTypes, long startTime,
+            int readerThreads, boolean dataTiles)
+    {
+        ExtendedValidate.notNullOrEmpty(name, "Job name");
+        ExtendedValidate.notNullOrEmpty(regionName, "Region name");
+        ExtendedValidate.couldBeDirectory(outDir, "Tile output directory");
+        Validate.notNull(regionFiles, "Region files cannot be null.");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        ExtendedValidate.isPositive(pixelsPerChunk, "Pixels per chunk");
+        Validate.notNull(mapTypes, "Map types cannot be null.");
+        ExtendedValidate.isPositive(readerThreads, "Reader thread count");
+        this.name = name;
+        this.regionName = regionName;
+        this.outDir = outDir;
+        this.regionFiles = Collections.unmodifiableList(
+                new ArrayList<>(regionFiles));
+        this.tileSize = tileSize;
+        this.altSizes = (altSizes == null) ? new int[0]
+                : Arrays.copyOf(altSizes, altSizes.length);
+        this.pixelsPerChunk = pixelsPerChunk;
+        this.mapTypes = Collections.unmodifiableSet(new TreeSet<>(mapTypes));
+        this.startTime = startTime;
+        this.readerThreads = readerThreads;
+        this.dataTiles = dataTiles;
+    }
+
+    /**
+     * Loads a job from a JSON file.
+     *
+     * @param jobFile       A file created with WorkerJob.save.
+     *
+     * @return              The loaded job.
+     *
+     * @throws IOException  If the file could not be read, or does not hold a
+     *                      valid job.
+     */
+    public static WorkerJob load(File jobFile) throws IOException
+    {
+        ExtendedValidate.isFile(jobFile, "Job file");
+        JsonObject json;
+        try (JsonReader reader = Json.createReader(
+                new FileInputStream(jobFile)))
+        {
+            json = reader.readObject();
+        }
+        catch (JsonException e)
+        {
+            throw new IOException("Invalid job file '" + jobFile + "'", e);
+        }
+        try
+        {
+            List<File> regionFiles = new ArrayList<>();
+            JsonArray fileArray = json.getJsonArray(JsonKeys.REGION_FILES);
+            for (int i = 0; i < fileArray.size(); i++)
+            {
+                regionFiles.add(new File(fileArray.getString(i)));
+            }
+            JsonArray sizeArray = json.getJsonArray(JsonKeys.ALT_SIZES);
+            int[] altSizes = new int[sizeArray.size()];
+            for (int i = 0; i < altSizes.length; i++)
+            {
+                altSizes[i] = sizeArray.getInt(i);
+            }
+            Set<MapType> mapTypes = new TreeSet<>();
+            JsonArray typeArray = json.getJsonArray(JsonKeys.MAP_TYPES);
+            for (int i = 0; i < typeArray.size(); i++)
+            {
+                mapTypes.add(MapType.valueOf(typeArray.getString(i)));
+            }
+            WorkerJob job = new WorkerJob(json.getString(JsonKeys.NAME),
+                    json.getString(JsonKeys.REGION_NAME),
+                    new File(json.getString(JsonKeys.OUT_DIR)), regionFiles,
+                    json.getInt(JsonKeys.TILE_SIZE), altSizes,
+                    json.getInt(JsonKeys.CHUNK_PX), mapTypes,
+                    json.getJsonNumber(JsonKeys.START_TIME).longValue(),
+                    json.getInt(JsonKeys.READER_THREADS),
+                    json.getBoolean(JsonKeys.DATA_TILES, false));
+            job.attempts = json.getInt(JsonKeys.ATTEMPTS, 0);
+            return job;
+        }
+        catch (NullPointerException | ClassCastException
+                | IllegalArgumentException e)
+        {
+            throw new IOException("Invalid job file '" + jobFile + "'", e);
+        }
+    }
+
+    /**
+     * Saves the job to a JSON file.
+     *
+     * @param jobFile       The file where the job will be written.
+     *
+     * @throws IOException  If the file could not be written.
+     */
+    public void save(File jobFile) throws IOException
+    {
+        ExtendedValidate.couldBeFile(jobFile, "Job file");
+        JsonArrayBuilder fileBuilder = Json.createArrayBuilder();
+        regionFiles.forEach((file) ->
+        {
+            fileBuilder.add(file.getAbsolutePath());
+        });
+        JsonArrayBuilder sizeBuilder = Json.createArrayBuilder();
+        for (int size : altSizes)
+        {
+            sizeBuilder.add(size);
+        }
+        JsonArrayBuilder typeBuilder = Json.createArrayBuilder();
+        mapTypes.forEach((type) -> typeBuilder.add(type.name()));
+        JsonObject json = Json.createObjectBuilder()
+                .add(JsonKeys.NAME, name)
+                .add(JsonKeys.REGION_NAME, regionName)
+                .add(JsonKeys.OUT_DIR, outDir.getAbsolutePath())
+                .add(JsonKeys.REGION_FILES, fileBuilder.build())
+                .add(JsonKeys.TILE_SIZE, tileSize)
+                .add(JsonKeys.ALT_SIZES, sizeBuilder.build())
+                .add(JsonKeys.CHUNK_PX, pixelsPerChunk)
+                .add(JsonKeys.MAP_TYPES, typeBuilder.build())
+                .add(JsonKeys.START_TIME, startTime)
+                .add(JsonKeys.READER_THREADS, readerThreads)
+                .add(JsonKeys.DATA_TILES, dataTiles)
+                .add(JsonKeys.ATTEMPTS, attempts)
+                .build();
+        try (JsonWriter writer = Json.createWriter(
+                new FileOutputStream(jobFile)))
+        {
+            writer.writeObject(json);
+        }
+    }
+
+    /**
+     * Divides region files into shards that can be mapped independently.
+     * Region files are grouped into blocks aligned to both region and tile
+     * boundaries, and blocks are distributed so each shard holds a similar
+     * number of region files.
+     *
+     * @param regionFiles  All region files to divide. The relative order of
+     *                     files within each shard is preserved.
+     *
+     * @param tileSize     The width and height in chunks of each map tile.
+     *
+     * @param shardCount   The maximum number of shards to create.
+     *
+     * @return             A list of non-empty region file shards.
+     */
+    public static List<List<File>> shardRegions(List<File> regionFiles,
+            int tileSize, int shardCount)
+    {
+        Validate.notNull(regionFiles, "Region files cannot be null.");
+        ExtendedValidate.isPositive(tileSize, "Tile size");
+        ExtendedValidate.isPositive(shardCount, "Shard count");
+        final int regionSize = MapUnit.convert(1, MapUnit.REGION,
+                MapUnit.CHUNK);
+        final int blockSize = leastCommonMultiple(regionSize, tileSize);
+        // Group regions by block, keeping the first seen block order:
+        Map<Point, List<File>> blocks = new LinkedHashMap<>();
+        for (File regionFile : regionFiles)
+        {
+            Point regionPt;
+            try
+            {
+                regionPt = MCAFile.getChunkCoords(regionFile);
+            }
+            catch (NumberFormatException e)
+            {
+                regionPt = null;
+            }
+            Point blockPt = (regionPt == null) ? new Point(0, 0)
+                    : TileMap.getTilePoint(regionPt.x, regionPt.y,
+                    blockSize);
+            List<File> blockFiles = blocks.get(blockPt);
+            if (blockFiles == null)
+            {
+                blockFiles = new ArrayList<>();
+                blocks.put(blockPt, blockFiles);
+            }
+            blockFiles.add(regionFile);
+        }
+        // Assign the largest blocks first, each to the smallest shard:
+        List<List<File>> sortedBlocks = new ArrayList<>(blocks.values());
+        Collections.sort(sortedBlocks, (first, second) ->
+                Integer.compare(second.size(), first.size()));
+        List<List<File>> shards = new ArrayList<>();
+        for (int i = 0; i < Math.min(shardCount, sortedBlocks.size()); i++)
+        {
+            shards.add(new ArrayList<>());
+        }
+        for (List<File> block : sortedBlocks)
+        {
+            List<File> smallest = shards.get(0);
+            for (List<File> shard : shards)
+            {
+                if (shard.size() < smallest.size())
+                {
+                    smallest = shard;
+                }
+            }
+            smallest.addAll(block);
+        }
+        // Restore the original scan order within each shard:
+        final Map<File, Integer> fileOrder = new LinkedHashMap<>();
+        for (int i = 0; i < regionFiles.size(); i++)
+        {
+            fileOrder.put(regionFiles.get(i), i);
+        }
+        shards.forEach((shard) -> Collections.sort(shard, (first, second) ->
+                Integer.compare(fileOrder.get(first), fileOrder.get(second))));
+        return shards;
+    }
+
+    /**
+     * Gets the job's name.
+     *
+     * @return  The name used to identify the job.
+     */
+    public String getName()
+    {
+        return name;
+    }
+
+    /**
+     * Gets the name of the mapped region.
+     *
+     * @return  The region name.
+     */
+    public String getRegionName()
+    {
+        return regionName;
+    }
+
+    /**
+     * Gets the directory where map tiles are saved.
+     *
+     * @return  The region-specific tile output directory.
+     */
+    public File getOutDir()
+    {
+        return outDir;
+    }
+
+    /**
+     * Gets the region files this job maps.
+     *
+     * @return  An unmodifiable list of region files.
+     */
+    public List<File> getRegionFiles()
+    {
+        return regionFiles;
+    }
+
+    /**
+     * Gets the map tile size.
+     *
+     * @return  The width and height in chunks of each map tile.
+     */
+    public int getTileSize()
+    {
+        return tileSize;
+    }
+
+    /**
+     * Gets the alternate scaled tile sizes to create.
+     *
+     * @return  A copy of the alternate tile size array.
+     */
+    public int[] getAltSizes()
+    {
+        return Arrays.copyOf(altSizes, altSizes.length);
+    }
+
+    /**
+     * Gets the size of each mapped chunk.
+     *
+     * @return  The width and height in pixels of each chunk.
+     */
+    public int getPixelsPerChunk()
+    {
+        return pixelsPerChunk;
+    }
+
+    /**
+     * Gets all map types to create.
+     *
+     * @return  An unmodifiable set of map types.
+     */
+    public Set<MapType> getMapTypes()
+    {
+        return mapTypes;
+    }
+
+    /**
+     * Gets the time map generation started.
+     *
+     * @return  The start time, in milliseconds since the epoch.
+     */
+    public long getStartTime()
+    {
+        return startTime;
+    }
+
+    /**
+     * Gets the number of region reader threads the worker should use.
+     *
+     * @return  The reader thread count.
+     */
+    public int getReaderThreads()
+    {
+        return readerThreads;
+    }
+
+    /**
+     * Checks if the worker should collect chunk values for data tiles.
+     *
+     * @return  Whether data tile values are included in the job's result.
+     */
+    public boolean dataTilesEnabled()
+    {
+        return dataTiles;
+    }
+
+    /**
+     * Gets the number of times mapping this job has already failed.
+     *
+     * @return  The number of failed attempts.
+     */
+    public int getAttempts()
+    {
+        return attempts;
+    }
+
+    /**
+     * Records a failed attempt to map this job. The new attempt count is only
+     * shared with other processes once the job is saved again.
+     */
+    public void addAttempt()
+    {
+        attempts++;
+    }
+
+    /**
+     * Finds the least common multiple of two positive integers.
+     *
+     * @param first   The first integer.
+     *
+     * @param second  The second integer.
+     *
+     * @return        The smallest positive integer that is a multiple of both
+     *                values.
+     */
+    private static int leastCommonMultiple(int first, int second)
+    {
+        int a = first;
+        int b = second;
+        while (b != 0)
+        {
+            int remainder = a % b;
+            a = b;
+            b = remainder;
+        }
+        return (first / a) * second;
+    }
+
+    // All JSON keys used in job files:
+    private static class JsonKeys
+    {
+        public static final String NAME = "name";
+        public static final String REGION_NAME = "regionName";
+        public static final String OUT_DIR = "outDir";
+        public static final String REGION_FILES = "regionFiles";
+        public static final String TILE_SIZE = "tileSize";
+        public static final String ALT_SIZES = "altSizes";
+        public static final String CHUNK_PX = "pixelsPerChunk";
+        public static final String MAP_TYPES = "mapTypes";
+        public static final String START_TIME = "startTime";
+        public static final String READER_THREADS = "readerThreads";
+        public static final String DATA_TILES = "dataTiles";
+        public static final String ATTEMPTS = "attempts";
+    }
+
+    // Unique job name:
+    private final String name;
+    // Mapped region name:
+    private final String regionName;
+    // Region-specific tile output directory:
+    private final File outDir;
+    // Region files to map:
+    private final List<File> regionFiles;
+    // Width and height in chunks of each tile:
+    private final int tileSize;
+    // Alternate scaled tile sizes:
+    private final int[] altSizes;
+    // Width and height in pixels of each chunk:
+    private final int pixelsPerChunk;
+    // Map types to create:
+    private final Set<MapType> mapTypes;
+    // Map generation start time:
+    private final long startTime;
+    // Number of region reader threads to use:
+    private final int readerThreads;
+    // Whether chunk values used by data tiles are collected:
+    private final boolean dataTiles;
+    // Number of failed attempts to map the job:
+    private int attempts = 0;
+}
@@ -10,5 +10,10 @@
  * single MapperThread object passes the resulting data to a MapCollector
  * object, and a ProgressThread object tracks and prints out the number of
  * region files processed.
+ * 
+ *  Large maps may also be divided between separate worker processes.
+ * WorkerJob objects describe a tile-aligned shard of region files, and a
+ * JobDirectory shares those jobs and their results between processes on the
+ * same machine.
  */
 package com.centuryglass.chunk_atlas.threads;
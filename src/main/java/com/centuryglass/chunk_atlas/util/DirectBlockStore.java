@@ -0,0 +1,201 @@
+/**
+ * @file DirectBlockStore.java
+ *
+ * Stores byte data outside of the Java heap in reusable fixed-size blocks.
+ */
+package com.centuryglass.chunk_atlas.util;
+
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.Arrays;
+import org.apache.commons.lang.Validate;
+
+/**
+ * DirectBlockStore holds byte arrays of any length within direct memory,
+ * split across fixed-size blocks. Blocks are allocated in large slabs and
+ * reused once freed, so stored data never occupies the Java heap, and
+ * repeatedly storing and freeing data doesn't depend on the garbage collector
+ * to release direct memory.
+ *
+ *  Stored data is identified by the array of block indices returned when it
+ * is stored. Memory allocated for slabs is only released when the store
+ * itself is garbage collected.
+ *
+ *  DirectBlockStore is not thread-safe.
+ */
+public class DirectBlockStore
+{
+    // Number of blocks allocated within each direct memory slab:
+    private static final int BLOCKS_PER_SLAB = 256;
+
+    /**
+     * Creates an empty store on construction. No direct memory is allocated
+     * until data is stored.
+     *
+     * @param blockSize  The size in bytes of each storage block.
+     */
+    public DirectBlockStore(int blockSize)
+    {
+        ExtendedValidate.isPositive(blockSize, "Block size");
+        Validate.isTrue((long) blockSize * BLOCKS_PER_SLAB
+                <= Integer.MAX_VALUE, "Block size is too large.");
+        this.blockSize = blockSize;
+        slabs = new ArrayList<>();
+        freeBlocks = new int[BLOCKS_PER_SLAB];
+    }
+
+    /**
+     * Gets the size of each storage block.
+     *
+     * @return  The block size in bytes.
+     */
+    public int getBlockSize()
+    {
+        return blockSize;
+    }
+
+    /**
+     * Gets the number of blocks needed to hold data of a given length.
+     *
+     * @param length  A data length in bytes.
+     *
+     * @return        The number of blocks store would use for that data.
+     */
+    public int getBlockCount(int length)
+    {
+        return (length + blockSize - 1) / blockSize;
+    }
+
+    /**
+     * Gets the amount of direct memory allocated by the store.
+     *
+     * @return  The total size in bytes of all allocated slabs.
+     */
+    public long getAllocatedBytes()
+    {
+        return (long) slabs.size() * BLOCKS_PER_SLAB * blockSize;
+    }
+
+    /**
+     * Copies data into free storage blocks, allocating a new slab if needed.
+     *
+     * @param data    An array holding the data to store.
+     *
+     * @param length  The number of bytes to store, starting from the
+     *                beginning of the array.
+     *
+     * @return        The indices of the blocks holding the data, in order.
+     */
+    public int[] store(byte[] data, int length)
+    {
+        Validate.notNull(data, "Stored data cannot be null.");
+        ExtendedValidate.inInclusiveBounds(length, 0, data.length,
+                "Stored data length");
+        final int[] blocks = new int[getBlockCount(length)];
+        for (int i = 0; i < blocks.length; i++)
+        {
+            if (freeCount == 0)
+            {
+                addSlab();
+            }
+            blocks[i] = freeBlocks[--freeCount];
+            final int offset = i * blockSize;
+            ByteBuffer slab = getBlock(blocks[i]);
+            slab.put(data, offset, Math.min(blockSize, length - offset));
+        }
+        return blocks;
+    }
+
+    /**
+     * Copies stored data back into an array.
+     *
+     * @param blocks  The block indices returned when the data was stored.
+     *
+     * @param length  The stored data length in bytes.
+     *
+     * @param dest    An array at least length bytes long where the data will
+     *                be copied.
+     */
+    public void read(int[] blocks, int length, byte[] dest)
+    {
+        Validate.notNull(blocks, "Block indices cannot be null.");
+        Validate.notNull(dest, "Destination array cannot be null.");
+        Validate.isTrue(length <= dest.length && length >= 0
+                && getBlockCount(length) <= blocks.length,
+                "Invalid stored data length.");
+        for (int i = 0; i * blockSize < length; i++)
+        {
+            final int offset = i * blockSize;
+            getBlock(blocks[i]).get(dest, offset,
+                    Math.min(blockSize, length - offset));
+        }
+    }
+
+    /**
+     * Releases storage blocks so they can be reused. The blocks must not be
+     * read or freed again afterwards.
+     *
+     * @param blocks  The block indices returned when data was stored.
+     */
+    public void free(int[] blocks)
+    {
+        Validate.notNull(blocks, "Block indices cannot be null.");
+        if (freeCount + blocks.length > freeBlocks.length)
+        {
+            freeBlocks = Arrays.copyOf(freeBlocks,
+                    Math.max(freeBlocks.length * 2, freeCount + blocks.length));
+        }
+        // Free in reverse, so the same blocks are reused in the same order:
+        for (int i = blocks.length - 1; i >= 0; i--)
+        {
+            freeBlocks[freeCount++] = blocks[i];
+        }
+    }
+
+    /**
+     * Gets a slab positioned at the start of a storage block.
+     *
+     * @param block  A block index.
+     *
+     * @return       The block's slab, with its position set to the block's
+     *               offset and its limit set to the block's end.
+     */
+    private ByteBuffer getBlock(int block)
+    {
+        ByteBuffer slab = slabs.get(block / BLOCKS_PER_SLAB);
+        final int offset = (block % BLOCKS_PER_SLAB) * blockSize;
+        slab.limit(offset + blockSize);
+        slab.position(offset);
+        return slab;
+    }
+
+    /**
+     * Allocates a new direct memory slab, adding all of its blocks to the free
+     * block list.
+     */
+    private void addSlab()
+    {
+        final int firstBlock = slabs.size() * BLOCKS_PER_SLAB;
+        Validate.isTrue(firstBlock <= Integer.MAX_VALUE - BLOCKS_PER_SLAB,
+                "Block store is full.");
+        slabs.add(ByteBuffer.allocateDirect(BLOCKS_PER_SLAB * blockSize));
+        if (freeBlocks.length < freeCount + BLOCKS_PER_SLAB)
+        {
+            freeBlocks = Arrays.copyOf(freeBlocks, freeCount + BLOCKS_PER_SLAB);
+        }
+        // Add in reverse, so blocks are used in ascending order:
+        for (int i = BLOCKS_PER_SLAB - 1; i >= 0; i--)
+        {
+            freeBlocks[freeCount++] = firstBlock + i;
+        }
+    }
+
+    // Size in bytes of each block:
+    private final int blockSize;
+    // Allocated direct memory slabs, in block index order:
+    private final ArrayList<ByteBuffer> slabs;
+    // Indices of unused blocks, used from the end of the array:
+    private int[] freeBlocks;
+    // Number of valid entries in freeBlocks:
+    private int freeCount = 0;
+}
@@ -137,6 +137,20 @@ public class ExtendedValidate
                 + "found " + value + ".");
     }
     
+    /**
+     * Tests that a long integer is greater than zero.
+     * 
+     * @param value          The long integer to validate.
+     * 
+     * @param messagePrefix  The string to print before the error message if
+     *                       the value is not positive.
+     */
+    public static void isPositive(long value, String messagePrefix)
+    {
+        assert (messagePrefix != null);
+        Validate.isTrue(value > 0, messagePrefix + " should be positive,"
+                + "found " + value + ".");
+    }
         
     /**
      * Tests that an integer is greater than or equal to zero.
@@ -0,0 +1,41 @@
+/**
+ * @file FileUtil.java
+ *
+ * Defines miscellaneous shared file functions.
+ */
+package com.centuryglass.chunk_atlas.util;
+
+import java.io.File;
+import java.io.IOException;
+import java.nio.file.AtomicMoveNotSupportedException;
+import java.nio.file.Files;
+import java.nio.file.StandardCopyOption;
+
+public class FileUtil
+{
+    /**
+     * Replaces a file with a newly written temporary file, atomically if
+     * possible.
+     *
+     * @param source        The new file.
+     *
+     * @param target        The file to replace.
+     *
+     * @throws IOException  If the file could not be moved.
+     */
+    public static void replaceFile(File source, File target)
+            throws IOException
+    {
+        try
+        {
+            Files.move(source.toPath(), target.toPath(),
+                    StandardCopyOption.REPLACE_EXISTING,
+                    StandardCopyOption.ATOMIC_MOVE);
+        }
+        catch (AtomicMoveNotSupportedException e)
+        {
+            Files.move(source.toPath(), target.toPath(),
+                    StandardCopyOption.REPLACE_EXISTING);
+        }
+    }
+}
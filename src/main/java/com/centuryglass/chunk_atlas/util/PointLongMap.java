@@ -0,0 +1,322 @@
+/**
+ * @file PointLongMap.java
+ *
+ * A compact map from integer point coordinates to primitive long values.
+ */
+package com.centuryglass.chunk_atlas.util;
+
+import java.util.Arrays;
+import org.apache.commons.lang.Validate;
+
+/**
+ * PointLongMap stores long values indexed by (x, z) coordinate pairs, packing
+ * each pair into a single long key within open-addressing hash tables. Unlike
+ * a HashMap using Point keys and Long values, no objects are allocated for
+ * each entry or lookup, so millions of chunk values can be stored without
+ * burdening the garbage collector.
+ *
+ *  PointLongMap is not thread-safe.
+ */
+public class PointLongMap
+{
+    // Table size used when no expected size is given:
+    private static final int DEFAULT_CAPACITY = 64;
+    // Maximum fraction of table slots holding entries before the table
+    // expands:
+    private static final double MAX_LOAD = 0.75;
+    // Largest allowed table size:
+    private static final int MAX_CAPACITY = 1 << 30;
+
+    /**
+     * Accepts a single map entry.
+     */
+    public interface EntryConsumer
+    {
+        /**
+         * Handles a map entry.
+         *
+         * @param x      The entry's x-coordinate.
+         *
+         * @param z      The entry's z-coordinate.
+         *
+         * @param value  The value stored for that coordinate.
+         */
+        void accept(int x, int z, long value);
+    }
+
+    /**
+     * Creates an empty map with a default initial capacity.
+     */
+    public PointLongMap()
+    {
+        this(DEFAULT_CAPACITY);
+    }
+
+    /**
+     * Creates an empty map able to hold an expected number of entries without
+     * expanding.
+     *
+     * @param expectedSize  The number of entries the map is expected to hold.
+     */
+    public PointLongMap(int expectedSize)
+    {
+        ExtendedValidate.isNotNegative(expectedSize, "Expected map size");
+        int capacity = DEFAULT_CAPACITY;
+        while (capacity < MAX_CAPACITY && capacity * MAX_LOAD < expectedSize)
+        {
+            capacity <<= 1;
+        }
+        allocate(capacity);
+    }
+
+    /**
+     * Packs a coordinate pair into a single key value.
+     *
+     * @param x  An x-coordinate.
+     *
+     * @param z  A z-coordinate.
+     *
+     * @return   The x-coordinate in the upper 32 bits and the z-coordinate in
+     *           the lower 32 bits.
+     */
+    public static long pack(int x, int z)
+    {
+        return ((long) x << 32) | (z & 0xffffffffL);
+    }
+
+    /**
+     * Gets the x-coordinate from a packed key.
+     *
+     * @param key  A key created with pack.
+     *
+     * @return     The key's x-coordinate.
+     */
+    public static int unpackX(long key)
+    {
+        return (int) (key >> 32);
+    }
+
+    /**
+     * Gets the z-coordinate from a packed key.
+     *
+     * @param key  A key created with pack.
+     *
+     * @return     The key's z-coordinate.
+     */
+    public static int unpackZ(long key)
+    {
+        return (int) key;
+    }
+
+    /**
+     * Gets the number of entries in the map.
+     *
+     * @return  The number of coordinates with stored values.
+     */
+    public int size()
+    {
+        return size;
+    }
+
+    /**
+     * Checks if the map holds no entries.
+     *
+     * @return  Whether the map is empty.
+     */
+    public boolean isEmpty()
+    {
+        return size == 0;
+    }
+
+    /**
+     * Checks if a value is stored for a coordinate.
+     *
+     * @param x  The coordinate's x value.
+     *
+     * @param z  The coordinate's z value.
+     *
+     * @return   Whether the map holds a value for that coordinate.
+     */
+    public boolean containsKey(int x, int z)
+    {
+        return used[findSlot(pack(x, z))];
+    }
+
+    /**
+     * Gets the value stored for a coordinate.
+     *
+     * @param x             The coordinate's x value.
+     *
+     * @param z             The coordinate's z value.
+     *
+     * @param defaultValue  The value to return if no value is stored.
+     *
+     * @return              The stored value, or defaultValue if the map
+     *                      holds no value for the coordinate.
+     */
+    public long get(int x, int z, long defaultValue)
+    {
+        final int slot = findSlot(pack(x, z));
+        return used[slot] ? values[slot] : defaultValue;
+    }
+
+    /**
+     * Stores a value for a coordinate, replacing any previous value.
+     *
+     * @param x      The coordinate's x value.
+     *
+     * @param z      The coordinate's z value.
+     *
+     * @param value  The value to store.
+     */
+    public void put(int x, int z, long value)
+    {
+        final long key = pack(x, z);
+        int slot = findSlot(key);
+        if (! used[slot])
+        {
+            if (size + 1 > threshold)
+            {
+                Validate.isTrue(keys.length < MAX_CAPACITY,
+                        "Point map is full.");
+                allocate(keys.length << 1);
+                slot = findSlot(key);
+            }
+            used[slot] = true;
+            keys[slot] = key;
+            size++;
+        }
+        values[slot] = value;
+    }
+
+    /**
+     * Removes all entries from the map.
+     */
+    public void clear()
+    {
+        Arrays.fill(used, false);
+        size = 0;
+    }
+
+    /**
+     * Runs an action for each map entry, in no particular order. The map
+     * must not be changed while this runs.
+     *
+     * @param action  The action to run for each entry.
+     */
+    public void forEach(EntryConsumer action)
+    {
+        for (int slot = 0; slot < keys.length; slot++)
+        {
+            if (used[slot])
+            {
+                action.accept(unpackX(keys[slot]), unpackZ(keys[slot]),
+                        values[slot]);
+            }
+        }
+    }
+
+    /**
+     * Copies all stored keys.
+     *
+     * @return  A new array holding the packed coordinates of every map
+     *          entry, in no particular order.
+     */
+    public long[] keys()
+    {
+        final long[] copy = new long[size];
+        int i = 0;
+        for (int slot = 0; slot < keys.length; slot++)
+        {
+            if (used[slot])
+            {
+                copy[i++] = keys[slot];
+            }
+        }
+        return copy;
+    }
+
+    /**
+     * Copies all stored values.
+     *
+     * @return  A new array holding every value in the map, in no particular
+     *          order.
+     */
+    public long[] values()
+    {
+        final long[] copy = new long[size];
+        int i = 0;
+        for (int slot = 0; slot < keys.length; slot++)
+        {
+            if (used[slot])
+            {
+                copy[i++] = values[slot];
+            }
+        }
+        return copy;
+    }
+
+    /**
+     * Finds the table slot holding a key, or the empty slot where it would be
+     * stored.
+     *
+     * @param key  A packed coordinate key.
+     *
+     * @return     The key's slot index.
+     */
+    private int findSlot(long key)
+    {
+        final int mask = keys.length - 1;
+        // Mix all key bits into the slot index:
+        long hash = key * 0x9e3779b97f4a7c15L;
+        int slot = (int) (hash ^ (hash >>> 32)) & mask;
+        while (used[slot] && keys[slot] != key)
+        {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    /**
+     * Replaces the hash tables with tables of a new size, moving all entries
+     * into the new tables.
+     *
+     * @param capacity  The new table size, which must be a power of two.
+     */
+    private void allocate(int capacity)
+    {
+        final long[] oldKeys = keys;
+        final long[] oldValues = values;
+        final boolean[] oldUsed = used;
+        keys = new long[capacity];
+        values = new long[capacity];
+        used = new boolean[capacity];
+        threshold = (capacity == MAX_CAPACITY) ? capacity - 1
+                : (int) (capacity * MAX_LOAD);
+        if (oldKeys == null)
+        {
+            return;
+        }
+        for (int i = 0; i < oldKeys.length; i++)
+        {
+            if (oldUsed[i])
+            {
+                final int slot = findSlot(oldKeys[i]);
+                used[slot] = true;
+                keys[slot] = oldKeys[i];
+                values[slot] = oldValues[i];
+            }
+        }
+    }
+
+    // Packed coordinate keys, indexed by slot:
+    private long[] keys = null;
+    // Stored values, indexed by slot:
+    private long[] values = null;
+    // Whether each slot holds an entry:
+    private boolean[] used = null;
+    // Number of stored entries:
+    private int size = 0;
+    // Number of entries the tables may hold before expanding:
+    private int threshold;
+}
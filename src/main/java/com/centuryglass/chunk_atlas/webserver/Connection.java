@@ -260,7 +260,6 @@ public class Connection
     public int sendPng(String imagePath, Map<String, String> headerStrings,
             String connectionSubPath) throws IOException
     {
-        final String FN_NAME = "sendPng";
         Validate.notNull(imagePath, "Image path cannot be null.");
         // Locate the file, copying resources to temp storage if needed:
         final File savedFile = new File(imagePath);
@@ -294,6 +293,32 @@ public class Connection
             bytesRead += lastRead;
         }
         byte[] imageData = Arrays.copyOfRange(imageBuffer, 0, bytesRead);
+        return sendPngData(imageData, headerStrings, connectionSubPath);
+    }
+    
+    /**
+     * Sends PNG image data through the connection.
+     * 
+     * @param imageData          The encoded PNG image.
+     * 
+     * @param headerStrings      An optional set of key/value pairs to add to
+     *                           the request's header.
+     * 
+     * @param connectionSubPath  An optional subdirectory under the main
+     *                           connection path where the request should be
+     *                           sent.
+     * 
+     * @return                   The response status code received over the
+     *                           connection, or -1 if no response was received.
+     *
+     * @throws IOException       If unable to load the connection's keys.
+     */
+    public int sendPngData(byte[] imageData,
+            Map<String, String> headerStrings, String connectionSubPath)
+            throws IOException
+    {
+        final String FN_NAME = "sendPngData";
+        Validate.notNull(imageData, "Image data cannot be null.");
         
         // Response code container, editable within lambdas:
         class MutableInt
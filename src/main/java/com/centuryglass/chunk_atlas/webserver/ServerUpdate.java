@@ -7,6 +7,8 @@ package com.centuryglass.chunk_atlas.webserver;
 
 import com.centuryglass.chunk_atlas.MapCreator;
 import com.centuryglass.chunk_atlas.config.LogConfig;
+import com.centuryglass.chunk_atlas.mapping.TileMap;
+import com.centuryglass.chunk_atlas.mapping.images.TileArchive;
 import com.centuryglass.chunk_atlas.util.ExtendedValidate;
 import java.io.File;
 import java.io.FileInputStream;
@@ -15,7 +17,9 @@ import java.io.FileOutputStream;
 import java.io.IOException;
 import java.security.GeneralSecurityException;
 import java.util.HashMap;
+import java.util.HashSet;
 import java.util.Map;
+import java.util.Set;
 import java.util.logging.Level;
 import javax.json.Json;
 import javax.json.JsonArray;
@@ -43,8 +47,11 @@ public class ServerUpdate
         JsonObjectBuilder messageBuilder = Json.createObjectBuilder();
         messageBuilder.add(UpdateKeys.UPDATE_TIME, System.currentTimeMillis());
         messageBuilder.add(UpdateKeys.TILES, mapCreator.getMapTileList());
+        messageBuilder.add(UpdateKeys.DATA_TILES,
+                mapCreator.getDataTileList());
         messageBuilder.add(UpdateKeys.KEYS, mapCreator.getMapKeys());
         message = messageBuilder.build();
+        uploadedImages = mapCreator.getUploadedTiles();
     }
     
     /**
@@ -63,6 +70,7 @@ public class ServerUpdate
         {
             message = reader.readObject();
         }
+        uploadedImages = new HashSet<>();
     }
     
     /**
@@ -95,15 +103,34 @@ public class ServerUpdate
         LogConfig.getLogger().log(Level.INFO,
                 "Sending {0} requested images to the web server.",
                 response.size());
+        // Tile archives opened to find tiles without image files:
+        Map<File, TileArchive> archives = new HashMap<>();
         for (int i = 0; i < response.size(); i++)
         {
             String requestedImage = response.getString(i);
+            if (uploadedImages.contains(requestedImage))
+            {
+                LogConfig.getLogger().logp(Level.FINEST, CLASSNAME, FN_NAME,
+                        "Skipping '{0}', already uploaded.", requestedImage);
+                continue;
+            }
             Map<String, String> imageHeaders = new HashMap<>();
             imageHeaders.put("path", requestedImage);
             try
             {
-                webConnection.sendPng(requestedImage, imageHeaders,
-                        ServerPaths.IMAGE_UPLOAD);
+                final File imageFile = new File(requestedImage);
+                final byte[] archived = imageFile.isFile() ? null
+                        : TileMap.readArchivedTile(imageFile, archives);
+                if (archived != null)
+                {
+                    webConnection.sendPngData(archived, imageHeaders,
+                            ServerPaths.IMAGE_UPLOAD);
+                }
+                else
+                {
+                    webConnection.sendPng(requestedImage, imageHeaders,
+                            ServerPaths.IMAGE_UPLOAD);
+                }
             }
             catch (IOException e)
             {
@@ -112,6 +139,19 @@ public class ServerUpdate
                         new Object[] { requestedImage, e });
             }
         }   
+        for (TileArchive archive : archives.values())
+        {
+            try
+            {
+                archive.close();
+            }
+            catch (IOException e)
+            {
+                LogConfig.getLogger().logp(Level.WARNING, CLASSNAME, FN_NAME,
+                        "Error closing tile archive '{0}': {1}",
+                        new Object[] { archive.getFile(), e });
+            }
+        }
     }
     
     /**
@@ -145,6 +185,7 @@ public class ServerUpdate
     {
         public static final String UPDATE_TIME = "updateTime";
         public static final String TILES = "tiles";
+        public static final String DATA_TILES = "dataTiles";
         public static final String KEYS = "keys";
         public static final String REGIONS = "regions";
         public static final String TYPES = "mapTypes";
@@ -162,5 +203,7 @@ public class ServerUpdate
     
     // The initial update message sent to the server
     private final JsonObject message;
+    // Image paths already uploaded while maps were generated:
+    private final Set<String> uploadedImages;
     
 }
@@ -109,7 +109,27 @@ public class ChunkData
     {
         return (Point) chunkPos.clone();
     }
-    
+
+    /**
+     *  Gets the chunk's x-coordinate without copying its position.
+     *
+     * @return  The chunk's x map coordinate.
+     */
+    public int getXPos()
+    {
+        return chunkPos.x;
+    }
+
+    /**
+     *  Gets the chunk's z-coordinate without copying its position.
+     *
+     * @return  The chunk's z map coordinate.
+     */
+    public int getZPos()
+    {
+        return chunkPos.y;
+    }
+
     /**
      *  Gets the chunk's inhabited time.
      *
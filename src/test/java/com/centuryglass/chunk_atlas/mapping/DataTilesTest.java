@@ -0,0 +1,167 @@
+package com.centuryglass.chunk_atlas.mapping;
+
+import com.centuryglass.chunk_atlas.worldinfo.Biome;
+import com.centuryglass.chunk_atlas.worldinfo.ChunkData;
+import java.awt.Point;
+import java.awt.Rectangle;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.nio.file.Files;
+import java.util.Arrays;
+import org.junit.jupiter.api.AfterEach;
+import static org.junit.jupiter.api.Assertions.*;
+import org.junit.jupiter.api.BeforeEach;
+import org.junit.jupiter.api.Test;
+
+public class DataTilesTest
+{
+    // Data tile size used by all tests:
+    private static final int TILE_SIZE = 4;
+    // Region name used by all tests:
+    private static final String REGION = "Test";
+    private File tileDir;
+
+    @BeforeEach
+    public void setUp() throws Exception
+    {
+        tileDir = Files.createTempDirectory("DataTilesTest").toFile();
+    }
+
+    @AfterEach
+    public void tearDown()
+    {
+        deleteAll(tileDir);
+    }
+
+    /**
+     * Recursively deletes a test file or directory.
+     */
+    private static void deleteAll(File file)
+    {
+        File[] children = file.listFiles();
+        if (children != null)
+        {
+            for (File child : children)
+            {
+                deleteAll(child);
+            }
+        }
+        file.delete();
+    }
+
+    /**
+     * Creates data tiles holding chunks within three separate tiles.
+     */
+    private DataTiles createTestTiles(File outDir)
+    {
+        DataTiles dataTiles = new DataTiles(outDir, REGION, TILE_SIZE);
+        ChunkData first = new ChunkData(new Point(0, 0), 100, 2000);
+        first.addBiome(Biome.OCEAN);
+        first.addBiome(Biome.OCEAN);
+        first.addBiome(Biome.DEEP_OCEAN);
+        dataTiles.addChunk(first);
+        dataTiles.addChunk(new ChunkData(new Point(1, 0), 5, 3000));
+        dataTiles.addChunk(new ChunkData(new Point(5, 3), 0, 0));
+        dataTiles.addChunk(new ChunkData(new Point(-1, -1),
+                ChunkData.ErrorFlag.CHUNK_MISSING));
+        return dataTiles;
+    }
+
+    /**
+     * Gets the file holding a data tile.
+     */
+    private static File getTileFile(File outDir, int x, int z)
+    {
+        return new File(new File(new File(outDir, DataTiles.DIR_NAME),
+                String.valueOf(TILE_SIZE)), REGION + "." + x + "." + z
+                + DataTiles.FILE_EXTENSION);
+    }
+
+    /**
+     * Reads a data tile file's header, returning the tile's chunk count.
+     */
+    private static int readChunkCount(File tileFile, int x, int z)
+            throws Exception
+    {
+        try (DataInputStream in = new DataInputStream(
+                new FileInputStream(tileFile)))
+        {
+            assertEquals(DataTiles.MAGIC, in.readInt());
+            assertEquals(DataTiles.VERSION, in.readShort());
+            assertEquals(x, in.readInt());
+            assertEquals(z, in.readInt());
+            assertEquals(TILE_SIZE, in.readInt());
+            return in.readInt();
+        }
+    }
+
+    /**
+     * Test of save method, of class DataTiles.
+     */
+    @Test
+    public void testSave() throws Exception
+    {
+        DataTiles dataTiles = createTestTiles(tileDir);
+        assertEquals(3, dataTiles.save());
+        assertEquals(3, dataTiles.getTileFiles().size());
+        assertEquals(2, readChunkCount(getTileFile(tileDir, 0, 0), 0, 0));
+        assertEquals(1, readChunkCount(getTileFile(tileDir, 4, 0), 4, 0));
+        assertEquals(1, readChunkCount(getTileFile(tileDir, -4, -4), -4,
+                -4));
+    }
+
+    /**
+     * Test of updateSavedTiles method, of class DataTiles.
+     */
+    @Test
+    public void testUpdateSavedTiles() throws Exception
+    {
+        createTestTiles(tileDir).save();
+        DataTiles updated = new DataTiles(tileDir, REGION, TILE_SIZE);
+        updated.updateSavedTiles(Arrays.asList(new Rectangle(0, 0, 1, 1),
+                new Rectangle(4, 0, 4, 4), new Rectangle(-4, -4, 1, 1)));
+        updated.addChunk(new ChunkData(new Point(3, 3), 7, 4000));
+        assertEquals(2, updated.save());
+        // Saved chunks outside of changed areas are kept:
+        assertEquals(2, readChunkCount(getTileFile(tileDir, 0, 0), 0, 0));
+        assertFalse(getTileFile(tileDir, 4, 0).exists());
+        assertEquals(1, readChunkCount(getTileFile(tileDir, -4, -4), -4,
+                -4));
+    }
+
+    /**
+     * Test of writeState and readState methods, of class DataTiles.
+     */
+    @Test
+    public void testStateRoundTrip() throws Exception
+    {
+        DataTiles original = createTestTiles(tileDir);
+        ByteArrayOutputStream stateBytes = new ByteArrayOutputStream();
+        try (DataOutputStream out = new DataOutputStream(stateBytes))
+        {
+            original.writeState(out);
+        }
+        File copyDir = new File(tileDir, "copy");
+        DataTiles copy = new DataTiles(copyDir, REGION, TILE_SIZE);
+        try (DataInputStream in = new DataInputStream(
+                new ByteArrayInputStream(stateBytes.toByteArray())))
+        {
+            copy.readState(in);
+        }
+        original.save();
+        copy.save();
+        for (Point tilePt : new Point[] { new Point(0, 0), new Point(4, 0),
+                new Point(-4, -4) })
+        {
+            assertArrayEquals(
+                    Files.readAllBytes(getTileFile(tileDir, tilePt.x,
+                    tilePt.y).toPath()),
+                    Files.readAllBytes(getTileFile(copyDir, tilePt.x,
+                    tilePt.y).toPath()));
+        }
+    }
+}
@@ -0,0 +1,243 @@
+package com.centuryglass.chunk_atlas.mapping.images;
+
+import java.awt.image.BufferedImage;
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.util.Arrays;
+import java.util.Random;
+import javax.imageio.ImageIO;
+import static org.junit.jupiter.api.Assertions.*;
+import org.junit.jupiter.api.Test;
+
+public class PngEncoderTest
+{
+    // Size of the small images used by most tests:
+    private static final int IMAGE_SIZE = 67;
+    // Size of an RGBA image holding enough data to be compressed in parallel:
+    private static final int PARALLEL_IMAGE_SIZE = 2100;
+    // Offsets of the bit depth and color type within encoded PNG data:
+    private static final int BIT_DEPTH_OFFSET = 24;
+    private static final int COLOR_TYPE_OFFSET = 25;
+    // PNG color types:
+    private static final int COLOR_RGB = 2;
+    private static final int COLOR_INDEXED = 3;
+    private static final int COLOR_RGBA = 6;
+
+    /**
+     * Creates an ARGB test image filled with pixels chosen from a palette.
+     */
+    private static BufferedImage createImage(int size, int[] palette,
+            long seed)
+    {
+        BufferedImage image = new BufferedImage(size, size,
+                BufferedImage.TYPE_INT_ARGB);
+        Random random = new Random(seed);
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                image.setRGB(x, y, palette[random.nextInt(palette.length)]);
+            }
+        }
+        return image;
+    }
+
+    /**
+     * Creates an ARGB test image filled with random colors, using a fixed
+     * alpha value if alpha is not negative.
+     */
+    private static BufferedImage createImage(int size, int alpha, long seed)
+    {
+        BufferedImage image = new BufferedImage(size, size,
+                BufferedImage.TYPE_INT_ARGB);
+        int[] pixels = new int[size * size];
+        Random random = new Random(seed);
+        for (int i = 0; i < pixels.length; i++)
+        {
+            // Smooth gradients with noise exercise every row filter:
+            int rgb = ((i % size) * 3 << 16) | ((i / size) << 8)
+                    | random.nextInt(64);
+            int pixelAlpha = (alpha < 0) ? random.nextInt(256) : alpha;
+            pixels[i] = (pixelAlpha << 24) | (rgb & 0xffffff);
+        }
+        image.setRGB(0, 0, size, size, pixels, 0, size);
+        return image;
+    }
+
+    /**
+     * Creates a palette of opaque colors.
+     */
+    private static int[] createPalette(int colorCount)
+    {
+        int[] palette = new int[colorCount];
+        for (int i = 0; i < colorCount; i++)
+        {
+            palette[i] = 0xff000000 | (i * 0x010307 * 37);
+        }
+        return palette;
+    }
+
+    /**
+     * Encodes an image, checks that ImageIO reads back identical pixels, and
+     * returns the encoded data.
+     */
+    private static byte[] assertRoundTrip(PngEncoder encoder,
+            BufferedImage image) throws Exception
+    {
+        ByteArrayOutputStream out = new ByteArrayOutputStream();
+        encoder.encode(image, out);
+        byte[] encoded = out.toByteArray();
+        BufferedImage decoded = ImageIO.read(
+                new ByteArrayInputStream(encoded));
+        assertNotNull(decoded);
+        assertPixelsEqual(image, decoded);
+        return encoded;
+    }
+
+    /**
+     * Checks that two images hold identical pixels. Fully transparent pixels
+     * only need to match in alpha.
+     */
+    private static void assertPixelsEqual(BufferedImage expected,
+            BufferedImage actual)
+    {
+        final int width = expected.getWidth();
+        final int height = expected.getHeight();
+        assertEquals(width, actual.getWidth());
+        assertEquals(height, actual.getHeight());
+        int[] expectedPixels = expected.getRGB(0, 0, width, height, null, 0,
+                width);
+        int[] actualPixels = actual.getRGB(0, 0, width, height, null, 0,
+                width);
+        for (int i = 0; i < expectedPixels.length; i++)
+        {
+            if ((expectedPixels[i] >>> 24) == 0)
+            {
+                assertEquals(0, actualPixels[i] >>> 24,
+                        "Alpha mismatch at pixel " + i);
+            }
+            else if (expectedPixels[i] != actualPixels[i])
+            {
+                fail("Pixel " + i + " expected "
+                        + Integer.toHexString(expectedPixels[i])
+                        + " but was " + Integer.toHexString(actualPixels[i]));
+            }
+        }
+    }
+
+    /**
+     * Test of encoding opaque images with each filter, of class PngEncoder.
+     */
+    @Test
+    public void testOpaqueRGB() throws Exception
+    {
+        BufferedImage image = createImage(IMAGE_SIZE, 0xff, 1);
+        for (PngEncoder.Filter filter : PngEncoder.Filter.values())
+        {
+            byte[] encoded = assertRoundTrip(new PngEncoder(6, filter),
+                    image);
+            assertEquals(COLOR_RGB, encoded[COLOR_TYPE_OFFSET]);
+        }
+    }
+
+    /**
+     * Test of encoding images with partial transparency with each filter, of
+     * class PngEncoder.
+     */
+    @Test
+    public void testPartialAlpha() throws Exception
+    {
+        BufferedImage image = createImage(IMAGE_SIZE, -1, 2);
+        for (PngEncoder.Filter filter : PngEncoder.Filter.values())
+        {
+            byte[] encoded = assertRoundTrip(new PngEncoder(6, filter),
+                    image);
+            assertEquals(COLOR_RGBA, encoded[COLOR_TYPE_OFFSET]);
+        }
+    }
+
+    /**
+     * Test of encoding fully transparent images, of class PngEncoder.
+     */
+    @Test
+    public void testFullyTransparent() throws Exception
+    {
+        BufferedImage image = new BufferedImage(IMAGE_SIZE, IMAGE_SIZE,
+                BufferedImage.TYPE_INT_ARGB);
+        byte[] encoded = assertRoundTrip(PngEncoder.DEFAULT, image);
+        assertEquals(COLOR_INDEXED, encoded[COLOR_TYPE_OFFSET]);
+        // Transparent pixels with color data are still stored as transparent:
+        image = createImage(IMAGE_SIZE, 0, 3);
+        assertRoundTrip(new PngEncoder(9, PngEncoder.Filter.ADAPTIVE, true),
+                image);
+    }
+
+    /**
+     * Test of encoding palette-indexed images at every bit depth, of class
+     * PngEncoder.
+     */
+    @Test
+    public void testIndexed() throws Exception
+    {
+        PngEncoder encoder = new PngEncoder(6, PngEncoder.Filter.ADAPTIVE,
+                true);
+        final int[][] depthColors = { { 1, 2 }, { 2, 4 }, { 4, 16 },
+            { 8, 256 } };
+        for (int[] depth : depthColors)
+        {
+            BufferedImage image = createImage(IMAGE_SIZE,
+                    createPalette(depth[1]), depth[0]);
+            byte[] encoded = assertRoundTrip(encoder, image);
+            assertEquals(COLOR_INDEXED, encoded[COLOR_TYPE_OFFSET]);
+            assertEquals(depth[0], encoded[BIT_DEPTH_OFFSET]);
+        }
+        // Translucent and transparent palette entries:
+        int[] palette = Arrays.copyOf(createPalette(5), 7);
+        palette[5] = 0x80ff0000;
+        palette[6] = 0;
+        byte[] encoded = assertRoundTrip(encoder,
+                createImage(IMAGE_SIZE, palette, 4));
+        assertEquals(COLOR_INDEXED, encoded[COLOR_TYPE_OFFSET]);
+        assertEquals(4, encoded[BIT_DEPTH_OFFSET]);
+        // Images with too many colors are saved without a palette:
+        encoded = assertRoundTrip(encoder, createImage(IMAGE_SIZE,
+                createPalette(257), 5));
+        assertEquals(COLOR_RGB, encoded[COLOR_TYPE_OFFSET]);
+    }
+
+    /**
+     * Test of encoding an image large enough to be compressed in parallel, of
+     * class PngEncoder.
+     */
+    @Test
+    public void testParallel() throws Exception
+    {
+        BufferedImage image = createImage(PARALLEL_IMAGE_SIZE, -1, 6);
+        byte[] encoded = assertRoundTrip(PngEncoder.DEFAULT, image);
+        assertEquals(COLOR_RGBA, encoded[COLOR_TYPE_OFFSET]);
+    }
+
+    /**
+     * Test of writing an image in groups of rows, of class PngEncoder.
+     */
+    @Test
+    public void testScanlineWriter() throws Exception
+    {
+        BufferedImage image = createImage(IMAGE_SIZE, -1, 7);
+        final int rowsPerGroup = 10;
+        ByteArrayOutputStream out = new ByteArrayOutputStream();
+        PngEncoder.ScanlineWriter writer = PngEncoder.DEFAULT.startImage(out,
+                IMAGE_SIZE, IMAGE_SIZE);
+        for (int y = 0; y < IMAGE_SIZE; y += rowsPerGroup)
+        {
+            int rowCount = Math.min(rowsPerGroup, IMAGE_SIZE - y);
+            writer.writeRows(image.getRGB(0, y, IMAGE_SIZE, rowCount, null, 0,
+                    IMAGE_SIZE), rowCount);
+        }
+        writer.finish();
+        BufferedImage decoded = ImageIO.read(
+                new ByteArrayInputStream(out.toByteArray()));
+        assertNotNull(decoded);
+        assertPixelsEqual(image, decoded);
+    }
+}
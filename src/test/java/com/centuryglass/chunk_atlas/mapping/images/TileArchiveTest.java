@@ -0,0 +1,123 @@
+package com.centuryglass.chunk_atlas.mapping.images;
+
+import java.io.File;
+import java.io.RandomAccessFile;
+import org.junit.jupiter.api.AfterEach;
+import static org.junit.jupiter.api.Assertions.*;
+import org.junit.jupiter.api.BeforeEach;
+import org.junit.jupiter.api.Test;
+
+public class TileArchiveTest
+{
+    // Main tile size used by all tests:
+    private static final int TILE_SIZE = 512;
+    private File archiveFile;
+
+    @BeforeEach
+    public void setUp() throws Exception
+    {
+        archiveFile = File.createTempFile("TileArchiveTest", ".archive");
+    }
+
+    @AfterEach
+    public void tearDown()
+    {
+        archiveFile.delete();
+    }
+
+    /**
+     * Creates test tile data with a given length and fill pattern.
+     */
+    private static byte[] createData(int length, int seed)
+    {
+        byte[] data = new byte[length];
+        for (int i = 0; i < length; i++)
+        {
+            data[i] = (byte) (i * 31 + seed);
+        }
+        return data;
+    }
+
+    /**
+     * Test of write, read, and remove methods, of class TileArchive.
+     */
+    @Test
+    public void testWriteRead() throws Exception
+    {
+        final TileArchive.Entry first = new TileArchive.Entry(TILE_SIZE, 0,
+                -512, 1024);
+        final TileArchive.Entry second = new TileArchive.Entry(64, 0,
+                -512, 1024);
+        final TileArchive.Entry zoomed = new TileArchive.Entry(TILE_SIZE, 2,
+                -1, 0);
+        try (TileArchive archive = new TileArchive(archiveFile, TILE_SIZE))
+        {
+            assertTrue(archive.write(first, createData(100, 1), 100));
+            assertTrue(archive.write(second, createData(20, 2), 20));
+            assertTrue(archive.write(zoomed, createData(300, 3), 300));
+            assertFalse(archive.write(first, createData(100, 1), 100));
+            assertArrayEquals(createData(100, 1), archive.read(first));
+            assertArrayEquals(createData(20, 2), archive.read(second));
+            assertArrayEquals(createData(300, 3), archive.read(zoomed));
+            assertNull(archive.read(new TileArchive.Entry(TILE_SIZE, 1,
+                    -1, 0)));
+            // Replace in place, then append when the data outgrows its space:
+            assertTrue(archive.write(first, createData(105, 4), 105));
+            assertArrayEquals(createData(105, 4), archive.read(first));
+            assertTrue(archive.write(first, createData(400, 5), 400));
+            assertArrayEquals(createData(400, 5), archive.read(first));
+            assertTrue(archive.remove(second));
+            assertFalse(archive.remove(second));
+            assertNull(archive.read(second));
+        }
+        try (TileArchive reader = new TileArchive(archiveFile))
+        {
+            assertEquals(TILE_SIZE, reader.getTileSize());
+            assertEquals(2, reader.getEntries().size());
+            assertArrayEquals(createData(400, 5), reader.read(first));
+            assertArrayEquals(createData(300, 3), reader.read(zoomed));
+            assertFalse(reader.contains(second));
+        }
+    }
+
+    /**
+     * Test of reopening an archive that was never closed, of class
+     * TileArchive.
+     */
+    @Test
+    public void testRecoverIndex() throws Exception
+    {
+        final TileArchive.Entry first = new TileArchive.Entry(TILE_SIZE, 0,
+                0, 0);
+        final TileArchive.Entry second = new TileArchive.Entry(TILE_SIZE, 0,
+                TILE_SIZE, 0);
+        TileArchive archive = new TileArchive(archiveFile, TILE_SIZE);
+        archive.write(first, createData(50, 1), 50);
+        archive.write(second, createData(60, 2), 60);
+        archive.write(first, createData(500, 3), 500);
+        archive.remove(second);
+        // Copy the archive before its index is written:
+        File copy = File.createTempFile("TileArchiveTest", ".archive");
+        try
+        {
+            try (RandomAccessFile source = new RandomAccessFile(archiveFile,
+                    "r");
+                    RandomAccessFile dest = new RandomAccessFile(copy, "rw"))
+            {
+                source.getChannel().transferTo(0, source.length(),
+                        dest.getChannel());
+            }
+            archive.close();
+            try (TileArchive reader = new TileArchive(copy))
+            {
+                assertEquals(1, reader.getEntries().size());
+                assertArrayEquals(createData(500, 3), reader.read(first));
+                assertNull(reader.read(second));
+            }
+        }
+        finally
+        {
+            copy.delete();
+        }
+    }
+}
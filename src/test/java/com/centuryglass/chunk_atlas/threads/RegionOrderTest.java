@@ -0,0 +1,79 @@
+package com.centuryglass.chunk_atlas.threads;
+
+import java.io.File;
+import java.util.ArrayList;
+import java.util.List;
+import static org.junit.jupiter.api.Assertions.*;
+import org.junit.jupiter.api.Test;
+
+public class RegionOrderTest
+{
+    // Tile size used by all tests, matching the size of one region file:
+    private static final int TILE_SIZE = 32;
+
+    /**
+     * Creates a region file with the given region coordinates.
+     */
+    private static File createRegionFile(int x, int z)
+    {
+        return new File("r." + x + "." + z + ".mca");
+    }
+
+    /**
+     * Test of sort method using ZORDER, of class RegionOrder.
+     */
+    @Test
+    public void testZOrderSort()
+    {
+        final int[][] expected = {
+                { -1, -1 }, { 0, -1 }, { -1, 0 }, { 0, 0 }, { 1, 0 },
+                { 0, 1 }, { 1, 1 }, { 2, 0 }, { 3, 0 }, { 2, 1 }, { 3, 1 },
+                { 0, 2 }, { 1, 2 }, { 0, 3 }, { 1, 3 }, { 2, 2 } };
+        List<File> regionFiles = new ArrayList<>();
+        for (int i = expected.length - 1; i >= 0; i--)
+        {
+            regionFiles.add(createRegionFile(expected[i][0], expected[i][1]));
+        }
+        RegionOrder.ZORDER.sort(regionFiles, TILE_SIZE);
+        for (int i = 0; i < expected.length; i++)
+        {
+            assertEquals(createRegionFile(expected[i][0], expected[i][1]),
+                    regionFiles.get(i));
+        }
+    }
+
+    /**
+     * Test of sort method using ZORDER with regions sharing tiles, of class
+     * RegionOrder.
+     */
+    @Test
+    public void testZOrderGroupsTiles()
+    {
+        List<File> regionFiles = new ArrayList<>();
+        for (int z = 3; z >= 0; z--)
+        {
+            for (int x = 3; x >= 0; x--)
+            {
+                regionFiles.add(createRegionFile(x, z));
+            }
+        }
+        RegionOrder.ZORDER.sort(regionFiles, TILE_SIZE * 2);
+        // Each group of four files should fill one tile:
+        for (int i = 0; i < regionFiles.size(); i += 4)
+        {
+            final String firstName = regionFiles.get(i).getName();
+            final String[] coords = firstName.split("\\.");
+            final int tileX = Integer.parseInt(coords[1]) / 2;
+            final int tileZ = Integer.parseInt(coords[2]) / 2;
+            for (int j = i + 1; j < i + 4; j++)
+            {
+                final String[] regionCoords
+                        = regionFiles.get(j).getName().split("\\.");
+                assertEquals(tileX, Integer.parseInt(regionCoords[1]) / 2);
+                assertEquals(tileZ, Integer.parseInt(regionCoords[2]) / 2);
+            }
+        }
+        assertEquals(createRegionFile(0, 0), regionFiles.get(0));
+        assertEquals(createRegionFile(2, 2), regionFiles.get(12));
+    }
+}
@@ -0,0 +1,64 @@
+package com.centuryglass.chunk_atlas.util;
+
+import static org.junit.jupiter.api.Assertions.*;
+import org.junit.jupiter.api.Test;
+
+public class DirectBlockStoreTest
+{
+    // Block size used by all tests:
+    private static final int BLOCK_SIZE = 64;
+
+    /**
+     * Test of store and read methods, of class DirectBlockStore.
+     */
+    @Test
+    public void testStoreRead()
+    {
+        DirectBlockStore store = new DirectBlockStore(BLOCK_SIZE);
+        final int[] lengths = { 0, 1, BLOCK_SIZE - 1, BLOCK_SIZE,
+                BLOCK_SIZE * 3 + 5 };
+        for (int length : lengths)
+        {
+            byte[] data = new byte[length + 7];
+            for (int i = 0; i < data.length; i++)
+            {
+                data[i] = (byte) (i * 31 + length);
+            }
+            final int[] blocks = store.store(data, length);
+            assertEquals(store.getBlockCount(length), blocks.length);
+            byte[] copy = new byte[length];
+            store.read(blocks, length, copy);
+            for (int i = 0; i < length; i++)
+            {
+                assertEquals(data[i], copy[i]);
+            }
+        }
+    }
+
+    /**
+     * Test of free method and block reuse, of class DirectBlockStore.
+     */
+    @Test
+    public void testFreeReuse()
+    {
+        DirectBlockStore store = new DirectBlockStore(BLOCK_SIZE);
+        final byte[] data = new byte[BLOCK_SIZE * 10];
+        final int[] first = store.store(data, data.length);
+        final long allocated = store.getAllocatedBytes();
+        assertTrue(allocated >= data.length);
+        for (int i = 0; i < 1000; i++)
+        {
+            store.free(first);
+            assertArrayEquals(first, store.store(data, data.length));
+        }
+        assertEquals(allocated, store.getAllocatedBytes());
+        final int[] second = store.store(data, data.length);
+        for (int block : second)
+        {
+            for (int used : first)
+            {
+                assertNotEquals(used, block);
+            }
+        }
+    }
+}
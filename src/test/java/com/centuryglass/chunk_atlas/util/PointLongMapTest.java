@@ -0,0 +1,95 @@
+package com.centuryglass.chunk_atlas.util;
+
+import java.util.Arrays;
+import static org.junit.jupiter.api.Assertions.*;
+import org.junit.jupiter.api.Test;
+
+public class PointLongMapTest
+{
+    // Number of entries used when testing table expansion:
+    private static final int GRID_SIZE = 200;
+
+    /**
+     * Test of pack, unpackX, and unpackZ methods, of class PointLongMap.
+     */
+    @Test
+    public void testPackUnpack()
+    {
+        final int[] coords = { 0, 1, -1, 31250, -31250, Integer.MAX_VALUE,
+                Integer.MIN_VALUE };
+        for (int x : coords)
+        {
+            for (int z : coords)
+            {
+                final long key = PointLongMap.pack(x, z);
+                assertEquals(x, PointLongMap.unpackX(key));
+                assertEquals(z, PointLongMap.unpackZ(key));
+            }
+        }
+    }
+
+    /**
+     * Test of put, get, and containsKey methods, of class PointLongMap.
+     */
+    @Test
+    public void testPutGet()
+    {
+        PointLongMap map = new PointLongMap();
+        assertTrue(map.isEmpty());
+        assertEquals(-1, map.get(3, -4, -1));
+        map.put(3, -4, 12);
+        map.put(-4, 3, 34);
+        assertTrue(map.containsKey(3, -4));
+        assertFalse(map.containsKey(4, -3));
+        assertEquals(12, map.get(3, -4, -1));
+        assertEquals(34, map.get(-4, 3, -1));
+        map.put(3, -4, 56);
+        assertEquals(56, map.get(3, -4, -1));
+        assertEquals(2, map.size());
+        map.clear();
+        assertTrue(map.isEmpty());
+        assertFalse(map.containsKey(3, -4));
+    }
+
+    /**
+     * Test of table expansion and forEach, keys, and values methods, of class
+     * PointLongMap.
+     */
+    @Test
+    public void testManyEntries()
+    {
+        PointLongMap map = new PointLongMap();
+        final int offset = GRID_SIZE / 2;
+        for (int x = -offset; x < offset; x++)
+        {
+            for (int z = -offset; z < offset; z++)
+            {
+                map.put(x, z, (long) x * GRID_SIZE + z);
+            }
+        }
+        final int count = GRID_SIZE * GRID_SIZE;
+        assertEquals(count, map.size());
+        final int[] visited = { 0 };
+        map.forEach((x, z, value) ->
+        {
+            assertEquals((long) x * GRID_SIZE + z, value);
+            visited[0]++;
+        });
+        assertEquals(count, visited[0]);
+        final long[] keys = map.keys();
+        final long[] values = map.values();
+        assertEquals(count, keys.length);
+        assertEquals(count, values.length);
+        for (int i = 0; i < count; i++)
+        {
+            final int x = PointLongMap.unpackX(keys[i]);
+            final int z = PointLongMap.unpackZ(keys[i]);
+            assertEquals(map.get(x, z, -1), values[i]);
+        }
+        Arrays.sort(keys);
+        for (int i = 1; i < count; i++)
+        {
+            assertNotEquals(keys[i - 1], keys[i]);
+        }
+    }
+}